@@ -0,0 +1,36 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   ConvertBinaryLog.cpp
+ * @brief  Converts the binary log written with --async_log_binary to the
+ * usual csv log files.
+ * @author Antoni Rosinol
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kimera-vio/logging/AsyncLogWriter.h"
+
+DEFINE_string(binary_log_path,
+              "./log_records.bin",
+              "Binary log written with --async_log_binary.");
+DECLARE_string(output_path);
+
+int main(int argc, char* argv[]) {
+  // Initialize Google's flags library.
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  // Initialize Google's logging library.
+  google::InitGoogleLogging(argv[0]);
+
+  // The log files are written to --output_path.
+  VIO::AsyncLogWriter::convertBinaryLog(FLAGS_binary_log_path,
+                                        FLAGS_output_path);
+  return 0;
+}
@@ -0,0 +1,118 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   VizStreamViewer.cpp
+ * @brief  Viewer for the visualization streamed by a pipeline running with
+ * --visualizer_type=1, possibly on a headless machine (use a tcp address, or
+ * forward the unix socket with ssh -L).
+ * @author Antoni Rosinol
+ */
+
+#include <unordered_map>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include <opencv2/viz.hpp>
+
+#include "kimera-vio/utils/UtilsOpenCV.h"
+#include "kimera-vio/visualizer/VizStream.h"
+#include "kimera-vio/visualizer/VizStreamSocket.h"
+
+// Address of the pipeline: unix:<path> or tcp:<host>:<port>.
+DECLARE_string(viz_stream_address);
+DEFINE_int32(viewer_trajectory_length,
+             -1,
+             "Number of poses displayed, -1 for the whole trajectory.");
+
+namespace {
+
+// Re-renders the whole scene, the viewer is not in the pipeline's way.
+void render(const VIO::VizStreamState& state, cv::viz::Viz3d* window) {
+  CHECK_NOTNULL(window);
+  window->removeAllWidgets();
+  window->showWidget("Coordinate Widget", cv::viz::WCoordinateSystem());
+  if (!state.trajectory().empty()) {
+    std::vector<cv::Affine3d> trajectory;
+    for (const VIO::VizStreamPose& pose : state.trajectory()) {
+      trajectory.push_back(
+          VIO::UtilsOpenCV::gtsamPose3ToCvAffine3d(pose.toPose3()));
+    }
+    window->showWidget(
+        "Trajectory",
+        cv::viz::WTrajectory(trajectory, cv::viz::WTrajectory::PATH));
+    window->showWidget(
+        "Body", cv::viz::WCameraPosition(0.2), trajectory.back());
+  }
+
+  if (!state.landmarks().empty()) {
+    cv::Mat cloud(1, static_cast<int>(state.landmarks().size()), CV_32FC3);
+    int i = 0;
+    for (const auto& landmark : state.landmarks()) {
+      cloud.at<cv::Vec3f>(0, i++) = cv::Vec3f(landmark.second);
+    }
+    window->showWidget("Landmarks",
+                       cv::viz::WCloud(cloud, cv::viz::Color::white()));
+  }
+
+  if (!state.triangles().empty()) {
+    cv::viz::Mesh mesh;
+    mesh.cloud.create(1, static_cast<int>(state.vertices().size()), CV_32FC3);
+    std::unordered_map<VIO::LandmarkId, int> vertex_index;
+    int i = 0;
+    for (const auto& vertex : state.vertices()) {
+      mesh.cloud.at<cv::Vec3f>(0, i) = cv::Vec3f(vertex.second);
+      vertex_index[vertex.first] = i++;
+    }
+    std::vector<int> polygons;
+    for (const VIO::VizStreamTriangle& triangle : state.triangles()) {
+      polygons.push_back(3);
+      for (const VIO::LandmarkId& id : triangle) {
+        polygons.push_back(vertex_index.at(id));
+      }
+    }
+    mesh.polygons = cv::Mat(polygons, true).reshape(1, 1);
+    window->showWidget("Mesh", cv::viz::WMesh(mesh));
+  }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  // Initialize Google's flags library.
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  // Initialize Google's logging library.
+  google::InitGoogleLogging(argv[0]);
+
+  cv::viz::Viz3d window("Kimera-VIO stream");
+  window.setBackgroundColor(cv::viz::Color::black());
+  VIO::VizStreamClient client;
+  VIO::VizStreamState state(FLAGS_viewer_trajectory_length);
+  VIO::VizStreamMessage message;
+  while (!window.wasStopped()) {
+    if (!client.isConnected()) {
+      if (!client.connect(FLAGS_viz_stream_address)) {
+        // Wait for the pipeline to start.
+        window.spinOnce(100, true);
+        continue;
+      }
+      LOG(INFO) << "Connected to " << FLAGS_viz_stream_address;
+    }
+    bool has_new_messages = false;
+    // Apply all the messages received before rendering.
+    while (client.receive(has_new_messages ? 0 : 30, &message)) {
+      state.apply(message);
+      has_new_messages = true;
+    }
+    if (has_new_messages) render(state, &window);
+    window.spinOnce(1, true);
+  }
+  return 0;
+}
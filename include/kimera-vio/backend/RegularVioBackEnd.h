@@ -20,6 +20,10 @@
 
 #pragma once
 
+#include <set>
+#include <unordered_map>
+#include <vector>
+
 #include <gtsam/slam/StereoFactor.h>
 
 #include "kimera-vio/backend/RegularVioBackEnd-definitions.h"
@@ -48,7 +52,7 @@ class RegularVioBackEnd : public VioBackEnd {
       boost::optional<gtsam::Pose3> stereo_ransac_body_pose =
           boost::none) override;
 
- private:
+ protected:
   typedef size_t Slot;
 
   // Type of handled regularities.
@@ -61,11 +65,31 @@ class RegularVioBackEnd : public VioBackEnd {
   /// Members
   LmkIdIsSmart lmk_id_is_smart_;  // TODO GROWS UNBOUNDED, use the loop in
                                   // getMapLmkIdsTo3dPointsInTimeHorizon();
-  typedef std::map<LandmarkId, RegularityType> LmkIdToRegularityTypeMap;
-  typedef std::map<PlaneId, LmkIdToRegularityTypeMap> PlaneIdToLmkIdRegType;
+  typedef std::unordered_map<LandmarkId, RegularityType>
+      LmkIdToRegularityTypeMap;
+  typedef std::unordered_map<PlaneId, LmkIdToRegularityTypeMap>
+      PlaneIdToLmkIdRegType;
   PlaneIdToLmkIdRegType plane_id_to_lmk_id_reg_type_;
   gtsam::FactorIndices delete_slots_of_converted_smart_factors_;
 
+  // Slots in the smoother's graph of the regularity factors of a plane.
+  // Maintained across optimizations with the slots of the newly added
+  // factors, so that we never have to loop over the whole graph to find them.
+  // Entries are lazily invalidated: a slot is only trusted if the smoother
+  // still has the expected factor in it (factors are removed by deletion and
+  // by marginalization).
+  struct PlaneFactorSlots {
+    // Lmk id to the slot of its point plane factor.
+    std::unordered_map<LandmarkId, Slot> point_plane_factor_slots_;
+    // Slot of the prior on the plane, if any.
+    boost::optional<Slot> plane_prior_slot_;
+  };
+  typedef std::unordered_map<PlaneId, PlaneFactorSlots> PlaneIdToFactorSlots;
+  PlaneIdToFactorSlots plane_id_to_factor_slots_;
+  // Reverse index: planes to which each lmk is attached by a regularity.
+  typedef std::unordered_map<LandmarkId, std::set<PlaneId>> LmkIdToPlaneIds;
+  LmkIdToPlaneIds lmk_id_to_plane_ids_;
+
   // For Stereo and Projection factors.
   gtsam::SharedNoiseModel stereo_noise_;
   gtsam::SharedNoiseModel mono_noise_;
@@ -84,6 +108,29 @@ class RegularVioBackEnd : public VioBackEnd {
   std::vector<Plane> planes_;
   size_t nr_of_planes_ = 0;
 
+ protected:
+  /* ------------------------------------------------------------------------ */
+  void removeOldRegularityFactors_Slow(
+      const std::vector<Plane>& planes,
+      const std::map<PlaneId, std::vector<std::pair<Slot, LandmarkId>>>&
+          map_idx_of_point_plane_factors_to_add,
+      PlaneIdToLmkIdRegType* plane_id_to_lmk_id_to_regularity_type_map,
+      gtsam::FactorIndices* delete_slots);
+
+  /* ------------------------------------------------------------------------ */
+  // Same as removeOldRegularityFactors_Slow, but uses the persistent
+  // plane_id_to_factor_slots_ index instead of looping over the whole graph.
+  void removeOldRegularityFactors(
+      const std::vector<Plane>& planes,
+      const std::map<PlaneId, std::vector<std::pair<Slot, LandmarkId>>>&
+          map_idx_of_point_plane_factors_to_add,
+      PlaneIdToLmkIdRegType* plane_id_to_lmk_id_to_reg_type_map,
+      gtsam::FactorIndices* delete_slots);
+
+  /* ------------------------------------------------------------------------ */
+  // Records the slots of the newly added point plane factors and plane priors.
+  virtual void updateExtraStructuresSlots() override;
+
  private:
   /* ------------------------------------------------------------------------ */
   void addLandmarksToGraph(const LandmarkIds& lmks_kf,
@@ -144,13 +191,35 @@ class RegularVioBackEnd : public VioBackEnd {
           idx_of_point_plane_factors_to_add);
 
   /* ------------------------------------------------------------------------ */
-  void removeOldRegularityFactors_Slow(
-      const std::vector<Plane>& planes,
-      const std::map<PlaneId, std::vector<std::pair<Slot, LandmarkId>>>&
-          map_idx_of_point_plane_factors_to_add,
-      PlaneIdToLmkIdRegType* plane_id_to_lmk_id_to_regularity_type_map,
+  // Given the good and bad point plane factors of a plane in the graph,
+  // decides which ones to delete (if the plane would not be constrained
+  // enough, it might add a prior on the plane instead).
+  void removeOldRegularityFactorsOfPlane(
+      const gtsam::Symbol& plane_symbol,
+      const std::vector<std::pair<Slot, LandmarkId>>&
+          point_plane_factor_slots_bad,
+      const std::vector<std::pair<Slot, LandmarkId>>&
+          point_plane_factor_slots_good,
+      const std::vector<std::pair<Slot, LandmarkId>>&
+          idx_of_point_plane_factors_to_add,
+      const bool& has_plane_a_prior,
+      const bool& has_plane_a_linear_factor,
+      const Slot& plane_prior_slot,
+      LmkIdToRegularityTypeMap* lmk_id_to_regularity_type_map,
       gtsam::FactorIndices* delete_slots);
 
+  /* ------------------------------------------------------------------------ */
+  // Whether the factor at the given slot of the graph is still a point plane
+  // factor between the given lmk and plane.
+  bool isPointPlaneFactorInGraph(const gtsam::NonlinearFactorGraph& graph,
+                                 const Slot& slot,
+                                 const LandmarkId& lmk_id,
+                                 const PlaneId& plane_key) const;
+
+  /* ------------------------------------------------------------------------ */
+  // Removes a plane from the regularity factor slots indices.
+  void deletePlaneFromFactorSlots(const PlaneId& plane_key);
+
   /* ------------------------------------------------------------------------ */
   void fillDeleteSlots(
       const std::vector<std::pair<Slot, LandmarkId>>& point_plane_factor_slots,
@@ -0,0 +1,121 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   StateCovarianceEstimator.h
+ * @brief  Computes the marginal covariance of the current state (pose,
+ * velocity and imu bias) in its own thread.
+ *
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <boost/optional.hpp>
+
+#include <gtsam/inference/Key.h>
+#include <gtsam/linear/GaussianFactorGraph.h>
+#include <gtsam/nonlinear/Values.h>
+
+#include "kimera-vio/common/vio_types.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+// Marginal covariance of the state at a given keyframe.
+struct StateCovariance {
+  KIMERA_POINTER_TYPEDEFS(StateCovariance);
+  //! Keyframe at which the covariance was requested.
+  FrameId kf_id_ = 0u;
+  //! Increases with every published covariance.
+  size_t version_ = 0u;
+  //! 15x15 covariance of pose, velocity and imu bias (see
+  //! UtilsOpenCV::Covariance_bvx2xvb for the ordering).
+  gtsam::Matrix covariance_;
+};
+
+class StateCovarianceEstimator {
+ public:
+  KIMERA_POINTER_TYPEDEFS(StateCovarianceEstimator);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(StateCovarianceEstimator);
+
+  /**
+   * @param parallel_run If true, covariances are computed in a worker thread,
+   * otherwise they are computed when requested (useful for tests).
+   */
+  explicit StateCovarianceEstimator(const bool& parallel_run = true);
+  virtual ~StateCovarianceEstimator();
+
+ public:
+  /**
+   * @brief requestCovariance Queues the computation of the covariance of the
+   * pose, velocity and imu bias of keyframe kf_id. Never blocks: if the worker
+   * is busy, only the latest request is kept.
+   * @param linear_graph Snapshot of the smoother's factors linearized at
+   * values. It is not modified, and must not be modified by the caller.
+   * @param values Linearization point.
+   */
+  void requestCovariance(
+      const gtsam::GaussianFactorGraph::shared_ptr& linear_graph,
+      const gtsam::Values& values,
+      const FrameId& kf_id);
+
+  /**
+   * @brief getLatestCovariance
+   * @return The latest published covariance, or nullptr if none has been
+   * computed yet.
+   */
+  StateCovariance::ConstPtr getLatestCovariance() const;
+
+  /* ------------------------------------------------------------------------ */
+  // Stops the worker thread, pending requests are discarded.
+  void shutdown();
+
+  /* ------------------------------------------------------------------------ */
+  // Computes the 15x15 covariance of pose, velocity and imu bias of kf_id.
+  static gtsam::Matrix computeCovariance(
+      const gtsam::GaussianFactorGraph& linear_graph,
+      const gtsam::Values& values,
+      const FrameId& kf_id);
+
+ private:
+  struct CovarianceRequest {
+    gtsam::GaussianFactorGraph::shared_ptr linear_graph_;
+    gtsam::Values values_;
+    FrameId kf_id_;
+  };
+
+  void spin();
+  void processRequest(const CovarianceRequest& request);
+
+ private:
+  const bool parallel_run_;
+
+  // Latest request not yet processed.
+  boost::optional<CovarianceRequest> pending_request_;
+  // Requests replaced by a newer one before being processed.
+  size_t num_skipped_requests_ = 0u;
+  std::mutex request_mutex_;
+  std::condition_variable request_condition_;
+  std::atomic_bool shutdown_ = {false};
+
+  // Latest published covariance.
+  StateCovariance::ConstPtr latest_covariance_ = nullptr;
+  size_t version_ = 0u;
+  mutable std::mutex covariance_mutex_;
+
+  std::unique_ptr<std::thread> worker_ = {nullptr};
+};
+
+}  // namespace VIO
@@ -47,6 +47,7 @@
 #include <gtsam_unstable/nonlinear/BatchFixedLagSmoother.h>
 #include <gtsam_unstable/slam/SmartStereoProjectionPoseFactor.h>
 
+#include "kimera-vio/backend/StateCovarianceEstimator.h"
 #include "kimera-vio/backend/VioBackEnd-definitions.h"
 #include "kimera-vio/backend/VioBackEndParams.h"
 #include "kimera-vio/factors/PointPlaneFactor.h"
@@ -125,6 +126,10 @@ class VioBackEnd {
 
   /* ------------------------------------------------------------------------ */
   // Update covariance matrix using getCurrentStateCovariance()
+  // If FLAGS_async_state_covariance, the covariance is computed in another
+  // thread, and state_covariance_lkf_ is updated with the latest available
+  // one (which might be from a previous keyframe, see
+  // state_covariance_kf_id_).
   // NOT TESTED
   void computeStateCovariance();
 
@@ -272,6 +277,19 @@ class VioBackEnd {
   /* ------------------------------------------------------------------------ */
   bool deleteLmkFromFeatureTracks(const LandmarkId& lmk_id);
 
+  /* ------------------------------------------------------------------------ */
+  // Triangulates the given smart factors at the latest estimates of the poses
+  // (state_, or new_values_ for poses not optimized yet), in parallel.
+  // Only used to get the lmks in time horizon: the smoother triangulates on
+  // its own when linearizing. Note that, although this function is const,
+  // gtsam overwrites the triangulation cached inside each smart factor.
+  // Factors observed from poses that are not estimated anymore keep their
+  // previous triangulation.
+  // [out] results, optional, triangulation of each smart factor.
+  void triangulateSmartFactors(
+      const std::vector<SmartStereoFactor::shared_ptr>& smart_factors,
+      std::vector<gtsam::TriangulationResult>* results = nullptr) const;
+
  private:
   /* ------------------------------------------------------------------------ */
   bool addVisualInertialStateAndOptimize(const BackendInput& input);
@@ -347,6 +365,12 @@ class VioBackEnd {
   /* ------------------------------------------------------------------------ */
   virtual void deleteLmkFromExtraStructures(const LandmarkId& lmk_id);
 
+  /* ------------------------------------------------------------------------ */
+  // Called right after the new factors have been added to the smoother, so
+  // that derived classes can record the slots of the factors they track
+  // (use smoother_->getISAM2Result().newFactorsIndices).
+  virtual void updateExtraStructuresSlots();
+
   /* ------------------------------------------------------------------------ */
   void updateNewSmartFactorsSlots(
       const std::vector<LandmarkId>& lmk_ids_of_new_smart_factors_tmp,
@@ -493,6 +517,10 @@ class VioBackEnd {
 
   // State covariance. (initialize to zero)
   gtsam::Matrix state_covariance_lkf_ = Eigen::MatrixXd::Zero(15, 15);
+  //! Keyframe at which state_covariance_lkf_ was computed.
+  FrameId state_covariance_kf_id_ = 0u;
+  //! Computes the state covariance off the backend thread.
+  StateCovarianceEstimator::UniquePtr state_covariance_estimator_ = {nullptr};
 
   // Vision params.
   gtsam::SmartStereoProjectionParams smart_factors_params_;
@@ -527,6 +555,20 @@ class VioBackEnd {
   // TODO grows unbounded currently, but it should be limited to time horizon.
   FeatureTracks feature_tracks_;
 
+  //! Version of state_, increased every time the estimate is updated.
+  size_t state_version_ = 0u;
+  //! Triangulation of the smart factors in time horizon, shared by all
+  //! consumers of the lmks of a keyframe (mesher, visualizer...) through
+  //! getMapLmkIdsTo3dPointsInTimeHorizon. Not used by the smoother.
+  //! An entry is valid only for the same smart factor and state_ version.
+  struct SmartFactorTriangulation {
+    SmartStereoFactor::shared_ptr factor_;
+    size_t state_version_;
+    gtsam::TriangulationResult result_;
+  };
+  std::unordered_map<LandmarkId, SmartFactorTriangulation>
+      smart_factor_triangulations_;
+
   // Counters.
   //! Last keyframe id.
   int last_kf_id_;
@@ -20,6 +20,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <functional>
 #include <string>
 #include <utility>  // for move
@@ -97,6 +98,9 @@ class DataProviderModule
     vio_pipeline_callback_ = cb;
   }
 
+  //! Number of stereo frames dropped because of overload so far.
+  inline size_t getNrDroppedFrames() const { return n_dropped_frames_; }
+
  protected:
   // Spin the dataset: processes the input data and constructs a Stereo Imu
   // Synchronized Packet (stereo pair + IMU measurements), the minimum data
@@ -105,8 +109,14 @@ class DataProviderModule
   // If a stereo pair appears after another stereo pair with no IMU packets in
   // between, it will be discarded.
   // The first valid pair is used as a timing fencepost and is not published.
+  // In overload mode (max_frame_queue_depth gflag), the oldest stereo pairs
+  // are dropped while too many are waiting, and their IMU data is published
+  // with the next stereo pair.
   InputUniquePtr getInputPacket() override;
 
+  //! Whether more frames are waiting than the overload mode allows.
+  bool isOverloaded() const;
+
   //! Called when general shutdown of PipelineModule is triggered.
   void shutdownQueues() override;
 
@@ -122,8 +132,11 @@ class DataProviderModule
   ThreadsafeQueue<Frame::UniquePtr> right_frame_queue_;
   const Timestamp kNoFrameYet = 0;
   Timestamp timestamp_last_frame_;
+  std::atomic<size_t> n_dropped_frames_;
   // TODO(Toni): remove these below
   StereoMatchingParams stereo_matching_params_;
+  //! Computed with the first stereo frame and shared with all the others.
+  StereoRectification::ConstPtr stereo_rectification_;
   VioPipelineCallback vio_pipeline_callback_;
 };
 
@@ -0,0 +1,245 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   AdaptiveRansac.h
+ * @brief  RANSAC with PROSAC sampling and SPRT model verification.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <opengv/sac/SampleConsensus.hpp>
+
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+/**
+ * @brief The AdaptiveRansac class is a drop-in replacement of
+ * opengv::sac::Ransac whose run-time adapts to the inlier ratio:
+ *  - PROSAC: the correspondences of the problem are assumed to be sorted by
+ *  decreasing quality, and samples are drawn from the best ones first.
+ *  - SPRT: models are verified one correspondence at a time and discarded as
+ *  soon as they are likely to be bad, instead of checking all of them.
+ *  - The number of iterations is updated with the best inlier ratio so far.
+ * Both PROSAC and SPRT can be disabled, in which case this is plain RANSAC.
+ * Only the problem's model estimation and distances are used, so the same
+ * problem can be re-used across calls (see setUniformIndices).
+ */
+template <typename PROBLEM_T>
+class AdaptiveRansac : public opengv::sac::SampleConsensus<PROBLEM_T> {
+ public:
+  KIMERA_POINTER_TYPEDEFS(AdaptiveRansac);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(AdaptiveRansac);
+  using Base = opengv::sac::SampleConsensus<PROBLEM_T>;
+  using model_t = typename PROBLEM_T::model_t;
+
+  /**
+   * @param randomize If false, each call to computeModel draws the same
+   * samples for the same problem, as opengv does.
+   */
+  AdaptiveRansac(int max_iterations = 1000,
+                 double threshold = 1.0,
+                 double probability = 0.99,
+                 bool randomize = true)
+      : Base(max_iterations, threshold, probability),
+        randomize_(randomize),
+        rng_(randomize ? std::random_device()() : 0u) {}
+  virtual ~AdaptiveRansac() = default;
+
+  bool computeModel(int debug_verbosity_level = 0) override {
+    CHECK(this->sac_model_);
+    const std::vector<int>& indices = *this->sac_model_->getIndices();
+    const int n_corrs = static_cast<int>(indices.size());
+    const int sample_size = this->sac_model_->getSampleSize();
+    this->iterations_ = 0;
+    this->model_.clear();
+    this->inliers_.clear();
+    if (n_corrs < sample_size) return false;
+    if (!randomize_) rng_.seed(0u);
+
+    // PROSAC growth function: n is the size of the set of best
+    // correspondences we sample from, it reaches n_corrs after
+    // max_iterations_ samples at most.
+    int n = use_prosac_ ? sample_size : n_corrs;
+    double T_n = this->max_iterations_;
+    for (int i = 0; i < sample_size; i++) {
+      T_n *= static_cast<double>(n - i) / static_cast<double>(n_corrs - i);
+    }
+    int T_n_prime = 1;
+
+    // SPRT state: delta is the probability of a correspondence being
+    // consistent with a bad model, epsilon the inlier ratio.
+    double delta = sprt_delta_;
+    double epsilon = sprt_epsilon_;
+    double sprt_threshold = sprtThreshold(delta, epsilon);
+    size_t n_rejected_models = 0u;
+    double rejected_consistent_ratio = 0.0;
+
+    int best_n_inliers = 0;
+    double k = this->max_iterations_;
+    int n_skipped = 0;
+    const int max_skipped = 10 * this->max_iterations_;
+    std::vector<int> sample(sample_size);
+    std::vector<int> block;
+    std::vector<double> distances;
+    model_t model;
+    while (this->iterations_ < k && this->iterations_ < this->max_iterations_ &&
+           n_skipped < max_skipped) {
+      const int t = this->iterations_ + n_skipped + 1;
+      if (use_prosac_ && t >= T_n_prime && n < n_corrs) {
+        const double T_n_next = T_n * (n + 1) / (n + 1 - sample_size);
+        T_n_prime += static_cast<int>(std::ceil(T_n_next - T_n));
+        T_n = T_n_next;
+        n++;
+      }
+      // The newest correspondence of the set is always in the sample until
+      // the set grows again.
+      drawSample(n, use_prosac_ && T_n_prime >= t, &sample);
+      for (int& idx : sample) idx = indices[idx];
+      if (!this->sac_model_->computeModelCoefficients(sample, model)) {
+        n_skipped++;
+        continue;
+      }
+      this->iterations_++;
+
+      // Verify the model, in blocks to amortize the calls to the problem.
+      int n_inliers = 0;
+      int n_tested = 0;
+      bool rejected = false;
+      double likelihood_ratio = 1.0;
+      for (int start = 0; start < n_corrs && !rejected; start += kBlockSize) {
+        block.assign(indices.begin() + start,
+                     indices.begin() + std::min(n_corrs, start + kBlockSize));
+        this->sac_model_->getSelectedDistancesToModel(model, block, distances);
+        for (const double& distance : distances) {
+          n_tested++;
+          const bool consistent = distance < this->threshold_;
+          if (consistent) n_inliers++;
+          if (use_sprt_) {
+            likelihood_ratio *= consistent ? delta / epsilon
+                                           : (1.0 - delta) / (1.0 - epsilon);
+            if (likelihood_ratio > sprt_threshold) {
+              rejected = true;
+              break;
+            }
+          }
+        }
+      }
+
+      if (rejected) {
+        // Re-estimate delta from the bad models.
+        n_rejected_models++;
+        rejected_consistent_ratio +=
+            static_cast<double>(n_inliers) / static_cast<double>(n_tested);
+        delta = clampProbability(rejected_consistent_ratio /
+                                 static_cast<double>(n_rejected_models));
+        sprt_threshold = sprtThreshold(delta, epsilon);
+        continue;
+      }
+
+      if (n_inliers > best_n_inliers) {
+        best_n_inliers = n_inliers;
+        this->model_ = sample;
+        this->model_coefficients_ = model;
+        const double inlier_ratio =
+            static_cast<double>(n_inliers) / static_cast<double>(n_corrs);
+        epsilon = clampProbability(inlier_ratio);
+        sprt_threshold = sprtThreshold(delta, epsilon);
+        // Probability of drawing an all-inlier sample and of SPRT accepting
+        // its model.
+        double p_good = std::pow(inlier_ratio, sample_size);
+        if (use_sprt_) p_good *= 1.0 - 1.0 / sprt_threshold;
+        k = std::log(1.0 - this->probability_) /
+            std::log(1.0 - clampProbability(p_good));
+      }
+    }
+    VLOG_IF(10, debug_verbosity_level > 0)
+        << "AdaptiveRansac: #iter = " << this->iterations_
+        << " #skipped = " << n_skipped << " #rejected by SPRT = "
+        << n_rejected_models << " #best inliers = " << best_n_inliers;
+
+    if (this->model_.empty()) return false;
+    this->sac_model_->selectWithinDistance(
+        this->model_coefficients_, this->threshold_, this->inliers_);
+    return true;
+  }
+
+ public:
+  //! Draw the samples from the best correspondences first.
+  bool use_prosac_ = true;
+  //! Verify the models with a Sequential Probability Ratio Test.
+  bool use_sprt_ = true;
+  //! Initial guesses of the SPRT, updated online.
+  double sprt_delta_ = 0.05;
+  double sprt_epsilon_ = 0.5;
+  //! Time to compute a model measured in verifications of a correspondence.
+  double sprt_model_time_ = 200.0;
+
+ private:
+  // Draws sample_size distinct positions among the first n; if
+  // include_last, position n - 1 is always part of the sample.
+  void drawSample(const int& n,
+                  const bool& include_last,
+                  std::vector<int>* sample) {
+    CHECK_NOTNULL(sample);
+    const int sample_size = static_cast<int>(sample->size());
+    int n_drawn = 0;
+    int n_candidates = n;
+    if (include_last) {
+      (*sample)[n_drawn++] = n - 1;
+      n_candidates = n - 1;
+    }
+    if (n_drawn == sample_size) return;
+    std::uniform_int_distribution<int> distribution(0, n_candidates - 1);
+    while (n_drawn < sample_size) {
+      const int candidate = distribution(rng_);
+      if (std::find(sample->begin(), sample->begin() + n_drawn, candidate) ==
+          sample->begin() + n_drawn) {
+        (*sample)[n_drawn++] = candidate;
+      }
+    }
+  }
+
+  // Threshold on the likelihood ratio above which a model is rejected,
+  // approximately optimal for the given delta and epsilon (Chum & Matas).
+  double sprtThreshold(const double& delta, const double& epsilon) const {
+    if (epsilon <= delta) return std::numeric_limits<double>::infinity();
+    const double C = (1.0 - delta) * std::log((1.0 - delta) / (1.0 - epsilon)) +
+                     delta * std::log(delta / epsilon);
+    const double K = sprt_model_time_ * C + 1.0;
+    double A = K;
+    for (size_t i = 0u; i < 10u; i++) A = K + std::log(A);
+    return A;
+  }
+
+  static double clampProbability(const double& p) {
+    static constexpr double kEps = std::numeric_limits<double>::epsilon();
+    return std::min(std::max(p, kEps), 1.0 - kEps);
+  }
+
+ private:
+  static constexpr int kBlockSize = 16;
+
+  const bool randomize_;
+  std::mt19937 rng_;
+};
+
+template <typename PROBLEM_T>
+constexpr int AdaptiveRansac<PROBLEM_T>::kBlockSize;
+
+}  // namespace VIO
@@ -0,0 +1,119 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   FeatureBudgetController.h
+ * @brief  Closed-loop control of the number of features, detector threshold
+ * and KLT effort of the frontend to hold a target latency.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+struct FeatureBudgetControllerParams {
+  //! Frontend processing time per frame to hold [ms].
+  double target_latency_ms_ = 30.0;
+  //! Range of the max number of features per frame.
+  int min_features_per_frame_ = 100;
+  int max_features_per_frame_ = 400;
+  //! Range of the pyramid levels and iterations of the KLT tracker.
+  int min_klt_max_level_ = 1;
+  int max_klt_max_level_ = 4;
+  int min_klt_max_iter_ = 10;
+  int max_klt_max_iter_ = 30;
+  //! Range of the scale of the detector threshold.
+  double min_threshold_scale_ = 0.25;
+  double max_threshold_scale_ = 2.0;
+  //! Gains of the PI controller on the relative latency error.
+  double kp_ = 0.5;
+  double ki_ = 0.1;
+  //! Smoothing of the latency measurements, in (0, 1].
+  double latency_smoothing_ = 0.2;
+  //! Below this ratio of tracks surviving the outlier rejection of a
+  //! keyframe, the budget is not cut regardless of the latency.
+  double min_inlier_ratio_ = 0.5;
+  //! Keyframes waiting for the backend above which the latency target is
+  //! lowered, since fewer features also lighten the backend.
+  size_t max_backend_lag_ = 2u;
+  //! Below this ratio of detected over requested corners the scene lacks
+  //! texture and the detector threshold is lowered.
+  double min_detection_ratio_ = 0.8;
+};
+
+//! What the frontend measured while processing a frame.
+struct FeatureBudgetMeasurement {
+  //! Processing time of the frame [ms].
+  double latency_ms_ = 0.0;
+  //! Only for keyframes, the rest is ignored otherwise.
+  bool is_keyframe_ = false;
+  //! Features tracked from the previous frame.
+  size_t n_tracked_ = 0u;
+  //! Tracked features that survived the outlier rejection.
+  size_t n_inliers_ = 0u;
+  //! New corners requested to and found by the detector.
+  size_t n_requested_ = 0u;
+  size_t n_detected_ = 0u;
+  //! Keyframes sent to the backend that it has not estimated yet.
+  size_t backend_lag_ = 0u;
+};
+
+//! Parameters for the detector and tracker of the next frames.
+struct FeatureBudget {
+  int max_features_per_frame_ = 0;
+  double threshold_scale_ = 1.0;
+  int klt_max_level_ = 0;
+  int klt_max_iter_ = 0;
+};
+
+/**
+ * @brief The FeatureBudgetController sets the effort of the frontend, in
+ * [0, 1], with a PI controller on the smoothed frame latency. The number of
+ * features decreases with the effort, and the KLT pyramid levels and
+ * iterations too once the effort is below one half. Poor tracking quality sets
+ * a floor on the effort, and a lagging backend lowers the latency target.
+ * Independently, the detector threshold is lowered if the detector can not
+ * find the corners it is asked for (low texture) and raised if it can but the
+ * frontend is late.
+ */
+class FeatureBudgetController {
+ public:
+  KIMERA_POINTER_TYPEDEFS(FeatureBudgetController);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(FeatureBudgetController);
+
+  explicit FeatureBudgetController(const FeatureBudgetControllerParams& params);
+  virtual ~FeatureBudgetController() = default;
+
+  //! Updates the budget with the measurements of the last frame.
+  const FeatureBudget& update(const FeatureBudgetMeasurement& measurement);
+
+  inline const FeatureBudget& getBudget() const { return budget_; }
+  inline double getEffort() const { return effort_; }
+
+ private:
+  void updateThresholdScale(const FeatureBudgetMeasurement& measurement,
+                            const double& latency_error);
+
+ private:
+  const FeatureBudgetControllerParams params_;
+
+  FeatureBudget budget_;
+  double effort_;
+  double integral_;
+  double smoothed_latency_ms_;
+  bool has_latency_;
+  // Effort floor given by the tracking quality of the last keyframe.
+  double min_effort_;
+};
+
+}  // namespace VIO
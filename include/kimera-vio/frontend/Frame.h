@@ -20,6 +20,7 @@
 #include <cstdlib>
 #include <numeric>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <glog/logging.h>
@@ -78,6 +79,21 @@ namespace VIO {
                   versors_(frame.versors_),
                   descriptors_(frame.descriptors_) {}
 
+        // Steals the keypoint containers, the image and calibration are
+        // shallow copies anyway.
+        Frame(Frame &&frame)
+                : PipelinePayload(frame.timestamp_),
+                  id_(frame.id_),
+                  cam_param_(frame.cam_param_),
+                  img_(frame.img_),
+                  isKeyframe_(frame.isKeyframe_),
+                  keypoints_(std::move(frame.keypoints_)),
+                  scores_(std::move(frame.scores_)),
+                  landmarks_(std::move(frame.landmarks_)),
+                  landmarks_age_(std::move(frame.landmarks_age_)),
+                  versors_(std::move(frame.versors_)),
+                  descriptors_(frame.descriptors_) {}
+
     public:
         /* ------------------------------------------------------------------------ */
         size_t getNrValidKeypoints() const {
@@ -19,6 +19,7 @@ namespace VIO {
 enum class OpticalFlowPredictorType {
   kNoPrediction = 0,
   kRotational = 1,
+  kPose = 2,
 };
 
 }  // namespace VIO
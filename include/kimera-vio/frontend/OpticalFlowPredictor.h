@@ -15,8 +15,11 @@
 
 #pragma once
 
+#include <vector>
+
 #include <opencv2/opencv.hpp>
 
+#include <gtsam/geometry/Pose3.h>
 #include <gtsam/geometry/Rot3.h>
 
 #include "kimera-vio/utils/Macros.h"
@@ -44,6 +47,24 @@ class OpticalFlowPredictor {
   virtual bool predictFlow(const KeypointsCV& prev_kps,
                            const gtsam::Rot3& cam1_R_cam2,
                            KeypointsCV* next_kps) = 0;
+
+  /**
+   * @brief predictFlowWithDepth Predicts optical flow for a set of image
+   * keypoints given the full relative pose of the cameras and the depth of the
+   * keypoints. By default, only the rotation is used.
+   * @param prev_kps: keypoints in previous (reference) image
+   * @param prev_depths: depth (z) of each keypoint in camera 1, non-positive if
+   * unknown.
+   * @param cam1_P_cam2: pose of camera 2 wrt camera 1.
+   * @param next_kps: keypoints in next image.
+   * @return true if flow could be determined successfully
+   */
+  virtual bool predictFlowWithDepth(const KeypointsCV& prev_kps,
+                                    const std::vector<double>& prev_depths,
+                                    const gtsam::Pose3& cam1_P_cam2,
+                                    KeypointsCV* next_kps) {
+    return predictFlow(prev_kps, cam1_P_cam2.rotation(), next_kps);
+  }
 };
 
 /**
@@ -148,4 +169,75 @@ class RotationalOpticalFlowPredictor : public OpticalFlowPredictor {
   const cv::Rect2f img_size_;
 };
 
+/**
+ * @brief The PoseOpticalFlowPredictor class predicts optical flow using the
+ * full relative pose of the cameras (i.e. from IMU propagation) and the depth
+ * of the keypoints (i.e. from the stereo matching of the last keyframe).
+ * Unlike the rotational predictor, it also predicts the parallax due to
+ * translation, so that the tracker needs less pyramid levels and iterations
+ * for fast translational motions.
+ * Keypoints without depth are predicted using the rotation only.
+ */
+class PoseOpticalFlowPredictor : public OpticalFlowPredictor {
+ public:
+  KIMERA_POINTER_TYPEDEFS(PoseOpticalFlowPredictor);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(PoseOpticalFlowPredictor);
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  PoseOpticalFlowPredictor(const cv::Matx33f& K, const cv::Size& img_size)
+      : K_(K),
+        K_inverse_(K.inv()),
+        img_size_(0.0f, 0.0f, img_size.width, img_size.height),
+        rotational_predictor_(K, img_size) {}
+  virtual ~PoseOpticalFlowPredictor() = default;
+
+  bool predictFlow(const KeypointsCV& prev_kps,
+                   const gtsam::Rot3& cam1_R_cam2,
+                   KeypointsCV* next_kps) override {
+    return rotational_predictor_.predictFlow(prev_kps, cam1_R_cam2, next_kps);
+  }
+
+  bool predictFlowWithDepth(const KeypointsCV& prev_kps,
+                            const std::vector<double>& prev_depths,
+                            const gtsam::Pose3& cam1_P_cam2,
+                            KeypointsCV* next_kps) override {
+    CHECK_NOTNULL(next_kps);
+    CHECK_EQ(prev_kps.size(), prev_depths.size());
+
+    // Keypoints without depth keep the rotational prediction.
+    // We use a new object in case next_kps is pointing to prev_kps!
+    KeypointsCV predicted_kps;
+    CHECK(rotational_predictor_.predictFlow(
+        prev_kps, cam1_P_cam2.rotation(), &predicted_kps));
+
+    // Points in camera 1 are taken to camera 2 as: R^T * (p - t).
+    const cv::Matx33f R_transpose = UtilsOpenCV::gtsamMatrix3ToCvMat(
+        cam1_P_cam2.rotation().matrix().transpose());
+    const gtsam::Vector3& t = cam1_P_cam2.translation();
+    const cv::Vec3f t_cv(t.x(), t.y(), t.z());
+    for (size_t i = 0u; i < prev_kps.size(); ++i) {
+      const double& depth = prev_depths[i];
+      if (depth <= 0.0) continue;
+      const KeypointCV& prev_kpt = prev_kps[i];
+      // Back-project to camera 1, move to camera 2 and project again.
+      const cv::Vec3f p1 = static_cast<float>(depth) * (K_inverse_ *
+                           cv::Vec3f(prev_kpt.x, prev_kpt.y, 1.0f));
+      const cv::Vec3f p2 = K_ * (R_transpose * (p1 - t_cv));
+      if (p2[2] <= 0.0f) continue;  // Landmark behind the camera.
+      const KeypointCV new_kpt(p2[0] / p2[2], p2[1] / p2[2]);
+      // Check that keypoints remain inside the image boundaries!
+      if (img_size_.contains(new_kpt)) predicted_kps[i] = new_kpt;
+    }
+
+    *next_kps = predicted_kps;
+    return true;
+  }
+
+ private:
+  const cv::Matx33f K_;          // Intrinsic matrix of camera
+  const cv::Matx33f K_inverse_;  // Cached inverse of K
+  const cv::Rect2f img_size_;
+  //! For keypoints without depth.
+  RotationalOpticalFlowPredictor rotational_predictor_;
+};
+
 }  // namespace VIO
@@ -34,6 +34,10 @@ class OpticalFlowPredictorFactory {
         return VIO::make_unique<RotationalOpticalFlowPredictor>(
             std::forward<Args>(args)...);
       }
+      case OpticalFlowPredictorType::kPose: {
+        return VIO::make_unique<PoseOpticalFlowPredictor>(
+            std::forward<Args>(args)...);
+      }
       default: {
         LOG(FATAL) << "Unknown OpticalFlowPredictorType: "
                    << static_cast<int>(optical_flow_predictor_type);
@@ -20,6 +20,7 @@
 #include <algorithm>
 #include <iostream>
 #include <iterator>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -38,10 +39,30 @@
 #include "kimera-vio/frontend/Frame.h"
 #include "kimera-vio/frontend/StereoFrame-definitions.h"
 #include "kimera-vio/frontend/StereoMatchingParams.h"
+#include "kimera-vio/utils/Macros.h"
 #include "kimera-vio/utils/UtilsGeometry.h"
 
 namespace VIO {
 
+/**
+ * @brief The StereoRectification struct holds what the rectification of a
+ * stereo camera computes: it only depends on the calibration, so it is
+ * computed for the first stereo frame and shared, read-only, by the next ones.
+ */
+struct StereoRectification {
+  KIMERA_POINTER_TYPEDEFS(StereoRectification);
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  //! Calibrations with R_rectify_, P_ and undistort_rectify_map_* filled in.
+  CameraParams left_cam_param_;
+  CameraParams right_cam_param_;
+  gtsam::Cal3_S2 left_undistRectCameraMatrix_;
+  gtsam::Cal3_S2 right_undistRectCameraMatrix_;
+  //! Pose of the left camera wrt the body frame after rectification!
+  gtsam::Pose3 B_Pose_camLrect_;
+  double baseline_ = 0.0;
+};
+
 class StereoFrame {
  public:
   // TODO(Toni) Do it pls...
@@ -49,22 +70,27 @@ class StereoFrame {
   KIMERA_POINTER_TYPEDEFS(StereoFrame);
   // EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
+  // If rectification is given (i.e. from a previous frame of the same
+  // stereo camera), it is used instead of computing it again.
   StereoFrame(const FrameId& id,
               const Timestamp& timestamp,
               const cv::Mat& left_image,
               const CameraParams& cam_param_left,
               const cv::Mat& right_image,
               const CameraParams& cam_param_right,
-              const StereoMatchingParams& stereo_matching_params);
+              const StereoMatchingParams& stereo_matching_params,
+              const StereoRectification::ConstPtr& rectification = nullptr);
 
   StereoFrame(const FrameId& id,
               const Timestamp& timestamp,
               const Frame& left_frame,
               const Frame& right_frame,
-              const StereoMatchingParams& stereo_matching_params);
+              const StereoMatchingParams& stereo_matching_params,
+              const StereoRectification::ConstPtr& rectification = nullptr);
 
   void initialize(const CameraParams& cam_param_left,
-                  const CameraParams& cam_param_right);
+                  const CameraParams& cam_param_right,
+                  const StereoRectification::ConstPtr& rectification);
 
  public:
   struct LandmarkInfo {
@@ -113,8 +139,15 @@ class StereoFrame {
 
   /* ------------------------------------------------------------------------ */
   // Copy rectification parameters from another stereo camera.
+  // The undistortion maps and projection matrices are shared, not cloned.
   void cloneRectificationParameters(const StereoFrame& sf);
 
+  /* ------------------------------------------------------------------------ */
+  // Undistort and rectify the stereo images, if not done already. Done at
+  // construction unless FLAGS_lazy_stereo_rectification, in which case
+  // sparseStereoMatching does it (i.e. only for keyframes).
+  void undistortRectifyImages();
+
   /* ------------------------------------------------------------------------ */
   // For each keypoint in the left frame, get
   // (i) keypoint in right frame,
@@ -128,6 +161,13 @@ class StereoFrame {
   /* ------------------------------------------------------------------------ */
   LandmarkInfo getLandmarkInfo(const LandmarkId& i) const;
 
+  /* ------------------------------------------------------------------------ */
+  // Compute the rectification of the stereo camera, to be shared by frames.
+  static StereoRectification::ConstPtr computeRectification(
+      const CameraParams& cam_param_left,
+      const CameraParams& cam_param_right,
+      const StereoMatchingParams& stereo_matching_params);
+
   /* ------------------------------------------------------------------------ */
   // Compute rectification parameters.
   static void computeRectificationParameters(
@@ -215,6 +255,10 @@ class StereoFrame {
   inline gtsam::Cal3_S2 getRightUndistRectCamMat() const {
     return right_undistRectCameraMatrix_;
   }
+  //! Null if the input images were already rectified.
+  inline StereoRectification::ConstPtr getRectification() const {
+    return rectification_;
+  }
 
   // NON-THREAD SAFE.
   inline const Frame& getLeftFrame() const { return left_frame_; }
@@ -254,6 +298,8 @@ class StereoFrame {
   //! Pose of the left camera wrt the body frame after rectification!
   gtsam::Pose3 B_Pose_camLrect_;
   double baseline_;
+  //! Shared by all the frames of the same stereo camera.
+  StereoRectification::ConstPtr rectification_;
 
  private:
   /* ------------------------------------------------------------------------ */
@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <utility>
+
 #include <gtsam/base/Vector.h>
 #include <gtsam/geometry/Pose3.h>
 
@@ -86,7 +88,8 @@ class StereoImuSyncPacket : public PipelinePayload {
   KIMERA_DELETE_COPY_CONSTRUCTORS(StereoImuSyncPacket);
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
   StereoImuSyncPacket() = delete;
-  StereoImuSyncPacket(const StereoFrame& stereo_frame,
+  // The stereo frame is moved in, pass an rvalue to avoid copying it.
+  StereoImuSyncPacket(StereoFrame stereo_frame,
                       const ImuStampS& imu_stamps,
                       const ImuAccGyrS& imu_accgyr,
                       const ReinitPacket& reinit_packet = ReinitPacket());
@@ -96,6 +99,9 @@ class StereoImuSyncPacket : public PipelinePayload {
 
   // Careful, returning references to members can lead to dangling refs.
   inline const StereoFrame& getStereoFrame() const { return stereo_frame_; }
+  //! Moves the stereo frame out to its consumer, getStereoFrame must not be
+  //! used afterwards.
+  inline StereoFrame releaseStereoFrame() { return std::move(stereo_frame_); }
   inline const ImuStampS& getImuStamps() const { return imu_stamps_; }
   inline const ImuAccGyrS& getImuAccGyrs() const { return imu_accgyrs_; }
   inline const ReinitPacket& getReinitPacket() const { return reinit_packet_; }
@@ -106,7 +112,7 @@ class StereoImuSyncPacket : public PipelinePayload {
   void print() const;
 
  private:
-  const StereoFrame stereo_frame_;
+  StereoFrame stereo_frame_;
   const ImuStampS imu_stamps_;
   const ImuAccGyrS imu_accgyrs_;
   const ReinitPacket reinit_packet_;
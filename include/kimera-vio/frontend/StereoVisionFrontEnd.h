@@ -16,7 +16,12 @@
 
 #include <memory>
 #include <atomic>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
+#include <boost/optional.hpp>
 #include <boost/shared_ptr.hpp>  // used for opengv
 
 #include <opencv2/highgui/highgui_c.h>
@@ -26,6 +31,8 @@
 #include <opencv2/opencv.hpp>
 
 #include "kimera-vio/backend/VioBackEnd-definitions.h"
+#include "kimera-vio/common/VioNavState.h"
+#include "kimera-vio/frontend/FeatureBudgetController.h"
 #include "kimera-vio/frontend/StereoFrame.h"
 #include "kimera-vio/frontend/StereoImuSyncPacket.h"
 #include "kimera-vio/frontend/StereoVisionFrontEnd-definitions.h"
@@ -72,6 +79,12 @@ class StereoVisionFrontEnd {
     imu_frontend_->updateBias(imu_bias);
   }
 
+  /* ------------------------------------------------------------------------ */
+  // Update the backend estimate of the last keyframe state, used to predict
+  // the pose of the current frame for optical flow and to measure how far
+  // behind the backend is. Thread-safe.
+  void updateBackendState(const VioNavStateTimestamped& W_State_Blkf);
+
   /**
    * @brief isInitialized Returns whether the frontend is initializing.
    * Needs to be Thread-Safe! Therefore, frontend_state_ is atomic.
@@ -113,7 +126,9 @@ class StereoVisionFrontEnd {
 
   // private: // TODO: Fix access to this function. Is this thread safe???
   /* ------------------------------------------------------------------------ */
-  FrontendOutput::UniquePtr spinOnce(const StereoFrontEndInputPayload& input);
+  // Takes ownership of the input to move its stereo frame in the frontend.
+  FrontendOutput::UniquePtr spinOnce(
+      StereoFrontEndInputPayload::UniquePtr input);
 
   /* ------------------------------------------------------------------------ */
   // Get IMU Params for IMU Frontend.
@@ -130,7 +145,7 @@ class StereoVisionFrontEnd {
 
   /* ------------------------------------------------------------------------ */
   // Frontend initialization.
-  void processFirstStereoFrame(const StereoFrame& firstFrame);
+  void processFirstStereoFrame(StereoFrame firstFrame);
 
   /**
    * @brief bootstrapSpin SpinOnce used when initializing the frontend.
@@ -138,7 +153,7 @@ class StereoVisionFrontEnd {
    * @return
    */
   FrontendOutput::UniquePtr bootstrapSpin(
-      const StereoFrontEndInputPayload& input);
+      StereoFrontEndInputPayload::UniquePtr input);
 
   /**
    * @brief nominalSpin SpinOnce used when in nominal mode after initialization
@@ -147,14 +162,47 @@ class StereoVisionFrontEnd {
    * @return
    */
   FrontendOutput::UniquePtr nominalSpin(
-      const StereoFrontEndInputPayload& input);
+      StereoFrontEndInputPayload::UniquePtr input);
 
   /* ------------------------------------------------------------------------ */
   // Frontend main function.
+  // The current frame is moved in, so that it is not copied.
+  // If given, keyframe_P_cur_frame (left camera, unrectified) is used to
+  // predict the optical flow together with the depth of the landmarks.
   StatusStereoMeasurementsPtr processStereoFrame(
-      const StereoFrame& cur_frame,
+      StereoFrame cur_frame,
       const gtsam::Rot3& keyframe_R_ref_frame,
-      cv::Mat* feature_tracks = nullptr);
+      cv::Mat* feature_tracks = nullptr,
+      const boost::optional<gtsam::Pose3>& keyframe_P_cur_frame = boost::none);
+
+  /* ------------------------------------------------------------------------ */
+  // Predict the pose of the current left camera (unrectified) wrt the last
+  // keyframe's by propagating the backend estimate of the last keyframe with
+  // the IMU. None if the backend has not estimated the last keyframe yet.
+  boost::optional<gtsam::Pose3> predictKeyframePoseCurFrame(
+      const gtsam::PreintegrationType& pim,
+      const gtsam::Pose3& body_Pose_cam) const;
+
+  /* ------------------------------------------------------------------------ */
+  // Store the landmarks triangulated by stereo in the last keyframe.
+  void updateKeyframeLandmarks(const StereoFrame& stereo_keyframe);
+
+  /* ------------------------------------------------------------------------ */
+  // Depth of the keypoints of the given frame given its pose wrt the last
+  // keyframe, non-positive if the landmark was not triangulated.
+  void getKeypointDepths(const Frame& frame,
+                         const gtsam::Pose3& keyframe_P_frame,
+                         std::vector<double>* depths) const;
+
+  /* ------------------------------------------------------------------------ */
+  // Feed the measurements of the last frame to the feature budget controller
+  // and apply the new budget to the detector and tracker, if enabled.
+  void updateFeatureBudget(const double& latency_ms);
+
+  /* ------------------------------------------------------------------------ */
+  // Number of keyframes sent to the backend that it has not estimated yet,
+  // zero if the backend has not estimated any.
+  size_t getBackendLag();
 
   /* ------------------------------------------------------------------------ */
   void outlierRejectionMono(const gtsam::Rot3& calLrectLkf_R_camLrectKf_imu,
@@ -163,10 +211,14 @@ class StereoVisionFrontEnd {
                             TrackingStatusPose* status_pose_mono);
 
   /* ------------------------------------------------------------------------ */
-  void outlierRejectionStereo(const gtsam::Rot3& calLrectLkf_R_camLrectKf_imu,
-                              const StereoFrame::Ptr& left_frame_lkf,
-                              const StereoFrame::Ptr& left_frame_k,
-                              TrackingStatusPose* status_pose_stereo);
+  // If given, matches_ref_cur_mono are the mono matches prior to the mono
+  // outlier rejection, needed to run concurrently with it.
+  void outlierRejectionStereo(
+      const gtsam::Rot3& calLrectLkf_R_camLrectKf_imu,
+      const StereoFrame::Ptr& left_frame_lkf,
+      const StereoFrame::Ptr& left_frame_k,
+      TrackingStatusPose* status_pose_stereo,
+      const KeypointMatches* matches_ref_cur_mono = nullptr);
 
   /* ------------------------------------------------------------------------ */
   inline static void printTrackingStatus(const TrackingStatus& status,
@@ -239,6 +291,14 @@ class StereoVisionFrontEnd {
   // We use this to calculate the rotation btw reference frame and current frame
   // Whenever a keyframe is created, we reset it to identity.
   gtsam::Rot3 keyframe_R_ref_frame_;
+  // Same but full pose of the left camera (unrectified), only used by the
+  // pose optical flow predictor, and none if it could not be predicted.
+  boost::optional<gtsam::Pose3> keyframe_P_ref_frame_;
+  // Landmarks triangulated in the last keyframe, in its left camera frame.
+  std::unordered_map<LandmarkId, gtsam::Point3> keyframe_lmks_;
+  // Backend estimate of the last keyframe state, guarded by the mutex.
+  mutable std::mutex backend_state_mutex_;
+  std::unique_ptr<VioNavStateTimestamped> backend_state_;
 
   // Counters.
   int frame_count_;
@@ -253,6 +313,14 @@ class StereoVisionFrontEnd {
   // Set of functionalities for tracking.
   Tracker tracker_;
 
+  // Adapts the detector and tracker to hold a target latency, null if
+  // disabled.
+  FeatureBudgetController::UniquePtr feature_budget_controller_;
+  // Measurements of the current frame for the feature budget controller.
+  FeatureBudgetMeasurement feature_budget_measurement_;
+  // Timestamps of the keyframes not estimated by the backend yet.
+  std::deque<Timestamp> keyframes_pending_backend_;
+
   // IMU frontend.
   std::unique_ptr<ImuFrontEnd> imu_frontend_;
 
@@ -16,6 +16,9 @@
 // TODO(Toni): put tracker in another folder.
 #pragma once
 
+#include <memory>
+#include <vector>
+
 #include <opencv2/opencv.hpp>
 #include <opencv2/cudaoptflow.hpp>
 
@@ -24,6 +27,7 @@
 #include <gtsam/geometry/Rot3.h>
 #include <gtsam/geometry/StereoCamera.h>
 
+#include "kimera-vio/frontend/AdaptiveRansac.h"
 #include "kimera-vio/frontend/CameraParams.h"
 #include "kimera-vio/frontend/Frame.h"
 #include "kimera-vio/frontend/OpticalFlowPredictor.h"
@@ -67,6 +71,13 @@ class Tracker {
                        Frame* cur_frame,
                        const gtsam::Rot3& inter_frame_rotation);
 
+  // Same as above, but the optical flow predictor can use the full relative
+  // pose and the depth of the ref_frame keypoints (non-positive if unknown).
+  void featureTracking(Frame* ref_frame,
+                       Frame* cur_frame,
+                       const gtsam::Pose3& ref_P_cur,
+                       const std::vector<double>& ref_depths);
+
   // TODO(Toni): this function is almost a replica of the Stereo version,
   // factorize.
   std::pair<TrackingStatus, gtsam::Pose3> geometricOutlierRejectionMono(
@@ -75,9 +86,13 @@ class Tracker {
 
   // TODO(Toni): this function is almost a replica of the Mono version,
   // factorize.
+  // If given, the stereo matches are taken from matches_ref_cur_mono instead
+  // of from the current landmarks of the frames, so that this can run while
+  // the mono outlier rejection removes landmarks.
   std::pair<TrackingStatus, gtsam::Pose3> geometricOutlierRejectionStereo(
       StereoFrame& ref_frame,
-      StereoFrame& cur_frame);
+      StereoFrame& cur_frame,
+      const KeypointMatches* matches_ref_cur_mono = nullptr);
 
   // Contrarily to the previous 2 this also returns a 3x3 covariance for the
   // translation estimate.
@@ -87,9 +102,11 @@ class Tracker {
                                              const gtsam::Rot3& R);
 
   std::pair<std::pair<TrackingStatus, gtsam::Pose3>, gtsam::Matrix3>
-  geometricOutlierRejectionStereoGivenRotation(StereoFrame& ref_stereoFrame,
-                                               StereoFrame& cur_stereoFrame,
-                                               const gtsam::Rot3& R);
+  geometricOutlierRejectionStereoGivenRotation(
+      StereoFrame& ref_stereoFrame,
+      StereoFrame& cur_stereoFrame,
+      const gtsam::Rot3& R,
+      const KeypointMatches* matches_ref_cur_mono = nullptr);
 
   void removeOutliersMono(const std::vector<int>& inliers,
                           Frame* ref_frame,
@@ -104,6 +121,10 @@ class Tracker {
   void checkStatusRightKeypoints(
       const std::vector<KeypointStatus>& right_keypoints_status);
 
+  // Overrides the pyramid levels and iterations of the KLT tracker of the
+  // params for the next frames.
+  void setKltParams(const int& klt_max_level, const int& klt_max_iter);
+
   /* ---------------------------- CONST FUNCTIONS --------------------------- */
   // returns frame with markers
   cv::Mat getTrackerImage(
@@ -132,6 +153,11 @@ class Tracker {
       const KeypointMatches& matches_ref_cur_mono,
       KeypointMatches* matches_ref_cur_stereo);
 
+  // Sorts the matches by decreasing age of the track in the ref frame, which
+  // is the order in which the adaptive RANSAC draws its samples.
+  static void sortMatchesByTrackAge(const Frame& ref_frame,
+                                    KeypointMatches* matches_ref_cur);
+
   static bool computeMedianDisparity(const KeypointsCV& ref_frame_kpts,
                                      const KeypointsCV& cur_frame_kpts,
                                      const KeypointMatches& matches_ref_cur,
@@ -169,12 +195,31 @@ class Tracker {
   // where we like.
   std::string output_images_path_;
 
-  // Monocular RANSACs
-  opengv::sac::Ransac<ProblemMono> mono_ransac_;
-  opengv::sac::Ransac<ProblemMonoGivenRot> mono_ransac_given_rot_;
+  // Monocular RANSACs: opengv's, or AdaptiveRansac if ransac_adaptive_.
+  std::unique_ptr<opengv::sac::SampleConsensus<ProblemMono>> mono_ransac_;
+  std::unique_ptr<opengv::sac::SampleConsensus<ProblemMonoGivenRot>>
+      mono_ransac_given_rot_;
 
   // Stereo RANSAC
-  opengv::sac::Ransac<ProblemStereo> stereo_ransac_;
+  std::unique_ptr<opengv::sac::SampleConsensus<ProblemStereo>> stereo_ransac_;
+
+  // Correspondences of each RANSAC and the adapters pointing to them, their
+  // memory is reused from keyframe to keyframe.
+  BearingVectors mono_f_ref_;
+  BearingVectors mono_f_cur_;
+  AdapterMono mono_adapter_;
+  BearingVectors mono_given_rot_f_ref_;
+  BearingVectors mono_given_rot_f_cur_;
+  AdapterMonoGivenRot mono_given_rot_adapter_;
+  BearingVectors stereo_f_ref_;
+  BearingVectors stereo_f_cur_;
+  AdapterStereo stereo_adapter_;
+
+  // Problems built once on the adapters above. Only re-used by the adaptive
+  // RANSAC, opengv's samples from the problem, which is re-seeded when built.
+  std::shared_ptr<ProblemMono> mono_problem_;
+  std::shared_ptr<ProblemMonoGivenRot> mono_given_rot_problem_;
+  std::shared_ptr<ProblemStereo> stereo_problem_;
 
   // CUDA related
   cv::Ptr<cv::cuda::SparsePyrLKOpticalFlow> opticalFlowCalculator;
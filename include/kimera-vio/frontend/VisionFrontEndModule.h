@@ -62,6 +62,10 @@ class StereoVisionFrontEndModule
   inline void updateImuBias(const ImuBias& imu_bias) const {
     vio_frontend_->updateImuBias(imu_bias);
   }
+  inline void updateBackendState(
+      const VioNavStateTimestamped& W_State_Blkf) const {
+    vio_frontend_->updateBackendState(W_State_Blkf);
+  }
 
  private:
   StereoVisionFrontEnd::UniquePtr vio_frontend_;
@@ -76,6 +76,9 @@ protected:
   double ransac_probability_ = 0.995;  // TODO (minor) : should we split this in
                                        // mono and stereo?
   bool ransac_randomize_ = true;
+  // Use AdaptiveRansac (PROSAC sampling by track age and SPRT verification)
+  // instead of opengv's RANSAC.
+  bool ransac_adaptive_ = false;
   bool ransac_use_1point_stereo_ = true;
   bool ransac_use_2point_mono_ = true;
 
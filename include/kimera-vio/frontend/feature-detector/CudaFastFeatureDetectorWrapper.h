@@ -12,9 +12,10 @@ class CudaFastFeatureDetectorWrapper : public cv::Feature2D{
 public:
     explicit CudaFastFeatureDetectorWrapper(int threshold=10, bool nonmaxSuppression=true, int type=cv::FastFeatureDetector::TYPE_9_16, int max_npoints=5000);
     void detect(cv::InputArray image, std::vector<cv::KeyPoint> &keypoints, cv::InputArray mask = cv::noArray()) override;
+    void setThreshold(int threshold);
 
 private:
-    cv::Ptr<cv::cuda::Feature2DAsync> internal_detector;
+    cv::Ptr<cv::cuda::FastFeatureDetector> internal_detector;
 };
 
 
@@ -14,6 +14,8 @@
 
 #pragma once
 
+#include <vector>
+
 #include <Eigen/Eigen>
 
 #include <opencv2/features2d.hpp>
@@ -37,12 +39,35 @@ class FeatureDetector {
  public:
   void featureDetection(Frame* cur_frame);
 
+  // Overrides the max number of features per frame of the params, and scales
+  // the detector threshold (FAST threshold or GFTT quality level) of the
+  // params for the next detections. A scale below 1 finds more corners.
+  void setFeatureBudget(const int& max_features_per_frame,
+                        const double& threshold_scale);
+
+  inline int getMaxFeaturesPerFrame() const { return max_features_per_frame_; }
+  inline double getThresholdScale() const { return threshold_scale_; }
+
  private:
   // Returns landmark_count (updated from the new keypoints),
   // and nr or extracted corners.
   KeypointsCV featureDetection(const Frame& cur_frame,
                                const int& need_n_corners);
 
+  // Detects new corners only in the cells of a grid that lack tracked
+  // features, one cell per task in parallel, without rasterizing a mask.
+  // The budget of new corners is split among the cells with fewer tracked
+  // features than their share of max_features_per_frame_.
+  KeypointsCV gridFeatureDetection(const Frame& cur_frame,
+                                   const int& need_n_corners);
+
+  // Refines the corners to subpixel accuracy, if enabled in the params.
+  void refineCorners(const cv::Mat& img, KeypointsCV* corners) const;
+
+  // Thresholds of the params scaled by threshold_scale_.
+  int scaledFastThreshold() const;
+  double scaledQualityLevel() const;
+
   // Parameters.
   const FeatureDetectorParams feature_detector_params_;
 
@@ -55,6 +80,18 @@ class FeatureDetector {
 
   // Actual feature detector implementation.
   cv::Ptr<cv::Feature2D> feature_detector_;
+
+  // FAST threshold of each cell of the grid for grid detection, lowered or
+  // raised depending on the number of corners found in the cell.
+  std::vector<int> cell_fast_thresholds_;
+
+  // Feature budget, initially the one of the params (see setFeatureBudget).
+  int max_features_per_frame_;
+  double threshold_scale_;
+
+  // Incremental id assigned to new landmarks, per detector so that
+  // independent pipelines in the same process do not share landmark ids.
+  LandmarkId next_lmk_id_;
 };
 
 }  // namespace VIO
@@ -93,6 +93,13 @@ struct FeatureDetectorParams : public PipelineParams {
 
   // FAST specific params
   int fast_thresh_ = 10;
+
+  //! Whether to detect in the cells of a grid that lack tracked features,
+  //! in parallel, instead of detecting over the whole image.
+  //! Only for FAST (with a threshold adapted per cell) and GFTT.
+  bool enable_grid_detection_ = false;
+  int grid_cols_ = 8;
+  int grid_rows_ = 6;
 };
 
 }  // namespace VIO
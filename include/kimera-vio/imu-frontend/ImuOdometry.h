@@ -0,0 +1,97 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   ImuOdometry.h
+ * @brief  Odometry at IMU rate by propagating the latest backend state with
+ * the IMU measurements received since.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "kimera-vio/common/VioNavState.h"
+#include "kimera-vio/common/vio_types.h"
+#include "kimera-vio/imu-frontend/ImuFrontEnd-definitions.h"
+#include "kimera-vio/imu-frontend/ImuFrontEnd.h"
+#include "kimera-vio/imu-frontend/ImuFrontEndParams.h"
+#include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/utils/ThreadsafeImuBuffer.h"
+
+namespace VIO {
+
+/**
+ * @brief The ImuOdometry propagates the latest state estimated by the backend
+ * with the IMU measurements received after it, and outputs the propagated
+ * state for each IMU measurement. Each measurement costs a single step of the
+ * preintegration and a prediction, so the odometry is output within
+ * microseconds of receiving the IMU data, instead of at keyframe rate and
+ * after the backend optimization.
+ * The IMU measurements are buffered so that whenever a new backend state
+ * arrives, which is always in the past, the propagation restarts from it with
+ * the new IMU bias.
+ * Nothing is output until the first backend state is received.
+ */
+class ImuOdometry {
+ public:
+  KIMERA_POINTER_TYPEDEFS(ImuOdometry);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(ImuOdometry);
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  using OutputCallback = std::function<void(const VioNavStateTimestamped&)>;
+
+  ImuOdometry(const ImuParams& imu_params, const ImuBias& imu_bias);
+  virtual ~ImuOdometry() = default;
+
+  //! Propagates the state to the time of the measurement and outputs it.
+  //! The measurements must be added in chronological order.
+  void addImuMeasurement(const ImuMeasurement& imu_measurement);
+  void addImuMeasurements(const ImuMeasurements& imu_measurements);
+
+  //! Restarts the propagation from the given state, typically the output of
+  //! the backend. Ignored if older than the IMU measurements buffered.
+  void updateBackendState(const VioNavStateTimestamped& state);
+
+  //! Callbacks are called in the thread adding the IMU measurements.
+  inline void registerOutputCallback(const OutputCallback& callback) {
+    output_callbacks_.push_back(callback);
+  }
+
+ private:
+  //! Integrates the last measurement up to timestamp, and predicts the state
+  //! at timestamp. The caller must hold the mutex.
+  VioNavStateTimestamped propagate(const Timestamp& timestamp,
+                                   const ImuAccGyr& imu_accgyr);
+
+ private:
+  //! Only used for the preintegration, always reset at the backend state.
+  ImuFrontEnd imu_frontend_;
+  //! IMU measurements to re-propagate from the past backend states.
+  utils::ThreadsafeImuBuffer imu_buffer_;
+
+  //! Guards everything below.
+  std::mutex mutex_;
+  VioNavStateTimestamped backend_state_;
+  bool has_backend_state_;
+  //! Where the propagation is at: the pim integrates from the backend state
+  //! up to last_timestamp_, and last_imu_accgyr_ is integrated next.
+  Timestamp last_timestamp_;
+  ImuAccGyr last_imu_accgyr_;
+  //! Newest IMU measurement received.
+  Timestamp newest_timestamp_;
+  ImuAccGyr newest_imu_accgyr_;
+  bool has_imu_measurement_;
+
+  std::vector<OutputCallback> output_callbacks_;
+};
+
+}  // namespace VIO
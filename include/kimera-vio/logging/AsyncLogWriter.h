@@ -0,0 +1,236 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   AsyncLogWriter.h
+ * @brief  Log records whose formatting is deferred, and the writer thread
+ * that formats them and writes them to disk in batches.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "kimera-vio/utils/LockFreeQueue.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+// Value of one field of a LogRecord.
+struct LogField {
+  enum class Type : uint8_t { Int = 0, UInt = 1, Double = 2, String = 3 };
+  Type type_ = Type::Int;
+  union {
+    int64_t int_ = 0;
+    uint64_t uint_;
+    double double_;
+  };
+  std::string string_;
+};
+
+/**
+ * @brief A record of a log file. Loggers only copy the values to log into a
+ * record; they are formatted when the record is written, which can happen in
+ * the writer thread (or offline, from the binary log).
+ */
+class LogRecord {
+ public:
+  enum class Type : uint8_t {
+    //! Lines of num_columns fields joined by a separator.
+    Rows = 0,
+    //! Text written as is.
+    Text = 1,
+    //! Discards the contents of the file.
+    Truncate = 2,
+    //! Creates the file whose path is the text of the record.
+    Open = 3,
+    //! Opens the file whose path is the text of the record in append mode.
+    OpenAppend = 4,
+    Close = 5
+  };
+
+  LogRecord() = default;
+  /**
+   * @param num_columns Number of fields in every line.
+   * @param separator Written between the fields of a line.
+   * @param line_end Written after the last field of a line.
+   */
+  explicit LogRecord(const size_t& num_columns,
+                     const char& separator = ',',
+                     const std::string& line_end = "\n");
+
+  static LogRecord Text(const std::string& text);
+  static LogRecord Control(const Type& type, const std::string& path = "");
+
+ public:
+  /* ------------------------------------------------------------------------ */
+  // Appends a field, integers and floating point values keep their type.
+  template <typename T>
+  typename std::enable_if<std::is_integral<T>::value &&
+                              std::is_signed<T>::value,
+                          LogRecord&>::type
+  operator<<(const T& value) {
+    fields_.emplace_back();
+    fields_.back().type_ = LogField::Type::Int;
+    fields_.back().int_ = static_cast<int64_t>(value);
+    return *this;
+  }
+  template <typename T>
+  typename std::enable_if<std::is_integral<T>::value &&
+                              !std::is_signed<T>::value,
+                          LogRecord&>::type
+  operator<<(const T& value) {
+    fields_.emplace_back();
+    fields_.back().type_ = LogField::Type::UInt;
+    fields_.back().uint_ = static_cast<uint64_t>(value);
+    return *this;
+  }
+  template <typename T>
+  typename std::enable_if<std::is_floating_point<T>::value, LogRecord&>::type
+  operator<<(const T& value) {
+    fields_.emplace_back();
+    fields_.back().type_ = LogField::Type::Double;
+    fields_.back().double_ = static_cast<double>(value);
+    return *this;
+  }
+  LogRecord& operator<<(const std::string& value);
+  LogRecord& operator<<(const char* value);
+
+  inline Type type() const { return type_; }
+  inline const std::string& text() const { return text_; }
+  inline size_t numFields() const { return fields_.size(); }
+
+  /* ------------------------------------------------------------------------ */
+  // Appends the record as it appears in a log file. Floating point values are
+  // printed with 20 significant digits, like the loggers' ofstreams.
+  void format(std::string* output) const;
+
+  /* ------------------------------------------------------------------------ */
+  // Appends the record in binary format.
+  void serialize(std::string* output) const;
+
+  /* ------------------------------------------------------------------------ */
+  /** @brief Reads a record written by serialize.
+   * @param[in, out] data Start of the record, moved past its end.
+   * @param[in] end End of the buffer.
+   * @param[out] record The record read.
+   * @return False if the buffer ends before the record.
+   */
+  static bool deserialize(const char** data,
+                          const char* end,
+                          LogRecord* record);
+
+ private:
+  Type type_ = Type::Text;
+  size_t num_columns_ = 0u;
+  char separator_ = ',';
+  std::string line_end_;
+  std::string text_;
+  std::vector<LogField> fields_;
+};
+
+/**
+ * @brief Writes the records of all the loggers in a dedicated thread, so that
+ * logging never blocks the modules on disk writes. Records are queued in a
+ * lock-free queue and written in batches, either formatted in their log files
+ * or serialized to a single binary log that convertBinaryLog turns into the
+ * same log files offline.
+ */
+class AsyncLogWriter {
+ public:
+  KIMERA_POINTER_TYPEDEFS(AsyncLogWriter);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(AsyncLogWriter);
+
+  /**
+   * @param queue_size Maximum number of records waiting to be written.
+   * @param flush_period_ms Period at which queued records are written.
+   * @param binary_log_path If not empty, all the records are serialized to
+   * this file instead of being formatted in their log files.
+   */
+  AsyncLogWriter(const size_t& queue_size,
+                 const int& flush_period_ms,
+                 const std::string& binary_log_path = "");
+  // Writes all the queued records before returning.
+  virtual ~AsyncLogWriter();
+
+  /* ------------------------------------------------------------------------ */
+  // Writer shared by all the loggers, configured with the async_log_* flags.
+  static AsyncLogWriter& instance();
+
+ public:
+  /* ------------------------------------------------------------------------ */
+  /** @brief Registers a log file, which is opened by the writer thread.
+   * @return The id of the file, to be used in write.
+   */
+  uint32_t openFile(const std::string& path, const bool& append_mode = false);
+
+  /* ------------------------------------------------------------------------ */
+  // Queues a record. Only blocks if the queue is full.
+  void write(const uint32_t& file_id, LogRecord&& record);
+
+  /* ------------------------------------------------------------------------ */
+  // Blocks until the records queued so far are written to disk.
+  void flush();
+
+  /* ------------------------------------------------------------------------ */
+  /** @brief Writes the log files stored in a binary log, as they would have
+   *  been written without binary logging.
+   * @param[in] binary_log_path Binary log written by an AsyncLogWriter.
+   * @param[in] output_dir Folder where the log files are written.
+   */
+  static void convertBinaryLog(const std::string& binary_log_path,
+                               const std::string& output_dir);
+
+ private:
+  struct QueuedRecord {
+    uint32_t file_id_ = 0u;
+    LogRecord record_;
+  };
+  class LogFiles;
+
+  void spin();
+  // Writes the formatted or serialized records and flushes the files.
+  void writeBatch();
+
+ private:
+  LockFreeQueue<QueuedRecord> queue_;
+  const int flush_period_ms_;
+  const bool binary_mode_;
+
+  std::atomic<uint32_t> next_file_id_ = {0u};
+  // Number of records pushed to and written from the queue.
+  std::atomic<uint64_t> num_pushed_ = {0u};
+  uint64_t num_popped_ = 0u;
+  uint64_t num_written_ = 0u;
+
+  // Only accessed by the writer thread.
+  std::unique_ptr<LogFiles> log_files_;
+  std::ofstream binary_log_;
+  std::string binary_buffer_;
+
+  std::mutex mutex_;
+  std::condition_variable wake_up_condition_;
+  std::condition_variable written_condition_;
+  std::atomic_bool shutdown_ = {false};
+  std::atomic_bool flush_requested_ = {false};
+
+  std::unique_ptr<std::thread> writer_ = {nullptr};
+};
+
+}  // namespace VIO
@@ -21,6 +21,7 @@
 #include <unordered_map>
 
 #include "kimera-vio/backend/VioBackEnd-definitions.h"
+#include "kimera-vio/logging/AsyncLogWriter.h"
 #include "kimera-vio/loopclosure/LoopClosureDetector-definitions.h"
 #include "kimera-vio/mesh/Mesh.h"
 
@@ -40,6 +41,7 @@ static inline void OpenFile(const std::string& output_filename,
 }
 
 // Wrapper for std::ofstream to open/close it when created/destructed.
+// With async_logging, the file is written by the AsyncLogWriter instead.
 class OfstreamWrapper {
  public:
   KIMERA_POINTER_TYPEDEFS(OfstreamWrapper);
@@ -49,6 +51,12 @@ class OfstreamWrapper {
   virtual ~OfstreamWrapper();
   void closeAndOpenLogFile();
 
+  /**
+   * @brief write Queues the record to the AsyncLogWriter with async_logging,
+   * otherwise formats it and flushes it to the file right away.
+   */
+  void write(LogRecord&& record);
+
  public:
   std::ofstream ofstream_;
   const std::string filename_;
@@ -58,6 +66,10 @@ class OfstreamWrapper {
  protected:
   void openLogFile(const std::string& output_file_name,
                    bool open_file_in_append_mode = false);
+
+ private:
+  const bool is_async_;
+  uint32_t async_file_id_ = 0u;
 };
 
 /**
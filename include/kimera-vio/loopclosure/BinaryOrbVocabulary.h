@@ -0,0 +1,72 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   BinaryOrbVocabulary.h
+ * @brief  ORB vocabulary that can be saved to and loaded from a compact binary
+ * file, which is loaded without any text parsing.
+ *
+ * @author Marcus Abate
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <DBoW2/DBoW2.h>
+
+namespace VIO {
+
+class BinaryOrbVocabulary : public OrbVocabulary {
+ public:
+  BinaryOrbVocabulary() = default;
+  explicit BinaryOrbVocabulary(const OrbVocabulary& vocabulary)
+      : OrbVocabulary(vocabulary) {}
+  virtual ~BinaryOrbVocabulary() = default;
+
+  /* ------------------------------------------------------------------------ */
+  /** @brief Saves the vocabulary tree in binary format: a header, the node
+   *  table in the same order as DBoW2's text format, one contiguous block
+   *  with all the descriptors, and the word table.
+   * @param[in] filename Path of the file to write.
+   */
+  void saveBinary(const std::string& filename) const;
+
+  /* ------------------------------------------------------------------------ */
+  /** @brief Loads a vocabulary saved with saveBinary. The file is read
+   *  through a memory mapping, but the node descriptors are copied out of it
+   *  into one heap allocation that they all share.
+   * @param[in] filename Path of the binary vocabulary.
+   */
+  void loadBinary(const std::string& filename);
+
+  /* ------------------------------------------------------------------------ */
+  /** @brief Checks the magic number of a file.
+   * @param[in] filename Path of the vocabulary.
+   * @return True if the file is a binary vocabulary, false if it is not (or
+   *  could not be read).
+   */
+  static bool isBinaryFile(const std::string& filename);
+
+  /* ------------------------------------------------------------------------ */
+  /** @brief Loads a vocabulary, binary or text, only once per process: the
+   *  pipelines that load the same file share the loaded vocabulary for as
+   *  long as one of them holds it. This only saves the loading time: each
+   *  DBoW2 database built from it still keeps its own copy of the tree.
+   * @param[in] filename Path of the vocabulary.
+   * @param[in] save_binary_filename If not empty and the vocabulary is loaded
+   *  from a text file, it is also saved in binary format to this path.
+   * @return The loaded vocabulary.
+   */
+  static std::shared_ptr<const BinaryOrbVocabulary> loadShared(
+      const std::string& filename,
+      const std::string& save_binary_filename = "");
+};
+
+}  // namespace VIO
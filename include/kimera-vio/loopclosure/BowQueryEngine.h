@@ -0,0 +1,111 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   BowQueryEngine.h
+ * @brief  Sharded inverted index of BoW vectors, queried in parallel. Returns
+ * the same results as DBoW2's database query with L1 scoring.
+ *
+ * @author Marcus Abate
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <DBoW2/DBoW2.h>
+
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+class BowQueryEngine {
+ public:
+  KIMERA_POINTER_TYPEDEFS(BowQueryEngine);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(BowQueryEngine);
+
+  /**
+   * @param num_shards Number of shards of the inverted index. Entries are
+   * assigned to shards round-robin, and each shard is scored in its own thread
+   * once the index is large enough.
+   */
+  explicit BowQueryEngine(const size_t& num_shards = 4u);
+  virtual ~BowQueryEngine() = default;
+
+ public:
+  /* ------------------------------------------------------------------------ */
+  /** @brief Adds a BoW vector to the index.
+   * @return Id of the new entry, which is the number of entries added before,
+   *  as in DBoW2.
+   */
+  DBoW2::EntryId add(const DBoW2::BowVector& bow_vec);
+
+  /* ------------------------------------------------------------------------ */
+  /** @brief Queries the index with the same semantics as
+   *  TemplatedDatabase::query for L1 scoring.
+   * @param[in] bow_vec Query BoW vector.
+   * @param[in] max_results Maximum number of results (<= 0 for all).
+   * @param[in] max_id Only entries with id lower than max_id are considered,
+   *  -1 considers them all.
+   * @param[out] results Results sorted by decreasing score, ties broken by
+   *  increasing entry id.
+   */
+  void query(const DBoW2::BowVector& bow_vec,
+             const int& max_results,
+             const int& max_id,
+             DBoW2::QueryResults* results) const;
+
+  /* ------------------------------------------------------------------------ */
+  // Removes all the entries.
+  void clear();
+
+  inline size_t size() const { return num_entries_; }
+  inline size_t numShards() const { return shards_.size(); }
+
+  /* ------------------------------------------------------------------------ */
+  // Scoring types for which the results match DBoW2.
+  static bool supportsScoring(const DBoW2::ScoringType& scoring_type);
+
+ private:
+  struct Posting {
+    //! Index of the entry within its shard.
+    uint32_t local_id_;
+    DBoW2::WordValue value_;
+  };
+
+  struct Shard {
+    //! Postings of every word, sorted by increasing entry id.
+    std::unordered_map<DBoW2::WordId, std::vector<Posting>> inverted_index_;
+    size_t num_entries_ = 0u;
+
+    // Scratch buffers of the last query, kept to avoid reallocations.
+    // Only the entries touched by a query are reset after it.
+    std::vector<double> scores_;
+    std::vector<uint8_t> is_touched_;
+    std::vector<uint32_t> touched_;
+  };
+
+  /* ------------------------------------------------------------------------ */
+  // Scores the entries of one shard and keeps its best max_results.
+  void queryShard(const DBoW2::BowVector& bow_vec,
+                  const int& max_results,
+                  const int& max_id,
+                  Shard* shard,
+                  const size_t& shard_idx,
+                  DBoW2::QueryResults* results) const;
+
+ private:
+  // Mutable because queries reuse the scratch buffers of each shard, which
+  // also means that concurrent queries on the same engine are not supported.
+  mutable std::vector<Shard> shards_;
+  size_t num_entries_ = 0u;
+};
+
+}  // namespace VIO
@@ -285,8 +285,19 @@ struct LcdOutput {
   FrameId id_recent_;
   gtsam::Pose3 relative_pose_;
   gtsam::Pose3 W_Pose_Map_;
+  //! If is_pgo_delta_ is false, states_ and nfg_ hold the full PGO
+  //! trajectory and graph. Otherwise states_ holds only the poses that changed
+  //! since the previous output, and nfg_ only the factors added since then.
   gtsam::Values states_;
   gtsam::NonlinearFactorGraph nfg_;
+  bool is_pgo_delta_ = false;
+  //! Increases with every output, a gap means a delta was missed.
+  size_t pgo_version_ = 0u;
+  //! False if the PGO, optimized in its own thread, does not include the
+  //! factors of this keyframe yet: for a loop closure, states_ is then the
+  //! trajectory before the closure. The full optimized trajectory is
+  //! published with the first output after the loop closure is applied.
+  bool is_pgo_optimized_ = true;
 };
 
 }  // namespace VIO
@@ -18,27 +18,29 @@
 #include <gtsam/geometry/Pose3.h>
 #include <gtsam/linear/NoiseModel.h>
 
+#include <atomic>
 #include <limits>
+#include <map>
 #include <memory>
 #include <opencv2/opencv.hpp>
+#include <string>
+#include <tuple>
+#include <typeindex>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include "kimera-vio/frontend/StereoFrame.h"
 #include "kimera-vio/logging/Logger.h"
+#include "kimera-vio/loopclosure/BinaryOrbVocabulary.h"
+#include "kimera-vio/loopclosure/BowQueryEngine.h"
 #include "kimera-vio/loopclosure/LcdThirdPartyWrapper.h"
 #include "kimera-vio/loopclosure/LoopClosureDetector-definitions.h"
 #include "kimera-vio/loopclosure/LoopClosureDetectorParams.h"
+#include "kimera-vio/loopclosure/PgoOptimizer.h"
 #include "kimera-vio/pipeline/PipelineModule.h"
 #include "kimera-vio/utils/ThreadsafeQueue.h"
 
-/* ------------------------------------------------------------------------ */
-// Forward declare KimeraRPGO, a private dependency.
-namespace KimeraRPGO {
-class RobustSolver;
-}
-
 namespace VIO {
 
 /* ------------------------------------------------------------------------ */
@@ -53,9 +55,12 @@ class LoopClosureDetector {
    * @param[in] lcd_params Parameters for the instance of LoopClosureDetector.
    * @param[in] log_output Output-logging flag. If set to true, the logger is
    *  instantiated and output/statistics are logged at every spinOnce().
+   * @param[in] parallel_run If true, the PGO is optimized in its own thread
+   *  (see lcd_async_pgo flag), so that detection never waits on it.
    */
   LoopClosureDetector(const LoopClosureDetectorParams& lcd_params,
-                      bool log_output);
+                      bool log_output,
+                      bool parallel_run = false);
 
   /* ------------------------------------------------------------------------ */
   virtual ~LoopClosureDetector();
@@ -165,6 +170,13 @@ class LoopClosureDetector {
    */
   const gtsam::Pose3 getWPoseMap() const;
 
+  /* ------------------------------------------------------------------------ */
+  /** @brief Forces the next output to carry the full PGO trajectory and graph
+   *  when only deltas are published (see lcd_publish_pgo_deltas flag).
+   *  Thread-safe.
+   */
+  inline void requestFullPgoSnapshot() { full_pgo_snapshot_requested_ = true; }
+
   /* ------------------------------------------------------------------------ */
   /** @brief Returns the values of the PGO, which is the full trajectory of the
    *  PGO.
@@ -200,6 +212,43 @@ class LoopClosureDetector {
    */
   void setVocabulary(const OrbVocabulary& voc);
 
+  /* ------------------------------------------------------------------------ */
+  /** @brief Saves the LCDFrame database (keypoints, 3D keypoints, versors and
+   *  descriptors) in binary format.
+   * @param[in] filename Path of the file to write.
+   */
+  void saveDatabase(const std::string& filename) const;
+
+  /* ------------------------------------------------------------------------ */
+  /** @brief Loads an LCDFrame database saved with saveDatabase and rebuilds
+   *  the BoW database from it, so that new frames can be matched against a
+   *  previous session with detectLoop. Must be called before any frame is
+   *  processed. The loaded frames keep their ids, and the frames processed
+   *  afterwards are numbered after them. They can only be matched: the PGO
+   *  of the previous session is not restored, so spinOnce does not add loop
+   *  closures with them to the PGO of this session.
+   * @param[in] filename Path of the database.
+   */
+  void loadDatabase(const std::string& filename);
+
+  /* ------------------------------------------------------------------------ */
+  /** @brief Whether a frame of the database comes from loadDatabase.
+   * @param[in] frame_id The id of the frame in the database.
+   */
+  inline bool isLoadedFrame(const FrameId& frame_id) const {
+    return frame_id < n_loaded_frames_;
+  }
+
+  /* ------------------------------------------------------------------------ */
+  /** @brief Returns the key in the PGO (the keyframe id) of a frame of the
+   *  database processed in this session.
+   * @param[in] frame_id The id of the frame in the database.
+   */
+  inline FrameId getPgoKey(const FrameId& frame_id) const {
+    CHECK(!isLoadedFrame(frame_id));
+    return frame_id - n_loaded_frames_;
+  }
+
   /* ------------------------------------------------------------------------ */
   /* @brief Prints parameters and other statistics on the LoopClosureDetector.
    */
@@ -217,6 +266,26 @@ class LoopClosureDetector {
   void rewriteStereoFrameFeatures(const std::vector<cv::KeyPoint>& keypoints,
                                   StereoFrame* stereo_frame) const;
 
+  /* ------------------------------------------------------------------------ */
+  /** @brief Computes ORB descriptors at the keypoints tracked by the frontend
+   *  that have a valid stereo match, reusing their depth and versors instead
+   *  of re-running feature detection and stereo matching.
+   * @param[in] stereo_frame A StereoFrame filled with front-end features.
+   * @param[out] keypoints The keypoints that got a descriptor, with class_id
+   *  set to their index in the StereoFrame.
+   * @param[out] keypoints_3d The 3D positions of keypoints.
+   * @param[out] versors The bearing vectors of keypoints.
+   * @param[out] descriptors_mat One descriptor per row for each keypoint.
+   * @return False if there are too few features with depth to rely on them,
+   *  in which case ORB features should be detected instead.
+   */
+  bool computeDescriptorsAtFrontendFeatures(
+      const StereoFrame& stereo_frame,
+      std::vector<cv::KeyPoint>* keypoints,
+      std::vector<gtsam::Vector3>* keypoints_3d,
+      BearingVectors* versors,
+      OrbDescriptor* descriptors_mat) const;
+
   /* ------------------------------------------------------------------------ */
   /** @brief Creates an image with matched ORB features between two frames.
    *  This is a utility for debugging the ORB feature matcher and isn't used
@@ -284,7 +353,55 @@ class LoopClosureDetector {
    */
   void initializePGO(const OdometryFactor& factor);
 
+  /* ------------------------------------------------------------------------ */
+  /** @brief Fills the PGO states and factor graph of an output payload, either
+   *  with the full PGO or with only what changed since the last output.
+   *  Factors are identified by their type and keys, not by their position in
+   *  the graph. If a factor published before is not in the graph anymore,
+   *  e.g. rejected by the robust solver, the full PGO is written.
+   * @param[in] pgo_states The current PGO trajectory.
+   * @param[in] pgo_nfg The current PGO factor graph.
+   * @param[in] full_snapshot If false, only the changes are written.
+   * @param[out] output The output payload to fill.
+   */
+  void fillPgoOutput(const gtsam::Values& pgo_states,
+                     const gtsam::NonlinearFactorGraph& pgo_nfg,
+                     const bool& full_snapshot,
+                     LcdOutput* output);
+
  private:
+  // A PGO factor is identified by its first and last keys and its type, and
+  // counted since identical factors may be added more than once.
+  using PgoFactorId = std::tuple<gtsam::Key, gtsam::Key, std::type_index>;
+  using PgoFactorCounts = std::map<PgoFactorId, size_t>;
+
+  /* ------------------------------------------------------------------------ */
+  /** @brief Identifies a PGO factor independently of its position in the
+   *  graph, see fillPgoOutput.
+   * @param[in] factor A factor of the PGO.
+   * @return The type and the first and last keys of the factor.
+   */
+  static PgoFactorId getPgoFactorId(const gtsam::NonlinearFactor& factor);
+
+  /* ------------------------------------------------------------------------ */
+  /** @brief Adds a BoW vector to the database and to the query engine.
+   * @param[in] bow_vec The BoW vector of the latest frame.
+   */
+  void addBowVector(const DBoW2::BowVector& bow_vec);
+
+  /* ------------------------------------------------------------------------ */
+  /** @brief Finds the two nearest neighbours in the match frame of every
+   *  descriptor in the query frame. The matches of the latest pair of frames
+   *  are cached, since geometric verification and pose recovery both need
+   *  them for the same candidate.
+   * @param[in] query_id The frame ID of the query frame in the database.
+   * @param[in] match_id The frame ID of the match frame in the database.
+   * @return The two best matches for each query descriptor.
+   */
+  const std::vector<std::vector<cv::DMatch>>& getKnnMatches(
+      const FrameId& query_id,
+      const FrameId& match_id) const;
+
   /* ------------------------------------------------------------------------ */
   /** @brief Computes the indices of keypoints that match between two frames.
    * @param[in] query_id The frame ID of the query frame in the database.
@@ -357,8 +474,14 @@ class LoopClosureDetector {
   cv::Ptr<cv::DescriptorMatcher> orb_feature_matcher_;
 
   // BoW and Loop Detection database and members
+  // Loaded once for all the pipelines of the process.
+  std::shared_ptr<const BinaryOrbVocabulary> vocabulary_;
   std::unique_ptr<OrbDatabase> db_BoW_;
+  // Mirrors the entries of db_BoW_ for faster queries, null if disabled.
+  BowQueryEngine::UniquePtr bow_query_engine_;
   std::vector<LCDFrame> db_frames_;
+  // The first frames of db_frames_ come from loadDatabase, query only.
+  size_t n_loaded_frames_ = 0u;
   FrameIDTimestampMap timestamp_map_;
 
   // Store latest computed objects for temporal matching and nss scoring
@@ -369,12 +492,21 @@ class LoopClosureDetector {
   gtsam::Pose3 B_Pose_camLrect_;
 
   // Robust PGO members
-  std::unique_ptr<KimeraRPGO::RobustSolver> pgo_;
+  PgoOptimizer::UniquePtr pgo_optimizer_;
   std::vector<gtsam::Pose3> W_Pose_Blkf_estimates_;
   gtsam::SharedNoiseModel
       shared_noise_model_;  // TODO(marcus): make accurate
                             // should also come in with input
 
+  // PGO output members, used to publish only deltas
+  size_t pgo_version_ = 0u;
+  gtsam::Values published_pgo_states_;
+  PgoFactorCounts published_pgo_factors_;
+  std::atomic_bool full_pgo_snapshot_requested_ = {false};
+  // Number of PGO updates once the latest loop closure is applied, zero if
+  // its optimized trajectory has already been published.
+  size_t pending_lc_num_updates_ = 0u;
+
   // Logging members
   std::unique_ptr<LoopClosureDetectorLogger> logger_;
   LcdDebugInfo debug_info_;
@@ -388,6 +520,16 @@ class LoopClosureDetector {
   using AdapterStereo = opengv::point_cloud::PointCloudAdapter;
   using SacProblemStereo =
       opengv::sac_problems::point_cloud::PointCloudSacProblem;
+
+  // Two best matches between the descriptors of a pair of frames.
+  struct KnnMatches {
+    FrameId query_id_;
+    FrameId match_id_;
+    std::vector<DMatchVec> matches_;
+  };
+  // Matches of the latest candidate, the frames are never modified once in
+  // the database so they stay valid.
+  mutable std::unique_ptr<KnnMatches> knn_matches_cache_;
 };  // class LoopClosureDetector
 
 enum class LoopClosureDetectorType {
@@ -405,10 +547,12 @@ class LcdFactory {
   static LoopClosureDetector::UniquePtr createLcd(
       const LoopClosureDetectorType& lcd_type,
       const LoopClosureDetectorParams& lcd_params,
-      bool log_output) {
+      bool log_output,
+      bool parallel_run = false) {
     switch (lcd_type) {
       case LoopClosureDetectorType::BoW: {
-        return VIO::make_unique<LoopClosureDetector>(lcd_params, log_output);
+        return VIO::make_unique<LoopClosureDetector>(
+            lcd_params, log_output, parallel_run);
       }
       default: {
         LOG(FATAL) << "Requested loop closure detector type is not supported.\n"
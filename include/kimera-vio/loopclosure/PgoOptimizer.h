@@ -0,0 +1,145 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   PgoOptimizer.h
+ * @brief  Runs the robust pose-graph optimization of the LoopClosureDetector
+ * in its own thread.
+ *
+ * @author Marcus Abate
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <gtsam/nonlinear/NonlinearFactorGraph.h>
+#include <gtsam/nonlinear/Values.h>
+
+#include "kimera-vio/common/vio_types.h"
+#include "kimera-vio/loopclosure/LoopClosureDetectorParams.h"
+#include "kimera-vio/utils/Macros.h"
+
+/* ------------------------------------------------------------------------ */
+// Forward declare KimeraRPGO, a private dependency.
+namespace KimeraRPGO {
+class RobustSolver;
+}
+
+namespace VIO {
+
+// Snapshot of the pose graph after an optimization.
+struct PgoEstimate {
+  KIMERA_POINTER_TYPEDEFS(PgoEstimate);
+  //! Optimized trajectory.
+  gtsam::Values states_;
+  //! Factors of the pose graph (loop closures rejected by PCM excluded).
+  gtsam::NonlinearFactorGraph nfg_;
+  size_t pgo_size_ = 0u;
+  size_t num_lc_ = 0u;
+  size_t num_lc_inliers_ = 0u;
+  //! Increases with every published estimate.
+  size_t version_ = 0u;
+  //! Number of updates applied, compare with getNumUpdatesAdded() to know
+  //! whether the estimate includes the latest factors.
+  size_t num_updates_ = 0u;
+};
+
+class PgoOptimizer {
+ public:
+  KIMERA_POINTER_TYPEDEFS(PgoOptimizer);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(PgoOptimizer);
+
+  /**
+   * @param lcd_params Parameters of the robust solver (PCM thresholds).
+   * @param parallel_run If true, updates are applied in a worker thread,
+   * otherwise they are applied when added (useful for tests).
+   */
+  PgoOptimizer(const LoopClosureDetectorParams& lcd_params,
+               const bool& parallel_run = true);
+  virtual ~PgoOptimizer();
+
+ public:
+  /* ------------------------------------------------------------------------ */
+  // Queues the prior factor and value of the first keyframe.
+  void addPrior(const gtsam::NonlinearFactorGraph& nfg,
+                const gtsam::Values& values);
+
+  /* ------------------------------------------------------------------------ */
+  // Queues odometry factors and their new values. Odometry queued while the
+  // worker is busy is merged into a single update.
+  void addOdometry(const gtsam::NonlinearFactorGraph& nfg,
+                   const gtsam::Values& values);
+
+  /* ------------------------------------------------------------------------ */
+  // Queues loop-closure factors, which trigger a full optimization.
+  void addLoopClosure(const gtsam::NonlinearFactorGraph& nfg);
+
+  /**
+   * @brief getLatestEstimate Never blocks on an optimization.
+   * @return The latest published estimate, or nullptr if no update has been
+   * applied yet.
+   */
+  PgoEstimate::ConstPtr getLatestEstimate() const;
+
+  /* ------------------------------------------------------------------------ */
+  // Number of updates added so far, applied or not.
+  size_t getNumUpdatesAdded() const;
+
+  /* ------------------------------------------------------------------------ */
+  // Blocks until all queued updates have been applied and published.
+  void waitUntilIdle();
+
+  /* ------------------------------------------------------------------------ */
+  // Applies the pending updates and stops the worker thread. Updates added
+  // afterwards are ignored.
+  void shutdown();
+
+ private:
+  enum class PgoUpdateType { Prior, Odometry, LoopClosure };
+  struct PgoUpdate {
+    PgoUpdateType type_;
+    gtsam::NonlinearFactorGraph nfg_;
+    gtsam::Values values_;
+  };
+
+  void addUpdate(PgoUpdate&& update);
+  void spin();
+  void processUpdates(std::deque<PgoUpdate>* updates);
+  void publishEstimate();
+
+ private:
+  const bool parallel_run_;
+
+  // Only accessed by the thread processing the updates.
+  std::unique_ptr<KimeraRPGO::RobustSolver> pgo_;
+  size_t num_updates_applied_ = 0u;
+
+  // Updates not yet processed.
+  std::deque<PgoUpdate> pending_updates_;
+  bool is_busy_ = false;
+  size_t num_updates_added_ = 0u;
+  mutable std::mutex update_mutex_;
+  std::condition_variable update_condition_;
+  std::condition_variable idle_condition_;
+  std::atomic_bool shutdown_ = {false};
+
+  // Latest published estimate.
+  PgoEstimate::ConstPtr latest_estimate_ = nullptr;
+  size_t version_ = 0u;
+  mutable std::mutex estimate_mutex_;
+
+  std::unique_ptr<std::thread> worker_ = {nullptr};
+};
+
+}  // namespace VIO
@@ -188,7 +188,8 @@ class Mesh {
   bool setVertexPosition(const LandmarkId& lmk_id,
                          const VertexPosition& vertex);
 
-  // Get a list of all lmk ids in the mesh.
+  // Get a list of all lmk ids in the mesh, the i-th one being the landmark of
+  // the vertex in the i-th row of the vertices mesh.
   LandmarkIds getLandmarkIds() const;
 
  private:
@@ -15,8 +15,12 @@
 #pragma once
 
 #include <stdlib.h>
+#include <array>
 #include <atomic>
 #include <limits>  // for numeric_limits<>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>  // for move
 #include <vector>
 
@@ -37,6 +41,13 @@ class Mesher {
   KIMERA_DELETE_COPY_CONSTRUCTORS(Mesher);
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
+  // Identifies a triangle of the mesh by the sorted lmk ids of its vertices.
+  typedef std::array<LandmarkId, 3> PolygonLmkIds;
+  // Z values voted by each polygon parallel to the ground in the z histogram.
+  typedef std::map<PolygonLmkIds, cv::Vec3f> PolygonZSamples;
+  // Theta/distance voted by each polygon parallel to walls in the 2d histogram.
+  typedef std::map<PolygonLmkIds, cv::Vec2f> PolygonWallSamples;
+
  public:
   explicit Mesher(const MesherParams& mesher_params,
                   const bool& serialize_meshes = false);
@@ -112,6 +123,20 @@ class Mesher {
       const Frame& frame,
       const std::vector<size_t>& selected_indices);
 
+ protected:
+  /* --------------------------------------------------------------------------
+   */
+  // Segment new planes in the mesh.
+  // Currently segments horizontal planes using z_components, which is
+  // expected to be a cv::Mat z_components (1, 0, CV_32F);
+  // And walls perpendicular to the ground, using a cv::Mat which is expected to
+  // be a cv::Mat walls (0, 0, CV_32FC2), with first channel being theta (yaw
+  // angle of the wall) and the second channel the distance of it.
+  // points_with_id_vio is only used if we are using stereo points...
+  void segmentNewPlanes(std::vector<Plane>* new_segmented_planes,
+                        const cv::Mat& z_components,
+                        const cv::Mat& walls);
+
  private:
   // Provide Mesh 3D in read-only mode.
   // Not the nicest to send a const &, should maybe use shared_ptr
@@ -297,18 +322,11 @@ class Mesher {
       const PointsWithIdMap& points_with_id_vio,
       bool only_associate_a_polygon_to_a_single_plane = false) const;
 
-  /* --------------------------------------------------------------------------
-   */
-  // Segment new planes in the mesh.
-  // Currently segments horizontal planes using z_components, which is
-  // expected to be a cv::Mat z_components (1, 0, CV_32F);
-  // And walls perpendicular to the ground, using a cv::Mat which is expected to
-  // be a cv::Mat walls (0, 0, CV_32FC2), with first channel being theta (yaw
-  // angle of the wall) and the second channel the distance of it.
-  // points_with_id_vio is only used if we are using stereo points...
-  void segmentNewPlanes(std::vector<Plane>* new_segmented_planes,
-                        const cv::Mat& z_components,
-                        const cv::Mat& walls);
+  /* ------------------------------------------------------------------------ */
+  // Flags the lmks of the mesh that are new or that moved further than
+  // incremental_histogram_lmk_tolerance since the histograms were updated with
+  // their polygons, so that only these polygons are voted again.
+  void updateMovedHistogramLmks();
 
   /* ------------------------------------------------------------------------ */
   // Segment wall planes.
@@ -396,6 +414,16 @@ class Mesher {
   // The 2d histogram of theta angle (latitude) and distance of polygons
   // perpendicular to the vertical (aka parallel to walls).
   Histogram hist_2d_;
+  // Samples currently voted in z_hist_ and hist_2d_ by each polygon, only
+  // used if histograms are updated incrementally.
+  PolygonZSamples z_polygon_samples_;
+  PolygonWallSamples wall_polygon_samples_;
+  // Lmk positions the voted samples were computed from, and lmks flagged to
+  // be voted again, only used if histograms are updated incrementally.
+  std::unordered_map<LandmarkId, Vertex3D> histogram_lmk_positions_;
+  std::unordered_set<LandmarkId> moved_histogram_lmk_ids_;
+  // Id of the next segmented plane.
+  size_t next_plane_id_;
 
   const MesherParams mesher_params_;
   std::unique_ptr<MesherLogger> mesher_logger_;
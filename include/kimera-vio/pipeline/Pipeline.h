@@ -29,11 +29,13 @@
 #include "kimera-vio/frontend/StereoCamera.h"
 #include "kimera-vio/frontend/StereoImuSyncPacket.h"
 #include "kimera-vio/frontend/VisionFrontEndModule.h"
+#include "kimera-vio/imu-frontend/ImuOdometry.h"
 #include "kimera-vio/loopclosure/LoopClosureDetector.h"
 #include "kimera-vio/mesh/MesherModule.h"
 #include "kimera-vio/pipeline/Pipeline-definitions.h"
 #include "kimera-vio/utils/ThreadsafeQueue.h"
 #include "kimera-vio/visualizer/Display.h"
+#include "kimera-vio/visualizer/DisplayInputQueue.h"
 #include "kimera-vio/visualizer/DisplayModule.h"
 #include "kimera-vio/visualizer/Visualizer3D.h"
 #include "kimera-vio/visualizer/Visualizer3DModule.h"
@@ -90,11 +92,13 @@ class Pipeline {
   inline void fillSingleImuQueue(const ImuMeasurement& imu_measurement) {
     CHECK(data_provider_module_);
     data_provider_module_->fillImuQueue(imu_measurement);
+    if (imu_odometry_) imu_odometry_->addImuMeasurement(imu_measurement);
   }
   //! Fill multiple IMU measurements in batch
   inline void fillMultiImuQueue(const ImuMeasurements& imu_measurements) {
     CHECK(data_provider_module_);
     data_provider_module_->fillImuQueue(imu_measurements);
+    if (imu_odometry_) imu_odometry_->addImuMeasurements(imu_measurements);
   }
 
  public:
@@ -180,6 +184,18 @@ class Pipeline {
     }
   }
 
+  //! Register external callback to output the odometry at IMU rate.
+  //! Called in the thread filling the IMU queue.
+  inline void registerImuOdometryCallback(
+      const ImuOdometry::OutputCallback& callback) {
+    if (imu_odometry_) {
+      imu_odometry_->registerOutputCallback(callback);
+    } else {
+      LOG(ERROR) << "Attempt to register IMU odometry callback, but no "
+                 << "ImuOdometry member is active in pipeline.";
+    }
+  }
+
   //! Register external callback to be called when the VIO pipeline shuts down.
   inline void registerShutdownCallback(
       const ShutdownPipelineCallback& callback) {
@@ -273,6 +289,9 @@ class Pipeline {
   //! Thread-safe queue for the backend.
   VioBackEndModule::InputQueue backend_input_queue_;
 
+  //! Propagates the backend state at IMU rate.
+  ImuOdometry::UniquePtr imu_odometry_;
+
   //! Mesher
   MesherModule::UniquePtr mesher_module_;
 
@@ -283,7 +302,7 @@ class Pipeline {
   VisualizerModule::UniquePtr visualizer_module_;
 
   //! Thread-safe queue for the input to the display module
-  DisplayModule::InputQueue display_input_queue_;
+  DisplayInputQueue display_input_queue_;
 
   //! Displays actual images and 3D visualization
   DisplayModule::UniquePtr display_module_;
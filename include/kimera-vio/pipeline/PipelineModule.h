@@ -97,7 +97,8 @@ class PipelineModuleBase {
   // TODO(Toni) Pass the specific queue synchronizer at the ctor level
   // (kind of like visitor pattern), and use the queue synchronizer base class.
   /**
-   * @brief Non-static wrapper around the static queue synchronizer.
+   * @brief Synchronizes the queue with a stateless queue synchronizer, so
+   * that nothing is shared with the modules of other pipelines.
    * this->name_id_ is used for the name_id parameter.
    */
   template <class T>
@@ -105,7 +106,8 @@ class PipelineModuleBase {
                  ThreadsafeQueue<T>* queue,
                  T* pipeline_payload,
                  int max_iterations = 10) {
-    return SimpleQueueSynchronizer<T>::getInstance().syncQueue(
+    SimpleQueueSynchronizer<T> queue_synchronizer;
+    return queue_synchronizer.syncQueue(
         timestamp, queue, pipeline_payload, name_id_, max_iterations);
   }
   /**
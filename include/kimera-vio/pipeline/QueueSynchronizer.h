@@ -27,8 +27,9 @@
 namespace VIO {
 
 /**
- * @brief The QueueSynchronizer class: a singleton class meant to
- * synchronize threadsafe queues (ThreadsafeQueue).
+ * @brief The QueueSynchronizer class: meant to synchronize threadsafe queues
+ * (ThreadsafeQueue). Synchronizers are stateless and owned by the modules
+ * that use them, so that several pipelines can run in the same process.
  */
 template <class T>
 class QueueSynchronizerBase {
@@ -65,16 +66,8 @@ class SimpleQueueSynchronizer : public QueueSynchronizerBase<T> {
  public:
   KIMERA_POINTER_TYPEDEFS(SimpleQueueSynchronizer);
   KIMERA_DELETE_COPY_CONSTRUCTORS(SimpleQueueSynchronizer);
-
-  /**
-   * @brief getInstance of a SimpleQueueSynchronizer
-   * @return a unique ptr to a simple queue synchronizer which can be casted
-   * to its base class for common interface as a QueueSynchronizer.
-   */
-  static SimpleQueueSynchronizer<T>& getInstance() {
-    static SimpleQueueSynchronizer<T> synchronizer_instance_;
-    return synchronizer_instance_;
-  }
+  SimpleQueueSynchronizer() = default;
+  virtual ~SimpleQueueSynchronizer() = default;
 
   /**
    * @brief Utility function to synchronize threadsafe queues.
@@ -101,7 +94,7 @@ class SimpleQueueSynchronizer : public QueueSynchronizerBase<T> {
                  T* pipeline_payload,
                  std::string name_id,
                  int max_iterations = 10,
-                 std::function<void(const T&)>* callback = nullptr) {
+                 std::function<void(const T&)>* callback = nullptr) override {
     CHECK_NOTNULL(queue);
     CHECK_NOTNULL(pipeline_payload);
     static_assert(
@@ -147,12 +140,6 @@ class SimpleQueueSynchronizer : public QueueSynchronizerBase<T> {
     CHECK(*pipeline_payload);
     return true;
   }
-
- private:
-  // TODO(Toni): don't make this guy a singleton... Rather send it around.
-  /// Non-constructible class, so make ctors private (copy ctors are deleted):
-  SimpleQueueSynchronizer() = default;
-  ~SimpleQueueSynchronizer() = default;
 };
 
 }  // namespace VIO
@@ -16,6 +16,7 @@
 
 #include <vector>
 #include <array>
+#include <utility>
 #include <opencv2/core.hpp>
 
 // TODO move these to .cpp when removing static functions...
@@ -129,6 +130,23 @@ public:
   // Calculates histogram.
   void calculateHistogram(const cv::Mat& input, bool log_histogram = false);
 
+  /* ------------------------------------------------------------------------ */
+  // Incrementally updates the histogram: votes in the samples in
+  // samples_to_add and votes out the ones in samples_to_remove.
+  // Samples are expected in the same format as for calculateHistogram
+  // (1 x N CV_32F for 1D histograms, N x 1 CV_32FC2 for 2D histograms).
+  // Only the touched bins are modified, and the cached smoothed histogram is
+  // only invalidated if some bin count actually changed.
+  // Logs the updated histogram as calculateHistogram does.
+  // Returns true if the histogram changed.
+  bool updateHistogram(const cv::Mat& samples_to_add,
+                       const cv::Mat& samples_to_remove,
+                       bool log_histogram = false);
+
+  /* ------------------------------------------------------------------------ */
+  // Sets all bins of the histogram to zero.
+  void clearHistogram();
+
   /* ------------------------------------------------------------------------ */
   // If you play with the peak_per attribute value, you can increase/decrease the
   // number of peaks found.
@@ -165,6 +183,12 @@ private:
   // The actual histogram.
   cv::Mat histogram_;
 
+  // Smoothed histogram cache, only recomputed when the histogram changes or
+  // when the smoothing kernel changes. Mutable since it is a cache.
+  mutable cv::Mat histogram_smoothed_;
+  mutable cv::Size smooth_size_;
+  mutable bool is_smoothed_histogram_dirty_ = true;
+
   /* ------------------------------------------------------------------------ */
   struct Length {
     int pos1 = 0;
@@ -175,6 +199,24 @@ private:
   };
 
 
+  /* ------------------------------------------------------------------------ */
+  // Allocates histogram_ with all bins set to 0, if not allocated already.
+  void allocateHistogram();
+
+  /* ------------------------------------------------------------------------ */
+  // Writes the histogram to histogram_<dims>.yaml.
+  void logHistogram() const;
+
+  /* ------------------------------------------------------------------------ */
+  // Computes the (flat) bin index of the given sample, returns false if the
+  // sample is outside the ranges of the histogram.
+  bool getBinIdx(const float* sample, int* bin_idx) const;
+
+  /* ------------------------------------------------------------------------ */
+  // Returns the histogram smoothed with a gaussian of size smooth_size,
+  // recomputing it only if the cache is dirty.
+  const cv::Mat& getSmoothedHistogram(const cv::Size& smooth_size) const;
+
   /* ------------------------------------------------------------------------ */
   int drawPeaks1D(cv::Mat* histImage,
                   const std::vector<PeakInfo>& peaks,
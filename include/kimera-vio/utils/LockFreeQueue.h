@@ -0,0 +1,137 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   LockFreeQueue.h
+ * @brief  Bounded multi-producer multi-consumer queue that never locks.
+ * Based on Dmitry Vyukov's bounded MPMC queue: every cell has a sequence
+ * number telling producers and consumers whether it is their turn to use it.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+template <typename T>
+class LockFreeQueue {
+ public:
+  KIMERA_POINTER_TYPEDEFS(LockFreeQueue);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(LockFreeQueue);
+
+  /**
+   * @param capacity Maximum number of elements in the queue, rounded up to
+   * the next power of two.
+   */
+  explicit LockFreeQueue(const size_t& capacity)
+      : capacity_(roundUpToPowerOfTwo(capacity)),
+        mask_(capacity_ - 1u),
+        cells_(new Cell[capacity_]),
+        enqueue_pos_(0u),
+        dequeue_pos_(0u) {
+    for (size_t i = 0u; i < capacity_; i++) {
+      cells_[i].sequence_.store(i, std::memory_order_relaxed);
+    }
+  }
+  virtual ~LockFreeQueue() = default;
+
+  /**
+   * @brief tryPush Moves value into the queue.
+   * @return False if the queue is full, in which case value is untouched.
+   */
+  bool tryPush(T&& value) {
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    Cell* cell = nullptr;
+    while (true) {
+      cell = &cells_[pos & mask_];
+      const size_t sequence = cell->sequence_.load(std::memory_order_acquire);
+      const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(sequence) -
+                                  static_cast<std::ptrdiff_t>(pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(
+                pos, pos + 1u, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->value_ = std::move(value);
+    cell->sequence_.store(pos + 1u, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief tryPop Moves the oldest element of the queue into value.
+   * @return False if the queue is empty.
+   */
+  bool tryPop(T* value) {
+    CHECK_NOTNULL(value);
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    Cell* cell = nullptr;
+    while (true) {
+      cell = &cells_[pos & mask_];
+      const size_t sequence = cell->sequence_.load(std::memory_order_acquire);
+      const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(sequence) -
+                                  static_cast<std::ptrdiff_t>(pos + 1u);
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(
+                pos, pos + 1u, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    *value = std::move(cell->value_);
+    cell->sequence_.store(pos + mask_ + 1u, std::memory_order_release);
+    return true;
+  }
+
+  inline size_t capacity() const { return capacity_; }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> sequence_;
+    T value_;
+  };
+
+  static size_t roundUpToPowerOfTwo(const size_t& value) {
+    CHECK_GT(value, 0u);
+    size_t power = 1u;
+    while (power < value) power <<= 1u;
+    return power;
+  }
+
+ private:
+  const size_t capacity_;
+  const size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+
+  // Padding keeps producers and consumers from sharing a cache line.
+  char pad0_[64];
+  std::atomic<size_t> enqueue_pos_;
+  char pad1_[64];
+  std::atomic<size_t> dequeue_pos_;
+  char pad2_[64];
+};
+
+}  // namespace VIO
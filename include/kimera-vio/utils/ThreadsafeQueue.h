@@ -127,6 +127,14 @@ class ThreadsafeQueueBase {
     return data_queue_.empty();
   }
 
+  /** \brief Number of elements in the queue.
+   * the state of the queue might change right after this query.
+   */
+  size_t size() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return data_queue_.size();
+  }
+
   /** \brief Checks if the queue is shutdown.
    * the state of the queue might change right after this query.
    */
@@ -222,12 +230,13 @@ class ThreadsafeQueue : public ThreadsafeQueueBase<T> {
  public:
   using TQB::queue_id_;
 
- private:
+ protected:
   using TQB::data_cond_;
   using TQB::data_queue_;
   using TQB::mutex_;
   using TQB::shutdown_;
 
+ private:
   //! Stats on how full the queue gets.
   std::unique_ptr<utils::StatsCollector> queue_size_stats_;
 };
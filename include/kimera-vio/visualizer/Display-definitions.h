@@ -24,7 +24,7 @@ namespace VIO {
 /**
  * @brief The DisplayType enum: enumerates the types of supported renderers.
  */
-enum class DisplayType { kOpenCV = 0 };
+enum class DisplayType { kOpenCV = 0, kStream = 1 };
 
 /**
  * @brief The WindowData struct: Contains internal data for Visualizer3D window.
@@ -48,6 +48,9 @@ struct WindowData {
   int mesh_shading_;
   bool mesh_ambient_;
   bool mesh_lighting_;
+
+  //! Whether the screen is frozen, toggled by the keyboard callback.
+  bool freeze_;
 };
 
 /**
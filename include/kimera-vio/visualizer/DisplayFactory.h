@@ -14,11 +14,14 @@
 
 #pragma once
 
+#include <type_traits>
+
 #include <glog/logging.h>
 
 #include "kimera-vio/utils/Macros.h"
 #include "kimera-vio/visualizer/Display.h"
 #include "kimera-vio/visualizer/OpenCvDisplay.h"
+#include "kimera-vio/visualizer/StreamDisplay.h"
 
 namespace VIO {
 
@@ -36,17 +39,39 @@ class DisplayFactory {
       Types ... args) {
     switch (display_type) {
       case DisplayType::kOpenCV: {
-        return VIO::make_unique<OpenCv3dDisplay>(args...);
+        return makeDisplayIfConstructible<OpenCv3dDisplay>(args...);
+      }
+      case DisplayType::kStream: {
+        return makeDisplayIfConstructible<StreamDisplay>(args...);
       }
       default: {
         LOG(FATAL) << "Requested display type is not supported.\n"
                    << "Currently supported display types:\n"
-                   << "0: OpenCV 3D viz\n 1: Pangolin (not supported yet)\n"
+                   << "0: OpenCV 3D viz\n 1: Stream to a viewer process\n"
                    << " but requested display: "
                    << static_cast<int>(display_type);
       }
     }
   }
+
+ private:
+  // Displays take different arguments, only the requested one must be
+  // constructible from the given ones.
+  template <class DisplayT, class... Types>
+  static typename std::enable_if<
+      std::is_constructible<DisplayT, Types...>::value,
+      DisplayBase::UniquePtr>::type
+  makeDisplayIfConstructible(Types... args) {
+    return VIO::make_unique<DisplayT>(args...);
+  }
+  template <class DisplayT, class... Types>
+  static typename std::enable_if<
+      !std::is_constructible<DisplayT, Types...>::value,
+      DisplayBase::UniquePtr>::type
+  makeDisplayIfConstructible(Types...) {
+    LOG(FATAL) << "Wrong arguments for the requested display type.";
+    return nullptr;
+  }
 };
 
 }  // namespace VIO
@@ -0,0 +1,74 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   DisplayInputQueue.h
+ * @brief  Display queue that drops inputs when the display is late, so that
+ * visualization never blocks nor grows the memory of the estimator.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/utils/Statistics.h"
+#include "kimera-vio/utils/ThreadsafeQueue.h"
+#include "kimera-vio/visualizer/Visualizer3D-definitions.h"
+
+namespace VIO {
+
+/**
+ * @brief The DisplayInputQueue class is the queue between the frontend and
+ * the visualizer (producers), and the display (consumer). Pushing never
+ * blocks: depending on the VisualizerQueuePolicy, queued inputs are dropped
+ * when new ones arrive. An input is only dropped if a newer input in the
+ * queue absorbs it (see DisplayInputBase::absorb), so that incremental 3D
+ * outputs are merged instead of lost.
+ */
+class DisplayInputQueue : public DisplayQueue {
+ public:
+  KIMERA_POINTER_TYPEDEFS(DisplayInputQueue);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(DisplayInputQueue);
+
+  DisplayInputQueue(const std::string& queue_id,
+                    const VisualizerQueueParams& params);
+  virtual ~DisplayInputQueue();
+
+  //! Pushes the input and drops the queued ones according to the policy.
+  bool push(DisplayInputBase::UniquePtr new_value) override;
+
+  DropStatistics getDropStatistics() const;
+
+ private:
+  typedef std::shared_ptr<DisplayInputBase::UniquePtr> QueuedInput;
+
+  //! Drops the queued inputs that the last one absorbs, if they are closer
+  //! in time than min_period (or all of them if min_period is negative).
+  size_t dropAbsorbedByLast(const Timestamp& min_period,
+                            std::vector<QueuedInput>* queued) const;
+
+  //! Drops the oldest absorbable inputs with the lowest priority until there
+  //! are no more than max_queue_size_ inputs.
+  size_t dropLowestPriority(std::vector<QueuedInput>* queued) const;
+
+  //! Whether the input can be dropped by merging it into a newer one.
+  static bool absorbIntoNewer(const size_t& index,
+                              const std::vector<QueuedInput>& queued);
+
+ private:
+  const VisualizerQueueParams params_;
+  //! Guarded by mutex_.
+  DropStatistics drop_statistics_;
+  utils::StatsCollector dropped_stats_;
+};
+
+}  // namespace VIO
@@ -0,0 +1,160 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   IncrementalSceneModel.h
+ * @brief  Keeps track of the geometry shown in the 3D window, to only
+ * re-create the widgets whose geometry changed since the previous keyframe.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/viz/types.hpp>
+
+#include "kimera-vio/backend/VioBackEnd-definitions.h"
+#include "kimera-vio/common/vio_types.h"
+#include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/visualizer/Visualizer3D-definitions.h"
+
+namespace VIO {
+
+/**
+ * @brief The IncrementalSceneModel class splits the point cloud, the mesh and
+ * the trajectory in chunks, each one displayed with its own widget. Every
+ * update is diffed against what is already displayed, and only the widgets of
+ * the chunks that changed are re-created, so that the cost of visualization
+ * does not grow with the length of the trajectory or the size of the mesh.
+ * Widgets that must disappear are collected and sent to the display in
+ * VisualizerOutput::widget_ids_to_remove_.
+ */
+class IncrementalSceneModel {
+ public:
+  KIMERA_POINTER_TYPEDEFS(IncrementalSceneModel);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(IncrementalSceneModel);
+
+  /**
+   * @param chunk_size Number of consecutive landmark ids in a chunk of the
+   * point cloud or the mesh, and number of poses in a trajectory segment.
+   * @param position_tolerance Points and lines that moved less than this are
+   * not re-drawn.
+   */
+  IncrementalSceneModel(const size_t& chunk_size = 256u,
+                        const float& position_tolerance = 0.005f);
+  virtual ~IncrementalSceneModel() = default;
+
+ public:
+  /* ------------------------------------------------------------------------ */
+  /** @brief Updates the widgets of the point cloud.
+   * @param[in] points Landmarks to display, the ones not given are removed.
+   * @param[in] lmk_id_to_lmk_type_map If not empty, colors points by type.
+   * @param[in] color Color of the points if not colored by type.
+   * @param[out] widgets Widgets of the chunks that changed.
+   */
+  void updatePointCloud(const PointsWithIdMap& points,
+                        const LmkIdToLmkTypeMap& lmk_id_to_lmk_type_map,
+                        const cv::viz::Color& color,
+                        WidgetsMap* widgets);
+
+  /* ------------------------------------------------------------------------ */
+  /** @brief Updates the widgets of the mesh, triangles are assigned to the
+   * chunk of their smallest landmark id.
+   * @param[in] vertices Mesh vertices, n rows of CV_32FC3.
+   * @param[in] colors Color of each vertex (n rows of CV_8UC3), or empty.
+   * @param[in] polygons Mesh triangles as [3 id_a id_b id_c ...], the ids
+   * being rows of vertices.
+   * @param[in] vertex_lmk_ids Landmark id of each vertex.
+   * @param[out] widgets Widgets of the chunks that changed.
+   */
+  void updateMesh(const cv::Mat& vertices,
+                  const cv::Mat& colors,
+                  const cv::Mat& polygons,
+                  const LandmarkIds& vertex_lmk_ids,
+                  WidgetsMap* widgets);
+
+  /* ------------------------------------------------------------------------ */
+  /** @brief Updates the widgets of the trajectory.
+   * @param[in] poses Poses to display.
+   * @param[in] first_pose_index Number of poses added before the first one,
+   * which identifies the segments of the trajectory.
+   * @param[out] widgets Widgets of the segments that changed.
+   */
+  void updateTrajectory(const std::deque<cv::Affine3d>& poses,
+                        const size_t& first_pose_index,
+                        WidgetsMap* widgets);
+
+  /* ------------------------------------------------------------------------ */
+  // Draws a line, unless it is already drawn within the position tolerance.
+  void updateLine(const std::string& line_id,
+                  const cv::Point3d& from,
+                  const cv::Point3d& to,
+                  WidgetsMap* widgets);
+
+  /* ------------------------------------------------------------------------ */
+  // Removes the mesh chunks, when the mesh is displayed as a single widget.
+  void clearMesh();
+
+  /* ------------------------------------------------------------------------ */
+  // Queues the removal of a widget from the window.
+  void removeWidget(const std::string& widget_id);
+
+  /* ------------------------------------------------------------------------ */
+  // Moves the ids of the widgets to remove since the last call.
+  void popRemovedWidgets(std::vector<std::string>* widget_ids);
+
+  /* ------------------------------------------------------------------------ */
+  // Whether the widget is a mesh, whose rendering properties are set by the
+  // display.
+  static bool isMeshWidgetId(const std::string& widget_id);
+
+ private:
+  struct ColoredPoint {
+    cv::Point3f position_;
+    cv::Vec3b color_;
+  };
+  typedef std::map<LandmarkId, ColoredPoint> PointChunk;
+  typedef std::array<LandmarkId, 3> Triangle;
+  struct MeshChunk {
+    std::set<Triangle> triangles_;
+    PointChunk vertices_;
+    bool colored_ = false;
+  };
+
+  //! Whether the chunk must be re-drawn to display the new one.
+  bool hasChanged(const PointChunk& drawn, const PointChunk& updated) const;
+
+  inline int64_t chunkIndex(const LandmarkId& lmk_id) const {
+    return static_cast<int64_t>(lmk_id) / static_cast<int64_t>(chunk_size_);
+  }
+
+ private:
+  const size_t chunk_size_;
+  const float squared_position_tolerance_;
+
+  //! What is displayed, by chunk index.
+  std::map<int64_t, PointChunk> point_chunks_;
+  std::map<int64_t, MeshChunk> mesh_chunks_;
+  //! Index of the first and last pose of each displayed segment.
+  std::map<size_t, std::pair<size_t, size_t>> trajectory_segments_;
+  std::unordered_map<std::string, std::pair<cv::Point3d, cv::Point3d>> lines_;
+
+  std::vector<std::string> removed_widgets_;
+};
+
+}  // namespace VIO
@@ -14,6 +14,9 @@
 
 #pragma once
 
+#include <set>
+#include <string>
+
 #include <opencv2/opencv.hpp>
 
 #include "kimera-vio/pipeline/Pipeline-definitions.h"  // Needed for shutdown cb
@@ -63,8 +66,12 @@ class OpenCv3dDisplay : public DisplayBase {
   void setWidgetPose(const std::string& widget_id,
                      const cv::Affine3d& widget_pose);
 
-  //! Sets the visualization properties of the 3D mesh.
-  void setMeshProperties(WidgetsMap* widgets);
+  //! Sets the visualization properties of a 3D mesh widget.
+  void setMeshProperties(cv::viz::Widget* mesh_widget);
+
+  //! Applies the visualization properties changed with the keyboard to the
+  //! mesh widgets already in the window and not in widgets.
+  void updateShownMeshProperties(const WidgetsMap& widgets);
 
   //! Sets a 3D Widget Pose, because Widget3D::setPose() doesn't work;
   void setFrustumPose(const cv::Affine3d& frustum_pose);
@@ -126,6 +133,14 @@ class OpenCv3dDisplay : public DisplayBase {
   ShutdownPipelineCallback shutdown_pipeline_cb_;
 
   OpenCv3dDisplayParams params_;
+
+  //! Mesh widgets in the window, the mesh may be split in chunks.
+  std::set<std::string> mesh_widget_ids_;
+  //! Properties of the mesh widgets in the window.
+  int mesh_representation_shown_;
+  int mesh_shading_shown_;
+  bool mesh_ambient_shown_;
+  bool mesh_lighting_shown_;
 };
 
 }  // namespace VIO
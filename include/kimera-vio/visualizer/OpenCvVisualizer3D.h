@@ -32,6 +32,7 @@
 #include "kimera-vio/logging/Logger.h"
 #include "kimera-vio/mesh/Mesher-definitions.h"
 #include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/visualizer/IncrementalSceneModel.h"
 #include "kimera-vio/visualizer/Visualizer3D-definitions.h"
 #include "kimera-vio/visualizer/Visualizer3D.h"
 
@@ -200,16 +201,21 @@ class OpenCvVisualizer3D : public Visualizer3D {
   //! Visualize a 3D point cloud of unique 3D landmarks with its connectivity.
   void visualizeMesh3D(const cv::Mat& mapPoints3d,
                        const cv::Mat& polygonsMesh,
-                       WidgetsMap* widgets);
+                       WidgetsMap* widgets,
+                       const LandmarkIds& vertex_lmk_ids = LandmarkIds());
 
   //! Visualize a 3D point cloud of unique 3D landmarks with its connectivity,
   //! and provide color for each polygon.
+  //! If the landmark id of each vertex is given and the mesh is not textured,
+  //! the mesh is displayed in chunks, and only the chunks that changed are
+  //! re-drawn (see IncrementalSceneModel).
   void visualizeMesh3D(const cv::Mat& map_points_3d,
                        const cv::Mat& colors,
                        const cv::Mat& polygons_mesh,
                        WidgetsMap* widgets,
                        const cv::Mat& tcoords = cv::Mat(),
-                       const cv::Mat& texture = cv::Mat());
+                       const cv::Mat& texture = cv::Mat(),
+                       const LandmarkIds& vertex_lmk_ids = LandmarkIds());
 
   /// Visualize a 3D point cloud of unique 3D landmarks with its connectivity.
   /// Each triangle is colored depending on the cluster it is in, or gray if it
@@ -223,13 +229,16 @@ class OpenCvVisualizer3D : public Visualizer3D {
   ///  n=3 for triangles.
   /// [in] color_mesh whether to color the mesh or not
   /// [in] timestamp to store the timestamp of the mesh when logging the mesh.
+  /// [in] vertex_lmk_ids landmark id of each vertex, to display the mesh in
+  ///  chunks.
   void visualizeMesh3DWithColoredClusters(
       const std::vector<Plane>& planes,
       const cv::Mat& map_points_3d,
       const cv::Mat& polygons_mesh,
       WidgetsMap* widgets,
       const bool visualize_mesh_with_colored_polygon_clusters = false,
-      const Timestamp& timestamp = 0.0);
+      const Timestamp& timestamp = 0.0,
+      const LandmarkIds& vertex_lmk_ids = LandmarkIds());
 
   //! Visualize convex hull in 2D for set of points in triangle cluster,
   //! projected along the normal of the cluster.
@@ -238,7 +247,8 @@ class OpenCvVisualizer3D : public Visualizer3D {
                            const cv::Mat& polygons_mesh,
                            WidgetsMap* widgets);
 
-  //!!!!!!!! Remove widget. True if successful, false if not.
+  //! Remove widget from the window, the removal is sent to the display in
+  //! VisualizerOutput::widget_ids_to_remove_. True if successful.
   bool removeWidget(const std::string& widget_id);
 
   //! Visualize line widgets from plane to lmks.
@@ -285,11 +295,33 @@ class OpenCvVisualizer3D : public Visualizer3D {
   Mesh3dVizPropertiesSetterCallback mesh3d_viz_properties_callback_;
 
   std::deque<cv::Affine3d> trajectory_poses_3d_;
+  //! Number of poses removed from the front of trajectory_poses_3d_.
+  size_t num_poses_dropped_;
+
+  //! What is displayed, to only re-draw the widgets that changed.
+  IncrementalSceneModel scene_model_;
 
   std::map<PlaneId, LineNr> plane_to_line_nr_map_;
   PlaneIdMap plane_id_map_;
   std::map<PlaneId, bool> is_plane_id_in_window_;
 
+  //! Mesher and backend outputs of the previous keyframe: the mesh is
+  //! displayed with one keyframe of delay.
+  std::vector<Plane> planes_prev_;
+  PointsWithIdMap points_with_id_VIO_prev_;
+  LmkIdToLmkTypeMap lmk_id_to_lmk_type_map_prev_;
+  cv::Mat vertices_mesh_prev_;
+  cv::Mat polygons_mesh_prev_;
+  LandmarkIds vertex_lmk_ids_prev_;
+  Mesh3DVizProperties mesh_3d_viz_props_prev_;
+
+  bool ply_mesh_visualized_;
+  //! Offset of the plane labels, so that they do not overlap.
+  double plane_label_offset_;
+  size_t point_cloud_id_;
+  //! Timestamp of the last logged mesh, 0 if none was logged yet.
+  Timestamp last_logged_mesh_timestamp_;
+
   //! Colors
   cv::viz::Color cloud_color_ = cv::viz::Color::white();
 
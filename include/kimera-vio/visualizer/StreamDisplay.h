@@ -0,0 +1,60 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   StreamDisplay.h
+ * @brief  Headless display that streams the output of the StreamVisualizer3D
+ * to viewers connected over a Unix or TCP socket.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <string>
+
+#include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/visualizer/Display.h"
+#include "kimera-vio/visualizer/StreamVisualizer3D.h"
+#include "kimera-vio/visualizer/VizStream.h"
+#include "kimera-vio/visualizer/VizStreamSocket.h"
+
+namespace VIO {
+
+struct StreamDisplayParams {
+  //! "unix:<path>" or "tcp:<port>", see VizStreamSocket.h
+  std::string address_ = "unix:/tmp/kimera_vio_viz.sock";
+  //! Viewers that fall this far behind are disconnected.
+  size_t max_pending_bytes_ = 16u << 20u;
+  //! Poses sent to viewers that connect, -1 for the whole trajectory.
+  int max_trajectory_length_ = -1;
+};
+
+class StreamDisplay : public DisplayBase {
+ public:
+  KIMERA_POINTER_TYPEDEFS(StreamDisplay);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(StreamDisplay);
+
+  explicit StreamDisplay(const StreamDisplayParams& params);
+  ~StreamDisplay() override = default;
+
+  /**
+   * @brief spinOnce
+   * Sends the changes in the scene to the viewers, and the whole scene to the
+   * viewers that just connected. 2D images are not streamed.
+   * @param display_input Must be a StreamVisualizerOutput to be streamed.
+   */
+  void spinOnce(DisplayInputBase::UniquePtr&& display_input) override;
+
+ private:
+  StreamDisplayParams params_;
+  VizStreamServer server_;
+  //! Scene as seen by the viewers, to send snapshots to new ones.
+  VizStreamState state_;
+};
+
+}  // namespace VIO
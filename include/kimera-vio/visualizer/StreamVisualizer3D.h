@@ -0,0 +1,65 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   StreamVisualizer3D.h
+ * @brief  Headless visualizer: instead of building widgets, it computes what
+ * changed in the scene since the last keyframe, to be streamed to a viewer.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/visualizer/Visualizer3D-definitions.h"
+#include "kimera-vio/visualizer/Visualizer3D.h"
+#include "kimera-vio/visualizer/VizStream.h"
+
+namespace VIO {
+
+struct StreamVisualizerOutput : public VisualizerOutput {
+  KIMERA_POINTER_TYPEDEFS(StreamVisualizerOutput);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(StreamVisualizerOutput);
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  StreamVisualizerOutput() : VisualizerOutput(), message_() {}
+  ~StreamVisualizerOutput() = default;
+
+  //! Deltas are sent to the viewers one after the other, none is dropped.
+  //! The stream display does not block, so they do not pile up.
+  bool absorb(DisplayInputBase*) override { return false; }
+
+  //! Changes in the scene since the previous output.
+  VizStreamMessage message_;
+};
+
+class StreamVisualizer3D : public Visualizer3D {
+ public:
+  KIMERA_POINTER_TYPEDEFS(StreamVisualizer3D);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(StreamVisualizer3D);
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  explicit StreamVisualizer3D(const VisualizationType& viz_type);
+  virtual ~StreamVisualizer3D() = default;
+
+ public:
+  /**
+   * @brief spinOnce
+   * Computes the delta between the scene of the input and the one already
+   * sent. Only the pose is sent if the visualization type is kNone, and the
+   * mesh only if it is kMesh2dTo3dSparse.
+   * @param input Backend, frontend and (optional) mesher outputs.
+   * @return A StreamVisualizerOutput, without widgets.
+   */
+  VisualizerOutput::UniquePtr spinOnce(const VisualizerInput& input) override;
+
+ private:
+  //! Scene already sent, the trajectory is not needed to compute deltas.
+  VizStreamState sent_state_;
+};
+
+}  // namespace VIO
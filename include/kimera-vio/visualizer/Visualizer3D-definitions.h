@@ -14,9 +14,11 @@
 
 #pragma once
 
+#include <algorithm>
 #include <memory>
+#include <set>
 #include <string>
-#include <string>
+#include <typeinfo>
 #include <unordered_map>
 #include <vector>
 
@@ -34,7 +36,9 @@ namespace VIO {
 
 enum class VisualizerType {
   //! OpenCV 3D viz, uses VTK underneath the hood.
-  OpenCV = 0u
+  OpenCV = 0u,
+  //! Headless, streams the scene to a viewer process (StreamDisplay).
+  Stream = 1u
 };
 
 enum class VisualizationType {
@@ -56,6 +60,44 @@ struct ImageToDisplay {
   cv::Mat image_;
 };
 
+/**
+ * @brief The VisualizerQueuePolicy enum: what to do with the visualizer and
+ * display inputs when visualization is slower than the estimator.
+ */
+enum class VisualizerQueuePolicy {
+  //! Keep everything, queues grow as long as visualization is late.
+  kUnbounded = 0,
+  //! Only visualize the latest keyframe, and display the latest output.
+  kLatestOnly = 1,
+  //! Visualize keyframes at most at max_rate_hz_ (in data time), and merge
+  //! the display outputs closer in time than that.
+  kMaxRate = 2,
+  //! Keep at most max_queue_size_ inputs, dropping the oldest ones with the
+  //! lowest priority first.
+  kPriority = 3
+};
+
+struct VisualizerQueueParams {
+  VisualizerQueuePolicy policy_ = VisualizerQueuePolicy::kUnbounded;
+  //! For kMaxRate.
+  double max_rate_hz_ = 10.0;
+  //! For kPriority.
+  size_t max_queue_size_ = 5u;
+};
+
+//! Counts of what a visualization queue received and dropped.
+struct DropStatistics {
+  size_t num_received_ = 0u;
+  size_t num_dropped_ = 0u;
+};
+
+/**
+ * @brief The DisplayPriority enum: which display inputs to drop first when
+ * the display is late. 3D outputs are never dropped but merged into the next
+ * ones (see DisplayInputBase::absorb).
+ */
+enum class DisplayPriority { kLow = 0, kHigh = 1 };
+
 struct DisplayInputBase {
   KIMERA_POINTER_TYPEDEFS(DisplayInputBase);
   KIMERA_DELETE_COPY_CONSTRUCTORS(DisplayInputBase);
@@ -63,8 +105,38 @@ struct DisplayInputBase {
   DisplayInputBase() = default;
   virtual ~DisplayInputBase() = default;
 
-  Timestamp timestamp_;
+  /**
+   * @brief absorb Takes what is still needed from an older input, which is
+   * then dropped from the display queue instead of being displayed.
+   * @param older Input of the same type, pushed before this one.
+   * @return False if older can not be dropped, in which case it is unchanged.
+   */
+  virtual bool absorb(DisplayInputBase* older) {
+    CHECK_NOTNULL(older);
+    if (typeid(*older) != typeid(*this)) return false;
+    absorbImages(older);
+    return true;
+  }
+
+  Timestamp timestamp_ = 0;
   std::vector<ImageToDisplay> images_to_display_;
+  DisplayPriority priority_ = DisplayPriority::kLow;
+
+ protected:
+  //! Keeps the images of the windows that this input does not update.
+  void absorbImages(DisplayInputBase* older) {
+    CHECK_NOTNULL(older);
+    for (ImageToDisplay& older_image : older->images_to_display_) {
+      const bool is_updated =
+          std::find_if(images_to_display_.begin(),
+                       images_to_display_.end(),
+                       [&older_image](const ImageToDisplay& image) {
+                         return image.name_ == older_image.name_;
+                       }) != images_to_display_.end();
+      if (!is_updated) images_to_display_.push_back(std::move(older_image));
+    }
+    older->images_to_display_.clear();
+  }
 };
 typedef ThreadsafeQueue<DisplayInputBase::UniquePtr> DisplayQueue;
 
@@ -102,11 +174,42 @@ struct VisualizerOutput : public DisplayInputBase {
       : DisplayInputBase(),
         visualization_type_(VisualizationType::kNone),
         widgets_(),
-        frustum_pose_(cv::Affine3d::Identity()) {}
+        widget_ids_to_remove_(),
+        frustum_pose_(cv::Affine3d::Identity()) {
+    priority_ = DisplayPriority::kHigh;
+  }
   ~VisualizerOutput() = default;
 
+  //! Widgets are updated incrementally, so the widgets of the older output
+  //! that this one does not replace or remove are kept, as its removals.
+  bool absorb(DisplayInputBase* older) override {
+    CHECK_NOTNULL(older);
+    if (typeid(*older) != typeid(*this)) return false;
+    absorbImages(older);
+    VisualizerOutput* older_output = static_cast<VisualizerOutput*>(older);
+    const std::set<std::string> removed_ids(widget_ids_to_remove_.begin(),
+                                            widget_ids_to_remove_.end());
+    for (auto& widget : older_output->widgets_) {
+      if (removed_ids.find(widget.first) == removed_ids.end() &&
+          widgets_.find(widget.first) == widgets_.end()) {
+        widgets_[widget.first] = std::move(widget.second);
+      }
+    }
+    older_output->widgets_.clear();
+    // Removals go before the widgets in the display, so older removals of
+    // widgets shown again by this output are harmless.
+    widget_ids_to_remove_.insert(widget_ids_to_remove_.begin(),
+                                 older_output->widget_ids_to_remove_.begin(),
+                                 older_output->widget_ids_to_remove_.end());
+    older_output->widget_ids_to_remove_.clear();
+    return true;
+  }
+
   VisualizationType visualization_type_;
+  //! Widgets to add or replace in the window.
   WidgetsMap widgets_;
+  //! Widgets to remove from the window, removed before showing widgets_.
+  std::vector<std::string> widget_ids_to_remove_;
   cv::Affine3d frustum_pose_;
 };
 
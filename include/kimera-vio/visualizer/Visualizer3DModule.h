@@ -14,6 +14,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <vector>
 
 #include <glog/logging.h>
@@ -22,6 +23,7 @@
 #include "kimera-vio/mesh/Mesher-definitions.h"
 #include "kimera-vio/pipeline/PipelineModule.h"
 #include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/utils/Statistics.h"
 #include "kimera-vio/utils/ThreadsafeQueue.h"
 #include "kimera-vio/visualizer/Visualizer3D-definitions.h"
 #include "kimera-vio/visualizer/Visualizer3D.h"
@@ -39,20 +41,30 @@ class VisualizerModule
   using VizBackendInput = BackendOutput::Ptr;
   using VizMesherInput = MesherOutput::Ptr;
 
-  VisualizerModule(OutputQueue* output_queue,
-                   bool parallel_run,
-                   Visualizer3D::UniquePtr visualizer);
-  virtual ~VisualizerModule() = default;
+  /**
+   * @param queue_params What to do with the keyframes when the visualizer is
+   * slower than the backend: dropped keyframes are not visualized.
+   */
+  VisualizerModule(
+      OutputQueue* output_queue,
+      bool parallel_run,
+      Visualizer3D::UniquePtr visualizer,
+      const VisualizerQueueParams& queue_params = VisualizerQueueParams());
+  virtual ~VisualizerModule();
 
   //! Callbacks to fill queues: they should be all lighting fast.
   inline void fillFrontendQueue(const VizFrontendInput& frontend_payload) {
-    frontend_queue_.push(frontend_payload);
+    // Only keyframes are visualized, do not hold the other frames' images.
+    if (frontend_payload->is_keyframe_) frontend_queue_.push(frontend_payload);
   }
   inline void fillBackendQueue(const VizBackendInput& backend_payload) {
     backend_queue_.push(backend_payload);
   }
   void fillMesherQueue(const VizMesherInput& mesher_payload);
 
+  //! Keyframes received from the backend, and the ones not visualized.
+  DropStatistics getDropStatistics() const;
+
  protected:
   //! Synchronize input queues. Currently doing it in a crude way:
   //! Pop blocking the payload that should be the last to be computed,
@@ -69,6 +81,9 @@ class VisualizerModule
   //! Checks if the module has work to do (should check input queues are empty)
   bool hasWork() const override;
 
+  //! Whether to skip the keyframe, according to the queue policy.
+  bool dropInput(const VizBackendInput& backend_payload) const;
+
  private:
   //! Input Queues
   ThreadsafeQueue<VizFrontendInput> frontend_queue_;
@@ -78,6 +93,13 @@ class VisualizerModule
 
   //! Visualizer implementation
   Visualizer3D::UniquePtr visualizer_;
+
+  const VisualizerQueueParams queue_params_;
+  //! Next keyframe timestamp to visualize, for VisualizerQueuePolicy::kMaxRate
+  Timestamp next_timestamp_;
+  std::atomic<size_t> num_received_;
+  std::atomic<size_t> num_dropped_;
+  utils::StatsCollector dropped_stats_;
 };
 
 }  // namespace VIO
@@ -0,0 +1,165 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   VizStream.h
+ * @brief  Compact messages with the poses, landmarks and mesh estimated by the
+ * pipeline, streamed to a viewer running in another process (or machine).
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include <gtsam/geometry/Pose3.h>
+
+#include "kimera-vio/common/vio_types.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+//! Pose of the body: translation and quaternion (x, y, z, w), in world frame.
+struct VizStreamPose {
+  VizStreamPose() = default;
+  VizStreamPose(const Timestamp& timestamp, const gtsam::Pose3& W_Pose_B);
+
+  gtsam::Pose3 toPose3() const;
+
+  Timestamp timestamp_ = 0;
+  std::array<float, 3> t_ = {{0.0f, 0.0f, 0.0f}};
+  std::array<float, 4> q_ = {{0.0f, 0.0f, 0.0f, 1.0f}};
+};
+
+//! Triangle of the mesh, given by the landmark ids of its vertices.
+typedef std::array<LandmarkId, 3> VizStreamTriangle;
+typedef std::unordered_map<LandmarkId, cv::Point3f> VizStreamPoints;
+
+/**
+ * @brief A message of the stream. Deltas only contain what changed since the
+ * previous message, snapshots contain the whole state for viewers that have
+ * just connected.
+ */
+struct VizStreamMessage {
+  KIMERA_POINTER_TYPEDEFS(VizStreamMessage);
+  enum class Type : uint8_t { kDelta = 0, kSnapshot = 1 };
+
+  Type type_ = Type::kDelta;
+  Timestamp timestamp_ = 0;
+  //! New poses (the whole trajectory in snapshots).
+  std::vector<VizStreamPose> poses_;
+  //! New or moved landmarks and mesh vertices.
+  std::vector<std::pair<LandmarkId, cv::Point3f>> landmarks_;
+  std::vector<LandmarkId> removed_landmarks_;
+  std::vector<std::pair<LandmarkId, cv::Point3f>> vertices_;
+  std::vector<LandmarkId> removed_vertices_;
+  std::vector<VizStreamTriangle> triangles_;
+  std::vector<VizStreamTriangle> removed_triangles_;
+
+  inline bool empty() const {
+    return poses_.empty() && landmarks_.empty() && removed_landmarks_.empty() &&
+           vertices_.empty() && removed_vertices_.empty() &&
+           triangles_.empty() && removed_triangles_.empty();
+  }
+
+  /* ------------------------------------------------------------------------ */
+  // Appends the message framed with its size, ready to be sent on a socket.
+  void serialize(std::string* output) const;
+
+  /* ------------------------------------------------------------------------ */
+  /** @brief Reads a message written by serialize.
+   * @param[in, out] data Start of the message, moved past its end.
+   * @param[in] end End of the buffer.
+   * @param[out] message The message read.
+   * @return False if the buffer ends before the message, in which case data
+   * is not moved.
+   */
+  static bool deserialize(const char** data,
+                          const char* end,
+                          VizStreamMessage* message);
+};
+
+/**
+ * @brief The state of the scene as seen by a viewer: the result of applying
+ * all the messages of a stream. The sender keeps one too, to compute deltas
+ * and snapshots.
+ */
+class VizStreamState {
+ public:
+  KIMERA_POINTER_TYPEDEFS(VizStreamState);
+
+  /**
+   * @param max_trajectory_length Maximum number of poses kept, or -1 to keep
+   * the whole trajectory.
+   */
+  explicit VizStreamState(const int& max_trajectory_length = -1);
+  virtual ~VizStreamState() = default;
+
+ public:
+  /* ------------------------------------------------------------------------ */
+  // Updates the state, a snapshot replaces it.
+  void apply(const VizStreamMessage& message);
+
+  /* ------------------------------------------------------------------------ */
+  // Message that brings an empty state to this one.
+  void snapshot(VizStreamMessage* message) const;
+
+  /* ------------------------------------------------------------------------ */
+  /** @brief Message that brings this state to the given one.
+   * @param[in] timestamp Timestamp of the new state.
+   * @param[in] pose Pose of the new state.
+   * @param[in] landmarks Landmarks of the new state.
+   * @param[in] vertices Mesh vertices of the new state.
+   * @param[in] triangles Mesh triangles of the new state.
+   * @param[in] position_tolerance Points that moved less than this are not
+   * sent again.
+   * @param[out] delta Message with the differences.
+   */
+  void computeDelta(const Timestamp& timestamp,
+                    const VizStreamPose& pose,
+                    const VizStreamPoints& landmarks,
+                    const VizStreamPoints& vertices,
+                    const std::set<VizStreamTriangle>& triangles,
+                    const float& position_tolerance,
+                    VizStreamMessage* delta) const;
+
+  void clear();
+
+  /* ------------------------------------------------------------------------ */
+  // Rotates the ids so that the smallest comes first, keeping the winding.
+  static VizStreamTriangle canonicalTriangle(const VizStreamTriangle& ids);
+
+  inline Timestamp timestamp() const { return timestamp_; }
+  inline const std::deque<VizStreamPose>& trajectory() const {
+    return trajectory_;
+  }
+  inline const VizStreamPoints& landmarks() const { return landmarks_; }
+  inline const VizStreamPoints& vertices() const { return vertices_; }
+  inline const std::set<VizStreamTriangle>& triangles() const {
+    return triangles_;
+  }
+
+ private:
+  const int max_trajectory_length_;
+
+  Timestamp timestamp_;
+  std::deque<VizStreamPose> trajectory_;
+  VizStreamPoints landmarks_;
+  VizStreamPoints vertices_;
+  std::set<VizStreamTriangle> triangles_;
+};
+
+}  // namespace VIO
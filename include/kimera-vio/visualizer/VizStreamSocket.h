@@ -0,0 +1,111 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   VizStreamSocket.h
+ * @brief  Unix and TCP sockets to send VizStream messages to viewers.
+ * Addresses are either "unix:<path>" or "tcp:<host>:<port>"; a server given
+ * "tcp:<port>" listens on all interfaces.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/visualizer/VizStream.h"
+
+namespace VIO {
+
+/**
+ * @brief Non-blocking server that sends the stream to all connected viewers.
+ * A viewer that does not keep up is disconnected instead of slowing down the
+ * pipeline, it gets a snapshot when it connects again.
+ */
+class VizStreamServer {
+ public:
+  KIMERA_POINTER_TYPEDEFS(VizStreamServer);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(VizStreamServer);
+
+  /**
+   * @param address Where to listen for viewers.
+   * @param max_pending_bytes Viewers with more bytes than this waiting to be
+   * sent are disconnected.
+   */
+  VizStreamServer(const std::string& address, const size_t& max_pending_bytes);
+  virtual ~VizStreamServer();
+
+ public:
+  /* ------------------------------------------------------------------------ */
+  // Accepts the viewers that connected since the last call.
+  // Returns true if some viewer still has to receive a snapshot.
+  bool acceptClients();
+
+  /* ------------------------------------------------------------------------ */
+  /** @brief Sends a serialized message to all the viewers.
+   * @param delta Sent to the viewers that already received a snapshot.
+   * @param snapshot Sent instead to the new viewers, may be empty if
+   * acceptClients returned false.
+   */
+  void broadcast(const std::string& delta, const std::string& snapshot);
+
+  inline size_t numClients() const { return clients_.size(); }
+
+ private:
+  struct Client {
+    int fd_ = -1;
+    bool has_snapshot_ = false;
+    std::string pending_;
+  };
+
+  // Sends as much of the pending bytes as possible without blocking.
+  // Returns false if the viewer disconnected.
+  bool sendPending(Client* client);
+  void closeClient(Client* client);
+
+ private:
+  const size_t max_pending_bytes_;
+  std::string unix_path_;
+  int listen_fd_;
+  std::vector<Client> clients_;
+};
+
+/**
+ * @brief Blocking client used by viewers to receive the stream.
+ */
+class VizStreamClient {
+ public:
+  KIMERA_POINTER_TYPEDEFS(VizStreamClient);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(VizStreamClient);
+
+  VizStreamClient();
+  virtual ~VizStreamClient();
+
+ public:
+  /* ------------------------------------------------------------------------ */
+  // Connects to the server, returns false if it is not listening.
+  bool connect(const std::string& address);
+  void disconnect();
+  inline bool isConnected() const { return fd_ >= 0; }
+
+  /* ------------------------------------------------------------------------ */
+  /** @brief Waits for the next message.
+   * @param[in] timeout_ms Maximum time waiting, -1 to wait indefinitely.
+   * @param[out] message The message received.
+   * @return False if no message arrived in time, or the server disconnected.
+   */
+  bool receive(const int& timeout_ms, VizStreamMessage* message);
+
+ private:
+  int fd_;
+  std::string buffer_;
+};
+
+}  // namespace VIO
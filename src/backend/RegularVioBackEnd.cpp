@@ -20,6 +20,8 @@
 
 #include "kimera-vio/backend/RegularVioBackEnd.h"
 
+#include <unordered_set>
+
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
@@ -63,6 +65,11 @@ DEFINE_bool(remove_old_reg_factors,
             true,
             "Remove regularity factors for those landmarks that were "
             "originally associated to the plane, but which are not anymore.");
+DEFINE_bool(use_fast_regularity_factor_removal,
+            true,
+            "Use the persistent index of regularity factor slots to find the "
+            "old regularity factors to remove, instead of looping over all "
+            "factors in the smoother's graph at every keyframe.");
 DEFINE_int32(min_num_of_plane_constraints_to_remove_factors,
              10,
              "Number of constraints for a plane to be considered "
@@ -322,10 +329,18 @@ bool RegularVioBackEnd::addVisualInertialStateAndOptimize(
           if (FLAGS_remove_old_reg_factors) {
             VLOG(10) << "Removing old regularity factors.";
             gtsam::FactorIndices delete_old_regularity_factors;
-            removeOldRegularityFactors_Slow(planes_,
-                                            idx_of_point_plane_factors_to_add,
-                                            &plane_id_to_lmk_id_reg_type_,
-                                            &delete_old_regularity_factors);
+            if (FLAGS_use_fast_regularity_factor_removal) {
+              removeOldRegularityFactors(planes_,
+                                         idx_of_point_plane_factors_to_add,
+                                         &plane_id_to_lmk_id_reg_type_,
+                                         &delete_old_regularity_factors);
+            } else {
+              removeOldRegularityFactors_Slow(
+                  planes_,
+                  idx_of_point_plane_factors_to_add,
+                  &plane_id_to_lmk_id_reg_type_,
+                  &delete_old_regularity_factors);
+            }
             if (delete_old_regularity_factors.size() > 0) {
               delete_slots.insert(delete_slots.end(),
                                   delete_old_regularity_factors.begin(),
@@ -801,15 +816,28 @@ void RegularVioBackEnd::deleteLmkFromExtraStructures(const LandmarkId& lmk_id) {
     lmk_id_is_smart_.erase(lmk_id);
   }
 
-  // Delete the entries related to this lmk id for all planes.
-  // NOT tested when using multiple planes...
+  // Delete the entries related to this lmk id for the planes it is attached
+  // to, using the reverse index instead of visiting all planes.
+  const auto& lmk_planes_it = lmk_id_to_plane_ids_.find(lmk_id);
+  if (lmk_planes_it != lmk_id_to_plane_ids_.end()) {
+    for (const PlaneId& plane_key : lmk_planes_it->second) {
+      const auto& plane_slots_it = plane_id_to_factor_slots_.find(plane_key);
+      if (plane_slots_it != plane_id_to_factor_slots_.end()) {
+        plane_slots_it->second.point_plane_factor_slots_.erase(lmk_id);
+      }
+    }
+    lmk_id_to_plane_ids_.erase(lmk_planes_it);
+  }
+
+  // The regularity types might not be in the reverse index yet (if their
+  // factors have not reached the smoother), so check all planes, these are
+  // hash lookups anyway.
   for (PlaneIdToLmkIdRegType::value_type& plane_id_to_map :
        plane_id_to_lmk_id_reg_type_) {
-    if (plane_id_to_map.second.find(lmk_id) != plane_id_to_map.second.end()) {
+    if (plane_id_to_map.second.erase(lmk_id) > 0u) {
       LOG(WARNING) << "Delete entrance in lmk_id_to_regularity_type_map"
                       " for lmk with id: "
                    << lmk_id;
-      plane_id_to_map.second.erase(lmk_id);
     }
   }
 }
@@ -1375,144 +1403,15 @@ void RegularVioBackEnd::removeOldRegularityFactors_Slow(
     const bool& has_plane_a_linear_factor =
         has_plane_a_linear_factor_map.at(plane_idx);
     const size_t& plane_prior_slot = plane_prior_slot_map.at(plane_idx);
-    /// If there are enough new constraints to be added then delete only
-    /// delete_slots else, if there are enough constraints left, only delete
-    /// delete_slots otherwise delete ALL constraints, both old and new, so that
-    /// the plane disappears (take into account priors!). Priors affecting
-    /// planes: linear container factor & prior on OrientedPlane3
-    const int32_t total_nr_of_plane_constraints =
-        point_plane_factor_slots_good.size() +
-        idx_of_point_plane_factors_to_add.size();
-    VLOG(10) << "Total number of constraints of plane "
-             << gtsam::DefaultKeyFormatter(plane_symbol.key())
-             << " is: " << total_nr_of_plane_constraints << "\n"
-             << "\tConstraints in graph which are good: "
-             << point_plane_factor_slots_good.size() << "\n"
-             << "\tConstraints that are going to be added: "
-             << idx_of_point_plane_factors_to_add.size() << "\n"
-             << "Constraints in graph which are bad: "
-             << point_plane_factor_slots_bad.size() << "\n"
-             << "Has the plane a prior? " << (has_plane_a_prior ? "Yes" : "No")
-             << ".\n"
-             << "Has the plane a linear factor? "
-             << (has_plane_a_linear_factor ? "Yes" : "No") << ".";
-    if (total_nr_of_plane_constraints >
-        FLAGS_min_num_of_plane_constraints_to_remove_factors) {
-      // The plane is fully constrained.
-      // We can just delete bad factors, assuming lmks will be well constrained.
-      // TODO ensure the lmks are themselves well constrained.
-      VLOG(10) << "Plane is fully constrained, removing only bad factors.";
-      fillDeleteSlots(point_plane_factor_slots_bad,
-                      &lmk_id_to_regularity_type_map,
-                      delete_slots);
-    } else {
-      // The plane is NOT fully constrained if we remove all bad factors,
-      // unless the plane has a prior.
-      // Check if the plane has a prior.
-      VLOG(10) << "Plane is NOT fully constrained if we just remove"
-                  " the bad factors.";
-      if (has_plane_a_prior || has_plane_a_linear_factor) {
-        // The plane has a prior.
-        VLOG(10) << "Plane has a prior.";
-        // TODO Remove: this is just a patch to avoid issue 32:
-        // https://github.mit.edu/lcarlone/VIO/issues/32
-        if (FLAGS_use_unstable_plane_removal) {
-          // This should be the correct way to do it, but a bug in gtsam will
-          // make the optimization break.
-          if (total_nr_of_plane_constraints == 0 && has_plane_a_prior &&
-              !has_plane_a_linear_factor) {
-            // Not only the plane is not fully constrained, it has no
-            // constraints at all, and we are going to delete the bad ones, so
-            // plane floating with a plane prior, not attached to anything
-            // else... Delete the prior as well, to get rid of this plane.
-            LOG(ERROR)
-                << "Plane has no constraints at all, deleting prior as well.";
-            CHECK_NE(plane_prior_slot, 0);
-            delete_slots->push_back(plane_prior_slot);
-          }
-        } else {
-          // This is just a patch...
-          // TODO maybe if we are deleting too much constraints, add a no
-          // information factor btw the plane and a lmk!
-          if (total_nr_of_plane_constraints >
-              FLAGS_min_num_of_plane_constraints_to_avoid_seg_fault) {
-            // Delete just the bad factors, since we still have some factors
-            // that won't make the optimizer try to delete the plane variable,
-            // which at the current time breaks gtsam.
-            VLOG(10) << "Delete bad factors attached to plane.";
-            fillDeleteSlots(point_plane_factor_slots_bad,
-                            &lmk_id_to_regularity_type_map,
-                            delete_slots);
-          } else {
-            // Do not delete all factors, otherwise gtsam will break.
-            VLOG(10)
-                << "Not deleting bad factors attached to plane, or gtsam will "
-                   "break.";
-          }
-        }
-      } else {
-        // The plane has NOT a prior.
-        if (FLAGS_use_unstable_plane_removal) {
-          // Delete all factors involving the plane so that iSAM removes the
-          // plane from the optimization.
-          LOG(ERROR) << "Plane has no prior, trying to forcefully"
-                        " remove the PLANE!";
-          debug_smoother_ = true;
-          fillDeleteSlots(point_plane_factor_slots_bad,
-                          &lmk_id_to_regularity_type_map,
-                          delete_slots);
-          fillDeleteSlots(point_plane_factor_slots_good,
-                          &lmk_id_to_regularity_type_map,
-                          delete_slots);
-
-          // Remove as well the factors that are going to be added in this
-          // iteration.
-          deleteNewSlots(plane_symbol.key(),
-                         idx_of_point_plane_factors_to_add,
-                         &lmk_id_to_regularity_type_map,
-                         &new_imu_prior_and_other_factors_);
-        } else {
-          // Do not use unstable implementation...
-          // Just add a prior on the plane and remove only bad factors...
-          // Add a prior to the plane.
-          VLOG(10)
-              << "Adding a prior to the plane, delete just the bad factors.";
-          gtsam::OrientedPlane3 plane_estimate;
-          CHECK(getEstimateOfKey(state_, plane_symbol.key(), &plane_estimate));
-          LOG(WARNING) << "Using plane prior on plane with id "
-                       << gtsam::DefaultKeyFormatter(plane_symbol);
-          CHECK(!has_plane_a_prior && !has_plane_a_linear_factor)
-              << "Check that the plane has no prior.";
-          static const gtsam::noiseModel::Diagonal::shared_ptr prior_noise =
-              gtsam::noiseModel::Diagonal::Sigmas(
-                  Vector3(FLAGS_prior_noise_sigma_normal,
-                          FLAGS_prior_noise_sigma_normal,
-                          FLAGS_prior_noise_sigma_distance));
-          new_imu_prior_and_other_factors_.push_back(
-              boost::make_shared<gtsam::PriorFactor<gtsam::OrientedPlane3>>(
-                  plane_symbol.key(), plane_estimate, prior_noise));
-
-          // Delete just the bad factors.
-          // TODO Remove: this is just a patch to avoid issue 32:
-          // https://github.mit.edu/lcarlone/VIO/issues/32
-          if (total_nr_of_plane_constraints >
-              FLAGS_min_num_of_plane_constraints_to_avoid_seg_fault) {
-            // Delete just the bad factors, since we still have some factors
-            // that won't make the optimizer try to delete the plane variable,
-            // which at the current time breaks gtsam.
-            VLOG(10) << "Delete bad factors attached to plane.";
-            fillDeleteSlots(point_plane_factor_slots_bad,
-                            &lmk_id_to_regularity_type_map,
-                            delete_slots);
-          } else {
-            // Do not delete all factors, otherwise gtsam will break.
-            VLOG(10)
-                << "Not deleting bad factors attached to plane, or gtsam will "
-                   "break.";
-          }
-        }
-      }  // The plane has NOT a prior.
-    }    // The plane is NOT fully constraint.
+    removeOldRegularityFactorsOfPlane(plane_symbol,
+                                      point_plane_factor_slots_bad,
+                                      point_plane_factor_slots_good,
+                                      idx_of_point_plane_factors_to_add,
+                                      has_plane_a_prior,
+                                      has_plane_a_linear_factor,
+                                      plane_prior_slot,
+                                      &lmk_id_to_regularity_type_map,
+                                      delete_slots);
   }
   //  // TODO now the plane could be floating around with a prior attached, but
   //  // not really attached to the rest of the graph...
@@ -1545,6 +1444,338 @@ void RegularVioBackEnd::removeOldRegularityFactors_Slow(
   //  //  }
 }
 
+/* -------------------------------------------------------------------------- */
+void RegularVioBackEnd::removeOldRegularityFactors(
+    const std::vector<Plane>& planes,
+    const std::map<PlaneId, std::vector<std::pair<Slot, LandmarkId>>>&
+        map_idx_of_point_plane_factors_to_add,
+    PlaneIdToLmkIdRegType* plane_id_to_lmk_id_to_reg_type_map,
+    gtsam::FactorIndices* delete_slots) {
+  CHECK_NOTNULL(plane_id_to_lmk_id_to_reg_type_map);
+  CHECK_NOTNULL(delete_slots);
+  VLOG(10) << "Starting removeOldRegularityFactors...";
+
+  const gtsam::NonlinearFactorGraph& graph = smoother_->getFactors();
+  for (const Plane& plane : planes) {
+    const gtsam::Symbol& plane_symbol = plane.getPlaneSymbol();
+    const PlaneId& plane_key = plane_symbol.key();
+    CHECK(!(state_.exists(plane_key) && new_values_.exists(plane_key)))
+        << "Inconsistency: plane is in current state,"
+           " but it is going to be added.";
+    if (!state_.exists(plane_key) || new_values_.exists(plane_key)) {
+      // The plane is not in the state yet, it is probably going to be added
+      // in this iteration, so it must be already well constrained and
+      // attached to the right lmks. Or it is not going to be added at all.
+      VLOG(10) << "Plane with id " << gtsam::DefaultKeyFormatter(plane_symbol)
+               << " is not in state.";
+      continue;
+    }
+
+    // Classify the point plane factors of this plane that are in the graph,
+    // dropping the index entries of the factors that are gone (deleted or
+    // marginalized).
+    std::vector<std::pair<Slot, LandmarkId>> point_plane_factor_slots_bad;
+    std::vector<std::pair<Slot, LandmarkId>> point_plane_factor_slots_good;
+    PlaneFactorSlots& plane_factor_slots = plane_id_to_factor_slots_[plane_key];
+    const std::unordered_set<LandmarkId> plane_lmk_ids(plane.lmk_ids_.begin(),
+                                                       plane.lmk_ids_.end());
+    for (auto it = plane_factor_slots.point_plane_factor_slots_.begin();
+         it != plane_factor_slots.point_plane_factor_slots_.end();) {
+      const LandmarkId& lmk_id = it->first;
+      const Slot& slot = it->second;
+      if (!isPointPlaneFactorInGraph(graph, slot, lmk_id, plane_key)) {
+        const auto& lmk_planes_it = lmk_id_to_plane_ids_.find(lmk_id);
+        if (lmk_planes_it != lmk_id_to_plane_ids_.end()) {
+          lmk_planes_it->second.erase(plane_key);
+          if (lmk_planes_it->second.empty()) {
+            lmk_id_to_plane_ids_.erase(lmk_planes_it);
+          }
+        }
+        it = plane_factor_slots.point_plane_factor_slots_.erase(it);
+        continue;
+      }
+      if (plane_lmk_ids.find(lmk_id) == plane_lmk_ids.end()) {
+        // We did not find the point in plane's lmks, therefore it should
+        // not be involved in a regularity anymore, delete this slot.
+        VLOG(20) << "Found bad point plane factor on lmk with id: " << lmk_id;
+        point_plane_factor_slots_bad.push_back(std::make_pair(slot, lmk_id));
+      } else {
+        // Store those factors that we will potentially keep.
+        point_plane_factor_slots_good.push_back(std::make_pair(slot, lmk_id));
+      }
+      ++it;
+    }
+
+    // Check the plane prior is still there.
+    bool has_plane_a_prior = false;
+    Slot plane_prior_slot = 0;  // Invalid slot.
+    if (plane_factor_slots.plane_prior_slot_) {
+      const Slot& slot = *plane_factor_slots.plane_prior_slot_;
+      if (graph.exists(slot) &&
+          boost::dynamic_pointer_cast<
+              gtsam::PriorFactor<gtsam::OrientedPlane3>>(graph.at(slot))) {
+        has_plane_a_prior = true;
+        plane_prior_slot = slot;
+      } else {
+        plane_factor_slots.plane_prior_slot_ = boost::none;
+      }
+    }
+
+    DCHECK(map_idx_of_point_plane_factors_to_add.find(plane_key) !=
+           map_idx_of_point_plane_factors_to_add.end());
+    const std::vector<std::pair<Slot, LandmarkId>>&
+        idx_of_point_plane_factors_to_add =
+            map_idx_of_point_plane_factors_to_add.at(plane_key);
+    const int32_t total_nr_of_plane_constraints =
+        point_plane_factor_slots_good.size() +
+        idx_of_point_plane_factors_to_add.size();
+
+    // Linear container factors are created by the smoother itself when
+    // marginalizing, so we cannot index them. Only look for them when the
+    // answer matters, aka when the plane is not fully constrained.
+    bool has_plane_a_linear_factor = false;
+    if (total_nr_of_plane_constraints <=
+        FLAGS_min_num_of_plane_constraints_to_remove_factors) {
+      for (const auto& g : graph) {
+        const auto& lcf =
+            boost::dynamic_pointer_cast<gtsam::LinearContainerFactor>(g);
+        if (lcf && lcf->find(plane_key) != lcf->end()) {
+          VLOG(10) << "Found linear container factor for plane: "
+                   << gtsam::DefaultKeyFormatter(plane_key);
+          has_plane_a_linear_factor = true;
+          break;
+        }
+      }
+    }
+
+    DCHECK(plane_id_to_lmk_id_to_reg_type_map->find(plane_key) !=
+           plane_id_to_lmk_id_to_reg_type_map->end());
+    removeOldRegularityFactorsOfPlane(
+        plane_symbol,
+        point_plane_factor_slots_bad,
+        point_plane_factor_slots_good,
+        idx_of_point_plane_factors_to_add,
+        has_plane_a_prior,
+        has_plane_a_linear_factor,
+        plane_prior_slot,
+        &(plane_id_to_lmk_id_to_reg_type_map->at(plane_key)),
+        delete_slots);
+  }
+  VLOG(10) << "Finished removeOldRegularityFactors.";
+}
+
+/* -------------------------------------------------------------------------- */
+void RegularVioBackEnd::removeOldRegularityFactorsOfPlane(
+    const gtsam::Symbol& plane_symbol,
+    const std::vector<std::pair<Slot, LandmarkId>>&
+        point_plane_factor_slots_bad,
+    const std::vector<std::pair<Slot, LandmarkId>>&
+        point_plane_factor_slots_good,
+    const std::vector<std::pair<Slot, LandmarkId>>&
+        idx_of_point_plane_factors_to_add,
+    const bool& has_plane_a_prior,
+    const bool& has_plane_a_linear_factor,
+    const Slot& plane_prior_slot,
+    LmkIdToRegularityTypeMap* lmk_id_to_regularity_type_map,
+    gtsam::FactorIndices* delete_slots) {
+  CHECK_NOTNULL(lmk_id_to_regularity_type_map);
+  CHECK_NOTNULL(delete_slots);
+  /// If there are enough new constraints to be added then delete only
+  /// delete_slots else, if there are enough constraints left, only delete
+  /// delete_slots otherwise delete ALL constraints, both old and new, so that
+  /// the plane disappears (take into account priors!). Priors affecting
+  /// planes: linear container factor & prior on OrientedPlane3
+  const int32_t total_nr_of_plane_constraints =
+      point_plane_factor_slots_good.size() +
+      idx_of_point_plane_factors_to_add.size();
+  VLOG(10) << "Total number of constraints of plane "
+           << gtsam::DefaultKeyFormatter(plane_symbol.key())
+           << " is: " << total_nr_of_plane_constraints << "\n"
+           << "\tConstraints in graph which are good: "
+           << point_plane_factor_slots_good.size() << "\n"
+           << "\tConstraints that are going to be added: "
+           << idx_of_point_plane_factors_to_add.size() << "\n"
+           << "Constraints in graph which are bad: "
+           << point_plane_factor_slots_bad.size() << "\n"
+           << "Has the plane a prior? " << (has_plane_a_prior ? "Yes" : "No")
+           << ".\n"
+           << "Has the plane a linear factor? "
+           << (has_plane_a_linear_factor ? "Yes" : "No") << ".";
+  if (total_nr_of_plane_constraints >
+      FLAGS_min_num_of_plane_constraints_to_remove_factors) {
+    // The plane is fully constrained.
+    // We can just delete bad factors, assuming lmks will be well constrained.
+    // TODO ensure the lmks are themselves well constrained.
+    VLOG(10) << "Plane is fully constrained, removing only bad factors.";
+    fillDeleteSlots(point_plane_factor_slots_bad,
+                    lmk_id_to_regularity_type_map,
+                    delete_slots);
+  } else {
+    // The plane is NOT fully constrained if we remove all bad factors,
+    // unless the plane has a prior.
+    // Check if the plane has a prior.
+    VLOG(10) << "Plane is NOT fully constrained if we just remove"
+                " the bad factors.";
+    if (has_plane_a_prior || has_plane_a_linear_factor) {
+      // The plane has a prior.
+      VLOG(10) << "Plane has a prior.";
+      // TODO Remove: this is just a patch to avoid issue 32:
+      // https://github.mit.edu/lcarlone/VIO/issues/32
+      if (FLAGS_use_unstable_plane_removal) {
+        // This should be the correct way to do it, but a bug in gtsam will
+        // make the optimization break.
+        if (total_nr_of_plane_constraints == 0 && has_plane_a_prior &&
+            !has_plane_a_linear_factor) {
+          // Not only the plane is not fully constrained, it has no
+          // constraints at all, and we are going to delete the bad ones, so
+          // plane floating with a plane prior, not attached to anything
+          // else... Delete the prior as well, to get rid of this plane.
+          LOG(ERROR)
+              << "Plane has no constraints at all, deleting prior as well.";
+          CHECK_NE(plane_prior_slot, 0);
+          delete_slots->push_back(plane_prior_slot);
+        }
+      } else {
+        // This is just a patch...
+        // TODO maybe if we are deleting too much constraints, add a no
+        // information factor btw the plane and a lmk!
+        if (total_nr_of_plane_constraints >
+            FLAGS_min_num_of_plane_constraints_to_avoid_seg_fault) {
+          // Delete just the bad factors, since we still have some factors
+          // that won't make the optimizer try to delete the plane variable,
+          // which at the current time breaks gtsam.
+          VLOG(10) << "Delete bad factors attached to plane.";
+          fillDeleteSlots(point_plane_factor_slots_bad,
+                          lmk_id_to_regularity_type_map,
+                          delete_slots);
+        } else {
+          // Do not delete all factors, otherwise gtsam will break.
+          VLOG(10)
+              << "Not deleting bad factors attached to plane, or gtsam will "
+                 "break.";
+        }
+      }
+    } else {
+      // The plane has NOT a prior.
+      if (FLAGS_use_unstable_plane_removal) {
+        // Delete all factors involving the plane so that iSAM removes the
+        // plane from the optimization.
+        LOG(ERROR) << "Plane has no prior, trying to forcefully"
+                      " remove the PLANE!";
+        debug_smoother_ = true;
+        fillDeleteSlots(point_plane_factor_slots_bad,
+                        lmk_id_to_regularity_type_map,
+                        delete_slots);
+        fillDeleteSlots(point_plane_factor_slots_good,
+                        lmk_id_to_regularity_type_map,
+                        delete_slots);
+
+        // Remove as well the factors that are going to be added in this
+        // iteration.
+        deleteNewSlots(plane_symbol.key(),
+                       idx_of_point_plane_factors_to_add,
+                       lmk_id_to_regularity_type_map,
+                       &new_imu_prior_and_other_factors_);
+      } else {
+        // Do not use unstable implementation...
+        // Just add a prior on the plane and remove only bad factors...
+        // Add a prior to the plane.
+        VLOG(10)
+            << "Adding a prior to the plane, delete just the bad factors.";
+        gtsam::OrientedPlane3 plane_estimate;
+        CHECK(getEstimateOfKey(state_, plane_symbol.key(), &plane_estimate));
+        LOG(WARNING) << "Using plane prior on plane with id "
+                     << gtsam::DefaultKeyFormatter(plane_symbol);
+        CHECK(!has_plane_a_prior && !has_plane_a_linear_factor)
+            << "Check that the plane has no prior.";
+        static const gtsam::noiseModel::Diagonal::shared_ptr prior_noise =
+            gtsam::noiseModel::Diagonal::Sigmas(
+                Vector3(FLAGS_prior_noise_sigma_normal,
+                        FLAGS_prior_noise_sigma_normal,
+                        FLAGS_prior_noise_sigma_distance));
+        new_imu_prior_and_other_factors_.push_back(
+            boost::make_shared<gtsam::PriorFactor<gtsam::OrientedPlane3>>(
+                plane_symbol.key(), plane_estimate, prior_noise));
+
+        // Delete just the bad factors.
+        // TODO Remove: this is just a patch to avoid issue 32:
+        // https://github.mit.edu/lcarlone/VIO/issues/32
+        if (total_nr_of_plane_constraints >
+            FLAGS_min_num_of_plane_constraints_to_avoid_seg_fault) {
+          // Delete just the bad factors, since we still have some factors
+          // that won't make the optimizer try to delete the plane variable,
+          // which at the current time breaks gtsam.
+          VLOG(10) << "Delete bad factors attached to plane.";
+          fillDeleteSlots(point_plane_factor_slots_bad,
+                          lmk_id_to_regularity_type_map,
+                          delete_slots);
+        } else {
+          // Do not delete all factors, otherwise gtsam will break.
+          VLOG(10)
+              << "Not deleting bad factors attached to plane, or gtsam will "
+                 "break.";
+        }
+      }
+    }  // The plane has NOT a prior.
+  }    // The plane is NOT fully constraint.
+}
+
+/* -------------------------------------------------------------------------- */
+void RegularVioBackEnd::updateExtraStructuresSlots() {
+  const gtsam::ISAM2Result& result = smoother_->getISAM2Result();
+  const gtsam::NonlinearFactorGraph& graph = smoother_->getFactors();
+  // Only look at the newly added factors, the rest of the index is kept from
+  // previous optimizations.
+  for (const size_t& slot : result.newFactorsIndices) {
+    if (!graph.exists(slot)) continue;
+    const auto& ppf =
+        boost::dynamic_pointer_cast<gtsam::PointPlaneFactor>(graph.at(slot));
+    if (ppf) {
+      const PlaneId& plane_key = ppf->getPlaneKey();
+      const LandmarkId& lmk_id = gtsam::Symbol(ppf->getPointKey()).index();
+      plane_id_to_factor_slots_[plane_key].point_plane_factor_slots_[lmk_id] =
+          slot;
+      lmk_id_to_plane_ids_[lmk_id].insert(plane_key);
+      continue;
+    }
+    const auto& plane_prior =
+        boost::dynamic_pointer_cast<gtsam::PriorFactor<gtsam::OrientedPlane3>>(
+            graph.at(slot));
+    if (plane_prior) {
+      plane_id_to_factor_slots_[plane_prior->key()].plane_prior_slot_ = slot;
+    }
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+bool RegularVioBackEnd::isPointPlaneFactorInGraph(
+    const gtsam::NonlinearFactorGraph& graph,
+    const Slot& slot,
+    const LandmarkId& lmk_id,
+    const PlaneId& plane_key) const {
+  if (!graph.exists(slot)) return false;
+  const auto& ppf =
+      boost::dynamic_pointer_cast<gtsam::PointPlaneFactor>(graph.at(slot));
+  return ppf && ppf->getPlaneKey() == plane_key &&
+         ppf->getPointKey() == gtsam::Symbol('l', lmk_id).key();
+}
+
+/* -------------------------------------------------------------------------- */
+void RegularVioBackEnd::deletePlaneFromFactorSlots(const PlaneId& plane_key) {
+  const auto& plane_it = plane_id_to_factor_slots_.find(plane_key);
+  if (plane_it == plane_id_to_factor_slots_.end()) return;
+  for (const auto& lmk_id_slot : plane_it->second.point_plane_factor_slots_) {
+    const auto& lmk_planes_it = lmk_id_to_plane_ids_.find(lmk_id_slot.first);
+    if (lmk_planes_it != lmk_id_to_plane_ids_.end()) {
+      lmk_planes_it->second.erase(plane_key);
+      if (lmk_planes_it->second.empty()) {
+        lmk_id_to_plane_ids_.erase(lmk_planes_it);
+      }
+    }
+  }
+  plane_id_to_factor_slots_.erase(plane_it);
+}
+
 /* -------------------------------------------------------------------------- */
 void RegularVioBackEnd::fillDeleteSlots(
     const std::vector<std::pair<Slot, LandmarkId>>&
@@ -1754,6 +1985,7 @@ void RegularVioBackEnd::updatePlaneEstimates(std::vector<Plane>* planes) {
                         " only happen if we are not having a VALID tracking "
                         "status, since then we are not updating planes.";
       }
+      deletePlaneFromFactorSlots(plane_key);
 
       // Delete the plane.
       plane_it = planes->erase(plane_it);
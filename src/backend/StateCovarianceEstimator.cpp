@@ -0,0 +1,147 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   StateCovarianceEstimator.cpp
+ * @brief  Computes the marginal covariance of the current state (pose,
+ * velocity and imu bias) in its own thread.
+ *
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/backend/StateCovarianceEstimator.h"
+
+#include <utility>
+
+#include <glog/logging.h>
+
+#include <gtsam/inference/Symbol.h>
+#include <gtsam/nonlinear/Marginals.h>
+
+#include "kimera-vio/utils/Timer.h"
+#include "kimera-vio/utils/UtilsOpenCV.h"
+
+namespace VIO {
+
+/* -------------------------------------------------------------------------- */
+StateCovarianceEstimator::StateCovarianceEstimator(const bool& parallel_run)
+    : parallel_run_(parallel_run) {
+  if (parallel_run_) {
+    worker_ = VIO::make_unique<std::thread>(&StateCovarianceEstimator::spin,
+                                            this);
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+StateCovarianceEstimator::~StateCovarianceEstimator() {
+  shutdown();
+}
+
+/* -------------------------------------------------------------------------- */
+void StateCovarianceEstimator::requestCovariance(
+    const gtsam::GaussianFactorGraph::shared_ptr& linear_graph,
+    const gtsam::Values& values,
+    const FrameId& kf_id) {
+  CHECK(linear_graph);
+  if (!parallel_run_) {
+    processRequest(CovarianceRequest{linear_graph, values, kf_id});
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(request_mutex_);
+    if (pending_request_) {
+      // Expected whenever the covariance takes longer than a keyframe.
+      num_skipped_requests_++;
+      VLOG(1) << "Covariance of keyframe " << pending_request_->kf_id_
+              << " was not computed in time, skipping it.";
+      LOG_EVERY_N(WARNING, 100)
+          << "Skipped " << num_skipped_requests_
+          << " covariance requests so far, the covariance lags behind the "
+             "keyframes.";
+    }
+    pending_request_ = CovarianceRequest{linear_graph, values, kf_id};
+  }
+  request_condition_.notify_one();
+}
+
+/* -------------------------------------------------------------------------- */
+StateCovariance::ConstPtr StateCovarianceEstimator::getLatestCovariance()
+    const {
+  std::lock_guard<std::mutex> lock(covariance_mutex_);
+  return latest_covariance_;
+}
+
+/* -------------------------------------------------------------------------- */
+void StateCovarianceEstimator::shutdown() {
+  {
+    std::lock_guard<std::mutex> lock(request_mutex_);
+    shutdown_ = true;
+    pending_request_ = boost::none;
+  }
+  request_condition_.notify_all();
+  if (worker_ && worker_->joinable()) {
+    worker_->join();
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+gtsam::Matrix StateCovarianceEstimator::computeCovariance(
+    const gtsam::GaussianFactorGraph& linear_graph,
+    const gtsam::Values& values,
+    const FrameId& kf_id) {
+  gtsam::Marginals marginals(
+      linear_graph, values, gtsam::Marginals::Factorization::CHOLESKY);
+
+  // Current state includes pose, velocity and imu biases.
+  gtsam::KeyVector keys;
+  keys.push_back(gtsam::Symbol('x', kf_id));
+  keys.push_back(gtsam::Symbol('v', kf_id));
+  keys.push_back(gtsam::Symbol('b', kf_id));
+
+  // Return the marginal covariance matrix.
+  return UtilsOpenCV::Covariance_bvx2xvb(
+      marginals.jointMarginalCovariance(keys)
+          .fullMatrix());  // 6 + 3 + 6 = 15x15matrix
+}
+
+/* -------------------------------------------------------------------------- */
+void StateCovarianceEstimator::spin() {
+  LOG(INFO) << "Spinning StateCovarianceEstimator.";
+  while (true) {
+    CovarianceRequest request;
+    {
+      std::unique_lock<std::mutex> lock(request_mutex_);
+      request_condition_.wait(lock,
+                              [this] { return shutdown_ || pending_request_; });
+      if (shutdown_) break;
+      request = std::move(*pending_request_);
+      pending_request_ = boost::none;
+    }
+    processRequest(request);
+  }
+  LOG(INFO) << "StateCovarianceEstimator successfully shutdown.";
+}
+
+/* -------------------------------------------------------------------------- */
+void StateCovarianceEstimator::processRequest(
+    const CovarianceRequest& request) {
+  auto tic = utils::Timer::tic();
+  StateCovariance::Ptr state_covariance = std::make_shared<StateCovariance>();
+  state_covariance->kf_id_ = request.kf_id_;
+  state_covariance->covariance_ = computeCovariance(
+      *request.linear_graph_, request.values_, request.kf_id_);
+  VLOG(5) << "Computed state covariance of keyframe " << request.kf_id_
+          << " in " << utils::Timer::toc(tic).count() << " ms.";
+
+  std::lock_guard<std::mutex> lock(covariance_mutex_);
+  state_covariance->version_ = ++version_;
+  latest_covariance_ = state_covariance;
+}
+
+}  // namespace VIO
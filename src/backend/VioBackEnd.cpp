@@ -29,6 +29,7 @@
 
 #include "kimera-vio/backend/VioBackEnd.h"
 
+#include <algorithm>
 #include <limits>  // for numeric_limits<>
 #include <map>
 #include <string>
@@ -38,12 +39,20 @@
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include <opencv2/core/core.hpp>
+
 #include "kimera-vio/common/VioNavState.h"
 #include "kimera-vio/imu-frontend/ImuFrontEnd-definitions.h"  // for safeCast
 #include "kimera-vio/utils/Statistics.h"
 #include "kimera-vio/utils/Timer.h"
 #include "kimera-vio/utils/UtilsNumerical.h"
 
+DEFINE_int32(smart_factor_triangulation_stripes,
+             4,
+             "Hint of the number of stripes (chunks) in which the smart "
+             "factors triangulated in batch are split, passed as nstripes to "
+             "cv::parallel_for_. OpenCV decides how many threads run them. "
+             "1 to triangulate them sequentially.");
 DEFINE_bool(debug_graph_before_opt,
             false,
             "Store factor graph before optimization for later printing if the "
@@ -60,9 +69,63 @@ DEFINE_int32(max_number_of_cheirality_exceptions,
 DEFINE_bool(compute_state_covariance,
             false,
             "Flag to compute state covariance from optimization backend");
+DEFINE_bool(async_state_covariance,
+            true,
+            "Compute the state covariance in a separate thread, so that the "
+            "backend does not wait for it. The backend then outputs the "
+            "latest covariance available, which might lag a few keyframes.");
 
 namespace VIO {
 
+namespace {
+
+// Triangulates a range of smart factors at the latest estimates of their
+// poses, see VioBackEnd::triangulateSmartFactors.
+class SmartFactorTriangulationBody : public cv::ParallelLoopBody {
+ public:
+  SmartFactorTriangulationBody(
+      const gtsam::Values& state,
+      const gtsam::Values& new_values,
+      const std::vector<SmartStereoFactor::shared_ptr>& smart_factors,
+      std::vector<gtsam::TriangulationResult>* results)
+      : state_(state),
+        new_values_(new_values),
+        smart_factors_(smart_factors),
+        results_(results) {}
+
+  void operator()(const cv::Range& range) const override {
+    for (int i = range.start; i < range.end; ++i) {
+      const SmartStereoFactor::shared_ptr& factor = smart_factors_.at(i);
+      CHECK(factor);
+      gtsam::Values poses;
+      bool has_all_poses = true;
+      for (const gtsam::Key& key : factor->keys()) {
+        if (state_.exists(key)) {
+          poses.insert(key, state_.at(key));
+        } else if (new_values_.exists(key)) {
+          poses.insert(key, new_values_.at(key));
+        } else {
+          has_all_poses = false;
+          break;
+        }
+      }
+      const gtsam::TriangulationResult& result =
+          has_all_poses ? factor->point(poses) : factor->point();
+      if (results_) {
+        results_->at(i) = result;
+      }
+    }
+  }
+
+ private:
+  const gtsam::Values& state_;
+  const gtsam::Values& new_values_;
+  const std::vector<SmartStereoFactor::shared_ptr>& smart_factors_;
+  std::vector<gtsam::TriangulationResult>* results_;
+};
+
+}  // namespace
+
 /* -------------------------------------------------------------------------- */
 VioBackEnd::VioBackEnd(const Pose3& B_Pose_leftCam,
                        const StereoCalibPtr& stereo_calibration,
@@ -495,6 +558,8 @@ PointsWithIdMap VioBackEnd::getMapLmkIdsTo3dPointsInTimeHorizon(
   // old_smart_factors_ has all smart factors included so far.
   // Retrieve lmk ids from smart factors in state.
   size_t nr_valid_smart_lmks = 0, nr_smart_lmks = 0, nr_proj_lmks = 0;
+  std::vector<std::pair<LandmarkId, SmartStereoFactor::shared_ptr>> smart_lmks;
+  smart_lmks.reserve(old_smart_factors_.size());
   for (SmartFactorMap::iterator old_smart_factor_it =
            old_smart_factors_.begin();
        old_smart_factor_it !=
@@ -567,9 +632,48 @@ PointsWithIdMap VioBackEnd::getMapLmkIdsTo3dPointsInTimeHorizon(
     boost::shared_ptr<SmartStereoFactor> gsf =
         boost::dynamic_pointer_cast<SmartStereoFactor>(graph.at(slot_id));
     CHECK(gsf) << "Cannot cast factor in graph to a smart stereo factor.";
+    smart_lmks.push_back(std::make_pair(lmk_id, gsf));
+
+    // Next iteration.
+    old_smart_factor_it++;
+  }
 
-    // Get triangulation result from smart factor.
-    const gtsam::TriangulationResult& result = gsf->point();
+  // Triangulate (in parallel) the smart factors that have not been
+  // triangulated yet at the current estimate. Keep only the cache entries of
+  // the smart factors in time horizon.
+  std::unordered_map<LandmarkId, SmartFactorTriangulation> triangulations;
+  std::vector<SmartStereoFactor::shared_ptr> factors_to_triangulate;
+  std::vector<LandmarkId> lmk_ids_to_triangulate;
+  for (const auto& lmk_id_factor : smart_lmks) {
+    const LandmarkId& lmk_id = lmk_id_factor.first;
+    const auto& cached_it = smart_factor_triangulations_.find(lmk_id);
+    if (cached_it != smart_factor_triangulations_.end() &&
+        cached_it->second.factor_ == lmk_id_factor.second &&
+        cached_it->second.state_version_ == state_version_) {
+      triangulations.insert(*cached_it);
+    } else {
+      factors_to_triangulate.push_back(lmk_id_factor.second);
+      lmk_ids_to_triangulate.push_back(lmk_id);
+    }
+  }
+  std::vector<gtsam::TriangulationResult> new_results;
+  triangulateSmartFactors(factors_to_triangulate, &new_results);
+  CHECK_EQ(new_results.size(), lmk_ids_to_triangulate.size());
+  for (size_t i = 0u; i < lmk_ids_to_triangulate.size(); ++i) {
+    triangulations.insert(std::make_pair(
+        lmk_ids_to_triangulate[i],
+        SmartFactorTriangulation{
+            factors_to_triangulate[i], state_version_, new_results[i]}));
+  }
+  smart_factor_triangulations_.swap(triangulations);
+  VLOG(10) << "Triangulated " << factors_to_triangulate.size() << " out of "
+           << smart_lmks.size() << " smart factors in time horizon.";
+
+  for (const auto& lmk_id_factor : smart_lmks) {
+    const LandmarkId& lmk_id = lmk_id_factor.first;
+    const SmartStereoFactor::shared_ptr& gsf = lmk_id_factor.second;
+    const gtsam::TriangulationResult& result =
+        smart_factor_triangulations_.at(lmk_id).result_;
     // Check that the boost::optional result is initialized.
     // Otherwise we will be dereferencing a nullptr and we will head
     // directly to undefined behaviour wonderland.
@@ -603,9 +707,6 @@ PointsWithIdMap VioBackEnd::getMapLmkIdsTo3dPointsInTimeHorizon(
       VLOG(20) << "Triangulation result for smart factor of lmk with id "
                << lmk_id << " is not initialized...";
     }  // result.is_initialized()?
-
-    // Next iteration.
-    old_smart_factor_it++;
   }
 
   // Step 2:
@@ -643,20 +744,34 @@ PointsWithIdMap VioBackEnd::getMapLmkIdsTo3dPointsInTimeHorizon(
 /* -------------------------------------------------------------------------- */
 // NOT TESTED (--> There is a UnitTest function in UtilsOpenCV)
 void VioBackEnd::computeStateCovariance() {
-  gtsam::Marginals marginals(smoother_->getFactors(),
-                             state_,
-                             gtsam::Marginals::Factorization::CHOLESKY);
-
-  // Current state includes pose, velocity and imu biases.
-  gtsam::KeyVector keys;
-  keys.push_back(gtsam::Symbol('x', curr_kf_id_));
-  keys.push_back(gtsam::Symbol('v', curr_kf_id_));
-  keys.push_back(gtsam::Symbol('b', curr_kf_id_));
-
-  // Return the marginal covariance matrix.
-  state_covariance_lkf_ = UtilsOpenCV::Covariance_bvx2xvb(
-      marginals.jointMarginalCovariance(keys)
-          .fullMatrix());  // 6 + 3 + 6 = 15x15matrix
+  // Linearize here: the smart factors in the graph cache their
+  // triangulation, so the graph cannot be shared with another thread.
+  // The expensive part (elimination) is done by the covariance estimator.
+  const gtsam::GaussianFactorGraph::shared_ptr linear_graph =
+      smoother_->getFactors().linearize(state_);
+  if (!FLAGS_async_state_covariance) {
+    state_covariance_lkf_ = StateCovarianceEstimator::computeCovariance(
+        *linear_graph, state_, curr_kf_id_);
+    state_covariance_kf_id_ = curr_kf_id_;
+    return;
+  }
+
+  if (!state_covariance_estimator_) {
+    state_covariance_estimator_ = VIO::make_unique<StateCovarianceEstimator>();
+  }
+  state_covariance_estimator_->requestCovariance(
+      linear_graph, state_, curr_kf_id_);
+
+  // Use the latest covariance available.
+  const StateCovariance::ConstPtr& state_covariance =
+      state_covariance_estimator_->getLatestCovariance();
+  if (state_covariance) {
+    state_covariance_lkf_ = state_covariance->covariance_;
+    state_covariance_kf_id_ = state_covariance->kf_id_;
+    VLOG(5) << "Using state covariance of keyframe " << state_covariance_kf_id_
+            << " (version " << state_covariance->version_
+            << ") at keyframe " << curr_kf_id_ << ".";
+  }
 }
 
 /* -------------------------------------------------------------------------- */
@@ -1049,6 +1164,9 @@ bool VioBackEnd::optimize(
 #endif
     VLOG(10) << "Finished to find smart factors slots.";
 
+    // Let derived classes record the slots of the other new factors.
+    updateExtraStructuresSlots();
+
     if (VLOG_IS_ON(5) || log_output_) {
       debug_info_.updateSlotTime_ =
           utils::Timer::toc<std::chrono::seconds>(start_time).count();
@@ -1170,6 +1288,7 @@ void VioBackEnd::addConstantVelocityFactor(const FrameId& from_id,
 void VioBackEnd::updateStates(const FrameId& cur_id) {
   VLOG(10) << "Starting to calculate estimate.";
   state_ = smoother_->calculateEstimate();
+  ++state_version_;
   VLOG(10) << "Finished to calculate estimate.";
 
   DCHECK(state_.find(gtsam::Symbol('x', cur_id)) != state_.end());
@@ -1441,6 +1560,11 @@ void VioBackEnd::deleteLmkFromExtraStructures(const LandmarkId& lmk_id) {
   return;
 }
 
+void VioBackEnd::updateExtraStructuresSlots() {
+  // There are no extra structures in the base class.
+  return;
+}
+
 /* -------------------------------------------------------------------------- */
 // BOOKKEEPING: updates the SlotIdx in the old_smart_factors such that
 // this idx points to the updated slots in the graph after optimization.
@@ -1882,6 +2006,25 @@ void VioBackEnd::printSelectedGraph(
   std::cout << std::endl;
 }
 
+/* -------------------------------------------------------------------------- */
+void VioBackEnd::triangulateSmartFactors(
+    const std::vector<SmartStereoFactor::shared_ptr>& smart_factors,
+    std::vector<gtsam::TriangulationResult>* results) const {
+  if (results) {
+    results->assign(smart_factors.size(),
+                    gtsam::TriangulationResult::Degenerate());
+  }
+  if (smart_factors.empty()) return;
+  // Each smart factor caches its own triangulation, and state_ and
+  // new_values_ are only read, so the factors can be split among OpenCV's
+  // worker threads.
+  const int n_stripes = std::max(FLAGS_smart_factor_triangulation_stripes, 1);
+  cv::parallel_for_(
+      cv::Range(0, static_cast<int>(smart_factors.size())),
+      SmartFactorTriangulationBody(state_, new_values_, smart_factors, results),
+      static_cast<double>(n_stripes));
+}
+
 /* -------------------------------------------------------------------------- */
 void VioBackEnd::computeSmartFactorStatistics() {
   // Compute number of valid/degenerate
@@ -15,6 +15,14 @@
 
 #include "kimera-vio/dataprovider/DataProviderModule.h"
 
+#include <gflags/gflags.h>
+
+DEFINE_int32(max_frame_queue_depth,
+             0,
+             "Overload mode: drop the oldest stereo frames while more than "
+             "this many are waiting in the data provider, their IMU data is "
+             "sent with the next frame. 0 disables it.");
+
 namespace VIO {
 
 DataProviderModule::DataProviderModule(
@@ -30,7 +38,10 @@ DataProviderModule::DataProviderModule(
       left_frame_queue_("data_provider_left_frame_queue"),
       right_frame_queue_("data_provider_right_frame_queue"),
       stereo_matching_params_(stereo_matching_params),
-      timestamp_last_frame_(kNoFrameYet) {}
+      timestamp_last_frame_(kNoFrameYet),
+      n_dropped_frames_(0u) {
+  CHECK_GE(FLAGS_max_frame_queue_depth, 0);
+}
 
 DataProviderModule::InputUniquePtr DataProviderModule::getInputPacket() {
   // Look for a left frame inside the queue.
@@ -65,6 +76,18 @@ DataProviderModule::InputUniquePtr DataProviderModule::getInputPacket() {
   }
   CHECK(right_frame_payload);
 
+  if (timestamp_last_frame_ != kNoFrameYet && isOverloaded()) {
+    // Keep timestamp_last_frame_, so that the IMU data of the dropped frames
+    // is sent with the next frame and the preintegration goes on across them.
+    ++n_dropped_frames_;
+    VLOG(1) << "Overload: dropping stereo frame with id "
+            << left_frame_payload->id_ << ", " << left_frame_queue_.size()
+            << " frames waiting.";
+    LOG_EVERY_N(WARNING, 100) << "Overload: dropped " << n_dropped_frames_
+                              << " stereo frames so far.";
+    return nullptr;
+  }
+
   if (imu_data_.imu_buffer_.size() == 0) {
     VLOG(1) << "No IMU measurements available yet, dropping this frame.";
     return nullptr;
@@ -155,16 +178,20 @@ DataProviderModule::InputUniquePtr DataProviderModule::getInputPacket() {
 
   if (!shutdown_) {
     CHECK(vio_pipeline_callback_);
-    vio_pipeline_callback_(VIO::make_unique<StereoImuSyncPacket>(
-        StereoFrame(
-            left_frame_payload->id_,
-            timestamp,
-            *left_frame_payload,
-            *right_frame_payload,
-            stereo_matching_params_),  // TODO(Toni): these params should
+    StereoFrame stereo_frame(
+        left_frame_payload->id_,
+        timestamp,
+        *left_frame_payload,
+        *right_frame_payload,
+        stereo_matching_params_,  // TODO(Toni): these params should
         // be given in PipelineParams.
-        imu_meas.timestamps_,
-        imu_meas.acc_gyr_));
+        stereo_rectification_);
+    // Only the first frame pays for computing the rectification.
+    stereo_rectification_ = stereo_frame.getRectification();
+    vio_pipeline_callback_(
+        VIO::make_unique<StereoImuSyncPacket>(std::move(stereo_frame),
+                                              imu_meas.timestamps_,
+                                              imu_meas.acc_gyr_));
   }
 
   // Push the synced messages to the frontend's input queue
@@ -184,6 +211,12 @@ DataProviderModule::InputUniquePtr DataProviderModule::getInputPacket() {
   return nullptr;
 }
 
+bool DataProviderModule::isOverloaded() const {
+  return FLAGS_max_frame_queue_depth > 0 &&
+         left_frame_queue_.size() >
+             static_cast<size_t>(FLAGS_max_frame_queue_depth);
+}
+
 void DataProviderModule::shutdownQueues() {
   left_frame_queue_.shutdown();
   right_frame_queue_.shutdown();
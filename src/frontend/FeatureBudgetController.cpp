@@ -0,0 +1,158 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   FeatureBudgetController.cpp
+ * @brief  Closed-loop control of the number of features, detector threshold
+ * and KLT effort of the frontend to hold a target latency.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/frontend/FeatureBudgetController.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+namespace {
+
+// Multiplicative step of the detector threshold scale per keyframe.
+constexpr double kThresholdScaleStep = 1.25;
+
+// Interpolates in [min_value, max_value] given a ratio in [0, 1].
+int interpolate(const int& min_value, const int& max_value, const double& t) {
+  return min_value +
+         static_cast<int>(std::lround(t * (max_value - min_value)));
+}
+
+}  // namespace
+
+FeatureBudgetController::FeatureBudgetController(
+    const FeatureBudgetControllerParams& params)
+    : params_(params),
+      budget_(),
+      effort_(1.0),
+      integral_(0.0),
+      smoothed_latency_ms_(0.0),
+      has_latency_(false),
+      min_effort_(0.0) {
+  CHECK_GT(params_.target_latency_ms_, 0.0);
+  CHECK_GE(params_.min_features_per_frame_, 0);
+  CHECK_LE(params_.min_features_per_frame_, params_.max_features_per_frame_);
+  CHECK_GE(params_.min_klt_max_level_, 0);
+  CHECK_LE(params_.min_klt_max_level_, params_.max_klt_max_level_);
+  CHECK_GT(params_.min_klt_max_iter_, 0);
+  CHECK_LE(params_.min_klt_max_iter_, params_.max_klt_max_iter_);
+  CHECK_GT(params_.min_threshold_scale_, 0.0);
+  CHECK_LE(params_.min_threshold_scale_, 1.0);
+  CHECK_GE(params_.max_threshold_scale_, 1.0);
+  CHECK_GT(params_.latency_smoothing_, 0.0);
+  CHECK_LE(params_.latency_smoothing_, 1.0);
+  CHECK_GT(params_.min_inlier_ratio_, 0.0);
+
+  // Full effort until we know better.
+  budget_.max_features_per_frame_ = params_.max_features_per_frame_;
+  budget_.threshold_scale_ = 1.0;
+  budget_.klt_max_level_ = params_.max_klt_max_level_;
+  budget_.klt_max_iter_ = params_.max_klt_max_iter_;
+}
+
+/* -------------------------------------------------------------------------- */
+const FeatureBudget& FeatureBudgetController::update(
+    const FeatureBudgetMeasurement& measurement) {
+  CHECK_GE(measurement.latency_ms_, 0.0);
+  if (has_latency_) {
+    smoothed_latency_ms_ += params_.latency_smoothing_ *
+                            (measurement.latency_ms_ - smoothed_latency_ms_);
+  } else {
+    smoothed_latency_ms_ = measurement.latency_ms_;
+    has_latency_ = true;
+  }
+
+  // A lagging backend is as much a symptom of too many features as a late
+  // frontend, since each feature track is a factor in the backend.
+  double target_latency_ms = params_.target_latency_ms_;
+  if (measurement.backend_lag_ > params_.max_backend_lag_) {
+    target_latency_ms *= static_cast<double>(params_.max_backend_lag_ + 1u) /
+                         static_cast<double>(measurement.backend_lag_ + 1u);
+  }
+  // Positive if there is headroom, relative to the target.
+  const double latency_error =
+      (target_latency_ms - smoothed_latency_ms_) / target_latency_ms;
+
+  // Tracking quality, only known for keyframes.
+  if (measurement.is_keyframe_ && measurement.n_tracked_ > 0u) {
+    const double inlier_ratio = static_cast<double>(measurement.n_inliers_) /
+                                static_cast<double>(measurement.n_tracked_);
+    min_effort_ = std::min(
+        std::max((params_.min_inlier_ratio_ - inlier_ratio) /
+                     params_.min_inlier_ratio_,
+                 0.0),
+        1.0);
+  }
+
+  // PI controller, the integral is frozen while saturated (anti-windup).
+  const double integral = integral_ + latency_error;
+  const double effort =
+      1.0 + params_.kp_ * latency_error + params_.ki_ * integral;
+  const bool saturated_high = effort >= 1.0 && latency_error > 0.0;
+  const bool saturated_low = effort <= min_effort_ && latency_error < 0.0;
+  if (!saturated_high && !saturated_low) integral_ = integral;
+  effort_ = std::min(std::max(effort, min_effort_), 1.0);
+
+  // Shed features first, then the KLT effort.
+  budget_.max_features_per_frame_ =
+      interpolate(params_.min_features_per_frame_,
+                  params_.max_features_per_frame_,
+                  effort_);
+  const double klt_effort = std::min(2.0 * effort_, 1.0);
+  budget_.klt_max_level_ = interpolate(
+      params_.min_klt_max_level_, params_.max_klt_max_level_, klt_effort);
+  budget_.klt_max_iter_ = interpolate(
+      params_.min_klt_max_iter_, params_.max_klt_max_iter_, klt_effort);
+
+  updateThresholdScale(measurement, latency_error);
+
+  VLOG(5) << "Feature budget: latency " << smoothed_latency_ms_ << " [ms]"
+          << " (target " << target_latency_ms << " [ms])"
+          << ", effort " << effort_ << " (min " << min_effort_ << ")"
+          << ", max features " << budget_.max_features_per_frame_
+          << ", threshold scale " << budget_.threshold_scale_
+          << ", KLT levels " << budget_.klt_max_level_ << ", KLT iterations "
+          << budget_.klt_max_iter_;
+  return budget_;
+}
+
+/* -------------------------------------------------------------------------- */
+void FeatureBudgetController::updateThresholdScale(
+    const FeatureBudgetMeasurement& measurement,
+    const double& latency_error) {
+  // Only keyframes detect features.
+  if (!measurement.is_keyframe_ || measurement.n_requested_ == 0u) return;
+  const double detection_ratio =
+      static_cast<double>(measurement.n_detected_) /
+      static_cast<double>(measurement.n_requested_);
+  double& scale = budget_.threshold_scale_;
+  if (detection_ratio < params_.min_detection_ratio_) {
+    // Low texture: look for weaker corners.
+    scale /= kThresholdScaleStep;
+  } else if (latency_error < 0.0) {
+    // Enough corners but late: fewer candidates are cheaper to suppress.
+    scale *= kThresholdScaleStep;
+  } else if (scale > 1.0) {
+    // Back to nominal once on time.
+    scale = std::max(scale / kThresholdScaleStep, 1.0);
+  }
+  scale = std::min(std::max(scale, params_.min_threshold_scale_),
+                   params_.max_threshold_scale_);
+}
+
+}  // namespace VIO
@@ -20,6 +20,11 @@
 #include <opencv2/core/core.hpp>
 
 DEFINE_bool(images_rectified, false, "Input image data already rectified.");
+DEFINE_bool(lazy_stereo_rectification,
+            false,
+            "Only undistort and rectify the stereo images when they are "
+            "needed for stereo matching, i.e. for keyframes. Non-keyframes "
+            "only track features in the left (unrectified) image.");
 
 namespace VIO {
 
@@ -28,7 +33,8 @@ StereoFrame::StereoFrame(const FrameId& id,
                          const Timestamp& timestamp,
                          const Frame& left_frame,
                          const Frame& right_frame,
-                         const StereoMatchingParams& stereo_matching_params)
+                         const StereoMatchingParams& stereo_matching_params,
+                         const StereoRectification::ConstPtr& rectification)
     : id_(id),
       timestamp_(timestamp),
       // TODO(Toni): these copies are the culprits of all evil...
@@ -39,7 +45,7 @@ StereoFrame::StereoFrame(const FrameId& id,
       // TODO(Toni): completely useless to copy params all the time...
       sparse_stereo_params_(stereo_matching_params),
       baseline_(0.0) {
-  initialize(left_frame_.cam_param_, right_frame_.cam_param_);
+  initialize(left_frame_.cam_param_, right_frame_.cam_param_, rectification);
   CHECK_EQ(id_, left_frame_.id_);
   CHECK_EQ(id_, right_frame_.id_);
   CHECK_EQ(timestamp_, left_frame_.timestamp_);
@@ -53,7 +59,8 @@ StereoFrame::StereoFrame(const FrameId& id,
                          const CameraParams& cam_param_left,
                          const cv::Mat& right_image,
                          const CameraParams& cam_param_right,
-                         const StereoMatchingParams& stereo_matching_params)
+                         const StereoMatchingParams& stereo_matching_params,
+                         const StereoRectification::ConstPtr& rectification)
     : id_(id),
       timestamp_(timestamp),
       left_frame_(id, timestamp, cam_param_left, left_image),
@@ -62,15 +69,17 @@ StereoFrame::StereoFrame(const FrameId& id,
       is_keyframe_(false),
       sparse_stereo_params_(stereo_matching_params),
       baseline_(0.0) {
-  initialize(cam_param_left, cam_param_right);
+  initialize(cam_param_left, cam_param_right, rectification);
   CHECK_EQ(id_, left_frame_.id_);
   CHECK_EQ(id_, right_frame_.id_);
   CHECK_EQ(timestamp_, left_frame_.timestamp_);
   CHECK_EQ(timestamp_, right_frame_.timestamp_);
 }
 
-void StereoFrame::initialize(const CameraParams& cam_param_left,
-                             const CameraParams& cam_param_right) {
+void StereoFrame::initialize(
+    const CameraParams& cam_param_left,
+    const CameraParams& cam_param_right,
+    const StereoRectification::ConstPtr& rectification) {
   // If input is rectified already
   if (is_rectified_) {
     left_img_rectified_ = left_frame_.img_;
@@ -84,41 +93,32 @@ void StereoFrame::initialize(const CameraParams& cam_param_left,
         cam_param_left.body_Pose_cam_.between(cam_param_right.body_Pose_cam_)
             .x();
   } else {
-    // TODO(Toni): the undistRect maps should be computed once and cached!!
-    computeRectificationParameters(
-        &left_frame_.cam_param_, &right_frame_.cam_param_, &B_Pose_camLrect_);
-    // TODO REMOVE ASSUMPTION ON x aligned stereo camera, can't we just take the
-    // norm?
-    baseline_ = left_frame_.cam_param_.body_Pose_cam_
-                    .between(right_frame_.cam_param_.body_Pose_cam_)
-                    .x();
-    left_undistRectCameraMatrix_ =
-        UtilsOpenCV::Cvmat2Cal3_S2(left_frame_.cam_param_.P_);
-    right_undistRectCameraMatrix_ =
-        UtilsOpenCV::Cvmat2Cal3_S2(right_frame_.cam_param_.P_);
-    //! Sanity check that rectified baseline remains within 10% of the
-    //! expected baseline.
-    const double& nominal_baseline = sparse_stereo_params_.nominal_baseline_;
-    static constexpr double kBaselineTolerance = 0.10;
-    if (baseline_ > (1.0 + kBaselineTolerance) * nominal_baseline ||
-        baseline_ < (1.0 - kBaselineTolerance) * nominal_baseline) {
-      LOG(FATAL) << "Baseline after rectification differs from nominal: \n"
-                 << "- Abnormal baseline: " << baseline_ << '\n'
-                 << "- Nominal baseline: " << nominal_baseline << '\n'
-                 << "(not within +/-10% bounds)";
+    if (rectification) {
+      // The rectification only depends on the calibration: reuse it.
+      CHECK(rectification->left_cam_param_.body_Pose_cam_.equals(
+          cam_param_left.body_Pose_cam_));
+      CHECK(rectification->right_cam_param_.body_Pose_cam_.equals(
+          cam_param_right.body_Pose_cam_));
+      CHECK_EQ(rectification->left_cam_param_.image_size_,
+               cam_param_left.image_size_);
+      CHECK_EQ(rectification->right_cam_param_.image_size_,
+               cam_param_right.image_size_);
+      rectification_ = rectification;
+    } else {
+      rectification_ = computeRectification(
+          cam_param_left, cam_param_right, sparse_stereo_params_);
     }
-    //! Rectify and undistort images
-    cv::remap(left_frame_.img_,
-              left_img_rectified_,
-              left_frame_.cam_param_.undistort_rectify_map_x_,
-              left_frame_.cam_param_.undistort_rectify_map_y_,
-              cv::INTER_LINEAR);
-    cv::remap(right_frame_.img_,
-              right_img_rectified_,
-              right_frame_.cam_param_.undistort_rectify_map_x_,
-              right_frame_.cam_param_.undistort_rectify_map_y_,
-              cv::INTER_LINEAR);
+    // Shallow copies: the undistortion maps are shared with other frames.
+    left_frame_.cam_param_ = rectification_->left_cam_param_;
+    right_frame_.cam_param_ = rectification_->right_cam_param_;
+    left_undistRectCameraMatrix_ = rectification_->left_undistRectCameraMatrix_;
+    right_undistRectCameraMatrix_ =
+        rectification_->right_undistRectCameraMatrix_;
+    B_Pose_camLrect_ = rectification_->B_Pose_camLrect_;
+    baseline_ = rectification_->baseline_;
     is_rectified_ = true;
+    //! Rectify and undistort images, unless it can wait for stereo matching.
+    if (!FLAGS_lazy_stereo_rectification) undistortRectifyImages();
   }
   VLOG(10) << "- size before (left): " << left_frame_.img_.rows << " x "
            << left_frame_.img_.cols << '\n'
@@ -130,6 +130,22 @@ void StereoFrame::initialize(const CameraParams& cam_param_left,
            << right_img_rectified_.cols;
 }
 
+/* -------------------------------------------------------------------------- */
+void StereoFrame::undistortRectifyImages() {
+  CHECK(is_rectified_) << "Rectification parameters are not available.";
+  if (!left_img_rectified_.empty() && !right_img_rectified_.empty()) return;
+  cv::remap(left_frame_.img_,
+            left_img_rectified_,
+            left_frame_.cam_param_.undistort_rectify_map_x_,
+            left_frame_.cam_param_.undistort_rectify_map_y_,
+            cv::INTER_LINEAR);
+  cv::remap(right_frame_.img_,
+            right_img_rectified_,
+            right_frame_.cam_param_.undistort_rectify_map_x_,
+            right_frame_.cam_param_.undistort_rectify_map_y_,
+            cv::INTER_LINEAR);
+}
+
 /* -------------------------------------------------------------------------- */
 // TODO: Clean up RGBD
 // TODO: this should be in StereoMatcher
@@ -144,6 +160,8 @@ void StereoFrame::sparseStereoMatching(const int verbosity) {
   }
 
   CHECK(is_rectified_);
+  // Rectified images are only computed here if lazy_stereo_rectification.
+  undistortRectifyImages();
 
   // Get rectified left keypoints.
   StatusKeypointsCV left_keypoints_rectified;
@@ -580,24 +598,64 @@ void StereoFrame::computeImgGradients(const cv::Mat& img,
 
 /* -------------------------------------------------------------------------- */
 void StereoFrame::cloneRectificationParameters(const StereoFrame& sf) {
+  // cv::Mat assignment shares the data: the maps are never modified in place.
   left_frame_.cam_param_.R_rectify_ = sf.left_frame_.cam_param_.R_rectify_;
   right_frame_.cam_param_.R_rectify_ = sf.right_frame_.cam_param_.R_rectify_;
   B_Pose_camLrect_ = sf.B_Pose_camLrect_;
   baseline_ = sf.baseline_;
   left_frame_.cam_param_.undistort_rectify_map_x_ =
-      sf.left_frame_.cam_param_.undistort_rectify_map_x_.clone();
+      sf.left_frame_.cam_param_.undistort_rectify_map_x_;
   left_frame_.cam_param_.undistort_rectify_map_y_ =
-      sf.left_frame_.cam_param_.undistort_rectify_map_y_.clone();
+      sf.left_frame_.cam_param_.undistort_rectify_map_y_;
   right_frame_.cam_param_.undistort_rectify_map_x_ =
-      sf.right_frame_.cam_param_.undistort_rectify_map_x_.clone();
+      sf.right_frame_.cam_param_.undistort_rectify_map_x_;
   right_frame_.cam_param_.undistort_rectify_map_y_ =
-      sf.right_frame_.cam_param_.undistort_rectify_map_y_.clone();
-  left_frame_.cam_param_.P_ = sf.left_frame_.cam_param_.P_.clone();
-  right_frame_.cam_param_.P_ = sf.right_frame_.cam_param_.P_.clone();
+      sf.right_frame_.cam_param_.undistort_rectify_map_y_;
+  left_frame_.cam_param_.P_ = sf.left_frame_.cam_param_.P_;
+  right_frame_.cam_param_.P_ = sf.right_frame_.cam_param_.P_;
   left_undistRectCameraMatrix_ = sf.left_undistRectCameraMatrix_;
   right_undistRectCameraMatrix_ = sf.right_undistRectCameraMatrix_;
+  rectification_ = sf.rectification_;
   is_rectified_ = true;
-  VLOG(10) << "cloned undistRect maps and other rectification parameters!";
+  VLOG(10) << "shared undistRect maps and other rectification parameters!";
+}
+
+/* -------------------------------------------------------------------------- */
+StereoRectification::ConstPtr StereoFrame::computeRectification(
+    const CameraParams& cam_param_left,
+    const CameraParams& cam_param_right,
+    const StereoMatchingParams& stereo_matching_params) {
+  StereoRectification::Ptr rectification =
+      std::make_shared<StereoRectification>();
+  rectification->left_cam_param_ = cam_param_left;
+  rectification->right_cam_param_ = cam_param_right;
+  computeRectificationParameters(&rectification->left_cam_param_,
+                                 &rectification->right_cam_param_,
+                                 &rectification->B_Pose_camLrect_);
+  // TODO REMOVE ASSUMPTION ON x aligned stereo camera, can't we just take the
+  // norm?
+  rectification->baseline_ =
+      rectification->left_cam_param_.body_Pose_cam_
+          .between(rectification->right_cam_param_.body_Pose_cam_)
+          .x();
+  rectification->left_undistRectCameraMatrix_ =
+      UtilsOpenCV::Cvmat2Cal3_S2(rectification->left_cam_param_.P_);
+  rectification->right_undistRectCameraMatrix_ =
+      UtilsOpenCV::Cvmat2Cal3_S2(rectification->right_cam_param_.P_);
+  //! Sanity check that rectified baseline remains within 10% of the
+  //! expected baseline.
+  const double& baseline = rectification->baseline_;
+  const double& nominal_baseline = stereo_matching_params.nominal_baseline_;
+  static constexpr double kBaselineTolerance = 0.10;
+  if (baseline > (1.0 + kBaselineTolerance) * nominal_baseline ||
+      baseline < (1.0 - kBaselineTolerance) * nominal_baseline) {
+    LOG(FATAL) << "Baseline after rectification differs from nominal: \n"
+               << "- Abnormal baseline: " << baseline << '\n'
+               << "- Nominal baseline: " << nominal_baseline << '\n'
+               << "(not within +/-10% bounds)";
+  }
+  VLOG(10) << "Computed undistRect maps and other rectification parameters!";
+  return rectification;
 }
 
 /* -------------------------------------------------------------------------- */
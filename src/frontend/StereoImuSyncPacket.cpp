@@ -19,12 +19,12 @@
 #include <utility>
 
 namespace VIO {
-StereoImuSyncPacket::StereoImuSyncPacket(const StereoFrame& stereo_frame,
+StereoImuSyncPacket::StereoImuSyncPacket(StereoFrame stereo_frame,
                                          const ImuStampS& imu_stamps,
                                          const ImuAccGyrS& imu_accgyrs,
                                          const ReinitPacket& reinit_packet)
     : PipelinePayload(stereo_frame.getTimestamp()),
-      stereo_frame_(stereo_frame),
+      stereo_frame_(std::move(stereo_frame)),
       imu_stamps_(imu_stamps),
       imu_accgyrs_(imu_accgyrs),
       reinit_packet_(reinit_packet) {
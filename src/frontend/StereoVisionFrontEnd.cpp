@@ -15,6 +15,10 @@
 
 #include "kimera-vio/frontend/StereoVisionFrontEnd.h"
 
+#include <algorithm>
+#include <thread>
+#include <utility>
+
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
@@ -39,6 +43,18 @@ DEFINE_bool(log_mono_tracking_images,
 DEFINE_bool(log_stereo_matching_images,
             false,
             "Display/Save mono tracking rectified and unrectified images.");
+DEFINE_bool(parallel_outlier_rejection,
+            false,
+            "Run the mono and stereo outlier rejection of keyframes "
+            "concurrently.");
+DEFINE_bool(feature_budget_control,
+            false,
+            "Adapt the number of features, the detector threshold and the KLT "
+            "effort of the frontend to hold a target latency.");
+DEFINE_double(feature_budget_target_latency_ms,
+              30.0,
+              "Frontend processing time per frame to hold with "
+              "feature_budget_control [ms].");
 
 namespace VIO {
 
@@ -58,6 +74,9 @@ StereoVisionFrontEnd::StereoVisionFrontEnd(
       keyframe_count_(0),
       feature_detector_(nullptr),
       tracker_(frontend_params, camera_params, display_queue),
+      feature_budget_controller_(nullptr),
+      feature_budget_measurement_(),
+      keyframes_pending_backend_(),
       trackerStatusSummary_(),
       output_images_path_("./outputImages/"),
       display_queue_(display_queue),
@@ -73,29 +92,53 @@ StereoVisionFrontEnd::StereoVisionFrontEnd(
   // Instantiate IMU frontend.
   imu_frontend_ = VIO::make_unique<ImuFrontEnd>(imu_params, imu_initial_bias);
 
+  if (FLAGS_feature_budget_control) {
+    // The params are the upper bound of the budget. The lower bound must stay
+    // clear of the number of features that triggers a keyframe.
+    FeatureBudgetControllerParams budget_params;
+    budget_params.target_latency_ms_ = FLAGS_feature_budget_target_latency_ms;
+    budget_params.max_features_per_frame_ =
+        frontend_params.feature_detector_params_.max_features_per_frame_;
+    budget_params.min_features_per_frame_ =
+        std::min(std::max(2 * static_cast<int>(
+                                  frontend_params.min_number_features_),
+                          budget_params.max_features_per_frame_ / 4),
+                 budget_params.max_features_per_frame_);
+    budget_params.max_klt_max_level_ = frontend_params.klt_max_level_;
+    budget_params.min_klt_max_level_ =
+        std::min(budget_params.min_klt_max_level_,
+                 budget_params.max_klt_max_level_);
+    budget_params.max_klt_max_iter_ = frontend_params.klt_max_iter_;
+    budget_params.min_klt_max_iter_ = std::min(
+        budget_params.min_klt_max_iter_, budget_params.max_klt_max_iter_);
+    feature_budget_controller_ =
+        VIO::make_unique<FeatureBudgetController>(budget_params);
+  }
+
   if (VLOG_IS_ON(1)) tracker_.tracker_params_.print();
 }
 
 /* -------------------------------------------------------------------------- */
 FrontendOutput::UniquePtr StereoVisionFrontEnd::spinOnce(
-    const StereoFrontEndInputPayload& input) {
+    StereoFrontEndInputPayload::UniquePtr input) {
+  CHECK(input);
   switch (frontend_state_) {
     case FrontendState::Bootstrap: {
-      return bootstrapSpin(input);
+      return bootstrapSpin(std::move(input));
     } break;
     case FrontendState::Nominal: {
-      return nominalSpin(input);
+      return nominalSpin(std::move(input));
     } break;
     default: { LOG(FATAL) << "Unrecognized frontend state."; } break;
   }
 }
 
 FrontendOutput::UniquePtr StereoVisionFrontEnd::bootstrapSpin(
-    const StereoFrontEndInputPayload& input) {
+    StereoFrontEndInputPayload::UniquePtr input) {
   CHECK(frontend_state_ == FrontendState::Bootstrap);
 
   // Initialize members of the frontend
-  processFirstStereoFrame(input.getStereoFrame());
+  processFirstStereoFrame(input->releaseStereoFrame());
 
   // Initialization done, set state to nominal
   frontend_state_ = FrontendState::Nominal;
@@ -108,13 +151,13 @@ FrontendOutput::UniquePtr StereoVisionFrontEnd::bootstrapSpin(
                                           getRelativePoseBodyStereo(),
                                           *stereoFrame_lkf_,
                                           nullptr,
-                                          input.getImuAccGyrs(),
+                                          input->getImuAccGyrs(),
                                           cv::Mat(),
                                           getTrackerInfo());
 }
 
 FrontendOutput::UniquePtr StereoVisionFrontEnd::nominalSpin(
-    const StereoFrontEndInputPayload& input) {
+    StereoFrontEndInputPayload::UniquePtr input) {
   CHECK(frontend_state_ == FrontendState::Nominal);
   // For timing
   utils::StatsCollector timing_stats_frame_rate("VioFrontEnd Frame Rate [ms]");
@@ -123,15 +166,14 @@ FrontendOutput::UniquePtr StereoVisionFrontEnd::nominalSpin(
   auto start_time = utils::Timer::tic();
 
   // Get stereo info
-  const StereoFrame& stereoFrame_k = input.getStereoFrame();
-  const auto& k = stereoFrame_k.getFrameId();
+  const FrameId k = input->getStereoFrame().getFrameId();
   VLOG(1) << "------------------- Processing frame k = " << k
           << "--------------------";
 
   ////////////////////////////// PROCESS IMU DATA //////////////////////////////
 
   // Print IMU data.
-  if (VLOG_IS_ON(10)) input.print();
+  if (VLOG_IS_ON(10)) input->print();
 
   // For k > 1
   // The preintegration btw frames is needed for RANSAC.
@@ -142,7 +184,7 @@ FrontendOutput::UniquePtr StereoVisionFrontEnd::nominalSpin(
   // into account!!!).
   auto tic_full_preint = utils::Timer::tic();
   const ImuFrontEnd::PimPtr& pim = imu_frontend_->preintegrateImuMeasurements(
-      input.getImuStamps(), input.getImuAccGyrs());
+      input->getImuStamps(), input->getImuAccGyrs());
   CHECK(pim);
 
   auto full_preint_duration =
@@ -168,6 +210,14 @@ FrontendOutput::UniquePtr StereoVisionFrontEnd::nominalSpin(
     body_Rot_cam.print("Body_Rot_cam");
     camLrectLkf_R_camLrectK_imu.print("calLrectLkf_R_camLrectK_imu");
   }
+
+  // Full pose of the left camera (unrectified, as the tracker uses it).
+  boost::optional<gtsam::Pose3> camLlkf_P_camLk_imu = boost::none;
+  if (tracker_.tracker_params_.optical_flow_predictor_type_ ==
+      OpticalFlowPredictorType::kPose) {
+    camLlkf_P_camLk_imu = predictKeyframePoseCurFrame(
+        *pim, stereoFrame_km1_->getLeftFrame().cam_param_.body_Pose_cam_);
+  }
   //////////////////////////////////////////////////////////////////////////////
 
   /////////////////////////////// TRACKING /////////////////////////////////////
@@ -175,11 +225,17 @@ FrontendOutput::UniquePtr StereoVisionFrontEnd::nominalSpin(
   // Rotation used in 1 and 2 point ransac.
   VLOG(10) << "Starting processStereoFrame...";
   cv::Mat feature_tracks;
-  StatusStereoMeasurementsPtr status_stereo_measurements = processStereoFrame(
-      stereoFrame_k, camLrectLkf_R_camLrectK_imu, &feature_tracks);
+  StatusStereoMeasurementsPtr status_stereo_measurements =
+      processStereoFrame(input->releaseStereoFrame(),
+                         camLrectLkf_R_camLrectK_imu,
+                         &feature_tracks,
+                         camLlkf_P_camLk_imu);
 
   CHECK(!stereoFrame_k_);  // processStereoFrame is setting this to nullptr!!!
   VLOG(10) << "Finished processStereoFrame.";
+
+  // Adapt the detector and tracker for the next frames.
+  updateFeatureBudget(utils::Timer::toc(start_time).count());
   //////////////////////////////////////////////////////////////////////////////
 
   if (stereoFrame_km1_->isKeyframe()) {
@@ -224,7 +280,7 @@ FrontendOutput::UniquePtr StereoVisionFrontEnd::nominalSpin(
         getRelativePoseBodyStereo(),
         *stereoFrame_lkf_, //! This is really the current keyframe in this if
         pim,
-        input.getImuAccGyrs(),
+        input->getImuAccGyrs(),
         feature_tracks,
         getTrackerInfo());
   } else {
@@ -239,7 +295,7 @@ FrontendOutput::UniquePtr StereoVisionFrontEnd::nominalSpin(
                                             getRelativePoseBodyStereo(),
                                             *stereoFrame_lkf_,
                                             pim,
-                                            input.getImuAccGyrs(),
+                                            input->getImuAccGyrs(),
                                             feature_tracks,
                                             getTrackerInfo());
   }
@@ -248,11 +304,9 @@ FrontendOutput::UniquePtr StereoVisionFrontEnd::nominalSpin(
 /* -------------------------------------------------------------------------- */
 // TODO this can be greatly improved, but we need to get rid of global variables
 // stereoFrame_km1_, stereoFrame_lkf_, stereoFrame_k_, etc...
-void StereoVisionFrontEnd::processFirstStereoFrame(
-    const StereoFrame& firstFrame) {
+void StereoVisionFrontEnd::processFirstStereoFrame(StereoFrame firstFrame) {
   VLOG(2) << "Processing first stereo frame \n";
-  stereoFrame_k_ =
-      std::make_shared<StereoFrame>(firstFrame);  // TODO this can be optimized!
+  stereoFrame_k_ = std::make_shared<StereoFrame>(std::move(firstFrame));
   stereoFrame_k_->setIsKeyframe(true);
   last_keyframe_timestamp_ = stereoFrame_k_->getTimestamp();
 
@@ -268,6 +322,8 @@ void StereoVisionFrontEnd::processFirstStereoFrame(
 
   // Get 3D points via stereo.
   stereoFrame_k_->sparseStereoMatching();
+  keyframe_P_ref_frame_ = gtsam::Pose3();
+  updateKeyframeLandmarks(*stereoFrame_k_);
 
   // Prepare for next iteration.
   stereoFrame_km1_ = stereoFrame_k_;
@@ -284,9 +340,10 @@ void StereoVisionFrontEnd::processFirstStereoFrame(
 // FRONTEND WORKHORSE
 // THIS FUNCTION CAN BE GREATLY OPTIMIZED
 StatusStereoMeasurementsPtr StereoVisionFrontEnd::processStereoFrame(
-    const StereoFrame& cur_frame,
+    StereoFrame cur_frame,
     const gtsam::Rot3& keyframe_R_cur_frame,
-    cv::Mat* feature_tracks) {
+    cv::Mat* feature_tracks,
+    const boost::optional<gtsam::Pose3>& keyframe_P_cur_frame) {
   VLOG(2) << "===================================================\n"
           << "Frame number: " << frame_count_ << " at time "
           << cur_frame.getTimestamp() << " empirical framerate (sec): "
@@ -295,14 +352,10 @@ StatusStereoMeasurementsPtr StereoVisionFrontEnd::processStereoFrame(
           << " (timestamp diff: "
           << cur_frame.getTimestamp() - stereoFrame_km1_->getTimestamp() << ")";
 
-  // TODO this copies the stereo frame!!
-  stereoFrame_k_ = std::make_shared<StereoFrame>(cur_frame);
-
-  // Copy rectification from previous frame to avoid recomputing it.
-  // TODO avoid copying altogether...
-  auto start_time = utils::Timer::tic();
-  stereoFrame_k_->cloneRectificationParameters(*stereoFrame_km1_);
-  double clone_rect_params_time = utils::Timer::toc(start_time).count();
+  // The rectification is already shared with the previous frames.
+  stereoFrame_k_ = std::make_shared<StereoFrame>(std::move(cur_frame));
+  CHECK(stereoFrame_k_->isRectified());
+  feature_budget_measurement_ = FeatureBudgetMeasurement();
 
   /////////////////////// TRACKING /////////////////////////////////////////////
   VLOG(2) << "Starting feature tracking...";
@@ -312,7 +365,19 @@ StatusStereoMeasurementsPtr StereoVisionFrontEnd::processStereoFrame(
   // We need to use the frame to frame rotation.
   gtsam::Rot3 ref_frame_R_cur_frame =
       keyframe_R_ref_frame_.inverse().compose(keyframe_R_cur_frame);
-  tracker_.featureTracking(left_frame_km1, left_frame_k, ref_frame_R_cur_frame);
+  if (keyframe_P_cur_frame && keyframe_P_ref_frame_) {
+    // Predict the flow with the full pose and the depth of the landmarks.
+    std::vector<double> ref_depths;
+    getKeypointDepths(*left_frame_km1, *keyframe_P_ref_frame_, &ref_depths);
+    tracker_.featureTracking(left_frame_km1,
+                             left_frame_k,
+                             keyframe_P_ref_frame_->between(
+                                 *keyframe_P_cur_frame),
+                             ref_depths);
+  } else {
+    tracker_.featureTracking(
+        left_frame_km1, left_frame_k, ref_frame_R_cur_frame);
+  }
 
   if (feature_tracks) {
     // TODO(Toni): these feature tracks are not outlier rejected...
@@ -356,15 +421,36 @@ StatusStereoMeasurementsPtr StereoVisionFrontEnd::processStereoFrame(
         << "Keyframe reason: low nr of features (" << nr_valid_features << " < "
         << tracker_.tracker_params_.min_number_features_ << ").";
 
+    auto start_time = utils::Timer::tic();
     double sparse_stereo_time = 0;
     if (tracker_.tracker_params_.useRANSAC_) {
       // MONO geometric outlier rejection
       TrackingStatusPose status_pose_mono;
       Frame* left_frame_lkf = stereoFrame_lkf_->getLeftFrameMutable();
-      outlierRejectionMono(keyframe_R_cur_frame,
-                           left_frame_lkf,
-                           left_frame_k,
-                           &status_pose_mono);
+      // In parallel, the stereo outlier rejection uses the mono matches
+      // prior to the mono outlier rejection, instead of reading the landmarks
+      // that the latter removes. A track survives if it is an inlier of both,
+      // regardless of which one finishes first.
+      const bool parallel_outlier_rejection =
+          FLAGS_parallel_outlier_rejection &&
+          tracker_.tracker_params_.useStereoTracking_;
+      KeypointMatches matches_ref_cur_mono;
+      std::thread mono_outlier_rejection;
+      if (parallel_outlier_rejection) {
+        Tracker::findMatchingKeypoints(
+            *left_frame_lkf, *left_frame_k, &matches_ref_cur_mono);
+        mono_outlier_rejection = std::thread([&]() {
+          outlierRejectionMono(keyframe_R_cur_frame,
+                               left_frame_lkf,
+                               left_frame_k,
+                               &status_pose_mono);
+        });
+      } else {
+        outlierRejectionMono(keyframe_R_cur_frame,
+                             left_frame_lkf,
+                             left_frame_k,
+                             &status_pose_mono);
+      }
 
       // STEREO geometric outlier rejection
       // get 3D points via stereo
@@ -373,10 +459,12 @@ StatusStereoMeasurementsPtr StereoVisionFrontEnd::processStereoFrame(
       sparse_stereo_time = utils::Timer::toc(start_time).count();
       TrackingStatusPose status_pose_stereo;
       if (tracker_.tracker_params_.useStereoTracking_) {
-        outlierRejectionStereo(keyframe_R_cur_frame,
-                               stereoFrame_lkf_,
-                               stereoFrame_k_,
-                               &status_pose_stereo);
+        outlierRejectionStereo(
+            keyframe_R_cur_frame,
+            stereoFrame_lkf_,
+            stereoFrame_k_,
+            &status_pose_stereo,
+            parallel_outlier_rejection ? &matches_ref_cur_mono : nullptr);
         if (status_pose_stereo.first == TrackingStatus::VALID) {
           trackerStatusSummary_.lkf_T_k_stereo_ = status_pose_stereo.second;
         }
@@ -385,6 +473,7 @@ StatusStereoMeasurementsPtr StereoVisionFrontEnd::processStereoFrame(
         status_pose_stereo.second = gtsam::Pose3();
         trackerStatusSummary_.kfTrackingStatus_stereo_ = TrackingStatus::INVALID;
       }
+      if (mono_outlier_rejection.joinable()) mono_outlier_rejection.join();
     } else {
       trackerStatusSummary_.kfTrackingStatus_mono_ = TrackingStatus::DISABLED;
       if (VLOG_IS_ON(2)) {
@@ -404,7 +493,21 @@ StatusStereoMeasurementsPtr StereoVisionFrontEnd::processStereoFrame(
     // Perform feature detection (note: this must be after RANSAC,
     // since if we discard more features, we need to extract more)
     CHECK(feature_detector_);
+    const size_t nr_inliers = left_frame_k->getNrValidKeypoints();
+    const size_t nr_keypoints = left_frame_k->keypoints_.size();
     feature_detector_->featureDetection(left_frame_k);
+    if (feature_budget_controller_) {
+      FeatureBudgetMeasurement& measurement = feature_budget_measurement_;
+      measurement.is_keyframe_ = true;
+      measurement.n_tracked_ = nr_valid_features;
+      measurement.n_inliers_ = nr_inliers;
+      measurement.n_requested_ = static_cast<size_t>(std::max(
+          feature_detector_->getMaxFeaturesPerFrame() -
+              static_cast<int>(nr_inliers),
+          0));
+      measurement.n_detected_ = left_frame_k->keypoints_.size() - nr_keypoints;
+      keyframes_pending_backend_.push_back(stereoFrame_k_->getTimestamp());
+    }
 
     // Get 3D points via stereo, including newly extracted
     // (this might be only for the visualization).
@@ -429,6 +532,7 @@ StatusStereoMeasurementsPtr StereoVisionFrontEnd::processStereoFrame(
 
     // Populate statistics.
     tracker_.checkStatusRightKeypoints(stereoFrame_k_->right_keypoints_status_);
+    updateKeyframeLandmarks(*stereoFrame_k_);
 
     // Move on.
     stereoFrame_lkf_ = stereoFrame_k_;
@@ -438,8 +542,7 @@ StatusStereoMeasurementsPtr StereoVisionFrontEnd::processStereoFrame(
     smart_stereo_measurements = getSmartStereoMeasurements(*stereoFrame_k_);
     double get_smart_stereo_meas_time = utils::Timer::toc(start_time).count();
 
-    VLOG(2) << "timeClone: " << clone_rect_params_time << '\n'
-            << "timeSparseStereo: " << sparse_stereo_time << '\n'
+    VLOG(2) << "timeSparseStereo: " << sparse_stereo_time << '\n'
             << "timeGetMeasurements: " << get_smart_stereo_meas_time;
   } else {
     stereoFrame_k_->setIsKeyframe(false);
@@ -449,10 +552,12 @@ StatusStereoMeasurementsPtr StereoVisionFrontEnd::processStereoFrame(
   if (stereoFrame_k_->isKeyframe()) {
     // Reset relative rotation if we have a keyframe.
     keyframe_R_ref_frame_ = gtsam::Rot3::identity();
+    keyframe_P_ref_frame_ = gtsam::Pose3();
   } else {
     // Update rotation from keyframe to next iteration reference frame (aka
     // cur_frame in current iteration).
     keyframe_R_ref_frame_ = keyframe_R_cur_frame;
+    keyframe_P_ref_frame_ = keyframe_P_cur_frame;
   }
 
   // Reset frames.
@@ -467,6 +572,115 @@ StatusStereoMeasurementsPtr StereoVisionFrontEnd::processStereoFrame(
                                                : SmartStereoMeasurements()));
 }
 
+/* -------------------------------------------------------------------------- */
+void StereoVisionFrontEnd::updateFeatureBudget(const double& latency_ms) {
+  if (!feature_budget_controller_) return;
+  feature_budget_measurement_.latency_ms_ = latency_ms;
+  feature_budget_measurement_.backend_lag_ = getBackendLag();
+  const FeatureBudget& budget =
+      feature_budget_controller_->update(feature_budget_measurement_);
+  CHECK(feature_detector_);
+  feature_detector_->setFeatureBudget(budget.max_features_per_frame_,
+                                      budget.threshold_scale_);
+  tracker_.setKltParams(budget.klt_max_level_, budget.klt_max_iter_);
+}
+
+/* -------------------------------------------------------------------------- */
+size_t StereoVisionFrontEnd::getBackendLag() {
+  Timestamp backend_timestamp;
+  {
+    std::lock_guard<std::mutex> lock(backend_state_mutex_);
+    if (!backend_state_) {
+      // Unknown, e.g. no backend.
+      keyframes_pending_backend_.clear();
+      return 0u;
+    }
+    backend_timestamp = backend_state_->timestamp_;
+  }
+  while (!keyframes_pending_backend_.empty() &&
+         keyframes_pending_backend_.front() <= backend_timestamp) {
+    keyframes_pending_backend_.pop_front();
+  }
+  return keyframes_pending_backend_.size();
+}
+
+/* -------------------------------------------------------------------------- */
+void StereoVisionFrontEnd::updateBackendState(
+    const VioNavStateTimestamped& W_State_Blkf) {
+  std::lock_guard<std::mutex> lock(backend_state_mutex_);
+  backend_state_ = VIO::make_unique<VioNavStateTimestamped>(W_State_Blkf);
+}
+
+/* -------------------------------------------------------------------------- */
+boost::optional<gtsam::Pose3> StereoVisionFrontEnd::predictKeyframePoseCurFrame(
+    const gtsam::PreintegrationType& pim,
+    const gtsam::Pose3& body_Pose_cam) const {
+  CHECK(stereoFrame_lkf_);
+  gtsam::NavState W_State_Blkf;
+  ImuBias imu_bias_lkf;
+  {
+    std::lock_guard<std::mutex> lock(backend_state_mutex_);
+    // The backend lags behind: it may not have estimated the last keyframe.
+    if (!backend_state_ ||
+        backend_state_->timestamp_ != stereoFrame_lkf_->getTimestamp()) {
+      return boost::none;
+    }
+    W_State_Blkf =
+        gtsam::NavState(backend_state_->pose_, backend_state_->velocity_);
+    imu_bias_lkf = backend_state_->imu_bias_;
+  }
+  // pim integrates the IMU measurements since the last keyframe.
+  const gtsam::NavState& W_State_Bk = pim.predict(W_State_Blkf, imu_bias_lkf);
+  const gtsam::Pose3& Blkf_Pose_Bk =
+      W_State_Blkf.pose().between(W_State_Bk.pose());
+  return body_Pose_cam.inverse() * Blkf_Pose_Bk * body_Pose_cam;
+}
+
+/* -------------------------------------------------------------------------- */
+void StereoVisionFrontEnd::updateKeyframeLandmarks(
+    const StereoFrame& stereo_keyframe) {
+  keyframe_lmks_.clear();
+  if (tracker_.tracker_params_.optical_flow_predictor_type_ !=
+      OpticalFlowPredictorType::kPose) {
+    return;
+  }
+  const Frame& left_frame = stereo_keyframe.getLeftFrame();
+  CHECK_EQ(stereo_keyframe.keypoints_3d_.size(), left_frame.landmarks_.size());
+  CHECK_EQ(stereo_keyframe.right_keypoints_status_.size(),
+           left_frame.landmarks_.size());
+  // keypoints_3d_ are expressed in the rectified left frame.
+  const gtsam::Rot3& camL_R_camLrect =
+      UtilsOpenCV::cvMatToGtsamRot3(left_frame.cam_param_.R_rectify_)
+          .inverse();
+  for (size_t i = 0u; i < left_frame.landmarks_.size(); ++i) {
+    const LandmarkId& lmk_id = left_frame.landmarks_[i];
+    if (lmk_id == -1 || stereo_keyframe.right_keypoints_status_[i] !=
+                            KeypointStatus::VALID) {
+      continue;
+    }
+    keyframe_lmks_[lmk_id] =
+        camL_R_camLrect.rotate(stereo_keyframe.keypoints_3d_[i]);
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+void StereoVisionFrontEnd::getKeypointDepths(
+    const Frame& frame,
+    const gtsam::Pose3& keyframe_P_frame,
+    std::vector<double>* depths) const {
+  CHECK_NOTNULL(depths)->clear();
+  depths->reserve(frame.landmarks_.size());
+  for (const LandmarkId& lmk_id : frame.landmarks_) {
+    const auto& it = keyframe_lmks_.find(lmk_id);
+    if (it == keyframe_lmks_.end()) {
+      depths->push_back(-1.0);
+    } else {
+      depths->push_back(keyframe_P_frame.transformTo(it->second).z());
+    }
+  }
+}
+
+/* -------------------------------------------------------------------------- */
 void StereoVisionFrontEnd::outlierRejectionMono(
     const gtsam::Rot3& calLrectLkf_R_camLrectKf_imu,
     Frame* left_frame_lkf,
@@ -505,7 +719,8 @@ void StereoVisionFrontEnd::outlierRejectionStereo(
     const gtsam::Rot3& calLrectLkf_R_camLrectKf_imu,
     const StereoFrame::Ptr& left_frame_lkf,
     const StereoFrame::Ptr& left_frame_k,
-    TrackingStatusPose* status_pose_stereo) {
+    TrackingStatusPose* status_pose_stereo,
+    const KeypointMatches* matches_ref_cur_mono) {
   CHECK(left_frame_lkf);
   CHECK(left_frame_k);
   CHECK_NOTNULL(status_pose_stereo);
@@ -517,11 +732,14 @@ void StereoVisionFrontEnd::outlierRejectionStereo(
     // 1-point RANSAC.
     std::tie(*status_pose_stereo, infoMatStereoTranslation) =
         tracker_.geometricOutlierRejectionStereoGivenRotation(
-            *stereoFrame_lkf_, *stereoFrame_k_, calLrectLkf_R_camLrectKf_imu);
+            *stereoFrame_lkf_,
+            *stereoFrame_k_,
+            calLrectLkf_R_camLrectKf_imu,
+            matches_ref_cur_mono);
   } else {
     // 3-point RANSAC.
     *status_pose_stereo = tracker_.geometricOutlierRejectionStereo(
-        *stereoFrame_lkf_, *stereoFrame_k_);
+        *stereoFrame_lkf_, *stereoFrame_k_, matches_ref_cur_mono);
     LOG_IF(WARNING, force_53point_ransac_) << "3-point RANSAC was enforced!";
   }
 
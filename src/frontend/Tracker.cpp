@@ -41,7 +41,11 @@ namespace VIO {
             // Only for debugging and visualization:
               optical_flow_predictor_(nullptr),
               display_queue_(display_queue),
-              output_images_path_("./outputImages/") {
+              output_images_path_("./outputImages/"),
+              mono_adapter_(mono_f_ref_, mono_f_cur_),
+              mono_given_rot_adapter_(mono_given_rot_f_ref_,
+                                      mono_given_rot_f_cur_),
+              stereo_adapter_(stereo_f_ref_, stereo_f_cur_) {
         // Create the optical flow prediction module
         optical_flow_predictor_ =
                 OpticalFlowPredictorFactory::makeOpticalFlowPredictor(
@@ -49,28 +53,72 @@ namespace VIO {
                         camera_params_.K_,
                         camera_params_.image_size_);
 
+        if (tracker_params_.ransac_adaptive_) {
+            // The adaptive RANSAC re-uses the problems (bound to the adapters).
+            const bool &randomize = tracker_params_.ransac_randomize_;
+            mono_ransac_ = VIO::make_unique<AdaptiveRansac<ProblemMono>>(
+                    tracker_params_.ransac_max_iterations_,
+                    tracker_params_.ransac_threshold_mono_,
+                    tracker_params_.ransac_probability_,
+                    randomize);
+            mono_ransac_given_rot_ =
+                    VIO::make_unique<AdaptiveRansac<ProblemMonoGivenRot>>(
+                            tracker_params_.ransac_max_iterations_,
+                            tracker_params_.ransac_threshold_mono_,
+                            tracker_params_.ransac_probability_,
+                            randomize);
+            stereo_ransac_ = VIO::make_unique<AdaptiveRansac<ProblemStereo>>(
+                    tracker_params_.ransac_max_iterations_,
+                    tracker_params_.ransac_threshold_stereo_,
+                    tracker_params_.ransac_probability_,
+                    randomize);
+            mono_problem_ = std::make_shared<ProblemMono>(
+                    mono_adapter_, ProblemMono::NISTER, randomize);
+            mono_given_rot_problem_ = std::make_shared<ProblemMonoGivenRot>(
+                    mono_given_rot_adapter_, randomize);
+            stereo_problem_ =
+                    std::make_shared<ProblemStereo>(stereo_adapter_, randomize);
+        } else {
+            mono_ransac_ = VIO::make_unique<opengv::sac::Ransac<ProblemMono>>();
+            mono_ransac_given_rot_ =
+                    VIO::make_unique<opengv::sac::Ransac<ProblemMonoGivenRot>>();
+            stereo_ransac_ =
+                    VIO::make_unique<opengv::sac::Ransac<ProblemStereo>>();
+        }
+
         // Setup Mono Ransac
-        mono_ransac_.threshold_ = tracker_params_.ransac_threshold_mono_;
-        mono_ransac_.max_iterations_ = tracker_params_.ransac_max_iterations_;
-        mono_ransac_.probability_ = tracker_params_.ransac_probability_;
+        mono_ransac_->threshold_ = tracker_params_.ransac_threshold_mono_;
+        mono_ransac_->max_iterations_ = tracker_params_.ransac_max_iterations_;
+        mono_ransac_->probability_ = tracker_params_.ransac_probability_;
 
         // Setup Mono Ransac given Rotation
-        mono_ransac_given_rot_.threshold_ = tracker_params_.ransac_threshold_mono_;
-        mono_ransac_given_rot_.max_iterations_ =
+        mono_ransac_given_rot_->threshold_ = tracker_params_.ransac_threshold_mono_;
+        mono_ransac_given_rot_->max_iterations_ =
                 tracker_params_.ransac_max_iterations_;
-        mono_ransac_given_rot_.probability_ = tracker_params_.ransac_probability_;
+        mono_ransac_given_rot_->probability_ = tracker_params_.ransac_probability_;
 
         // Setup Stereo Ransac
-        stereo_ransac_.threshold_ = tracker_params_.ransac_threshold_stereo_;
-        stereo_ransac_.max_iterations_ = tracker_params_.ransac_max_iterations_;
-        stereo_ransac_.probability_ = tracker_params_.ransac_probability_;
+        stereo_ransac_->threshold_ = tracker_params_.ransac_threshold_stereo_;
+        stereo_ransac_->max_iterations_ = tracker_params_.ransac_max_iterations_;
+        stereo_ransac_->probability_ = tracker_params_.ransac_probability_;
 
         // Setup CUDA Optical Flow Calculator
         const cv::Size2i klt_window_size(tracker_params.klt_win_size_,
                                          tracker_params.klt_win_size_);
 
         opticalFlowCalculator = cv::cuda::SparsePyrLKOpticalFlow::create(
-                klt_window_size, tracker_params.klt_max_level_, 30, true);
+                klt_window_size,
+                tracker_params.klt_max_level_,
+                tracker_params.klt_max_iter_,
+                true);
+    }
+
+    void Tracker::setKltParams(const int &klt_max_level, const int &klt_max_iter) {
+        CHECK_GE(klt_max_level, 0);
+        CHECK_GT(klt_max_iter, 0);
+        CHECK(opticalFlowCalculator);
+        opticalFlowCalculator->setMaxLevel(klt_max_level);
+        opticalFlowCalculator->setNumIters(klt_max_iter);
     }
 
 // TODO(Toni) a pity that this function is not const just because
@@ -78,13 +126,27 @@ namespace VIO {
     void Tracker::featureTracking(Frame *ref_frame,
                                   Frame *cur_frame,
                                   const gtsam::Rot3 &ref_R_cur) {
+        // Without depths only the rotation is used for prediction.
+        featureTracking(ref_frame,
+                        cur_frame,
+                        gtsam::Pose3(ref_R_cur, gtsam::Point3::Zero()),
+                        std::vector<double>());
+    }
+
+    void Tracker::featureTracking(Frame *ref_frame,
+                                  Frame *cur_frame,
+                                  const gtsam::Pose3 &ref_P_cur,
+                                  const std::vector<double> &ref_depths) {
         CHECK_NOTNULL(ref_frame);
         CHECK_NOTNULL(cur_frame);
         auto tic = utils::Timer::tic();
 
         // Fill up structure for reference pixels and their labels.
         const size_t &n_ref_kpts = ref_frame->keypoints_.size();
+        const bool use_depths = !ref_depths.empty();
+        if (use_depths) CHECK_EQ(ref_depths.size(), n_ref_kpts);
         KeypointsCV px_ref;
+        std::vector<double> depths_ref;
         std::vector<size_t> indices_of_valid_landmarks;
         px_ref.reserve(n_ref_kpts);
         indices_of_valid_landmarks.reserve(n_ref_kpts);
@@ -92,6 +154,7 @@ namespace VIO {
             if (ref_frame->landmarks_[i] != -1) {
                 // Current reference frame keypoint has a valid landmark.
                 px_ref.push_back(ref_frame->keypoints_[i]);
+                if (use_depths) depths_ref.push_back(ref_depths[i]);
                 indices_of_valid_landmarks.push_back(i);
             }
         }
@@ -107,7 +170,13 @@ namespace VIO {
         LOG_IF(ERROR, px_ref.size() == 0u) << "No keypoints in reference frame!";
 
         KeypointsCV px_cur;
-        CHECK(optical_flow_predictor_->predictFlow(px_ref, ref_R_cur, &px_cur));
+        if (use_depths) {
+            CHECK(optical_flow_predictor_->predictFlowWithDepth(
+                    px_ref, depths_ref, ref_P_cur, &px_cur));
+        } else {
+            CHECK(optical_flow_predictor_->predictFlow(
+                    px_ref, ref_P_cur.rotation(), &px_cur));
+        }
         KeypointsCV px_predicted = px_cur;
 
         // Do the actual tracking, so px_cur becomes the new pixel locations.
@@ -208,50 +277,53 @@ namespace VIO {
 
         KeypointMatches matches_ref_cur;
         findMatchingKeypoints(*ref_frame, *cur_frame, &matches_ref_cur);
+        if (tracker_params_.ransac_adaptive_) {
+            sortMatchesByTrackAge(*ref_frame, &matches_ref_cur);
+        }
 
         // Get bearing vectors for open_gv.
-        const size_t &n_matches = matches_ref_cur.size();
-        BearingVectors f_cur;
-        f_cur.reserve(n_matches);
-        BearingVectors f_ref;
-        f_ref.reserve(n_matches);
+        mono_f_ref_.clear();
+        mono_f_cur_.clear();
         for (const KeypointMatch &kp_ref_kp_cur : matches_ref_cur) {
             // TODO(Toni) (luca): if versors are only needed at keyframe,
             // do not compute every frame
-            f_ref.push_back(ref_frame->versors_.at(kp_ref_kp_cur.first));
-            f_cur.push_back(cur_frame->versors_.at(kp_ref_kp_cur.second));
+            mono_f_ref_.push_back(ref_frame->versors_.at(kp_ref_kp_cur.first));
+            mono_f_cur_.push_back(cur_frame->versors_.at(kp_ref_kp_cur.second));
         }
 
-        // Setup problem.
-        AdapterMono adapter(f_ref, f_cur);
-        std::shared_ptr<ProblemMono> problem = std::make_shared<ProblemMono>(
-                adapter, ProblemMono::NISTER, tracker_params_.ransac_randomize_);
-
-        // Update new problem for monocular ransac.
-        mono_ransac_.sac_model_ = problem;
+        // Setup problem for monocular ransac.
+        if (tracker_params_.ransac_adaptive_) {
+            mono_problem_->setUniformIndices(mono_f_ref_.size());
+            mono_ransac_->sac_model_ = mono_problem_;
+        } else {
+            mono_ransac_->sac_model_ = std::make_shared<ProblemMono>(
+                    mono_adapter_,
+                    ProblemMono::NISTER,
+                    tracker_params_.ransac_randomize_);
+        }
 
         // Solve.
-        if (!mono_ransac_.computeModel(0)) {
+        if (!mono_ransac_->computeModel(0)) {
             VLOG(10) << "failure: 5pt RANSAC could not find a solution.";
             return std::make_pair(TrackingStatus::INVALID, gtsam::Pose3());
         }
 
         VLOG(10) << "geometricOutlierRejectionMono: RANSAC complete.";
 
-        VLOG(10) << "RANSAC (MONO): #iter = " << mono_ransac_.iterations_ << '\n'
-                 << " #inliers = " << mono_ransac_.inliers_.size() << " #outliers = "
-                 << mono_ransac_.inliers_.size() - matches_ref_cur.size();
+        VLOG(10) << "RANSAC (MONO): #iter = " << mono_ransac_->iterations_ << '\n'
+                 << " #inliers = " << mono_ransac_->inliers_.size() << " #outliers = "
+                 << mono_ransac_->inliers_.size() - matches_ref_cur.size();
         debug_info_.nrMonoPutatives_ = matches_ref_cur.size();
 
         // Remove outliers. This modifies the frames, that is why this function does
         // not simply accept const Frames. And removes outliers from matches.
         removeOutliersMono(
-                mono_ransac_.inliers_, ref_frame, cur_frame, &matches_ref_cur);
+                mono_ransac_->inliers_, ref_frame, cur_frame, &matches_ref_cur);
 
         // Check quality of tracking.
         TrackingStatus status = TrackingStatus::VALID;
-        if (mono_ransac_.inliers_.size() < tracker_params_.minNrMonoInliers_) {
-            VLOG(10) << "FEW_MATCHES: " << mono_ransac_.inliers_.size();
+        if (mono_ransac_->inliers_.size() < tracker_params_.minNrMonoInliers_) {
+            VLOG(10) << "FEW_MATCHES: " << mono_ransac_->inliers_.size();
             status = TrackingStatus::FEW_MATCHES;
         }
 
@@ -273,11 +345,11 @@ namespace VIO {
 
         // Get the resulting transformation: a 3x4 matrix [R t].
         const opengv::transformation_t &best_transformation =
-                mono_ransac_.model_coefficients_;
+                mono_ransac_->model_coefficients_;
 
         debug_info_.monoRansacTime_ = utils::Timer::toc(start_time_tic).count();
-        debug_info_.nrMonoInliers_ = mono_ransac_.inliers_.size();
-        debug_info_.monoRansacIters_ = mono_ransac_.iterations_;
+        debug_info_.nrMonoInliers_ = mono_ransac_->inliers_.size();
+        debug_info_.monoRansacIters_ = mono_ransac_->iterations_;
 
         return std::make_pair(status,
                               UtilsOpenCV::openGvTfToGtsamPose3(best_transformation));
@@ -295,52 +367,59 @@ namespace VIO {
 
         KeypointMatches matches_ref_cur;
         findMatchingKeypoints(*ref_frame, *cur_frame, &matches_ref_cur);
+        if (tracker_params_.ransac_adaptive_) {
+            sortMatchesByTrackAge(*ref_frame, &matches_ref_cur);
+        }
 
         // Vector of bearing vectors.
-        BearingVectors f_cur;
-        f_cur.reserve(matches_ref_cur.size());
-        BearingVectors f_ref;
-        f_ref.reserve(matches_ref_cur.size());
+        mono_given_rot_f_ref_.clear();
+        mono_given_rot_f_cur_.clear();
         for (const KeypointMatch &it : matches_ref_cur) {
-            f_ref.push_back(ref_frame->versors_.at(it.first));
-            f_cur.push_back(R.rotate(cur_frame->versors_.at(it.second)));
+            mono_given_rot_f_ref_.push_back(ref_frame->versors_.at(it.first));
+            mono_given_rot_f_cur_.push_back(
+                    R.rotate(cur_frame->versors_.at(it.second)));
         }
 
         // Setup problem.
-        AdapterMonoGivenRot adapter(f_ref, f_cur);
-        std::shared_ptr<ProblemMonoGivenRot> problem =
-                std::make_shared<ProblemMonoGivenRot>(adapter,
-                                                      tracker_params_.ransac_randomize_);
-        mono_ransac_given_rot_.sac_model_ = problem;
+        if (tracker_params_.ransac_adaptive_) {
+            mono_given_rot_problem_->setUniformIndices(
+                    mono_given_rot_f_ref_.size());
+            mono_ransac_given_rot_->sac_model_ = mono_given_rot_problem_;
+        } else {
+            mono_ransac_given_rot_->sac_model_ =
+                    std::make_shared<ProblemMonoGivenRot>(
+                            mono_given_rot_adapter_,
+                            tracker_params_.ransac_randomize_);
+        }
 
         VLOG(10) << "geometricOutlierRejectionMonoGivenRot: starting 2-point RANSAC";
 
         // Solve.
-        if (!mono_ransac_given_rot_.computeModel(0)) {
+        if (!mono_ransac_given_rot_->computeModel(0)) {
             LOG(WARNING) << "2-point RANSAC could not find a solution!";
             return std::make_pair(TrackingStatus::INVALID, gtsam::Pose3());
         }
         VLOG(10) << "geometricOutlierRejectionMonoGivenRot: RANSAC complete";
 
-        VLOG(10) << "RANSAC (MONO): #iter = " << mono_ransac_given_rot_.iterations_
+        VLOG(10) << "RANSAC (MONO): #iter = " << mono_ransac_given_rot_->iterations_
                  << '\n'
-                 << " #inliers = " << mono_ransac_given_rot_.inliers_.size()
+                 << " #inliers = " << mono_ransac_given_rot_->inliers_.size()
                  << "\n #outliers = "
-                 << mono_ransac_given_rot_.inliers_.size() - matches_ref_cur.size()
+                 << mono_ransac_given_rot_->inliers_.size() - matches_ref_cur.size()
                  << "\n Total = " << matches_ref_cur.size();
         debug_info_.nrMonoPutatives_ = matches_ref_cur.size();
 
         // Remove outliers.
         debug_info_.nrMonoPutatives_ = matches_ref_cur.size();  // before cleaning.
         removeOutliersMono(
-                mono_ransac_given_rot_.inliers_, ref_frame, cur_frame, &matches_ref_cur);
+                mono_ransac_given_rot_->inliers_, ref_frame, cur_frame, &matches_ref_cur);
 
         // TODO(Toni):
         // CHECK QUALITY OF TRACKING
         TrackingStatus status = TrackingStatus::VALID;
-        if (mono_ransac_given_rot_.inliers_.size() <
+        if (mono_ransac_given_rot_->inliers_.size() <
             tracker_params_.minNrMonoInliers_) {
-            VLOG(10) << "FEW_MATCHES: " << mono_ransac_given_rot_.inliers_.size();
+            VLOG(10) << "FEW_MATCHES: " << mono_ransac_given_rot_->inliers_.size();
             status = TrackingStatus::FEW_MATCHES;
         }
         double disparity;
@@ -359,7 +438,7 @@ namespace VIO {
 
         // Get the resulting transformation: a 3x4 matrix [R t].
         opengv::transformation_t best_transformation =
-                mono_ransac_given_rot_.model_coefficients_;
+                mono_ransac_given_rot_->model_coefficients_;
         gtsam::Pose3 camLlkf_P_camLkf =
                 UtilsOpenCV::openGvTfToGtsamPose3(best_transformation);
         // note: this always returns the identity rotation, hence we have to
@@ -381,8 +460,8 @@ namespace VIO {
         }
 
         debug_info_.monoRansacTime_ = utils::Timer::toc(start_time_tic).count();
-        debug_info_.nrMonoInliers_ = mono_ransac_given_rot_.inliers_.size();
-        debug_info_.monoRansacIters_ = mono_ransac_given_rot_.iterations_;
+        debug_info_.nrMonoInliers_ = mono_ransac_given_rot_->inliers_.size();
+        debug_info_.monoRansacIters_ = mono_ransac_given_rot_->iterations_;
 
         return std::make_pair(status, camLrectlkf_P_camLrectkf);
     }
@@ -428,12 +507,20 @@ namespace VIO {
     Tracker::geometricOutlierRejectionStereoGivenRotation(
             StereoFrame &ref_stereoFrame,
             StereoFrame &cur_stereoFrame,
-            const gtsam::Rot3 &R) {
+            const gtsam::Rot3 &R,
+            const KeypointMatches *matches_ref_cur_mono) {
         auto start_time_tic = utils::Timer::tic();
 
         KeypointMatches matches_ref_cur;
-        findMatchingStereoKeypoints(
-                ref_stereoFrame, cur_stereoFrame, &matches_ref_cur);
+        if (matches_ref_cur_mono) {
+            findMatchingStereoKeypoints(ref_stereoFrame,
+                                        cur_stereoFrame,
+                                        *matches_ref_cur_mono,
+                                        &matches_ref_cur);
+        } else {
+            findMatchingStereoKeypoints(
+                    ref_stereoFrame, cur_stereoFrame, &matches_ref_cur);
+        }
 
         VLOG(10) << "geometricOutlierRejectionStereoGivenRot:"
                     " starting 1-point RANSAC (voting)";
@@ -652,77 +739,101 @@ namespace VIO {
 // TODO(Toni): this function is almost a replica of the Mono version,
 // factorize.
     std::pair<TrackingStatus, gtsam::Pose3>
-    Tracker::geometricOutlierRejectionStereo(StereoFrame &ref_stereoFrame,
-                                             StereoFrame &cur_stereoFrame) {
+    Tracker::geometricOutlierRejectionStereo(
+            StereoFrame &ref_stereoFrame,
+            StereoFrame &cur_stereoFrame,
+            const KeypointMatches *matches_ref_cur_mono) {
         auto start_time_tic = utils::Timer::tic();
 
         KeypointMatches matches_ref_cur;
-        findMatchingStereoKeypoints(
-                ref_stereoFrame, cur_stereoFrame, &matches_ref_cur);
+        if (matches_ref_cur_mono) {
+            findMatchingStereoKeypoints(ref_stereoFrame,
+                                        cur_stereoFrame,
+                                        *matches_ref_cur_mono,
+                                        &matches_ref_cur);
+        } else {
+            findMatchingStereoKeypoints(
+                    ref_stereoFrame, cur_stereoFrame, &matches_ref_cur);
+        }
+        if (tracker_params_.ransac_adaptive_) {
+            sortMatchesByTrackAge(ref_stereoFrame.getLeftFrame(),
+                                  &matches_ref_cur);
+        }
 
         VLOG(10) << "geometricOutlierRejectionStereo:"
                     " starting 3-point RANSAC (voting)";
 
         // Vector of 3D vectors
-        const size_t &n_matches = matches_ref_cur.size();
-        BearingVectors f_cur;
-        f_cur.reserve(n_matches);
-        BearingVectors f_ref;
-        f_ref.reserve(n_matches);
+        stereo_f_ref_.clear();
+        stereo_f_cur_.clear();
         for (const KeypointMatch &it : matches_ref_cur) {
-            f_ref.push_back(ref_stereoFrame.keypoints_3d_.at(it.first));
-            f_cur.push_back(cur_stereoFrame.keypoints_3d_.at(it.second));
+            stereo_f_ref_.push_back(ref_stereoFrame.keypoints_3d_.at(it.first));
+            stereo_f_cur_.push_back(cur_stereoFrame.keypoints_3d_.at(it.second));
         }
 
         // Setup problem (3D-3D adapter) -
         // http://laurentkneip.github.io/opengv/page_how_to_use.html
-        AdapterStereo adapter(f_ref, f_cur);
-        std::shared_ptr<ProblemStereo> problem = std::make_shared<ProblemStereo>(
-                adapter, tracker_params_.ransac_randomize_);
-
-        // Update new problem for stereo ransac.
-        stereo_ransac_.sac_model_ = problem;
+        if (tracker_params_.ransac_adaptive_) {
+            stereo_problem_->setUniformIndices(stereo_f_ref_.size());
+            stereo_ransac_->sac_model_ = stereo_problem_;
+        } else {
+            stereo_ransac_->sac_model_ = std::make_shared<ProblemStereo>(
+                    stereo_adapter_, tracker_params_.ransac_randomize_);
+        }
 
         // Solve.
-        if (!stereo_ransac_.computeModel(0)) {
+        if (!stereo_ransac_->computeModel(0)) {
             VLOG(10) << "failure: (Arun) RANSAC could not find a solution.";
             return std::make_pair(TrackingStatus::INVALID, gtsam::Pose3());
         }
 
         VLOG(10) << "geometricOutlierRejectionStereo: voting complete.";
 
-        VLOG(10) << "RANSAC (STEREO): #iter = " << stereo_ransac_.iterations_ << '\n'
-                 << " #inliers = " << stereo_ransac_.inliers_.size()
+        VLOG(10) << "RANSAC (STEREO): #iter = " << stereo_ransac_->iterations_ << '\n'
+                 << " #inliers = " << stereo_ransac_->inliers_.size()
                  << "\n #outliers = "
-                 << stereo_ransac_.inliers_.size() - matches_ref_cur.size();
+                 << stereo_ransac_->inliers_.size() - matches_ref_cur.size();
         debug_info_.nrStereoPutatives_ = matches_ref_cur.size();
 
         // Remove outliers.
-        removeOutliersStereo(stereo_ransac_.inliers_,
+        removeOutliersStereo(stereo_ransac_->inliers_,
                              &ref_stereoFrame,
                              &cur_stereoFrame,
                              &matches_ref_cur);
 
         // Check quality of tracking.
         TrackingStatus status = TrackingStatus::VALID;
-        if (stereo_ransac_.inliers_.size() < tracker_params_.minNrStereoInliers_) {
-            VLOG(10) << "FEW_MATCHES: " << stereo_ransac_.inliers_.size();
+        if (stereo_ransac_->inliers_.size() < tracker_params_.minNrStereoInliers_) {
+            VLOG(10) << "FEW_MATCHES: " << stereo_ransac_->inliers_.size();
             status = TrackingStatus::FEW_MATCHES;
         }
 
         // Get the resulting transformation: a 3x4 matrix [R t].
         const opengv::transformation_t &best_transformation =
-                stereo_ransac_.model_coefficients_;
+                stereo_ransac_->model_coefficients_;
 
         // Fill debug info.
         debug_info_.stereoRansacTime_ = utils::Timer::toc(start_time_tic).count();
-        debug_info_.nrStereoInliers_ = stereo_ransac_.inliers_.size();
-        debug_info_.stereoRansacIters_ = stereo_ransac_.iterations_;
+        debug_info_.nrStereoInliers_ = stereo_ransac_->inliers_.size();
+        debug_info_.stereoRansacIters_ = stereo_ransac_->iterations_;
 
         return std::make_pair(status,
                               UtilsOpenCV::openGvTfToGtsamPose3(best_transformation));
     }
 
+    void Tracker::sortMatchesByTrackAge(const Frame &ref_frame,
+                                        KeypointMatches *matches_ref_cur) {
+        CHECK_NOTNULL(matches_ref_cur);
+        const std::vector<size_t> &ages = ref_frame.landmarks_age_;
+        CHECK_EQ(ages.size(), ref_frame.keypoints_.size());
+        // Stable so that, with equal ages, the order does not change.
+        std::stable_sort(matches_ref_cur->begin(),
+                         matches_ref_cur->end(),
+                         [&ages](const KeypointMatch &a, const KeypointMatch &b) {
+                             return ages.at(a.first) > ages.at(b.first);
+                         });
+    }
+
     void Tracker::findOutliers(const KeypointMatches &matches_ref_cur,
                                std::vector<int> inliers,
                                std::vector<int> *outliers) {
@@ -28,7 +28,7 @@ StereoVisionFrontEndModule::StereoVisionFrontEndModule(
 StereoVisionFrontEndModule::OutputUniquePtr
 StereoVisionFrontEndModule::spinOnce(StereoImuSyncPacket::UniquePtr input) {
   CHECK(input);
-  return vio_frontend_->spinOnce(*input);
+  return vio_frontend_->spinOnce(std::move(input));
 }
 
 }  // namespace VIO
@@ -63,6 +63,8 @@ void FrontendParams::print() const {
                         ransac_probability_,
                         "ransac_randomize_: ",
                         ransac_randomize_,
+                        "ransac_adaptive_: ",
+                        ransac_adaptive_,
                         // "** STEREO tracker parameters **\n"
                         "intra_keyframe_time_: ",
                         intra_keyframe_time_ns_,
@@ -105,6 +107,7 @@ bool FrontendParams::parseYAML(const std::string& filepath) {
   yaml_parser.getYamlParam("ransac_max_iterations", &ransac_max_iterations_);
   yaml_parser.getYamlParam("ransac_probability", &ransac_probability_);
   yaml_parser.getYamlParam("ransac_randomize", &ransac_randomize_);
+  yaml_parser.getYamlParam("ransac_adaptive", &ransac_adaptive_);
 
   // Given in seconds, needs to be converted to nanoseconds.
   double intra_keyframe_time_seconds;
@@ -130,6 +133,10 @@ bool FrontendParams::parseYAML(const std::string& filepath) {
       optical_flow_predictor_type_ = OpticalFlowPredictorType::kRotational;
       break;
     }
+    case VIO::to_underlying(OpticalFlowPredictorType::kPose): {
+      optical_flow_predictor_type_ = OpticalFlowPredictorType::kPose;
+      break;
+    }
     default: {
       LOG(FATAL) << "Unknown Optical Flow Predictor Type: "
                  << optical_flow_predictor_type;
@@ -159,6 +166,7 @@ bool FrontendParams::equals(const FrontendParams& tp2, double tol) const {
          (ransac_max_iterations_ == tp2.ransac_max_iterations_) &&
          (fabs(ransac_probability_ - tp2.ransac_probability_) <= tol) &&
          (ransac_randomize_ == tp2.ransac_randomize_) &&
+         (ransac_adaptive_ == tp2.ransac_adaptive_) &&
          // STEREO parameters:
          (fabs(intra_keyframe_time_ns_ - tp2.intra_keyframe_time_ns_) <= tol) &&
          (min_number_features_ == tp2.min_number_features_) &&
@@ -23,3 +23,7 @@ void CudaFastFeatureDetectorWrapper::detect(const cv::_InputArray &image, std::v
 
     internal_detector->convert(keypoints_gpu, keypoints);
 }
+
+void CudaFastFeatureDetectorWrapper::setThreshold(int threshold) {
+    internal_detector->setThreshold(threshold);
+}
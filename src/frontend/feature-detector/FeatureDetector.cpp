@@ -8,6 +8,8 @@
 
 #include <opencv2/cudafeatures2d.hpp>
 #include <algorithm>
+#include <cmath>
+#include <vector>
 
 #include "kimera-vio/utils/Timer.h"
 #include "kimera-vio/utils/UtilsOpenCV.h"  // Just for ExtractCorners...
@@ -17,11 +19,219 @@
 
 namespace VIO {
 
+    namespace {
+
+        // FAST compares each pixel with a circle of this radius, so cells are
+        // padded by it to also detect the corners next to the cell borders.
+        constexpr int kFastRadius = 3;
+        // Change of the FAST threshold of a cell per frame.
+        constexpr int kFastThresholdStep = 1;
+        // The FAST threshold of a cell is raised if it finds more than this many
+        // times the corners it needs.
+        constexpr size_t kFastExcessFactor = 4u;
+
+        struct GridCell {
+            cv::Rect roi_;
+            // Max number of new corners to detect in the cell.
+            int budget_ = 0;
+            std::vector<cv::KeyPoint> corners_;
+        };
+
+        // Detects the corners of each cell with a positive budget, cells are
+        // independent so they are processed in parallel.
+        // fast_thresh and quality_level are the ones of the params, scaled by
+        // the feature budget.
+        class GridDetectionBody : public cv::ParallelLoopBody {
+        public:
+            GridDetectionBody(const cv::Mat &img,
+                              const FeatureDetectorParams &params,
+                              const int &fast_thresh,
+                              const double &quality_level,
+                              const int &grid_cols,
+                              const std::vector<KeypointsCV> &tracked_per_cell,
+                              const std::vector<size_t> &cells_to_detect,
+                              std::vector<GridCell> *cells,
+                              std::vector<int> *fast_thresholds)
+                    : img_(img),
+                      params_(params),
+                      fast_thresh_(fast_thresh),
+                      quality_level_(quality_level),
+                      grid_cols_(grid_cols),
+                      tracked_per_cell_(tracked_per_cell),
+                      cells_to_detect_(cells_to_detect),
+                      cells_(CHECK_NOTNULL(cells)),
+                      fast_thresholds_(CHECK_NOTNULL(fast_thresholds)) {}
+
+            void operator()(const cv::Range &range) const override {
+                for (int i = range.start; i < range.end; ++i) {
+                    detectInCell(cells_to_detect_.at(i));
+                }
+            }
+
+        private:
+            void detectInCell(const size_t &cell_idx) const {
+                GridCell &cell = cells_->at(cell_idx);
+                const cv::Rect padded_roi =
+                        cv::Rect(cell.roi_.x - kFastRadius,
+                                 cell.roi_.y - kFastRadius,
+                                 cell.roi_.width + 2 * kFastRadius,
+                                 cell.roi_.height + 2 * kFastRadius) &
+                        cv::Rect(0, 0, img_.cols, img_.rows);
+                const cv::Mat cell_img = img_(padded_roi);
+
+                std::vector<cv::KeyPoint> candidates;
+                if (params_.feature_detector_type_ == FeatureDetectorType::FAST) {
+                    cv::FAST(cell_img,
+                             candidates,
+                             fast_thresholds_->at(cell_idx),
+                             true);
+                } else {
+                    // The quality level of GFTT is relative to the best corner of
+                    // the cell, which makes it a per-cell threshold.
+                    std::vector<cv::Point2f> corners;
+                    cv::goodFeaturesToTrack(cell_img,
+                                            corners,
+                                            static_cast<int>(kFastExcessFactor) *
+                                            cell.budget_,
+                                            quality_level_,
+                                            params_
+                                                .min_distance_btw_tracked_and_detected_features_,
+                                            cv::noArray(),
+                                            params_.block_size_,
+                                            params_.use_harris_corner_detector_,
+                                            params_.k_);
+                    // Corners are sorted by decreasing quality.
+                    candidates.reserve(corners.size());
+                    for (size_t i = 0u; i < corners.size(); ++i) {
+                        candidates.push_back(cv::KeyPoint(
+                                corners[i],
+                                1.0f,
+                                -1.0f,
+                                static_cast<float>(corners.size() - i)));
+                    }
+                }
+
+                // Back to image coordinates, only keep the corners of this cell.
+                const cv::Point2f offset(padded_roi.x, padded_roi.y);
+                size_t n_in_cell = 0u;
+                for (const cv::KeyPoint &candidate : candidates) {
+                    cv::KeyPoint kp = candidate;
+                    kp.pt += offset;
+                    if (kp.pt.x >= cell.roi_.x && kp.pt.y >= cell.roi_.y &&
+                        kp.pt.x < cell.roi_.x + cell.roi_.width &&
+                        kp.pt.y < cell.roi_.y + cell.roi_.height) {
+                        candidates[n_in_cell++] = kp;
+                    }
+                }
+                candidates.resize(n_in_cell);
+                std::sort(candidates.begin(),
+                          candidates.end(),
+                          [](const cv::KeyPoint &a, const cv::KeyPoint &b) {
+                              return a.response > b.response;
+                          });
+
+                // Greedily take the strongest corners far enough from the tracked
+                // features and from the corners already taken.
+                const double min_distance =
+                        params_.min_distance_btw_tracked_and_detected_features_;
+                const double min_sq_distance = min_distance * min_distance;
+                const int cell_col = cell_idx % grid_cols_;
+                const int cell_row = cell_idx / grid_cols_;
+                const int n_cells = static_cast<int>(cells_->size());
+                const int radius_cols = static_cast<int>(
+                        std::ceil(min_distance / std::max(cell.roi_.width, 1)));
+                const int radius_rows = static_cast<int>(
+                        std::ceil(min_distance / std::max(cell.roi_.height, 1)));
+                cell.corners_.clear();
+                for (const cv::KeyPoint &kp : candidates) {
+                    if (static_cast<int>(cell.corners_.size()) >= cell.budget_) {
+                        break;
+                    }
+                    bool is_isolated = true;
+                    for (const cv::KeyPoint &taken : cell.corners_) {
+                        const cv::Point2f d = kp.pt - taken.pt;
+                        if (d.dot(d) < min_sq_distance) {
+                            is_isolated = false;
+                            break;
+                        }
+                    }
+                    for (int row = cell_row - radius_rows;
+                         is_isolated && row <= cell_row + radius_rows;
+                         ++row) {
+                        for (int col = cell_col - radius_cols;
+                             is_isolated && col <= cell_col + radius_cols;
+                             ++col) {
+                            const int neighbor_idx = row * grid_cols_ + col;
+                            if (col < 0 || col >= grid_cols_ || row < 0 ||
+                                neighbor_idx >= n_cells) {
+                                continue;
+                            }
+                            for (const KeypointCV &tracked :
+                                    tracked_per_cell_.at(neighbor_idx)) {
+                                const cv::Point2f d = kp.pt - tracked;
+                                if (d.dot(d) < min_sq_distance) {
+                                    is_isolated = false;
+                                    break;
+                                }
+                            }
+                        }
+                    }
+                    if (is_isolated) cell.corners_.push_back(kp);
+                }
+
+                if (params_.feature_detector_type_ == FeatureDetectorType::FAST) {
+                    // Lower the threshold of cells that lack corners (e.g. low
+                    // texture), raise it for those with too many.
+                    int &threshold = fast_thresholds_->at(cell_idx);
+                    const size_t budget = static_cast<size_t>(cell.budget_);
+                    if (candidates.size() < budget) {
+                        threshold = std::max(threshold - kFastThresholdStep,
+                                             std::max(fast_thresh_ / 2, 1));
+                    } else if (candidates.size() > kFastExcessFactor * budget) {
+                        threshold = std::min(threshold + kFastThresholdStep,
+                                             2 * fast_thresh_);
+                    }
+                }
+            }
+
+        private:
+            const cv::Mat &img_;
+            const FeatureDetectorParams &params_;
+            const int fast_thresh_;
+            const double quality_level_;
+            const int grid_cols_;
+            const std::vector<KeypointsCV> &tracked_per_cell_;
+            const std::vector<size_t> &cells_to_detect_;
+            std::vector<GridCell> *cells_;
+            std::vector<int> *fast_thresholds_;
+        };
+
+    }  // namespace
+
     FeatureDetector::FeatureDetector(
             const FeatureDetectorParams &feature_detector_params)
             : feature_detector_params_(feature_detector_params),
               non_max_suppression_(nullptr),
-              feature_detector_() {
+              feature_detector_(),
+              cell_fast_thresholds_(),
+              max_features_per_frame_(
+                      feature_detector_params.max_features_per_frame_),
+              threshold_scale_(1.0),
+              next_lmk_id_(0) {
+        if (feature_detector_params.enable_grid_detection_) {
+            CHECK(feature_detector_params.feature_detector_type_ ==
+                  FeatureDetectorType::FAST ||
+                  feature_detector_params.feature_detector_type_ ==
+                  FeatureDetectorType::GFTT)
+                << "Grid detection is only implemented for FAST and GFTT.";
+            CHECK_GT(feature_detector_params.grid_cols_, 0);
+            CHECK_GT(feature_detector_params.grid_rows_, 0);
+            cell_fast_thresholds_.assign(
+                    feature_detector_params.grid_cols_ *
+                    feature_detector_params.grid_rows_,
+                    feature_detector_params.fast_thresh_);
+        }
+
         // TODO(Toni): parametrize as well whether we use bucketing or anms...
         // Right now we asume we want anms not bucketing...
         if (feature_detector_params.enable_non_max_suppression_) {
@@ -89,6 +299,63 @@ namespace VIO {
         }
     }
 
+    void FeatureDetector::setFeatureBudget(const int &max_features_per_frame,
+                                           const double &threshold_scale) {
+        CHECK_GE(max_features_per_frame, 0);
+        CHECK_GT(threshold_scale, 0.0);
+        max_features_per_frame_ = max_features_per_frame;
+        threshold_scale_ = threshold_scale;
+        const int fast_thresh = scaledFastThreshold();
+        const double quality_level = scaledQualityLevel();
+
+        // Keep the thresholds of the cells within the band around the new one.
+        for (int &cell_fast_threshold : cell_fast_thresholds_) {
+            cell_fast_threshold = std::min(
+                    std::max(cell_fast_threshold, std::max(fast_thresh / 2, 1)),
+                    2 * fast_thresh);
+        }
+
+        CHECK(feature_detector_);
+        switch (feature_detector_params_.feature_detector_type_) {
+            case FeatureDetectorType::FAST: {
+                feature_detector_.dynamicCast<CudaFastFeatureDetectorWrapper>()
+                        ->setThreshold(fast_thresh);
+                break;
+            }
+            case FeatureDetectorType::ORB: {
+                cv::Ptr<cv::cuda::ORB> orb =
+                        feature_detector_.dynamicCast<cv::cuda::ORB>();
+                orb->setMaxFeatures(std::max(max_features_per_frame, 1));
+                orb->setFastThreshold(fast_thresh);
+                break;
+            }
+            case FeatureDetectorType::GFTT: {
+                cv::Ptr<cv::GFTTDetector> gftt =
+                        feature_detector_.dynamicCast<cv::GFTTDetector>();
+                gftt->setMaxFeatures(std::max(max_features_per_frame, 1));
+                gftt->setQualityLevel(quality_level);
+                break;
+            }
+            default: {
+                LOG(FATAL) << "Unknown feature detector type: "
+                           << VIO::to_underlying(
+                                   feature_detector_params_.feature_detector_type_);
+            }
+        }
+    }
+
+    int FeatureDetector::scaledFastThreshold() const {
+        return std::max(
+                static_cast<int>(std::lround(feature_detector_params_.fast_thresh_ *
+                                             threshold_scale_)),
+                1);
+    }
+
+    double FeatureDetector::scaledQualityLevel() const {
+        return std::min(feature_detector_params_.quality_level_ * threshold_scale_,
+                        1.0);
+    }
+
 // TODO(Toni) Optimize this function.
     void FeatureDetector::featureDetection(Frame *cur_frame) {
         CHECK_NOTNULL(cur_frame);
@@ -106,8 +373,7 @@ namespace VIO {
 
         // Detect new features in image.
         // detect this much new corners if possible
-        int nr_corners_needed = std::max(
-                feature_detector_params_.max_features_per_frame_ - n_existing, 0);
+        int nr_corners_needed = std::max(max_features_per_frame_ - n_existing, 0);
         // debug_info_.need_n_corners_ = nr_corners_needed;
 
         ///////////////// FEATURE DETECTION //////////////////////
@@ -132,23 +398,21 @@ namespace VIO {
             cur_frame->scores_.reserve(new_nr_keypoints);
             cur_frame->versors_.reserve(new_nr_keypoints);
 
-            // Incremental id assigned to new landmarks
-            static LandmarkId lmk_id = 0;
             const CameraParams &cam_param = cur_frame->cam_param_;
             for (const KeypointCV &corner : corners) {
-                cur_frame->landmarks_.push_back(lmk_id);
+                cur_frame->landmarks_.push_back(next_lmk_id_);
                 // New keypoint, so seen in a single (key)frame so far.
                 cur_frame->landmarks_age_.push_back(1u);
                 cur_frame->keypoints_.push_back(corner);
                 cur_frame->scores_.push_back(0.0);  // NOT IMPLEMENTED
                 cur_frame->versors_.push_back(Frame::calibratePixel(corner, cam_param));
-                ++lmk_id;
+                ++next_lmk_id_;
             }
             VLOG(10) << "featureExtraction: frame " << cur_frame->id_
                      << ",  Nr tracked keypoints: " << prev_nr_keypoints
                      << ",  Nr extracted keypoints: " << n_corners
                      << ",  total: " << cur_frame->keypoints_.size()
-                     << "  (max: " << feature_detector_params_.max_features_per_frame_
+                     << "  (max: " << max_features_per_frame_
                      << ")";
         } else {
             LOG(WARNING) << "No corners extracted for frame with id: "
@@ -158,7 +422,15 @@ namespace VIO {
 
     KeypointsCV FeatureDetector::featureDetection(const Frame &cur_frame,
                                                   const int &need_n_corners) {
-        // TODO(TONI) need to do grid based approach!
+        if (feature_detector_params_.enable_grid_detection_) {
+            auto tic = utils::Timer::tic();
+            KeypointsCV new_corners =
+                    gridFeatureDetection(cur_frame, need_n_corners);
+            VLOG(1) << "Grid detection of " << new_corners.size()
+                    << " corners Timing [ms]: " << utils::Timer::toc(tic).count();
+            refineCorners(cur_frame.img_, &new_corners);
+            return new_corners;
+        }
 
         // cv::namedWindow("Input Image", cv::WINDOW_AUTOSIZE);
         // cv::imshow("Input Image", cur_frame.img_);
@@ -230,15 +502,117 @@ namespace VIO {
         //                              tracker_params_.k_,
         //                              tracker_params_.use_harris_detector_);
 
+        refineCorners(cur_frame.img_, &new_corners);
+        //}
+
+        return new_corners;
+    }
+
+    KeypointsCV FeatureDetector::gridFeatureDetection(const Frame &cur_frame,
+                                                      const int &need_n_corners) {
+        const cv::Mat &img = cur_frame.img_;
+        CHECK_EQ(img.type(), CV_8UC1);
+        if (need_n_corners <= 0) return KeypointsCV();
+
+        const int &grid_cols = feature_detector_params_.grid_cols_;
+        const int &grid_rows = feature_detector_params_.grid_rows_;
+        const size_t n_cells = static_cast<size_t>(grid_cols * grid_rows);
+        CHECK_EQ(cell_fast_thresholds_.size(), n_cells);
+        const int cell_width = (img.cols + grid_cols - 1) / grid_cols;
+        const int cell_height = (img.rows + grid_rows - 1) / grid_rows;
+
+        // Bin the tracked features, instead of drawing them in a mask.
+        std::vector<KeypointsCV> tracked_per_cell(n_cells);
+        for (size_t i = 0u; i < cur_frame.keypoints_.size(); ++i) {
+            if (cur_frame.landmarks_.at(i) == -1) continue;
+            const KeypointCV &kp = cur_frame.keypoints_.at(i);
+            const int col = std::min(
+                    std::max(static_cast<int>(kp.x) / cell_width, 0),
+                    grid_cols - 1);
+            const int row = std::min(
+                    std::max(static_cast<int>(kp.y) / cell_height, 0),
+                    grid_rows - 1);
+            tracked_per_cell[row * grid_cols + col].push_back(kp);
+        }
+
+        // Split the new corners among the cells that lack tracked features,
+        // in proportion to what they lack.
+        const int features_per_cell =
+                (max_features_per_frame_ + static_cast<int>(n_cells) - 1) /
+                static_cast<int>(n_cells);
+        std::vector<GridCell> cells(n_cells);
+        std::vector<int> deficits(n_cells, 0);
+        int total_deficit = 0;
+        for (size_t idx = 0u; idx < n_cells; ++idx) {
+            const int col = static_cast<int>(idx) % grid_cols;
+            const int row = static_cast<int>(idx) / grid_cols;
+            cells[idx].roi_ = cv::Rect(col * cell_width,
+                                       row * cell_height,
+                                       cell_width,
+                                       cell_height) &
+                              cv::Rect(0, 0, img.cols, img.rows);
+            if (cells[idx].roi_.area() == 0) continue;
+            deficits[idx] = std::max(
+                    features_per_cell -
+                    static_cast<int>(tracked_per_cell[idx].size()),
+                    0);
+            total_deficit += deficits[idx];
+        }
+        if (total_deficit == 0) return KeypointsCV();
+        const int n_new_corners = std::min(need_n_corners, total_deficit);
+        int n_assigned = 0;
+        for (size_t idx = 0u; idx < n_cells; ++idx) {
+            cells[idx].budget_ = deficits[idx] * n_new_corners / total_deficit;
+            n_assigned += cells[idx].budget_;
+        }
+        // Rounding leftovers.
+        for (size_t idx = 0u; idx < n_cells && n_assigned < n_new_corners; ++idx) {
+            if (cells[idx].budget_ < deficits[idx]) {
+                ++cells[idx].budget_;
+                ++n_assigned;
+            }
+        }
+
+        std::vector<size_t> cells_to_detect;
+        cells_to_detect.reserve(n_cells);
+        for (size_t idx = 0u; idx < n_cells; ++idx) {
+            if (cells[idx].budget_ > 0) cells_to_detect.push_back(idx);
+        }
+        VLOG(1) << "Need n corners: " << need_n_corners << " in "
+                << cells_to_detect.size() << " of " << n_cells << " cells.";
+        cv::parallel_for_(cv::Range(0, static_cast<int>(cells_to_detect.size())),
+                          GridDetectionBody(img,
+                                            feature_detector_params_,
+                                            scaledFastThreshold(),
+                                            scaledQualityLevel(),
+                                            grid_cols,
+                                            tracked_per_cell,
+                                            cells_to_detect,
+                                            &cells,
+                                            &cell_fast_thresholds_));
+
+        KeypointsCV new_corners;
+        new_corners.reserve(n_new_corners);
+        for (const size_t &idx : cells_to_detect) {
+            for (const cv::KeyPoint &kp : cells[idx].corners_) {
+                new_corners.push_back(kp.pt);
+            }
+        }
+        return new_corners;
+    }
+
+    void FeatureDetector::refineCorners(const cv::Mat &img,
+                                        KeypointsCV *corners) const {
+        CHECK_NOTNULL(corners);
         // TODO this takes a ton of time 27ms each time...
         // Change window_size, and term_criteria to improve timing
-        if (new_corners.size() > 0) {
+        if (corners->size() > 0) {
             if (feature_detector_params_.enable_subpixel_corner_refinement_) {
                 const auto &subpixel_params =
                         feature_detector_params_.subpixel_corner_finder_params_;
                 auto tic = utils::Timer::tic();
-                cv::cornerSubPix(cur_frame.img_,
-                                 new_corners,
+                cv::cornerSubPix(img,
+                                 *corners,
                                  subpixel_params.window_size_,
                                  subpixel_params.zero_zone_,
                                  subpixel_params.term_criteria_);
@@ -246,9 +620,6 @@ namespace VIO {
                         << utils::Timer::toc(tic).count();
             }
         }
-        //}
-
-        return new_corners;
     }
 
 }  // namespace VIO
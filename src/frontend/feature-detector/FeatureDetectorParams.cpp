@@ -88,7 +88,13 @@ void FeatureDetectorParams::print() const {
                         "k_: ",
                         k_,
                         "Fast Threshold",
-                        fast_thresh_);
+                        fast_thresh_,
+                        "Enable grid detection",
+                        enable_grid_detection_,
+                        "Grid columns",
+                        grid_cols_,
+                        "Grid rows",
+                        grid_rows_);
   LOG(INFO) << out.str();
   if (enable_subpixel_corner_refinement_) {
     subpixel_corner_finder_params_.print();
@@ -177,6 +183,13 @@ bool FeatureDetectorParams::parseYAML(const std::string& filepath) {
   // FAST specific params
   yaml_parser.getYamlParam("fast_thresh", &fast_thresh_);
 
+  // Grid-based detection params
+  yaml_parser.getYamlParam("enable_grid_detection", &enable_grid_detection_);
+  yaml_parser.getYamlParam("grid_cols", &grid_cols_);
+  yaml_parser.getYamlParam("grid_rows", &grid_rows_);
+  CHECK_GT(grid_cols_, 0);
+  CHECK_GT(grid_rows_, 0);
+
   return true;
 }
 
@@ -195,7 +208,9 @@ bool FeatureDetectorParams::equals(const FeatureDetectorParams& tp2,
          (fabs(quality_level_ - tp2.quality_level_) <= tol) &&
          (block_size_ == tp2.block_size_) &&
          (use_harris_corner_detector_ == tp2.use_harris_corner_detector_) &&
-         (fabs(k_ - tp2.k_) <= tol) && (fast_thresh_ == tp2.fast_thresh_);
+         (fabs(k_ - tp2.k_) <= tol) && (fast_thresh_ == tp2.fast_thresh_) &&
+         (enable_grid_detection_ == tp2.enable_grid_detection_) &&
+         (grid_cols_ == tp2.grid_cols_) && (grid_rows_ == tp2.grid_rows_);
 }
 
 }  // namespace VIO
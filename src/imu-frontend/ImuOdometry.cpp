@@ -0,0 +1,181 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   ImuOdometry.cpp
+ * @brief  Odometry at IMU rate by propagating the latest backend state with
+ * the IMU measurements received since.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/imu-frontend/ImuOdometry.h"
+
+#include <memory>
+
+#include <glog/logging.h>
+
+#include <gtsam/navigation/NavState.h>
+
+namespace VIO {
+
+namespace {
+
+// How far in the past a backend state can be re-propagated from [ns].
+constexpr Timestamp kImuBufferLengthNs = 10000000000;  // 10 s
+
+}  // namespace
+
+ImuOdometry::ImuOdometry(const ImuParams& imu_params, const ImuBias& imu_bias)
+    : imu_frontend_(imu_params, imu_bias),
+      imu_buffer_(kImuBufferLengthNs),
+      mutex_(),
+      backend_state_(0, VioNavState()),
+      has_backend_state_(false),
+      last_timestamp_(0),
+      last_imu_accgyr_(ImuAccGyr::Zero()),
+      newest_timestamp_(0),
+      newest_imu_accgyr_(ImuAccGyr::Zero()),
+      has_imu_measurement_(false),
+      output_callbacks_() {}
+
+/* -------------------------------------------------------------------------- */
+void ImuOdometry::addImuMeasurement(const ImuMeasurement& imu_measurement) {
+  const Timestamp& timestamp = imu_measurement.timestamp_;
+  const ImuAccGyr& imu_accgyr = imu_measurement.acc_gyr_;
+  std::unique_ptr<VioNavStateTimestamped> output = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (has_imu_measurement_ && timestamp <= newest_timestamp_) {
+      LOG(WARNING) << "Skipping IMU measurement at " << timestamp
+                   << "[ns], not newer than the last one at "
+                   << newest_timestamp_ << "[ns].";
+      return;
+    }
+    imu_buffer_.addMeasurement(timestamp, imu_accgyr);
+    if (!has_imu_measurement_) {
+      // A backend state received before any IMU data holds this one.
+      last_imu_accgyr_ = imu_accgyr;
+      has_imu_measurement_ = true;
+    }
+    newest_timestamp_ = timestamp;
+    newest_imu_accgyr_ = imu_accgyr;
+
+    // The backend state might be more recent than the measurement.
+    if (has_backend_state_ && timestamp > last_timestamp_) {
+      output = VIO::make_unique<VioNavStateTimestamped>(
+          propagate(timestamp, imu_accgyr));
+    }
+  }
+
+  // Outside of the lock, so that a slow callback does not block the backend.
+  if (output) {
+    for (const OutputCallback& callback : output_callbacks_) {
+      CHECK(callback);
+      callback(*output);
+    }
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+void ImuOdometry::addImuMeasurements(const ImuMeasurements& imu_measurements) {
+  CHECK_EQ(imu_measurements.timestamps_.cols(),
+           imu_measurements.acc_gyr_.cols());
+  for (int i = 0; i < imu_measurements.timestamps_.cols(); ++i) {
+    addImuMeasurement(ImuMeasurement(imu_measurements.timestamps_(i),
+                                     imu_measurements.acc_gyr_.col(i)));
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+void ImuOdometry::updateBackendState(const VioNavStateTimestamped& state) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (has_backend_state_ && state.timestamp_ <= backend_state_.timestamp_) {
+    LOG(WARNING) << "Ignoring backend state at " << state.timestamp_
+                 << "[ns], not newer than the current one at "
+                 << backend_state_.timestamp_ << "[ns].";
+    return;
+  }
+
+  // Re-propagate from the new state up to the newest IMU measurement.
+  ImuStampS imu_stamps;
+  ImuAccGyrS imu_accgyr;
+  if (has_imu_measurement_ && newest_timestamp_ > state.timestamp_) {
+    using QueryResult = utils::ThreadsafeImuBuffer::QueryResult;
+    switch (imu_buffer_.getImuDataInterpolatedBorders(
+        state.timestamp_, newest_timestamp_, &imu_stamps, &imu_accgyr)) {
+      case QueryResult::kDataAvailable: {
+        break;
+      }
+      case QueryResult::kTooFewMeasurementsAvailable: {
+        // Both timestamps are between the same two measurements.
+        imu_stamps.resize(Eigen::NoChange, 2);
+        imu_accgyr.resize(Eigen::NoChange, 2);
+        imu_stamps << state.timestamp_, newest_timestamp_;
+        ImuAccGyr interpolated_imu_accgyr;
+        imu_buffer_.interpolateValueAtTimestamp(state.timestamp_,
+                                                &interpolated_imu_accgyr);
+        imu_accgyr.col(0) = interpolated_imu_accgyr;
+        imu_accgyr.col(1) = newest_imu_accgyr_;
+        break;
+      }
+      case QueryResult::kDataNeverAvailable: {
+        LOG(WARNING) << "Ignoring backend state at " << state.timestamp_
+                     << "[ns], older than the IMU measurements buffered.";
+        return;
+      }
+      default: {
+        LOG(ERROR) << "Unexpected IMU buffer query result, ignoring backend "
+                      "state at "
+                   << state.timestamp_ << "[ns].";
+        return;
+      }
+    }
+  }
+
+  imu_frontend_.updateBias(state.imu_bias_);
+  imu_frontend_.resetIntegrationWithCachedBias();
+  backend_state_ = state;
+  has_backend_state_ = true;
+  if (imu_stamps.cols() > 0) {
+    // Integrates all but the newest measurement, which is integrated with
+    // the next one received.
+    imu_frontend_.preintegrateImuMeasurements(imu_stamps, imu_accgyr);
+    last_timestamp_ = newest_timestamp_;
+  } else {
+    // The state is more recent than the IMU data: hold the newest measurement
+    // from the time of the state on.
+    last_timestamp_ = state.timestamp_;
+  }
+  last_imu_accgyr_ = newest_imu_accgyr_;
+}
+
+/* -------------------------------------------------------------------------- */
+VioNavStateTimestamped ImuOdometry::propagate(const Timestamp& timestamp,
+                                              const ImuAccGyr& imu_accgyr) {
+  CHECK(has_backend_state_);
+  CHECK_GT(timestamp, last_timestamp_);
+  ImuStampS imu_stamps(1, 2);
+  imu_stamps << last_timestamp_, timestamp;
+  ImuAccGyrS imu_accgyrs(6, 2);
+  imu_accgyrs << last_imu_accgyr_, imu_accgyr;
+  const ImuFrontEnd::PimPtr pim =
+      imu_frontend_.preintegrateImuMeasurements(imu_stamps, imu_accgyrs);
+  CHECK(pim);
+  last_timestamp_ = timestamp;
+  last_imu_accgyr_ = imu_accgyr;
+
+  const gtsam::NavState navstate = pim->predict(
+      gtsam::NavState(backend_state_.pose_, backend_state_.velocity_),
+      backend_state_.imu_bias_);
+  return VioNavStateTimestamped(timestamp,
+                                navstate.pose(),
+                                navstate.velocity(),
+                                backend_state_.imu_bias_);
+}
+
+}  // namespace VIO
@@ -0,0 +1,539 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   AsyncLogWriter.cpp
+ * @brief  Log records whose formatting is deferred, and the writer thread
+ * that formats them and writes them to disk in batches.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/logging/AsyncLogWriter.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <unordered_map>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kimera-vio/common/vio_types.h"
+
+DEFINE_int32(async_log_queue_size,
+             16384,
+             "Maximum number of log records waiting to be written when "
+             "async_logging is true.");
+DEFINE_int32(async_log_flush_period_ms,
+             50,
+             "Period at which queued log records are written to disk.");
+DEFINE_bool(async_log_binary,
+            false,
+            "Serialize all log records to log_records.bin in the output path "
+            "instead of writing the log files. Use convertBinaryLog to get the "
+            "log files offline.");
+
+DECLARE_string(output_path);
+
+namespace VIO {
+
+namespace {
+
+const char kBinaryLogMagic[8] = {'K', 'V', 'I', 'O', 'L', 'O', 'G', 'B'};
+const uint32_t kBinaryLogVersion = 1u;
+
+// Records popped from the queue before writing them to disk.
+const size_t kMaxBatchSize = 4096u;
+// Formatted logs of a file are written once they get larger than this.
+const size_t kMaxBufferSize = 1u << 20u;
+
+template <typename T>
+void appendBinary(const T& value, std::string* output) {
+  output->append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void appendBinaryString(const std::string& value, std::string* output) {
+  appendBinary(static_cast<uint32_t>(value.size()), output);
+  output->append(value);
+}
+
+template <typename T>
+bool readBinary(const char** data, const char* end, T* value) {
+  if (end - *data < static_cast<std::ptrdiff_t>(sizeof(T))) return false;
+  std::memcpy(value, *data, sizeof(T));
+  *data += sizeof(T);
+  return true;
+}
+
+bool readBinaryString(const char** data, const char* end, std::string* value) {
+  uint32_t size = 0u;
+  if (!readBinary(data, end, &size)) return false;
+  if (end - *data < static_cast<std::ptrdiff_t>(size)) return false;
+  value->assign(*data, size);
+  *data += size;
+  return true;
+}
+
+void formatField(const LogField& field, std::string* output) {
+  switch (field.type_) {
+    case LogField::Type::Int: {
+      output->append(std::to_string(field.int_));
+      break;
+    }
+    case LogField::Type::UInt: {
+      output->append(std::to_string(field.uint_));
+      break;
+    }
+    case LogField::Type::Double: {
+      // Same as an ostream with precision 20.
+      char buffer[32];
+      const int size =
+          std::snprintf(buffer, sizeof(buffer), "%.20g", field.double_);
+      CHECK_GT(size, 0);
+      output->append(buffer, static_cast<size_t>(size));
+      break;
+    }
+    case LogField::Type::String: {
+      output->append(field.string_);
+      break;
+    }
+    default: {
+      LOG(FATAL) << "Unrecognized log field type.";
+    }
+  }
+}
+
+}  // namespace
+
+/* -------------------------------------------------------------------------- */
+LogRecord::LogRecord(const size_t& num_columns,
+                     const char& separator,
+                     const std::string& line_end)
+    : type_(Type::Rows),
+      num_columns_(num_columns),
+      separator_(separator),
+      line_end_(line_end) {
+  CHECK_GT(num_columns_, 0u);
+}
+
+/* -------------------------------------------------------------------------- */
+LogRecord LogRecord::Text(const std::string& text) {
+  LogRecord record;
+  record.type_ = Type::Text;
+  record.text_ = text;
+  return record;
+}
+
+/* -------------------------------------------------------------------------- */
+LogRecord LogRecord::Control(const Type& type, const std::string& path) {
+  CHECK(type != Type::Rows && type != Type::Text);
+  LogRecord record;
+  record.type_ = type;
+  record.text_ = path;
+  return record;
+}
+
+/* -------------------------------------------------------------------------- */
+LogRecord& LogRecord::operator<<(const std::string& value) {
+  fields_.emplace_back();
+  fields_.back().type_ = LogField::Type::String;
+  fields_.back().string_ = value;
+  return *this;
+}
+
+/* -------------------------------------------------------------------------- */
+LogRecord& LogRecord::operator<<(const char* value) {
+  return *this << std::string(CHECK_NOTNULL(value));
+}
+
+/* -------------------------------------------------------------------------- */
+void LogRecord::format(std::string* output) const {
+  CHECK_NOTNULL(output);
+  switch (type_) {
+    case Type::Rows: {
+      CHECK_EQ(fields_.size() % num_columns_, 0u)
+          << "Log record with incomplete lines.";
+      for (size_t i = 0u; i < fields_.size(); i++) {
+        if (i % num_columns_ != 0u) output->push_back(separator_);
+        formatField(fields_[i], output);
+        if ((i + 1u) % num_columns_ == 0u) output->append(line_end_);
+      }
+      break;
+    }
+    case Type::Text: {
+      output->append(text_);
+      break;
+    }
+    default: {
+      // Control records have no contents.
+      break;
+    }
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+void LogRecord::serialize(std::string* output) const {
+  CHECK_NOTNULL(output);
+  appendBinary(static_cast<uint8_t>(type_), output);
+  if (type_ != Type::Rows) {
+    appendBinaryString(text_, output);
+    return;
+  }
+  appendBinary(static_cast<uint32_t>(num_columns_), output);
+  appendBinary(separator_, output);
+  appendBinaryString(line_end_, output);
+  appendBinary(static_cast<uint32_t>(fields_.size()), output);
+  for (const LogField& field : fields_) {
+    appendBinary(static_cast<uint8_t>(field.type_), output);
+    switch (field.type_) {
+      case LogField::Type::Int: {
+        appendBinary(field.int_, output);
+        break;
+      }
+      case LogField::Type::UInt: {
+        appendBinary(field.uint_, output);
+        break;
+      }
+      case LogField::Type::Double: {
+        appendBinary(field.double_, output);
+        break;
+      }
+      case LogField::Type::String: {
+        appendBinaryString(field.string_, output);
+        break;
+      }
+      default: {
+        LOG(FATAL) << "Unrecognized log field type.";
+      }
+    }
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+bool LogRecord::deserialize(const char** data,
+                            const char* end,
+                            LogRecord* record) {
+  CHECK_NOTNULL(data);
+  CHECK_NOTNULL(record);
+  *record = LogRecord();
+  uint8_t type = 0u;
+  if (!readBinary(data, end, &type)) return false;
+  CHECK_LE(type, static_cast<uint8_t>(Type::Close)) << "Corrupted log record.";
+  record->type_ = static_cast<Type>(type);
+  if (record->type_ != Type::Rows) {
+    return readBinaryString(data, end, &record->text_);
+  }
+
+  uint32_t num_columns = 0u;
+  uint32_t num_fields = 0u;
+  if (!readBinary(data, end, &num_columns) ||
+      !readBinary(data, end, &record->separator_) ||
+      !readBinaryString(data, end, &record->line_end_) ||
+      !readBinary(data, end, &num_fields)) {
+    return false;
+  }
+  CHECK_GT(num_columns, 0u) << "Corrupted log record.";
+  record->num_columns_ = num_columns;
+  record->fields_.resize(num_fields);
+  for (LogField& field : record->fields_) {
+    uint8_t field_type = 0u;
+    if (!readBinary(data, end, &field_type)) return false;
+    field.type_ = static_cast<LogField::Type>(field_type);
+    bool is_complete = false;
+    switch (field.type_) {
+      case LogField::Type::Int: {
+        is_complete = readBinary(data, end, &field.int_);
+        break;
+      }
+      case LogField::Type::UInt: {
+        is_complete = readBinary(data, end, &field.uint_);
+        break;
+      }
+      case LogField::Type::Double: {
+        is_complete = readBinary(data, end, &field.double_);
+        break;
+      }
+      case LogField::Type::String: {
+        is_complete = readBinaryString(data, end, &field.string_);
+        break;
+      }
+      default: {
+        LOG(FATAL) << "Corrupted log record.";
+      }
+    }
+    if (!is_complete) return false;
+  }
+  return true;
+}
+
+/* ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+// Log files written from their records, with buffered writes.
+class AsyncLogWriter::LogFiles {
+ public:
+  // If output_dir is not empty, files are written there instead of at the
+  // path of their Open record.
+  explicit LogFiles(const std::string& output_dir = "")
+      : output_dir_(output_dir) {}
+  ~LogFiles() { flush(); }
+
+  void apply(const uint32_t& file_id, const LogRecord& record) {
+    switch (record.type()) {
+      case LogRecord::Type::Open:
+      case LogRecord::Type::OpenAppend: {
+        std::unique_ptr<LogFile>& file = files_[file_id];
+        file = VIO::make_unique<LogFile>();
+        file->path_ = record.text();
+        if (!output_dir_.empty()) {
+          const size_t slash = file->path_.find_last_of('/');
+          file->path_ = output_dir_ + '/' +
+                        (slash == std::string::npos
+                             ? file->path_
+                             : file->path_.substr(slash + 1u));
+        }
+        open(record.type() == LogRecord::Type::OpenAppend, file.get());
+        break;
+      }
+      case LogRecord::Type::Close: {
+        LogFile* file = getFile(file_id);
+        write(file);
+        file->stream_.close();
+        files_.erase(file_id);
+        break;
+      }
+      case LogRecord::Type::Truncate: {
+        LogFile* file = getFile(file_id);
+        file->buffer_.clear();
+        file->stream_.close();
+        open(false, file);
+        break;
+      }
+      default: {
+        LogFile* file = getFile(file_id);
+        record.format(&file->buffer_);
+        if (file->buffer_.size() > kMaxBufferSize) write(file);
+      }
+    }
+  }
+
+  void flush() {
+    for (auto& file : files_) {
+      write(file.second.get());
+      file.second->stream_.flush();
+    }
+  }
+
+ private:
+  struct LogFile {
+    std::string path_;
+    std::ofstream stream_;
+    std::string buffer_;
+  };
+
+  LogFile* getFile(const uint32_t& file_id) {
+    const auto it = files_.find(file_id);
+    CHECK(it != files_.end()) << "Log record for a file that is not open.";
+    return it->second.get();
+  }
+
+  void open(const bool& append_mode, LogFile* file) {
+    CHECK_NOTNULL(file);
+    file->stream_.open(file->path_,
+                       append_mode ? std::ios_base::app : std::ios_base::out);
+    CHECK(file->stream_.is_open()) << "Cannot open file: " << file->path_;
+  }
+
+  void write(LogFile* file) {
+    CHECK_NOTNULL(file);
+    if (file->buffer_.empty()) return;
+    file->stream_.write(file->buffer_.data(), file->buffer_.size());
+    CHECK(file->stream_.good()) << "Error writing to " << file->path_;
+    file->buffer_.clear();
+  }
+
+ private:
+  const std::string output_dir_;
+  std::unordered_map<uint32_t, std::unique_ptr<LogFile>> files_;
+};
+
+/* ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+AsyncLogWriter::AsyncLogWriter(const size_t& queue_size,
+                               const int& flush_period_ms,
+                               const std::string& binary_log_path)
+    : queue_(queue_size),
+      flush_period_ms_(flush_period_ms),
+      binary_mode_(!binary_log_path.empty()),
+      log_files_(VIO::make_unique<LogFiles>()) {
+  CHECK_GT(flush_period_ms_, 0);
+  if (binary_mode_) {
+    binary_log_.open(binary_log_path, std::ios::out | std::ios::binary);
+    CHECK(binary_log_.is_open()) << "Cannot open file: " << binary_log_path;
+    binary_log_.write(kBinaryLogMagic, sizeof(kBinaryLogMagic));
+    binary_log_.write(reinterpret_cast<const char*>(&kBinaryLogVersion),
+                      sizeof(kBinaryLogVersion));
+    LOG(INFO) << "Writing binary log to " << binary_log_path;
+  }
+  writer_ = VIO::make_unique<std::thread>(&AsyncLogWriter::spin, this);
+}
+
+/* -------------------------------------------------------------------------- */
+AsyncLogWriter::~AsyncLogWriter() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutdown_ = true;
+  }
+  wake_up_condition_.notify_all();
+  if (writer_ && writer_->joinable()) {
+    writer_->join();
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+AsyncLogWriter& AsyncLogWriter::instance() {
+  static AsyncLogWriter writer(
+      static_cast<size_t>(FLAGS_async_log_queue_size),
+      FLAGS_async_log_flush_period_ms,
+      FLAGS_async_log_binary ? FLAGS_output_path + "/log_records.bin" : "");
+  return writer;
+}
+
+/* -------------------------------------------------------------------------- */
+uint32_t AsyncLogWriter::openFile(const std::string& path,
+                                  const bool& append_mode) {
+  const uint32_t file_id = next_file_id_++;
+  write(file_id,
+        LogRecord::Control(append_mode ? LogRecord::Type::OpenAppend
+                                       : LogRecord::Type::Open,
+                           path));
+  return file_id;
+}
+
+/* -------------------------------------------------------------------------- */
+void AsyncLogWriter::write(const uint32_t& file_id, LogRecord&& record) {
+  QueuedRecord queued;
+  queued.file_id_ = file_id;
+  queued.record_ = std::move(record);
+  while (!queue_.tryPush(std::move(queued))) {
+    // The writer is behind, wake it up instead of waiting for its period.
+    wake_up_condition_.notify_one();
+    std::this_thread::yield();
+  }
+  num_pushed_++;
+}
+
+/* -------------------------------------------------------------------------- */
+void AsyncLogWriter::flush() {
+  const uint64_t num_pushed = num_pushed_;
+  std::unique_lock<std::mutex> lock(mutex_);
+  flush_requested_ = true;
+  wake_up_condition_.notify_one();
+  written_condition_.wait(
+      lock, [&] { return num_written_ >= num_pushed || shutdown_; });
+}
+
+/* -------------------------------------------------------------------------- */
+void AsyncLogWriter::spin() {
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      wake_up_condition_.wait_for(
+          lock, std::chrono::milliseconds(flush_period_ms_), [this] {
+            return shutdown_ || flush_requested_;
+          });
+      flush_requested_ = false;
+    }
+    const bool is_shutdown = shutdown_;
+    writeBatch();
+    // Records queued before the shutdown have been written.
+    if (is_shutdown) break;
+  }
+  written_condition_.notify_all();
+}
+
+/* -------------------------------------------------------------------------- */
+void AsyncLogWriter::writeBatch() {
+  const uint64_t num_popped_before = num_popped_;
+  QueuedRecord queued;
+  bool is_queue_empty = false;
+  while (!is_queue_empty) {
+    size_t batch_size = 0u;
+    while (batch_size < kMaxBatchSize && queue_.tryPop(&queued)) {
+      if (binary_mode_) {
+        appendBinary(queued.file_id_, &binary_buffer_);
+        queued.record_.serialize(&binary_buffer_);
+      } else {
+        log_files_->apply(queued.file_id_, queued.record_);
+      }
+      batch_size++;
+    }
+    num_popped_ += batch_size;
+    is_queue_empty = batch_size < kMaxBatchSize;
+
+    if (binary_mode_ && !binary_buffer_.empty()) {
+      binary_log_.write(binary_buffer_.data(), binary_buffer_.size());
+      CHECK(binary_log_.good()) << "Error writing the binary log.";
+      binary_buffer_.clear();
+    }
+  }
+  if (num_popped_ == num_popped_before) {
+    // Nothing new to write, but a flush may be waiting.
+    std::lock_guard<std::mutex> lock(mutex_);
+    num_written_ = num_popped_;
+  } else {
+    if (binary_mode_) {
+      binary_log_.flush();
+    } else {
+      log_files_->flush();
+    }
+    VLOG(10) << "AsyncLogWriter: wrote " << num_popped_ - num_popped_before
+             << " log records.";
+    std::lock_guard<std::mutex> lock(mutex_);
+    num_written_ = num_popped_;
+  }
+  written_condition_.notify_all();
+}
+
+/* -------------------------------------------------------------------------- */
+void AsyncLogWriter::convertBinaryLog(const std::string& binary_log_path,
+                                      const std::string& output_dir) {
+  std::ifstream stream(binary_log_path, std::ios::in | std::ios::binary);
+  CHECK(stream.good()) << "Could not open " << binary_log_path;
+  std::stringstream contents;
+  contents << stream.rdbuf();
+  const std::string buffer = contents.str();
+
+  const char* data = buffer.data();
+  const char* end = data + buffer.size();
+  CHECK(end - data >= static_cast<std::ptrdiff_t>(sizeof(kBinaryLogMagic)) &&
+        std::memcmp(data, kBinaryLogMagic, sizeof(kBinaryLogMagic)) == 0)
+      << binary_log_path << " is not a binary log.";
+  data += sizeof(kBinaryLogMagic);
+  uint32_t version = 0u;
+  CHECK(readBinary(&data, end, &version) && version == kBinaryLogVersion)
+      << "Unsupported binary log version in " << binary_log_path;
+
+  LogFiles log_files(output_dir);
+  size_t num_records = 0u;
+  while (data < end) {
+    uint32_t file_id = 0u;
+    LogRecord record;
+    if (!readBinary(&data, end, &file_id) ||
+        !LogRecord::deserialize(&data, end, &record)) {
+      LOG(WARNING) << "Binary log " << binary_log_path
+                   << " ends with a truncated record, ignoring it.";
+      break;
+    }
+    log_files.apply(file_id, record);
+    num_records++;
+  }
+  log_files.flush();
+  LOG(INFO) << "Converted " << num_records << " log records from "
+            << binary_log_path << " to " << output_dir;
+}
+
+}  // namespace VIO
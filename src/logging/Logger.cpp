@@ -16,7 +16,9 @@
 
 #include <fstream>
 #include <memory>
+#include <sstream>
 #include <string>
+#include <utility>
 
 #include <boost/filesystem.hpp>  // to create folders
 #include <boost/foreach.hpp>
@@ -29,6 +31,10 @@
 #include "kimera-vio/utils/UtilsOpenCV.h"
 
 DEFINE_string(output_path, "./", "Path where to store VIO's log output.");
+DEFINE_bool(async_logging,
+            false,
+            "Format and write the logs in a dedicated thread, in batches, "
+            "instead of in the modules' threads.");
 
 namespace VIO {
 
@@ -36,23 +42,53 @@ namespace VIO {
 // This constructor will directly open the log file when called.
 OfstreamWrapper::OfstreamWrapper(const std::string& filename,
                                  const bool& open_file_in_append_mode)
-    : filename_(filename), output_path_(FLAGS_output_path) {
-  openLogFile(filename, open_file_in_append_mode);
+    : filename_(filename),
+      output_path_(FLAGS_output_path),
+      is_async_(FLAGS_async_logging) {
+  if (is_async_) {
+    CHECK(!filename.empty());
+    async_file_id_ = AsyncLogWriter::instance().openFile(
+        output_path_ + '/' + filename, open_file_in_append_mode);
+  } else {
+    openLogFile(filename, open_file_in_append_mode);
+  }
 }
 
 // This destructor will directly close the log file when the wrapper is
 // destructed. So no need to explicitly call .close();
 OfstreamWrapper::~OfstreamWrapper() {
   LOG(INFO) << "Closing output file: " << filename_.c_str();
-  ofstream_.close();
+  if (is_async_) {
+    AsyncLogWriter::instance().write(
+        async_file_id_, LogRecord::Control(LogRecord::Type::Close));
+  } else {
+    ofstream_.close();
+  }
 }
 
 void OfstreamWrapper::closeAndOpenLogFile() {
-  ofstream_.close();
   CHECK(!filename_.empty());
+  if (is_async_) {
+    AsyncLogWriter::instance().write(
+        async_file_id_, LogRecord::Control(LogRecord::Type::Truncate));
+    return;
+  }
+  ofstream_.close();
   OpenFile(output_path_ + '/' + filename_, &ofstream_, false);
 }
 
+void OfstreamWrapper::write(LogRecord&& record) {
+  if (is_async_) {
+    AsyncLogWriter::instance().write(async_file_id_, std::move(record));
+    return;
+  }
+  std::string text;
+  record.format(&text);
+  ofstream_.write(text.data(), text.size());
+  ofstream_.flush();
+  CHECK(ofstream_.good()) << "Error writing to file: " << filename_;
+}
+
 void OfstreamWrapper::openLogFile(const std::string& output_file_name,
                                   bool open_file_in_append_mode) {
   CHECK(!output_file_name.empty());
@@ -72,12 +108,14 @@ void EurocGtLogger::logGtData(const std::string& file_path) {
   std::string dummy_header;
   std::getline(f_in, dummy_header);
 
-  std::ofstream& output_stream = output_gt_poses_csv_.ofstream_;
   // First, write header
-  output_stream << "#timestamp,x,y,z,qw,qx,qy,qz,vx,vy,vz,"
-                << "bgx,bgy,bgz,bax,bay,baz" << std::endl;
+  output_gt_poses_csv_.write(
+      LogRecord::Text("#timestamp,x,y,z,qw,qx,qy,qz,vx,vy,vz,"
+                      "bgx,bgy,bgz,bax,bay,baz\n"));
   // Then, copy all gt data to file
-  output_stream << f_in.rdbuf();
+  std::stringstream gt_data;
+  gt_data << f_in.rdbuf();
+  output_gt_poses_csv_.write(LogRecord::Text(gt_data.str()));
 
   // Clean
   f_in.close();
@@ -139,13 +177,13 @@ void BackendLogger::displayInitialStateVioInfo(
 
 void BackendLogger::logBackendResultsCSV(const BackendOutput& vio_output) {
   // We log the poses in csv format for later alignement and analysis.
-  std::ofstream& output_stream = output_poses_vio_csv_.ofstream_;
   bool& is_header_written = is_header_written_poses_vio_;
 
   // First, write header, but only once.
   if (!is_header_written) {
-    output_stream << "#timestamp,x,y,z,qw,qx,qy,qz,vx,vy,vz,"
-                  << "bgx,bgy,bgz,bax,bay,baz" << std::endl;
+    output_poses_vio_csv_.write(
+        LogRecord::Text("#timestamp,x,y,z,qw,qx,qy,qz,vx,vy,vz,"
+                        "bgx,bgy,bgz,bax,bay,baz\n"));
     is_header_written = true;
   }
   const auto& cached_state = vio_output.W_State_Blkf_;
@@ -154,63 +192,65 @@ void BackendLogger::logBackendResultsCSV(const BackendOutput& vio_output) {
   const auto& w_vel_blkf = cached_state.velocity_.transpose();
   const auto& imu_bias_gyro = cached_state.imu_bias_.gyroscope().transpose();
   const auto& imu_bias_acc = cached_state.imu_bias_.accelerometer().transpose();
-  output_stream << cached_state.timestamp_ << ","  //
-                << w_pose_blkf_trans.x() << ","    //
-                << w_pose_blkf_trans.y() << ","    //
-                << w_pose_blkf_trans.z() << ","    //
-                << w_pose_blkf_rot(0) << ","       // q_w
-                << w_pose_blkf_rot(1) << ","       // q_x
-                << w_pose_blkf_rot(2) << ","       // q_y
-                << w_pose_blkf_rot(3) << ","       // q_z
-                << w_vel_blkf(0) << ","            //
-                << w_vel_blkf(1) << ","            //
-                << w_vel_blkf(2) << ","            //
-                << imu_bias_gyro(0) << ","         //
-                << imu_bias_gyro(1) << ","         //
-                << imu_bias_gyro(2) << ","         //
-                << imu_bias_acc(0) << ","          //
-                << imu_bias_acc(1) << ","          //
-                << imu_bias_acc(2)                 //
-                << std::endl;
+  LogRecord record(17u);
+  record << cached_state.timestamp_  //
+         << w_pose_blkf_trans.x()    //
+         << w_pose_blkf_trans.y()    //
+         << w_pose_blkf_trans.z()    //
+         << w_pose_blkf_rot(0)       // q_w
+         << w_pose_blkf_rot(1)       // q_x
+         << w_pose_blkf_rot(2)       // q_y
+         << w_pose_blkf_rot(3)       // q_z
+         << w_vel_blkf(0)            //
+         << w_vel_blkf(1)            //
+         << w_vel_blkf(2)            //
+         << imu_bias_gyro(0)         //
+         << imu_bias_gyro(1)         //
+         << imu_bias_gyro(2)         //
+         << imu_bias_acc(0)          //
+         << imu_bias_acc(1)          //
+         << imu_bias_acc(2);         //
+  output_poses_vio_csv_.write(std::move(record));
 }
 
 void BackendLogger::logSmartFactorsStats(const BackendOutput& output) {
-  std::ofstream& output_stream = output_smart_factors_stats_csv_.ofstream_;
   bool& is_header_written = is_header_written_smart_factors_;
 
   // First, write header, but only once.
   if (!is_header_written) {
-    output_stream << "#cur_kf_id,timestamp_kf,numSF,"
-                  << "numValid,numDegenerate,numFarPoints,numOutliers,"
-                  << "numCheirality,numNonInitialized,meanPixelError,"
-                  << "maxPixelError,meanTrackLength,maxTrackLength,"
-                  << "nrElementsInMatrix,nrZeroElementsInMatrix" << std::endl;
+    output_smart_factors_stats_csv_.write(
+        LogRecord::Text("#cur_kf_id,timestamp_kf,numSF,"
+                        "numValid,numDegenerate,numFarPoints,numOutliers,"
+                        "numCheirality,numNonInitialized,meanPixelError,"
+                        "maxPixelError,meanTrackLength,maxTrackLength,"
+                        "nrElementsInMatrix,nrZeroElementsInMatrix\n"));
     is_header_written = true;
   }
 
-  output_stream << output.cur_kf_id_ << "," << output.W_State_Blkf_.timestamp_
-                << "," << output.debug_info_.numSF_ << ","
-                << output.debug_info_.numValid_ << ","
-                << output.debug_info_.numDegenerate_ << ","
-                << output.debug_info_.numFarPoints_ << ","
-                << output.debug_info_.numOutliers_ << ","
-                << output.debug_info_.numCheirality_ << ","
-                << output.debug_info_.numNonInitialized_ << ","
-                << output.debug_info_.meanPixelError_ << ","
-                << output.debug_info_.maxPixelError_ << ","
-                << output.debug_info_.meanTrackLength_ << ","
-                << output.debug_info_.maxTrackLength_ << ","
-                << output.debug_info_.nrElementsInMatrix_ << ","
-                << output.debug_info_.nrZeroElementsInMatrix_ << std::endl;
+  LogRecord record(15u);
+  record << output.cur_kf_id_ << output.W_State_Blkf_.timestamp_
+         << output.debug_info_.numSF_ << output.debug_info_.numValid_
+         << output.debug_info_.numDegenerate_
+         << output.debug_info_.numFarPoints_
+         << output.debug_info_.numOutliers_
+         << output.debug_info_.numCheirality_
+         << output.debug_info_.numNonInitialized_
+         << output.debug_info_.meanPixelError_
+         << output.debug_info_.maxPixelError_
+         << output.debug_info_.meanTrackLength_
+         << output.debug_info_.maxTrackLength_
+         << output.debug_info_.nrElementsInMatrix_
+         << output.debug_info_.nrZeroElementsInMatrix_;
+  output_smart_factors_stats_csv_.write(std::move(record));
 }
 
 void BackendLogger::logBackendPimNavstates(const BackendOutput& output) {
-  std::ofstream& output_stream = output_pim_navstates_csv_.ofstream_;
   bool& is_header_written = is_header_written_pim_navstates_;
 
   // First, write header, but only once.
   if (!is_header_written) {
-    output_stream << "#timestamp_kf,x,y,z,qw,qx,qy,qz,vx,vy,vz" << std::endl;
+    output_pim_navstates_csv_.write(
+        LogRecord::Text("#timestamp_kf,x,y,z,qw,qx,qy,qz,vx,vy,vz\n"));
     is_header_written = true;
   }
 
@@ -219,62 +259,63 @@ void BackendLogger::logBackendPimNavstates(const BackendOutput& output) {
   const gtsam::Quaternion& quaternion = pose.rotation().toQuaternion();
   const gtsam::Velocity3& velocity = output.debug_info_.navstate_k_.velocity();
 
-  output_stream << output.W_State_Blkf_.timestamp_ << "," << position.x() << ","
-                << position.y() << "," << position.z() << "," << quaternion.w()
-                << "," << quaternion.x() << "," << quaternion.y() << ","
-                << quaternion.z() << "," << velocity.x() << "," << velocity.y()
-                << "," << velocity.z() << std::endl;
+  LogRecord record(11u);
+  record << output.W_State_Blkf_.timestamp_ << position.x() << position.y()
+         << position.z() << quaternion.w() << quaternion.x() << quaternion.y()
+         << quaternion.z() << velocity.x() << velocity.y() << velocity.z();
+  output_pim_navstates_csv_.write(std::move(record));
 }
 
 void BackendLogger::logBackendTiming(const BackendOutput& output) {
-  std::ofstream& output_stream = output_backend_timing_csv_.ofstream_;
   bool& is_header_written = is_header_written_backend_timing_;
 
   // First, write header, but only once.
   if (!is_header_written) {
-    output_stream << "#cur_kf_id,factorsAndSlotsTime,preUpdateTime,"
-                  << "updateTime,updateSlotTime,extraIterationsTime,"
-                  << "linearizeTime,linearSolveTime,retractTime,"
-                  << "linearizeMarginalizeTime,marginalizeTime" << std::endl;
+    output_backend_timing_csv_.write(
+        LogRecord::Text("#cur_kf_id,factorsAndSlotsTime,preUpdateTime,"
+                        "updateTime,updateSlotTime,extraIterationsTime,"
+                        "linearizeTime,linearSolveTime,retractTime,"
+                        "linearizeMarginalizeTime,marginalizeTime\n"));
     is_header_written = true;
   }
 
   // Log timing for benchmarking and performance profiling.
-  output_stream << output.cur_kf_id_ << ","
-                << output.debug_info_.factorsAndSlotsTime_ << ","
-                << output.debug_info_.preUpdateTime_ << ","
-                << output.debug_info_.updateTime_ << ","
-                << output.debug_info_.updateSlotTime_ << ","
-                << output.debug_info_.extraIterationsTime_ << ","
-                << output.debug_info_.linearizeTime_ << ","
-                << output.debug_info_.linearSolveTime_ << ","
-                << output.debug_info_.retractTime_ << ","
-                << output.debug_info_.linearizeMarginalizeTime_ << ","
-                << output.debug_info_.marginalizeTime_ << std::endl;
+  LogRecord record(11u);
+  record << output.cur_kf_id_ << output.debug_info_.factorsAndSlotsTime_
+         << output.debug_info_.preUpdateTime_
+         << output.debug_info_.updateTime_
+         << output.debug_info_.updateSlotTime_
+         << output.debug_info_.extraIterationsTime_
+         << output.debug_info_.linearizeTime_
+         << output.debug_info_.linearSolveTime_
+         << output.debug_info_.retractTime_
+         << output.debug_info_.linearizeMarginalizeTime_
+         << output.debug_info_.marginalizeTime_;
+  output_backend_timing_csv_.write(std::move(record));
 }
 
 void BackendLogger::logBackendFactorsStats(const BackendOutput& output) {
-  std::ofstream& output_stream = output_backend_factors_stats_csv_.ofstream_;
   bool& is_header_written = is_header_written_backend_factors_stats_;
 
   // First, write header, but only once.
   if (!is_header_written) {
-    output_stream << "#cur_kf_id,numAddedSmartF,numAddedImuF,numAddedNoMotionF,"
-                  << "numAddedConstantF,numAddedBetweenStereoF,state_size,"
-                  << "landmark_count" << std::endl;
+    output_backend_factors_stats_csv_.write(LogRecord::Text(
+        "#cur_kf_id,numAddedSmartF,numAddedImuF,numAddedNoMotionF,"
+        "numAddedConstantF,numAddedBetweenStereoF,state_size,"
+        "landmark_count\n"));
     is_header_written = true;
   }
 
   // Log timing for benchmarking and performance profiling.
   // Statistics about factors added to the graph.
-  output_stream << output.cur_kf_id_ << ","
-                << output.debug_info_.numAddedSmartF_ << ","
-                << output.debug_info_.numAddedImuF_ << ","
-                << output.debug_info_.numAddedNoMotionF_ << ","
-                << output.debug_info_.numAddedConstantVelF_ << ","
-                << output.debug_info_.numAddedBetweenStereoF_ << ","
-                << output.state_.size() << "," << output.landmark_count_
-                << std::endl;
+  LogRecord record(8u);
+  record << output.cur_kf_id_ << output.debug_info_.numAddedSmartF_
+         << output.debug_info_.numAddedImuF_
+         << output.debug_info_.numAddedNoMotionF_
+         << output.debug_info_.numAddedConstantVelF_
+         << output.debug_info_.numAddedBetweenStereoF_ << output.state_.size()
+         << output.landmark_count_;
+  output_backend_factors_stats_csv_.write(std::move(record));
 }
 
 /* ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
@@ -288,32 +329,27 @@ VisualizerLogger::VisualizerLogger()
 
 void VisualizerLogger::logLandmarks(const PointsWithId& lmks) {
   // Absolute vio errors
-  std::ofstream& output_landmarks_stream = output_landmarks_.ofstream_;
-  output_landmarks_stream << "Id\t"
-                          << "x\t"
-                          << "y\t"
-                          << "z\n";
+  output_landmarks_.write(LogRecord::Text("Id\tx\ty\tz\n"));
+  LogRecord record(4u, '\t');
   for (const PointWithId& point : lmks) {
-    output_landmarks_stream << point.first << "\t" << point.second.x() << "\t"
-                            << point.second.y() << "\t" << point.second.z()
-                            << "\n";
+    record << point.first << point.second.x() << point.second.y()
+           << point.second.z();
   }
-  output_landmarks_stream << std::endl;
+  output_landmarks_.write(std::move(record));
+  output_landmarks_.write(LogRecord::Text("\n"));
 }
 
 void VisualizerLogger::logLandmarks(const cv::Mat& lmks) {
   // cv::Mat each row has a lmk with x, y, z.
   // Absolute vio errors
-  std::ofstream& output_landmarks_stream = output_landmarks_.ofstream_;
-  output_landmarks_stream << "x\t"
-                          << "y\t"
-                          << "z\n";
+  output_landmarks_.write(LogRecord::Text("x\ty\tz\n"));
+  LogRecord record(3u, '\t');
   for (int i = 0; i < lmks.rows; i++) {
-    output_landmarks_stream << lmks.at<float>(i, 0) << "\t"
-                            << lmks.at<float>(i, 1) << "\t"
-                            << lmks.at<float>(i, 2) << "\n";
+    record << lmks.at<float>(i, 0) << lmks.at<float>(i, 1)
+           << lmks.at<float>(i, 2);
   }
-  output_landmarks_stream << std::endl;
+  output_landmarks_.write(std::move(record));
+  output_landmarks_.write(LogRecord::Text("\n"));
 }
 
 void VisualizerLogger::logMesh(const cv::Mat& lmks,
@@ -321,16 +357,16 @@ void VisualizerLogger::logMesh(const cv::Mat& lmks,
                                const cv::Mat& mesh,
                                const double& timestamp,
                                bool log_accumulated_mesh) {
-  std::ofstream& output_mesh_stream = output_mesh_.ofstream_;
   bool& is_header_written = is_header_written_mesh_;
 
-  CHECK(output_mesh_stream) << "Output File Mesh: error writing.";
   // Number of vertices in the mesh.
   int vertex_count = lmks.rows;
   // Number of faces in the mesh.
   int faces_count = std::round(mesh.rows / 4);
   // First, write header, but only once.
   if (!is_header_written || !log_accumulated_mesh) {
+    std::ostringstream output_mesh_stream;
+    output_mesh_stream.precision(20);
     output_mesh_stream << "ply\n"
                        << "format ascii 1.0\n"
                        << "comment Mesh for SPARK VIO at timestamp "
@@ -345,28 +381,29 @@ void VisualizerLogger::logMesh(const cv::Mat& lmks,
                        << "element face " << faces_count << "\n"
                        << "property list uchar int vertex_indices\n"
                        << "end_header\n";
+    output_mesh_.write(LogRecord::Text(output_mesh_stream.str()));
     is_header_written = true;
   }
 
   // Second, log vertices.
+  LogRecord vertices(6u, ' ', " \n");
   for (int i = 0; i < lmks.rows; i++) {
-    output_mesh_stream << lmks.at<float>(i, 0) << " "  // Log vertices x y z.
-                       << lmks.at<float>(i, 1) << " " << lmks.at<float>(i, 2)
-                       << " " << int(colors.at<uint8_t>(i, 0))
-                       << " "  // Log vertices colors.
-                       << int(colors.at<uint8_t>(i, 1)) << " "
-                       << int(colors.at<uint8_t>(i, 2)) << " \n";
+    vertices << lmks.at<float>(i, 0)  // Log vertices x y z.
+             << lmks.at<float>(i, 1) << lmks.at<float>(i, 2)
+             << int(colors.at<uint8_t>(i, 0))  // Log vertices colors.
+             << int(colors.at<uint8_t>(i, 1)) << int(colors.at<uint8_t>(i, 2));
   }
+  output_mesh_.write(std::move(vertices));
   // Finally, log faces.
+  LogRecord faces(4u, ' ', " \n");
   for (int i = 0; i < faces_count; i++) {
     // Assumes the mesh is made of triangles
     int index = i * 4;
-    output_mesh_stream << mesh.at<int32_t>(index) << " "
-                       << mesh.at<int32_t>(index + 1) << " "
-                       << mesh.at<int32_t>(index + 2) << " "
-                       << mesh.at<int32_t>(index + 3) << " \n";
+    faces << mesh.at<int32_t>(index) << mesh.at<int32_t>(index + 1)
+          << mesh.at<int32_t>(index + 2) << mesh.at<int32_t>(index + 3);
   }
-  output_mesh_stream << std::endl;
+  output_mesh_.write(std::move(faces));
+  output_mesh_.write(LogRecord::Text("\n"));
 }
 
 /* ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
@@ -396,54 +433,50 @@ void FrontendLogger::logFrontendStats(
     const TrackerStatusSummary& tracker_summary,
     const size_t& nrKeypoints) {
   // We log frontend results in csv format.
-  std::ofstream& output_stream_stats = output_frontend_stats_.ofstream_;
   bool& is_header_written = is_header_written_frontend_stats_;
 
   if (!is_header_written) {
-    output_stream_stats << "#timestamp_lkf,mono_status,stereo_status,"
-                        << "nr_keypoints,nrDetectedFeatures,nrTrackerFeatures,"
-                        << "nrMonoInliers,nrMonoPutatives,nrStereoInliers,"
-                        << "nrStereoPutatives,monoRansacIters,"
-                        << "stereoRansacIters,nrValidRKP,nrNoLeftRectRKP,"
-                        << "nrNoRightRectRKP,nrNoDepthRKP,nrFailedArunRKP,"
-                        << "featureDetectionTime,featureTrackingTime,"
-                        << "monoRansacTime,stereoRansacTime,"
-                        << "featureSelectionTime,extracted_corners,"
-                        << "need_n_corners" << std::endl;
+    output_frontend_stats_.write(
+        LogRecord::Text("#timestamp_lkf,mono_status,stereo_status,"
+                        "nr_keypoints,nrDetectedFeatures,nrTrackerFeatures,"
+                        "nrMonoInliers,nrMonoPutatives,nrStereoInliers,"
+                        "nrStereoPutatives,monoRansacIters,"
+                        "stereoRansacIters,nrValidRKP,nrNoLeftRectRKP,"
+                        "nrNoRightRectRKP,nrNoDepthRKP,nrFailedArunRKP,"
+                        "featureDetectionTime,featureTrackingTime,"
+                        "monoRansacTime,stereoRansacTime,"
+                        "featureSelectionTime,extracted_corners,"
+                        "need_n_corners\n"));
     is_header_written = true;
   }
 
-  output_stream_stats
-      << timestamp_lkf << ","
+  LogRecord record(24u);
+  record
+      << timestamp_lkf
       // Mono status.
       << TrackerStatusSummary::asString(tracker_summary.kfTrackingStatus_mono_)
-      << ","
       // Stereo status.
       << TrackerStatusSummary::asString(
              tracker_summary.kfTrackingStatus_stereo_)
-      << ","
       // Nr of keypoints.
-      << nrKeypoints << ","
+      << nrKeypoints
       // Feature detection, tracking and ransac.
-      << tracker_info.nrDetectedFeatures_ << ","
-      << tracker_info.nrTrackerFeatures_ << "," << tracker_info.nrMonoInliers_
-      << "," << tracker_info.nrMonoPutatives_ << ","
-      << tracker_info.nrStereoInliers_ << "," << tracker_info.nrStereoPutatives_
-      << "," << tracker_info.monoRansacIters_ << ","
-      << tracker_info.stereoRansacIters_ << ","
+      << tracker_info.nrDetectedFeatures_ << tracker_info.nrTrackerFeatures_
+      << tracker_info.nrMonoInliers_ << tracker_info.nrMonoPutatives_
+      << tracker_info.nrStereoInliers_ << tracker_info.nrStereoPutatives_
+      << tracker_info.monoRansacIters_ << tracker_info.stereoRansacIters_
       // Performance of sparse-stereo-matching and ransac.
-      << tracker_info.nrValidRKP_ << "," << tracker_info.nrNoLeftRectRKP_ << ","
-      << tracker_info.nrNoRightRectRKP_ << "," << tracker_info.nrNoDepthRKP_
-      << "," << tracker_info.nrFailedArunRKP_ << ","
+      << tracker_info.nrValidRKP_ << tracker_info.nrNoLeftRectRKP_
+      << tracker_info.nrNoRightRectRKP_ << tracker_info.nrNoDepthRKP_
+      << tracker_info.nrFailedArunRKP_
       // Info about timing.
-      << tracker_info.featureDetectionTime_ << ","
-      << tracker_info.featureTrackingTime_ << ","
-      << tracker_info.monoRansacTime_ << "," << tracker_info.stereoRansacTime_
-      << ","
+      << tracker_info.featureDetectionTime_
+      << tracker_info.featureTrackingTime_ << tracker_info.monoRansacTime_
+      << tracker_info.stereoRansacTime_
       // Info about feature selector.
-      << tracker_info.featureSelectionTime_ << ","
-      << tracker_info.extracted_corners_ << "," << tracker_info.need_n_corners_
-      << std::endl;
+      << tracker_info.featureSelectionTime_ << tracker_info.extracted_corners_
+      << tracker_info.need_n_corners_;
+  output_frontend_stats_.write(std::move(record));
 }
 
 void FrontendLogger::logFrontendRansac(
@@ -451,14 +484,13 @@ void FrontendLogger::logFrontendRansac(
     const gtsam::Pose3& relative_pose_body_mono,
     const gtsam::Pose3& relative_pose_body_stereo) {
   // We log the relative poses in csv format for later analysis.
-  std::ofstream& output_stream_mono = output_frontend_ransac_mono_.ofstream_;
-  std::ofstream& output_stream_stereo =
-      output_frontend_ransac_stereo_.ofstream_;
   bool& is_header_written = is_header_written_ransac_mono_;
 
   if (!is_header_written) {
-    output_stream_mono << "#timestamp_lkf,x,y,z,qw,qx,qy,qz" << std::endl;
-    output_stream_stereo << "#timestamp_lkf,x,y,z,qw,qx,qy,qz" << std::endl;
+    output_frontend_ransac_mono_.write(
+        LogRecord::Text("#timestamp_lkf,x,y,z,qw,qx,qy,qz\n"));
+    output_frontend_ransac_stereo_.write(
+        LogRecord::Text("#timestamp_lkf,x,y,z,qw,qx,qy,qz\n"));
     is_header_written = true;
   }
 
@@ -468,10 +500,11 @@ void FrontendLogger::logFrontendRansac(
   const gtsam::Quaternion& mono_quat =
       relative_pose_body_mono.rotation().toQuaternion();
 
-  output_stream_mono << timestamp_lkf << "," << mono_tran.x() << ","
-                     << mono_tran.y() << "," << mono_tran.z() << ","
-                     << mono_quat.w() << "," << mono_quat.x() << ","
-                     << mono_quat.y() << "," << mono_quat.z() << std::endl;
+  LogRecord mono_record(8u);
+  mono_record << timestamp_lkf << mono_tran.x() << mono_tran.y()
+              << mono_tran.z() << mono_quat.w() << mono_quat.x()
+              << mono_quat.y() << mono_quat.z();
+  output_frontend_ransac_mono_.write(std::move(mono_record));
 
   // Log relative stereo poses; pose from previous keyframe to current keyframe,
   // in previous-keyframe coordinates. These are not cumulative trajectories.
@@ -479,11 +512,11 @@ void FrontendLogger::logFrontendRansac(
   const gtsam::Quaternion& stereo_quat =
       relative_pose_body_stereo.rotation().toQuaternion();
 
-  output_stream_stereo << timestamp_lkf << "," << stereo_tran.x() << ","
-                       << stereo_tran.y() << "," << stereo_tran.z() << ","
-                       << stereo_quat.w() << "," << stereo_quat.x() << ","
-                       << stereo_quat.y() << "," << stereo_quat.z()
-                       << std::endl;
+  LogRecord stereo_record(8u);
+  stereo_record << timestamp_lkf << stereo_tran.x() << stereo_tran.y()
+                << stereo_tran.z() << stereo_quat.w() << stereo_quat.x()
+                << stereo_quat.y() << stereo_quat.z();
+  output_frontend_ransac_stereo_.write(std::move(stereo_record));
 }
 
 void FrontendLogger::logFrontendImg(const FrameId& kf_id,
@@ -517,9 +550,9 @@ PipelineLogger::PipelineLogger()
 void PipelineLogger::logPipelineOverallTiming(
     const std::chrono::milliseconds& duration) {
   // Add header.
-  std::ofstream& outputFile_timingOverall_ = output_pipeline_timing_.ofstream_;
-  outputFile_timingOverall_ << "vio_overall_time [ms]" << std::endl;
-  outputFile_timingOverall_ << duration.count();
+  output_pipeline_timing_.write(LogRecord::Text("vio_overall_time [ms]\n"));
+  output_pipeline_timing_.write(
+      LogRecord::Text(std::to_string(duration.count())));
 
   VIO::utils::Statistics::WriteAllSamplesToCsvFile(FLAGS_output_path + '/' +
                                                    "StatisticsVIO.csv");
@@ -544,12 +577,12 @@ void LoopClosureDetectorLogger::logLCDResult(const LcdOutput& lcd_output) {
 
 void LoopClosureDetectorLogger::logLoopClosure(const LcdOutput& lcd_output) {
   // We log loop-closure results in csv format.
-  std::ofstream& output_stream_lcd = output_lcd_.ofstream_;
   bool& is_header_written = is_header_written_lcd_;
 
   if (!is_header_written) {
-    output_stream_lcd << "#timestamp_kf,timestamp_query,timestamp_match,isLoop,"
-                      << "matchKfId,queryKfId,x,y,z,qw,qx,qy,qz" << std::endl;
+    output_lcd_.write(
+        LogRecord::Text("#timestamp_kf,timestamp_query,timestamp_match,isLoop,"
+                        "matchKfId,queryKfId,x,y,z,qw,qx,qy,qz\n"));
     is_header_written = true;
   }
 
@@ -557,69 +590,65 @@ void LoopClosureDetectorLogger::logLoopClosure(const LcdOutput& lcd_output) {
   const gtsam::Quaternion& rel_quat =
       lcd_output.relative_pose_.rotation().toQuaternion();
 
-  output_stream_lcd << lcd_output.timestamp_kf_ << ","
-                    << lcd_output.timestamp_query_ << ","
-                    << lcd_output.timestamp_match_ << ","
-                    << lcd_output.is_loop_closure_ << ","
-                    << lcd_output.id_match_ << "," << lcd_output.id_recent_
-                    << "," << rel_trans.x() << "," << rel_trans.y() << ","
-                    << rel_trans.z() << "," << rel_quat.w() << ","
-                    << rel_quat.x() << "," << rel_quat.y() << ","
-                    << rel_quat.z() << std::endl;
+  LogRecord record(13u);
+  record << lcd_output.timestamp_kf_ << lcd_output.timestamp_query_
+         << lcd_output.timestamp_match_ << lcd_output.is_loop_closure_
+         << lcd_output.id_match_ << lcd_output.id_recent_ << rel_trans.x()
+         << rel_trans.y() << rel_trans.z() << rel_quat.w() << rel_quat.x()
+         << rel_quat.y() << rel_quat.z();
+  output_lcd_.write(std::move(record));
 }
 
 void LoopClosureDetectorLogger::logOptimizedTraj(const LcdOutput& lcd_output) {
   // We close and reopen log file to clear contents completely.
   output_traj_.closeAndOpenLogFile();
   // We log the full optimized trajectory in csv format.
-  std::ofstream& output_stream_traj = output_traj_.ofstream_;
 
   // TODO(marcus): set the append to false on this one and overwrite EVERY TIME
 
   bool is_header_written = false;
   if (!is_header_written) {
-    output_stream_traj << "#timestamp_kf,x,y,z,qw,qx,qy,qz" << std::endl;
+    output_traj_.write(LogRecord::Text("#timestamp_kf,x,y,z,qw,qx,qy,qz\n"));
     is_header_written = true;
   }
 
   const gtsam::Values& traj = lcd_output.states_;
 
+  LogRecord record(8u);
   for (size_t i = 1; i < traj.size(); i++) {
     const gtsam::Pose3& pose = traj.at<gtsam::Pose3>(i);
     const gtsam::Point3& trans = pose.translation();
     const gtsam::Quaternion& quat = pose.rotation().toQuaternion();
 
-    output_stream_traj << ts_map_.at(i) << "," << trans.x() << "," << trans.y()
-                       << "," << trans.z() << "," << quat.w() << "," << quat.x()
-                       << "," << quat.y() << "," << quat.z() << std::endl;
+    record << ts_map_.at(i) << trans.x() << trans.y() << trans.z() << quat.w()
+           << quat.x() << quat.y() << quat.z();
   }
+  output_traj_.write(std::move(record));
 }
 
 void LoopClosureDetectorLogger::logDebugInfo(const LcdDebugInfo& debug_info) {
   // We log the loop-closure result of every key frame in csv format.
-  std::ofstream& output_stream_status = output_status_.ofstream_;
   bool& is_header_written = is_header_written_status_;
 
   if (!is_header_written) {
-    output_stream_status << "#timestamp_kf,lcd_status,query_id,match_id,"
-                         << "mono_input_size,mono_inliers,mono_iters,"
-                         << "stereo_input_size,stereo_inliers,stereo_iters,"
-                         << "pgo_size,pgo_lc_count,pgo_lc_inliers" << std::endl;
+    output_status_.write(
+        LogRecord::Text("#timestamp_kf,lcd_status,query_id,match_id,"
+                        "mono_input_size,mono_inliers,mono_iters,"
+                        "stereo_input_size,stereo_inliers,stereo_iters,"
+                        "pgo_size,pgo_lc_count,pgo_lc_inliers\n"));
     is_header_written = true;
   }
 
-  output_stream_status << debug_info.timestamp_ << ","
-                       << LoopResult::asString(debug_info.loop_result_.status_)
-                       << "," << debug_info.loop_result_.query_id_ << ","
-                       << debug_info.loop_result_.match_id_ << ","
-                       << debug_info.mono_input_size_ << ","
-                       << debug_info.mono_inliers_ << ","
-                       << debug_info.mono_iter_ << ","
-                       << debug_info.stereo_input_size_ << ","
-                       << debug_info.stereo_inliers_ << ","
-                       << debug_info.stereo_iter_ << "," << debug_info.pgo_size_
-                       << "," << debug_info.pgo_lc_count_ << ","
-                       << debug_info.pgo_lc_inliers_ << std::endl;
+  LogRecord record(13u);
+  record << debug_info.timestamp_
+         << LoopResult::asString(debug_info.loop_result_.status_)
+         << debug_info.loop_result_.query_id_
+         << debug_info.loop_result_.match_id_ << debug_info.mono_input_size_
+         << debug_info.mono_inliers_ << debug_info.mono_iter_
+         << debug_info.stereo_input_size_ << debug_info.stereo_inliers_
+         << debug_info.stereo_iter_ << debug_info.pgo_size_
+         << debug_info.pgo_lc_count_ << debug_info.pgo_lc_inliers_;
+  output_status_.write(std::move(record));
 }
 
 }  // namespace VIO
@@ -0,0 +1,265 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   BinaryOrbVocabulary.cpp
+ * @brief  ORB vocabulary that can be saved to and loaded from a compact binary
+ * file, which is loaded without any text parsing.
+ *
+ * @author Marcus Abate
+ */
+
+#include "kimera-vio/loopclosure/BinaryOrbVocabulary.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "kimera-vio/utils/Timer.h"
+
+namespace VIO {
+
+namespace {
+
+const char kMagic[8] = {'K', 'V', 'I', 'O', 'V', 'O', 'C', 'B'};
+const uint32_t kVersion = 1u;
+
+struct Header {
+  char magic_[8];
+  uint32_t version_;
+  int32_t k_;
+  int32_t L_;
+  int32_t weighting_;
+  int32_t scoring_;
+  uint32_t n_nodes_;
+  uint32_t n_words_;
+  uint32_t descriptor_bytes_;
+};
+static_assert(sizeof(Header) == 40u, "Unexpected padding in Header.");
+
+// One per node but the root, which has no descriptor.
+struct NodeRecord {
+  uint32_t id_;
+  uint32_t parent_;
+  double weight_;
+};
+static_assert(sizeof(NodeRecord) == 16u, "Unexpected padding in NodeRecord.");
+
+// Read-only memory mapping of a whole file.
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string& filename) {
+    fd_ = open(filename.c_str(), O_RDONLY);
+    CHECK_GE(fd_, 0) << "Could not open " << filename;
+    struct stat file_stat;
+    CHECK_EQ(fstat(fd_, &file_stat), 0) << "Could not stat " << filename;
+    size_ = static_cast<size_t>(file_stat.st_size);
+    CHECK_GT(size_, 0u) << "Empty file " << filename;
+    void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+    CHECK(data != MAP_FAILED) << "Could not memory-map " << filename;
+    data_ = static_cast<const char*>(data);
+  }
+  ~MappedFile() {
+    munmap(const_cast<char*>(data_), size_);
+    close(fd_);
+  }
+
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  int fd_ = -1;
+  const char* data_ = nullptr;
+  size_t size_ = 0u;
+};
+
+}  // namespace
+
+/* ------------------------------------------------------------------------ */
+void BinaryOrbVocabulary::saveBinary(const std::string& filename) const {
+  CHECK(!m_nodes.empty()) << "Cannot save an empty vocabulary.";
+  const uint32_t descriptor_bytes = static_cast<uint32_t>(DBoW2::FORB::L);
+
+  // Same breadth-first order as DBoW2, so children keep their order on load.
+  std::vector<NodeRecord> records;
+  records.reserve(m_nodes.size() - 1u);
+  std::deque<DBoW2::NodeId> parents = {0u};
+  while (!parents.empty()) {
+    const Node& parent = m_nodes[parents.front()];
+    parents.pop_front();
+    for (const DBoW2::NodeId& child_id : parent.children) {
+      const Node& child = m_nodes[child_id];
+      records.push_back(NodeRecord{child.id, parent.id, child.weight});
+      if (!child.isLeaf()) parents.push_back(child_id);
+    }
+  }
+  CHECK_EQ(records.size() + 1u, m_nodes.size());
+
+  Header header;
+  std::memcpy(header.magic_, kMagic, sizeof(kMagic));
+  header.version_ = kVersion;
+  header.k_ = m_k;
+  header.L_ = m_L;
+  header.weighting_ = static_cast<int32_t>(m_weighting);
+  header.scoring_ = static_cast<int32_t>(m_scoring);
+  header.n_nodes_ = static_cast<uint32_t>(m_nodes.size());
+  header.n_words_ = static_cast<uint32_t>(m_words.size());
+  header.descriptor_bytes_ = descriptor_bytes;
+
+  std::ofstream file(filename, std::ios::out | std::ios::binary);
+  CHECK(file.good()) << "Could not open " << filename << " for writing.";
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(records.data()),
+             records.size() * sizeof(NodeRecord));
+  for (const NodeRecord& record : records) {
+    const cv::Mat& descriptor = m_nodes[record.id_].descriptor;
+    CHECK_EQ(descriptor.total() * descriptor.elemSize(), descriptor_bytes);
+    CHECK(descriptor.isContinuous());
+    file.write(reinterpret_cast<const char*>(descriptor.data),
+               descriptor_bytes);
+  }
+  for (const Node* word : m_words) {
+    CHECK_NOTNULL(word);
+    const uint32_t node_id = word->id;
+    file.write(reinterpret_cast<const char*>(&node_id), sizeof(node_id));
+  }
+  CHECK(file.good()) << "Could not write vocabulary to " << filename;
+}
+
+/* ------------------------------------------------------------------------ */
+void BinaryOrbVocabulary::loadBinary(const std::string& filename) {
+  MappedFile file(filename);
+  const char* data = file.data();
+
+  CHECK_GE(file.size(), sizeof(Header)) << "Truncated vocabulary " << filename;
+  Header header;
+  std::memcpy(&header, data, sizeof(header));
+  CHECK_EQ(std::memcmp(header.magic_, kMagic, sizeof(kMagic)), 0)
+      << filename << " is not a binary vocabulary.";
+  CHECK_EQ(header.version_, kVersion)
+      << "Unsupported binary vocabulary version in " << filename;
+  CHECK_EQ(header.descriptor_bytes_, static_cast<uint32_t>(DBoW2::FORB::L));
+  CHECK_GT(header.n_nodes_, 0u);
+
+  const size_t n_records = header.n_nodes_ - 1u;
+  const size_t records_offset = sizeof(Header);
+  const size_t descriptors_offset =
+      records_offset + n_records * sizeof(NodeRecord);
+  const size_t words_offset =
+      descriptors_offset + n_records * header.descriptor_bytes_;
+  CHECK_EQ(file.size(), words_offset + header.n_words_ * sizeof(uint32_t))
+      << "Corrupted vocabulary " << filename;
+
+  m_k = header.k_;
+  m_L = header.L_;
+  m_weighting = static_cast<DBoW2::WeightingType>(header.weighting_);
+  m_scoring = static_cast<DBoW2::ScoringType>(header.scoring_);
+  createScoringObject();
+
+  // All descriptors in one allocation, nodes hold row views into it. They
+  // can not be views into the mapping: DBoW2 databases keep shallow copies
+  // of the vocabulary, which may outlive this one and thus the mapping.
+  cv::Mat descriptors(static_cast<int>(n_records),
+                      static_cast<int>(header.descriptor_bytes_),
+                      CV_8U);
+  std::memcpy(descriptors.data,
+              data + descriptors_offset,
+              n_records * header.descriptor_bytes_);
+
+  m_nodes.clear();
+  m_nodes.resize(header.n_nodes_);
+  m_nodes[0].id = 0u;
+  for (size_t i = 0u; i < n_records; i++) {
+    NodeRecord record;
+    std::memcpy(&record,
+                data + records_offset + i * sizeof(NodeRecord),
+                sizeof(record));
+    CHECK_LT(record.id_, header.n_nodes_);
+    CHECK_LT(record.parent_, header.n_nodes_);
+    Node& node = m_nodes[record.id_];
+    node.id = record.id_;
+    node.parent = record.parent_;
+    node.weight = record.weight_;
+    node.descriptor = descriptors.row(static_cast<int>(i));
+    m_nodes[record.parent_].children.push_back(record.id_);
+  }
+
+  m_words.clear();
+  m_words.resize(header.n_words_);
+  for (size_t word_id = 0u; word_id < header.n_words_; word_id++) {
+    uint32_t node_id;
+    std::memcpy(&node_id,
+                data + words_offset + word_id * sizeof(uint32_t),
+                sizeof(node_id));
+    CHECK_LT(node_id, header.n_nodes_);
+    m_nodes[node_id].word_id = static_cast<DBoW2::WordId>(word_id);
+    m_words[word_id] = &m_nodes[node_id];
+  }
+}
+
+/* ------------------------------------------------------------------------ */
+bool BinaryOrbVocabulary::isBinaryFile(const std::string& filename) {
+  std::ifstream file(filename, std::ios::in | std::ios::binary);
+  if (!file.good()) return false;
+  char magic[sizeof(kMagic)];
+  file.read(magic, sizeof(magic));
+  return file.good() && std::memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+}
+
+/* ------------------------------------------------------------------------ */
+std::shared_ptr<const BinaryOrbVocabulary> BinaryOrbVocabulary::loadShared(
+    const std::string& filename,
+    const std::string& save_binary_filename) {
+  static std::mutex mutex;
+  static std::map<std::string, std::weak_ptr<const BinaryOrbVocabulary>>
+      vocabularies;
+  // Held while loading, so that pipelines created concurrently wait for the
+  // first one to load the vocabulary instead of loading it again.
+  std::lock_guard<std::mutex> lock(mutex);
+  std::shared_ptr<const BinaryOrbVocabulary> vocabulary =
+      vocabularies[filename].lock();
+  if (vocabulary) {
+    LOG(INFO) << "Sharing the vocabulary already loaded from " << filename;
+    return vocabulary;
+  }
+
+  std::ifstream file(filename.c_str());
+  CHECK(file.good()) << "Incorrect vocabulary path: " << filename;
+  file.close();
+
+  LOG(INFO) << "Loading vocabulary from " << filename;
+  auto tic = utils::Timer::tic();
+  std::shared_ptr<BinaryOrbVocabulary> loaded =
+      std::make_shared<BinaryOrbVocabulary>();
+  if (isBinaryFile(filename)) {
+    loaded->loadBinary(filename);
+  } else {
+    loaded->load(filename);
+    if (!save_binary_filename.empty()) {
+      loaded->saveBinary(save_binary_filename);
+      LOG(INFO) << "Saved binary vocabulary to " << save_binary_filename;
+    }
+  }
+  LOG(INFO) << "Loaded vocabulary with " << loaded->size()
+            << " visual words in " << utils::Timer::toc(tic).count() << " ms.";
+  vocabularies[filename] = loaded;
+  return loaded;
+}
+
+}  // namespace VIO
@@ -0,0 +1,190 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   BowQueryEngine.cpp
+ * @brief  Sharded inverted index of BoW vectors, queried in parallel. Returns
+ * the same results as DBoW2's database query with L1 scoring.
+ *
+ * @author Marcus Abate
+ */
+
+#include "kimera-vio/loopclosure/BowQueryEngine.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <thread>
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+namespace {
+
+// Below this many entries per shard, spawning threads costs more than the
+// scoring itself and all the shards are scored in the calling thread.
+const size_t kMinEntriesPerShardForThreads = 512u;
+
+// Orders raw L1 scores (lower is more similar) and breaks ties by entry id,
+// so that the results do not depend on the number of shards.
+bool isBetterRawScore(const DBoW2::Result& a, const DBoW2::Result& b) {
+  return a.Score < b.Score || (a.Score == b.Score && a.Id < b.Id);
+}
+
+// Keeps the best max_results of results, sorted.
+void selectBest(const int& max_results, DBoW2::QueryResults* results) {
+  CHECK_NOTNULL(results);
+  if (max_results > 0 && results->size() > static_cast<size_t>(max_results)) {
+    std::partial_sort(results->begin(),
+                      results->begin() + max_results,
+                      results->end(),
+                      isBetterRawScore);
+    results->resize(max_results);
+  } else {
+    std::sort(results->begin(), results->end(), isBetterRawScore);
+  }
+}
+
+}  // namespace
+
+/* -------------------------------------------------------------------------- */
+BowQueryEngine::BowQueryEngine(const size_t& num_shards)
+    : shards_(std::max<size_t>(num_shards, 1u)), num_entries_(0u) {}
+
+/* -------------------------------------------------------------------------- */
+DBoW2::EntryId BowQueryEngine::add(const DBoW2::BowVector& bow_vec) {
+  const DBoW2::EntryId entry_id = static_cast<DBoW2::EntryId>(num_entries_);
+  Shard& shard = shards_[num_entries_ % shards_.size()];
+  const uint32_t local_id = static_cast<uint32_t>(shard.num_entries_);
+  // Entries are added in increasing id order, so postings stay sorted.
+  for (const auto& word : bow_vec) {
+    shard.inverted_index_[word.first].push_back(Posting{local_id, word.second});
+  }
+  shard.num_entries_++;
+  num_entries_++;
+  return entry_id;
+}
+
+/* -------------------------------------------------------------------------- */
+void BowQueryEngine::query(const DBoW2::BowVector& bow_vec,
+                           const int& max_results,
+                           const int& max_id,
+                           DBoW2::QueryResults* results) const {
+  CHECK_NOTNULL(results);
+  results->clear();
+  if (bow_vec.empty() || num_entries_ == 0u) return;
+
+  const size_t n_shards = shards_.size();
+  std::vector<DBoW2::QueryResults> shard_results(n_shards);
+  if (n_shards > 1u &&
+      num_entries_ >= n_shards * kMinEntriesPerShardForThreads) {
+    std::vector<std::thread> workers;
+    workers.reserve(n_shards - 1u);
+    for (size_t i = 1u; i < n_shards; i++) {
+      workers.emplace_back(&BowQueryEngine::queryShard,
+                           this,
+                           std::cref(bow_vec),
+                           std::cref(max_results),
+                           std::cref(max_id),
+                           &shards_[i],
+                           i,
+                           &shard_results[i]);
+    }
+    queryShard(
+        bow_vec, max_results, max_id, &shards_[0], 0u, &shard_results[0]);
+    for (std::thread& worker : workers) worker.join();
+  } else {
+    for (size_t i = 0u; i < n_shards; i++) {
+      queryShard(
+          bow_vec, max_results, max_id, &shards_[i], i, &shard_results[i]);
+    }
+  }
+
+  for (const DBoW2::QueryResults& shard_result : shard_results) {
+    results->insert(results->end(), shard_result.begin(), shard_result.end());
+  }
+  selectBest(max_results, results);
+
+  // Same normalization as DBoW2: scores in [0, 1], higher is more similar.
+  for (DBoW2::Result& result : *results) {
+    result.Score = -result.Score / 2.0;
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+void BowQueryEngine::clear() {
+  const size_t n_shards = shards_.size();
+  shards_.clear();
+  shards_.resize(n_shards);
+  num_entries_ = 0u;
+}
+
+/* -------------------------------------------------------------------------- */
+bool BowQueryEngine::supportsScoring(const DBoW2::ScoringType& scoring_type) {
+  return scoring_type == DBoW2::L1_NORM;
+}
+
+/* -------------------------------------------------------------------------- */
+void BowQueryEngine::queryShard(const DBoW2::BowVector& bow_vec,
+                                const int& max_results,
+                                const int& max_id,
+                                Shard* shard,
+                                const size_t& shard_idx,
+                                DBoW2::QueryResults* results) const {
+  CHECK_NOTNULL(shard);
+  CHECK_NOTNULL(results);
+  const size_t n_shards = shards_.size();
+  if (shard->scores_.size() < shard->num_entries_) {
+    shard->scores_.resize(shard->num_entries_, 0.0);
+    shard->is_touched_.resize(shard->num_entries_, 0u);
+  }
+  shard->touched_.clear();
+
+  // Entries of this shard with a local id below this one are queryable.
+  size_t max_local_id = shard->num_entries_;
+  if (max_id != -1) {
+    const size_t max_entry_id = static_cast<size_t>(std::max(max_id, 0));
+    max_local_id = std::min(
+        max_local_id,
+        max_entry_id > shard_idx
+            ? (max_entry_id - shard_idx + n_shards - 1u) / n_shards
+            : 0u);
+  }
+  if (max_local_id == 0u) return;
+
+  for (const auto& word : bow_vec) {
+    const auto it = shard->inverted_index_.find(word.first);
+    if (it == shard->inverted_index_.end()) continue;
+    const DBoW2::WordValue& qvalue = word.second;
+    for (const Posting& posting : it->second) {
+      // Postings are sorted, so the rest of the list is too recent.
+      if (posting.local_id_ >= max_local_id) break;
+      const DBoW2::WordValue& dvalue = posting.value_;
+      // Same accumulation as DBoW2, so that scores are bit-identical.
+      shard->scores_[posting.local_id_] +=
+          std::fabs(qvalue - dvalue) - std::fabs(qvalue) - std::fabs(dvalue);
+      if (!shard->is_touched_[posting.local_id_]) {
+        shard->is_touched_[posting.local_id_] = 1u;
+        shard->touched_.push_back(posting.local_id_);
+      }
+    }
+  }
+
+  results->reserve(shard->touched_.size());
+  for (const uint32_t& local_id : shard->touched_) {
+    const DBoW2::EntryId entry_id =
+        static_cast<DBoW2::EntryId>(local_id * n_shards + shard_idx);
+    results->push_back(DBoW2::Result(entry_id, shard->scores_[local_id]));
+    shard->scores_[local_id] = 0.0;
+    shard->is_touched_[local_id] = 0u;
+  }
+  selectBest(max_results, results);
+}
+
+}  // namespace VIO
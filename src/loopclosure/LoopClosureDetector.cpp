@@ -15,9 +15,12 @@
  */
 
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <fstream>
 #include <memory>
 #include <string>
+#include <typeinfo>
 #include <vector>
 
 #include <gflags/gflags.h>
@@ -32,13 +35,52 @@
 #include <KimeraRPGO/RobustSolver.h>
 
 #include "kimera-vio/loopclosure/LoopClosureDetector.h"
+#include "kimera-vio/loopclosure/BinaryOrbVocabulary.h"
 #include "kimera-vio/utils/Statistics.h"
 #include "kimera-vio/utils/Timer.h"
 #include "kimera-vio/utils/UtilsOpenCV.h"
 
 DEFINE_string(vocabulary_path,
               "../vocabulary/ORBvoc.yml",
-              "Path to BoW vocabulary file for LoopClosureDetector module.");
+              "Path to BoW vocabulary file for LoopClosureDetector module. "
+              "Both DBoW2 text and binary vocabularies are supported.");
+DEFINE_string(save_binary_vocabulary_path,
+              "",
+              "If set and the vocabulary is loaded from a text file, it is "
+              "saved in binary format to this path for faster startup.");
+DEFINE_bool(lcd_use_frontend_features,
+            false,
+            "Compute ORB descriptors at the keypoints tracked by the frontend "
+            "and reuse their stereo depth, instead of detecting new ORB "
+            "features and re-running stereo matching on every keyframe.");
+DEFINE_int32(lcd_min_frontend_features,
+             50,
+             "Minimum number of frontend features with valid depth needed to "
+             "skip ORB detection when lcd_use_frontend_features is true.");
+DEFINE_bool(lcd_cache_knn_matches,
+            true,
+            "Reuse the descriptor matches of the latest candidate between "
+            "geometric verification and pose recovery.");
+DEFINE_bool(lcd_publish_pgo_deltas,
+            false,
+            "Only publish the PGO poses that changed and the factors added "
+            "since the previous output. The full PGO is still published after "
+            "a loop closure or when requested.");
+DEFINE_bool(lcd_async_pgo,
+            true,
+            "Optimize the PGO in its own thread when running in parallel, so "
+            "that loop-closure detection never waits on an optimization.");
+DEFINE_bool(lcd_use_bow_query_engine,
+            true,
+            "Query BoW candidates with a sharded inverted index scored in "
+            "parallel instead of DBoW2's database. Results are identical; only "
+            "used with L1 scoring vocabularies.");
+DEFINE_int32(lcd_bow_query_shards,
+             4,
+             "Number of shards (and threads) of the BoW query engine.");
+DEFINE_double(lcd_pgo_delta_tol,
+              1e-9,
+              "Tolerance under which a PGO pose is considered unchanged.");
 
 /** Verbosity settings: (cumulative with every increase in level)
       0: Runtime errors and warnings, spin start and frequency are reported.
@@ -49,23 +91,70 @@ DEFINE_string(vocabulary_path,
 
 namespace VIO {
 
+namespace {
+
+const char kDatabaseMagic[8] = {'K', 'V', 'I', 'O', 'L', 'C', 'D', 'B'};
+const uint32_t kDatabaseVersion = 1u;
+
+template <typename T>
+void writeBinary(std::ofstream* stream, const T& value) {
+  stream->write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+T readBinary(std::ifstream* stream) {
+  T value;
+  stream->read(reinterpret_cast<char*>(&value), sizeof(T));
+  CHECK(stream->good()) << "Truncated LoopClosureDetector database.";
+  return value;
+}
+
+// Orientation of the intensity centroid of the circular patch around pt, as
+// computed by ORB's detector [deg]. The patch must fit in the image.
+float intensityCentroidAngle(const cv::Mat& img,
+                             const cv::Point2f& pt,
+                             const int& radius) {
+  CHECK_EQ(img.type(), CV_8UC1);
+  const int x = cvRound(pt.x);
+  const int y = cvRound(pt.y);
+  int m01 = 0;
+  int m10 = 0;
+  for (int v = -radius; v <= radius; v++) {
+    const int u_max =
+        cvFloor(std::sqrt(static_cast<double>(radius * radius - v * v)));
+    const uchar* row = img.ptr<uchar>(y + v);
+    for (int u = -u_max; u <= u_max; u++) {
+      const int intensity = row[x + u];
+      m10 += u * intensity;
+      m01 += v * intensity;
+    }
+  }
+  return cv::fastAtan2(static_cast<float>(m01), static_cast<float>(m10));
+}
+
+}  // namespace
+
 /* ------------------------------------------------------------------------ */
 LoopClosureDetector::LoopClosureDetector(
     const LoopClosureDetectorParams& lcd_params,
-    bool log_output)
+    bool log_output,
+    bool parallel_run)
     : lcd_state_(LcdState::Bootstrap),
       lcd_params_(lcd_params),
       log_output_(log_output),
       set_intrinsics_(false),
       orb_feature_detector_(),
       orb_feature_matcher_(),
+      vocabulary_(nullptr),
       db_BoW_(nullptr),
+      bow_query_engine_(nullptr),
       db_frames_(),
+      n_loaded_frames_(0u),
       timestamp_map_(),
       lcd_tp_wrapper_(nullptr),
       latest_bowvec_(),
       B_Pose_camLrect_(),
-      pgo_(nullptr),
+      pgo_optimizer_(nullptr),
       W_Pose_Blkf_estimates_(),
       logger_(nullptr) {
   // TODO(marcus): This should come in with every input payload, not be
@@ -89,17 +178,12 @@ LoopClosureDetector::LoopClosureDetector(
   orb_feature_matcher_ =
       cv::DescriptorMatcher::create(lcd_params_.matcher_type_);
 
-  // Load ORB vocabulary:
-  std::ifstream f_vocab(FLAGS_vocabulary_path.c_str());
-  CHECK(f_vocab.good()) << "LoopClosureDetector: Incorrect vocabulary path: "
-                        << FLAGS_vocabulary_path;
-  f_vocab.close();
-
-  OrbVocabulary vocab;
-  LOG(INFO) << "LoopClosureDetector:: Loading vocabulary from "
-            << FLAGS_vocabulary_path;
-  vocab.load(FLAGS_vocabulary_path);
-  LOG(INFO) << "Loaded vocabulary with " << vocab.size() << " visual words.";
+  // Load ORB vocabulary, loaded only once per process (the database below
+  // still copies it):
+  vocabulary_ = BinaryOrbVocabulary::loadShared(
+      FLAGS_vocabulary_path, FLAGS_save_binary_vocabulary_path);
+  CHECK(vocabulary_);
+  const OrbVocabulary& vocab = *vocabulary_;
 
   // Initialize the thirdparty wrapper:
   lcd_tp_wrapper_ = VIO::make_unique<LcdThirdPartyWrapper>(lcd_params_);
@@ -107,13 +191,16 @@ LoopClosureDetector::LoopClosureDetector(
   // Initialize db_BoW_:
   db_BoW_ = VIO::make_unique<OrbDatabase>(vocab);
 
-  // Initialize pgo_:
-  // TODO(marcus): parametrize the verbosity of PGO params
-  KimeraRPGO::RobustSolverParams pgo_params;
-  pgo_params.setPcmSimple3DParams(lcd_params_.pgo_trans_threshold_,
-                                  lcd_params_.pgo_rot_threshold_,
-                                  KimeraRPGO::Verbosity::QUIET);
-  pgo_ = VIO::make_unique<KimeraRPGO::RobustSolver>(pgo_params);
+  // Initialize bow_query_engine_:
+  if (FLAGS_lcd_use_bow_query_engine &&
+      BowQueryEngine::supportsScoring(vocab.getScoringType())) {
+    bow_query_engine_ = VIO::make_unique<BowQueryEngine>(
+        static_cast<size_t>(std::max(FLAGS_lcd_bow_query_shards, 1)));
+  }
+
+  // Initialize pgo_optimizer_:
+  pgo_optimizer_ = VIO::make_unique<PgoOptimizer>(
+      lcd_params_, parallel_run && FLAGS_lcd_async_pgo);
 
   if (log_output) logger_ = VIO::make_unique<LoopClosureDetectorLogger>();
 }
@@ -149,8 +236,7 @@ LcdOutput::UniquePtr LoopClosureDetector::spinOnce(const LcdInput& input) {
       break;
     }
     case LcdState::Nominal: {
-      // TODO(marcus): need a better check than this:
-      CHECK_GT(pgo_->calculateEstimate().size(), 0);
+      CHECK(!W_Pose_Blkf_estimates_.empty());
       addOdometryFactorAndOptimize(odom_factor);
       break;
     }
@@ -162,9 +248,14 @@ LcdOutput::UniquePtr LoopClosureDetector::spinOnce(const LcdInput& input) {
   // Process the StereoFrame and check for a loop closure with previous ones.
   LoopResult loop_result;
   // Try to find a loop and update the PGO with the result if available.
-  if (detectLoop(input.stereo_frame_, &loop_result)) {
-    LoopClosureFactor lc_factor(loop_result.match_id_,
-                                loop_result.query_id_,
+  const bool is_loop = detectLoop(input.stereo_frame_, &loop_result);
+  // Frames of a loaded database are not in the PGO: a loop with one of them
+  // is only reported by detectLoop.
+  const bool is_loop_closure =
+      is_loop && !isLoadedFrame(loop_result.match_id_);
+  if (is_loop_closure) {
+    LoopClosureFactor lc_factor(getPgoKey(loop_result.match_id_),
+                                getPgoKey(loop_result.query_id_),
                                 loop_result.relative_pose_,
                                 shared_noise_model_);
 
@@ -178,8 +269,13 @@ LcdOutput::UniquePtr LoopClosureDetector::spinOnce(const LcdInput& input) {
     stat_pgo_timing.AddSample(update_duration);
 
     VLOG(1) << "LoopClosureDetector: LOOP CLOSURE detected from keyframe "
-            << loop_result.match_id_ << " to keyframe "
-            << loop_result.query_id_;
+            << getPgoKey(loop_result.match_id_) << " to keyframe "
+            << getPgoKey(loop_result.query_id_);
+  } else if (is_loop) {
+    VLOG(1) << "LoopClosureDetector: keyframe "
+            << getPgoKey(loop_result.query_id_)
+            << " matched frame " << loop_result.match_id_
+            << " of the loaded database, not added to the PGO.";
   } else {
     VLOG(2) << "LoopClosureDetector: No loop closure detected. Reason: "
             << LoopResult::asString(loop_result.status_);
@@ -187,47 +283,74 @@ LcdOutput::UniquePtr LoopClosureDetector::spinOnce(const LcdInput& input) {
 
   // Timestamps for PGO and for LCD should match now.
   CHECK_EQ(db_frames_.back().timestamp_,
-           timestamp_map_.at(db_frames_.back().id_));
-  CHECK_EQ(timestamp_map_.size(), db_frames_.size());
+           timestamp_map_.at(getPgoKey(db_frames_.back().id_)));
+  CHECK_EQ(timestamp_map_.size(), db_frames_.size() - n_loaded_frames_);
   CHECK_EQ(timestamp_map_.size(), W_Pose_Blkf_estimates_.size());
 
   // Construct output payload.
-  CHECK(pgo_);
+  // The optimizer may lag behind when running in its own thread, the latest
+  // optimized trajectory is used as is.
+  CHECK(pgo_optimizer_);
+  PgoEstimate::ConstPtr pgo_estimate = pgo_optimizer_->getLatestEstimate();
+  if (!pgo_estimate) pgo_estimate = std::make_shared<PgoEstimate>();
+  const size_t pgo_num_updates_added = pgo_optimizer_->getNumUpdatesAdded();
+  if (is_loop_closure) pending_lc_num_updates_ = pgo_num_updates_added;
+  // Only the estimate including a loop closure moves the trajectory.
+  const bool is_lc_optimized =
+      pending_lc_num_updates_ > 0u &&
+      pgo_estimate->num_updates_ >= pending_lc_num_updates_;
+  if (is_lc_optimized) pending_lc_num_updates_ = 0u;
   const gtsam::Pose3& w_Pose_map = getWPoseMap();
-  const gtsam::Values& pgo_states = pgo_->calculateEstimate();
-  const gtsam::NonlinearFactorGraph& pgo_nfg = pgo_->getFactorsUnsafe();
+  const gtsam::Values& pgo_states = pgo_estimate->states_;
+  const gtsam::NonlinearFactorGraph& pgo_nfg = pgo_estimate->nfg_;
 
   LcdOutput::UniquePtr output_payload = nullptr;
-  if (loop_result.isLoop()) {
+  if (is_loop_closure) {
+    const FrameId match_key = getPgoKey(loop_result.match_id_);
+    const FrameId query_key = getPgoKey(loop_result.query_id_);
     output_payload =
         VIO::make_unique<LcdOutput>(true,
                                     input.timestamp_kf_,
-                                    timestamp_map_.at(loop_result.query_id_),
-                                    timestamp_map_.at(loop_result.match_id_),
-                                    loop_result.match_id_,
-                                    loop_result.query_id_,
+                                    timestamp_map_.at(query_key),
+                                    timestamp_map_.at(match_key),
+                                    match_key,
+                                    query_key,
                                     loop_result.relative_pose_,
                                     w_Pose_map,
-                                    pgo_states,
-                                    pgo_nfg);
+                                    gtsam::Values(),
+                                    gtsam::NonlinearFactorGraph());
   } else {
     output_payload = VIO::make_unique<LcdOutput>();
     output_payload->W_Pose_Map_ = w_Pose_map;
-    output_payload->states_ = pgo_states;
-    output_payload->nfg_ = pgo_nfg;
   }
+  output_payload->is_pgo_optimized_ =
+      pgo_estimate->num_updates_ == pgo_num_updates_added;
+  // A loop closure moves the whole trajectory: publish everything in that
+  // case. So does fillPgoOutput if published factors were rejected.
+  const bool full_pgo_snapshot = !FLAGS_lcd_publish_pgo_deltas ||
+                                 is_lc_optimized ||
+                                 full_pgo_snapshot_requested_.exchange(false);
+  fillPgoOutput(pgo_states, pgo_nfg, full_pgo_snapshot, output_payload.get());
   CHECK(output_payload) << "Missing LCD output payload.";
 
   if (logger_) {
     debug_info_.timestamp_ = output_payload->timestamp_kf_;
     debug_info_.loop_result_ = loop_result;
-    debug_info_.pgo_size_ = pgo_->size();
-    debug_info_.pgo_lc_count_ = pgo_->getNumLC();
-    debug_info_.pgo_lc_inliers_ = pgo_->getNumLCInliers();
+    debug_info_.pgo_size_ = pgo_estimate->pgo_size_;
+    debug_info_.pgo_lc_count_ = pgo_estimate->num_lc_;
+    debug_info_.pgo_lc_inliers_ = pgo_estimate->num_lc_inliers_;
 
     logger_->logTimestampMap(timestamp_map_);
     logger_->logDebugInfo(debug_info_);
-    logger_->logLCDResult(*output_payload);
+    if (output_payload->is_pgo_delta_) {
+      // The optimized trajectory is always logged in full.
+      logger_->logLoopClosure(*output_payload);
+      LcdOutput traj_output;
+      traj_output.states_ = pgo_states;
+      logger_->logOptimizedTraj(traj_output);
+    } else {
+      logger_->logLCDResult(*output_payload);
+    }
   }
 
   return output_payload;
@@ -237,34 +360,46 @@ LcdOutput::UniquePtr LoopClosureDetector::spinOnce(const LcdInput& input) {
 FrameId LoopClosureDetector::processAndAddFrame(
     const StereoFrame& stereo_frame) {
   std::vector<cv::KeyPoint> keypoints;
+  std::vector<gtsam::Vector3> keypoints_3d;
+  BearingVectors versors;
   OrbDescriptor descriptors_mat;
-  OrbDescriptorVec descriptors_vec;
 
-  // Extract ORB features and construct descriptors_vec.
-  orb_feature_detector_->detectAndCompute(
-      stereo_frame.getLeftFrame().img_, cv::Mat(), keypoints, descriptors_mat);
-
-  int L = orb_feature_detector_->descriptorSize();
-  descriptors_vec.resize(descriptors_mat.size().height);
-
-  for (size_t i = 0; i < descriptors_vec.size(); i++) {
-    descriptors_vec[i] = cv::Mat(1, L, descriptors_mat.type());  // one row only
-    descriptors_mat.row(i).copyTo(descriptors_vec[i].row(0));
+  if (!FLAGS_lcd_use_frontend_features ||
+      !computeDescriptorsAtFrontendFeatures(stereo_frame,
+                                            &keypoints,
+                                            &keypoints_3d,
+                                            &versors,
+                                            &descriptors_mat)) {
+    // Extract ORB features.
+    keypoints.clear();
+    orb_feature_detector_->detectAndCompute(stereo_frame.getLeftFrame().img_,
+                                            cv::Mat(),
+                                            keypoints,
+                                            descriptors_mat);
+
+    // Fill StereoFrame with ORB keypoints and perform stereo matching.
+    StereoFrame cp_stereo_frame(stereo_frame);
+    rewriteStereoFrameFeatures(keypoints, &cp_stereo_frame);
+    keypoints_3d = cp_stereo_frame.keypoints_3d_;
+    versors = cp_stereo_frame.getLeftFrame().versors_;
   }
 
-  // Fill StereoFrame with ORB keypoints and perform stereo matching.
-  StereoFrame cp_stereo_frame(stereo_frame);
-  rewriteStereoFrameFeatures(keypoints, &cp_stereo_frame);
+  // Construct descriptors_vec as row views into descriptors_mat: no copies.
+  OrbDescriptorVec descriptors_vec;
+  descriptors_vec.reserve(descriptors_mat.rows);
+  for (int i = 0; i < descriptors_mat.rows; i++) {
+    descriptors_vec.push_back(descriptors_mat.row(i));
+  }
 
   // Build and store LCDFrame object.
-  db_frames_.push_back(LCDFrame(cp_stereo_frame.getTimestamp(),
+  db_frames_.push_back(LCDFrame(stereo_frame.getTimestamp(),
                                 db_frames_.size(),
-                                cp_stereo_frame.getFrameId(),
+                                stereo_frame.getFrameId(),
                                 keypoints,
-                                cp_stereo_frame.keypoints_3d_,
+                                keypoints_3d,
                                 descriptors_vec,
                                 descriptors_mat,
-                                cp_stereo_frame.getLeftFrame().versors_));
+                                versors));
 
   CHECK(!db_frames_.empty());
   return db_frames_.back().id_;
@@ -285,17 +420,27 @@ bool LoopClosureDetector::detectLoop(const StereoFrame& stereo_frame,
                                       bow_vec);
 
   int max_possible_match_id = frame_id - lcd_params_.dist_local_;
+  // The frames of a loaded database are never temporally local.
+  max_possible_match_id = std::max(max_possible_match_id,
+                                   static_cast<int>(n_loaded_frames_) - 1);
   if (max_possible_match_id < 0) max_possible_match_id = 0;
 
   // Query for BoW vector matches in database.
   DBoW2::QueryResults query_result;
-  db_BoW_->query(bow_vec,
-                 query_result,
-                 lcd_params_.max_db_results_,
-                 max_possible_match_id);
+  if (bow_query_engine_) {
+    bow_query_engine_->query(bow_vec,
+                             lcd_params_.max_db_results_,
+                             max_possible_match_id,
+                             &query_result);
+  } else {
+    db_BoW_->query(bow_vec,
+                   query_result,
+                   lcd_params_.max_db_results_,
+                   max_possible_match_id);
+  }
 
   // Add current BoW vector to database.
-  db_BoW_->add(bow_vec);
+  addBowVector(bow_vec);
 
   if (query_result.empty()) {
     result->status_ = LCDStatus::NO_MATCHES;
@@ -454,13 +599,19 @@ bool LoopClosureDetector::recoverPose(const FrameId& query_id,
 /* ------------------------------------------------------------------------ */
 const gtsam::Pose3 LoopClosureDetector::getWPoseMap() const {
   if (W_Pose_Blkf_estimates_.size() > 1) {
-    CHECK(pgo_);
-    const gtsam::Pose3& w_Pose_Bkf_estim = W_Pose_Blkf_estimates_.back();
-    const gtsam::Pose3& w_Pose_Bkf_optimal =
-        pgo_->calculateEstimate().at<gtsam::Pose3>(
-            W_Pose_Blkf_estimates_.size() - 1);
-
-    return w_Pose_Bkf_optimal.between(w_Pose_Bkf_estim);
+    CHECK(pgo_optimizer_);
+    PgoEstimate::ConstPtr pgo_estimate = pgo_optimizer_->getLatestEstimate();
+    if (pgo_estimate && !pgo_estimate->states_.empty()) {
+      // Use the latest keyframe that the optimizer has already processed.
+      const size_t key = std::min(W_Pose_Blkf_estimates_.size(),
+                                  pgo_estimate->states_.size()) -
+                         1u;
+      const gtsam::Pose3& w_Pose_Bkf_estim = W_Pose_Blkf_estimates_.at(key);
+      const gtsam::Pose3& w_Pose_Bkf_optimal =
+          pgo_estimate->states_.at<gtsam::Pose3>(key);
+
+      return w_Pose_Bkf_optimal.between(w_Pose_Bkf_estim);
+    }
   }
 
   return gtsam::Pose3();
@@ -468,14 +619,16 @@ const gtsam::Pose3 LoopClosureDetector::getWPoseMap() const {
 
 /* ------------------------------------------------------------------------ */
 const gtsam::Values LoopClosureDetector::getPGOTrajectory() const {
-  CHECK(pgo_);
-  return pgo_->calculateEstimate();
+  CHECK(pgo_optimizer_);
+  PgoEstimate::ConstPtr pgo_estimate = pgo_optimizer_->getLatestEstimate();
+  return pgo_estimate ? pgo_estimate->states_ : gtsam::Values();
 }
 
 /* ------------------------------------------------------------------------ */
 const gtsam::NonlinearFactorGraph LoopClosureDetector::getPGOnfg() const {
-  CHECK(pgo_);
-  return pgo_->getFactorsUnsafe();
+  CHECK(pgo_optimizer_);
+  PgoEstimate::ConstPtr pgo_estimate = pgo_optimizer_->getLatestEstimate();
+  return pgo_estimate ? pgo_estimate->nfg_ : gtsam::NonlinearFactorGraph();
 }
 
 /* ------------------------------------------------------------------------ */
@@ -496,11 +649,165 @@ void LoopClosureDetector::setIntrinsics(const StereoFrame& stereo_frame) {
 /* ------------------------------------------------------------------------ */
 void LoopClosureDetector::setDatabase(const OrbDatabase& db) {
   db_BoW_ = VIO::make_unique<OrbDatabase>(db);
+  // DBoW2 does not expose the BoW vectors of its entries, so a non-empty
+  // database cannot be mirrored by the query engine.
+  if (bow_query_engine_ && db_BoW_->size() > 0u) {
+    LOG(WARNING) << "LoopClosureDetector: disabling the BoW query engine for "
+                    "a non-empty database.";
+    bow_query_engine_.reset();
+  } else if (bow_query_engine_) {
+    bow_query_engine_->clear();
+  }
 }
 
 /* ------------------------------------------------------------------------ */
 void LoopClosureDetector::setVocabulary(const OrbVocabulary& voc) {
+  // Clears the database as well.
   db_BoW_->setVocabulary(voc);
+  if (bow_query_engine_) {
+    bow_query_engine_->clear();
+    if (!BowQueryEngine::supportsScoring(voc.getScoringType())) {
+      bow_query_engine_.reset();
+    }
+  }
+}
+
+/* ------------------------------------------------------------------------ */
+void LoopClosureDetector::addBowVector(const DBoW2::BowVector& bow_vec) {
+  CHECK(db_BoW_);
+  db_BoW_->add(bow_vec);
+  if (bow_query_engine_) {
+    bow_query_engine_->add(bow_vec);
+    DCHECK_EQ(bow_query_engine_->size(), db_BoW_->size());
+  }
+}
+
+/* ------------------------------------------------------------------------ */
+void LoopClosureDetector::saveDatabase(const std::string& filename) const {
+  std::ofstream stream(filename, std::ios::out | std::ios::binary);
+  CHECK(stream.good()) << "Could not open " << filename << " for writing.";
+
+  stream.write(kDatabaseMagic, sizeof(kDatabaseMagic));
+  writeBinary(&stream, kDatabaseVersion);
+  writeBinary(&stream, static_cast<uint64_t>(db_frames_.size()));
+  for (const LCDFrame& frame : db_frames_) {
+    writeBinary(&stream, frame.timestamp_);
+    writeBinary(&stream, static_cast<uint64_t>(frame.id_));
+    writeBinary(&stream, static_cast<uint64_t>(frame.id_kf_));
+
+    writeBinary(&stream, static_cast<uint64_t>(frame.keypoints_.size()));
+    for (const cv::KeyPoint& keypoint : frame.keypoints_) {
+      writeBinary(&stream, keypoint.pt.x);
+      writeBinary(&stream, keypoint.pt.y);
+      writeBinary(&stream, keypoint.size);
+      writeBinary(&stream, keypoint.angle);
+      writeBinary(&stream, keypoint.response);
+      writeBinary(&stream, static_cast<int32_t>(keypoint.octave));
+      writeBinary(&stream, static_cast<int32_t>(keypoint.class_id));
+    }
+
+    writeBinary(&stream, static_cast<uint64_t>(frame.keypoints_3d_.size()));
+    for (const gtsam::Vector3& keypoint_3d : frame.keypoints_3d_) {
+      stream.write(reinterpret_cast<const char*>(keypoint_3d.data()),
+                   3u * sizeof(double));
+    }
+
+    writeBinary(&stream, static_cast<uint64_t>(frame.versors_.size()));
+    for (const Vector3& versor : frame.versors_) {
+      stream.write(reinterpret_cast<const char*>(versor.data()),
+                   3u * sizeof(double));
+    }
+
+    const OrbDescriptor& descriptors = frame.descriptors_mat_;
+    CHECK(descriptors.empty() || descriptors.isContinuous());
+    writeBinary(&stream, static_cast<int32_t>(descriptors.rows));
+    writeBinary(&stream, static_cast<int32_t>(descriptors.cols));
+    writeBinary(&stream, static_cast<int32_t>(descriptors.type()));
+    stream.write(reinterpret_cast<const char*>(descriptors.data),
+                 descriptors.total() * descriptors.elemSize());
+  }
+  CHECK(stream.good()) << "Could not write database to " << filename;
+  LOG(INFO) << "LoopClosureDetector: saved " << db_frames_.size()
+            << " frames to " << filename;
+}
+
+/* ------------------------------------------------------------------------ */
+void LoopClosureDetector::loadDatabase(const std::string& filename) {
+  CHECK(db_frames_.empty())
+      << "LoopClosureDetector: the database must be loaded before processing "
+         "any frame.";
+  CHECK(db_BoW_);
+  std::ifstream stream(filename, std::ios::in | std::ios::binary);
+  CHECK(stream.good()) << "Could not open " << filename;
+
+  char magic[sizeof(kDatabaseMagic)];
+  stream.read(magic, sizeof(magic));
+  CHECK(stream.good() &&
+        std::equal(magic, magic + sizeof(magic), kDatabaseMagic))
+      << filename << " is not a LoopClosureDetector database.";
+  CHECK_EQ(readBinary<uint32_t>(&stream), kDatabaseVersion)
+      << "Unsupported LoopClosureDetector database version in " << filename;
+
+  const uint64_t n_frames = readBinary<uint64_t>(&stream);
+  db_frames_.reserve(n_frames);
+  db_BoW_->clear();
+  if (bow_query_engine_) bow_query_engine_->clear();
+  for (uint64_t i = 0u; i < n_frames; i++) {
+    LCDFrame frame;
+    frame.timestamp_ = readBinary<Timestamp>(&stream);
+    frame.id_ = readBinary<uint64_t>(&stream);
+    frame.id_kf_ = readBinary<uint64_t>(&stream);
+    CHECK_EQ(frame.id_, db_frames_.size());
+
+    frame.keypoints_.resize(readBinary<uint64_t>(&stream));
+    for (cv::KeyPoint& keypoint : frame.keypoints_) {
+      keypoint.pt.x = readBinary<float>(&stream);
+      keypoint.pt.y = readBinary<float>(&stream);
+      keypoint.size = readBinary<float>(&stream);
+      keypoint.angle = readBinary<float>(&stream);
+      keypoint.response = readBinary<float>(&stream);
+      keypoint.octave = readBinary<int32_t>(&stream);
+      keypoint.class_id = readBinary<int32_t>(&stream);
+    }
+
+    frame.keypoints_3d_.resize(readBinary<uint64_t>(&stream));
+    for (gtsam::Vector3& keypoint_3d : frame.keypoints_3d_) {
+      stream.read(reinterpret_cast<char*>(keypoint_3d.data()),
+                  3u * sizeof(double));
+    }
+
+    frame.versors_.resize(readBinary<uint64_t>(&stream));
+    for (Vector3& versor : frame.versors_) {
+      stream.read(reinterpret_cast<char*>(versor.data()), 3u * sizeof(double));
+    }
+
+    const int32_t rows = readBinary<int32_t>(&stream);
+    const int32_t cols = readBinary<int32_t>(&stream);
+    const int32_t type = readBinary<int32_t>(&stream);
+    frame.descriptors_mat_ = OrbDescriptor(rows, cols, type);
+    stream.read(reinterpret_cast<char*>(frame.descriptors_mat_.data),
+                frame.descriptors_mat_.total() *
+                    frame.descriptors_mat_.elemSize());
+    CHECK(stream.good()) << "Truncated LoopClosureDetector database.";
+    frame.descriptors_vec_.reserve(rows);
+    for (int32_t row = 0; row < rows; row++) {
+      frame.descriptors_vec_.push_back(frame.descriptors_mat_.row(row));
+    }
+
+    // Rebuild the BoW database entry of the frame.
+    DBoW2::BowVector bow_vec;
+    db_BoW_->getVocabulary()->transform(frame.descriptors_vec_, bow_vec);
+    addBowVector(bow_vec);
+    // As in detectLoop, for normalized similarity scoring (NSS).
+    if (static_cast<int>(frame.id_ + 1) > lcd_params_.dist_local_) {
+      latest_bowvec_ = bow_vec;
+    }
+
+    db_frames_.push_back(frame);
+  }
+  n_loaded_frames_ = db_frames_.size();
+  LOG(INFO) << "LoopClosureDetector: loaded " << db_frames_.size()
+            << " frames from " << filename;
 }
 
 /* ------------------------------------------------------------------------ */
@@ -568,6 +875,75 @@ void LoopClosureDetector::rewriteStereoFrameFeatures(
   CHECK_EQ(stereo_frame->right_keypoints_rectified_.size(), num_kp);
 }
 
+/* ------------------------------------------------------------------------ */
+bool LoopClosureDetector::computeDescriptorsAtFrontendFeatures(
+    const StereoFrame& stereo_frame,
+    std::vector<cv::KeyPoint>* keypoints,
+    std::vector<gtsam::Vector3>* keypoints_3d,
+    BearingVectors* versors,
+    OrbDescriptor* descriptors_mat) const {
+  CHECK_NOTNULL(keypoints);
+  CHECK_NOTNULL(keypoints_3d);
+  CHECK_NOTNULL(versors);
+  CHECK_NOTNULL(descriptors_mat);
+
+  const Frame& left_frame = stereo_frame.getLeftFrame();
+  const size_t num_kp = left_frame.keypoints_.size();
+  CHECK_EQ(left_frame.versors_.size(), num_kp);
+  CHECK_EQ(stereo_frame.right_keypoints_status_.size(), num_kp);
+  CHECK_EQ(stereo_frame.keypoints_3d_.size(), num_kp);
+
+  // Only keypoints with a valid stereo match are useful: their depth is needed
+  // for pose recovery. The class_id keeps track of the frontend index.
+  // ORB only computes the orientation of the keypoints it detects, so it is
+  // computed here for the descriptors to be rotation invariant like those of
+  // the detected ORB features. Keypoints whose patch does not fit in the
+  // image are skipped, ORB would drop them anyway.
+  const cv::Mat& img = left_frame.img_;
+  const int radius = lcd_params_.patch_sze_ / 2;
+  const cv::Rect inner_rect(
+      radius, radius, img.cols - 2 * radius, img.rows - 2 * radius);
+  keypoints->clear();
+  keypoints->reserve(num_kp);
+  for (size_t i = 0; i < num_kp; i++) {
+    if (stereo_frame.right_keypoints_status_[i] != KeypointStatus::VALID) {
+      continue;
+    }
+    const KeypointCV& keypoint = left_frame.keypoints_[i];
+    const cv::Point pixel(cvRound(keypoint.x), cvRound(keypoint.y));
+    if (!inner_rect.contains(pixel)) continue;
+    keypoints->push_back(
+        cv::KeyPoint(keypoint,
+                     lcd_params_.patch_sze_,
+                     intensityCentroidAngle(img, keypoint, radius),
+                     0.0f,
+                     0,
+                     static_cast<int>(i)));
+  }
+
+  // ORB drops keypoints too close to the image border.
+  orb_feature_detector_->compute(img, *keypoints, *descriptors_mat);
+  CHECK_EQ(static_cast<size_t>(descriptors_mat->rows), keypoints->size());
+  if (keypoints->size() <
+      static_cast<size_t>(FLAGS_lcd_min_frontend_features)) {
+    VLOG(3) << "LoopClosureDetector: only " << keypoints->size()
+            << " frontend features with depth, detecting ORB features instead.";
+    return false;
+  }
+
+  keypoints_3d->clear();
+  versors->clear();
+  keypoints_3d->reserve(keypoints->size());
+  versors->reserve(keypoints->size());
+  for (const cv::KeyPoint& keypoint : *keypoints) {
+    const size_t idx = static_cast<size_t>(keypoint.class_id);
+    DCHECK_LT(idx, num_kp);
+    keypoints_3d->push_back(stereo_frame.keypoints_3d_[idx]);
+    versors->push_back(left_frame.versors_[idx]);
+  }
+  return true;
+}
+
 /* ------------------------------------------------------------------------ */
 cv::Mat LoopClosureDetector::computeAndDrawMatchesBetweenFrames(
     const cv::Mat& query_img,
@@ -575,18 +951,13 @@ cv::Mat LoopClosureDetector::computeAndDrawMatchesBetweenFrames(
     const FrameId& query_id,
     const FrameId& match_id,
     bool cut_matches) const {
-  std::vector<std::vector<cv::DMatch>> matches;
   std::vector<cv::DMatch> good_matches;
 
   // Use the Lowe's Ratio Test only if asked.
   double lowe_ratio = 1.0;
   if (cut_matches) lowe_ratio = lcd_params_.lowe_ratio_;
 
-  // TODO(marcus): this can use computeMatchedIndices() as well...
-  orb_feature_matcher_->knnMatch(db_frames_[query_id].descriptors_mat_,
-                                 db_frames_[match_id].descriptors_mat_,
-                                 matches,
-                                 2u);
+  const std::vector<DMatchVec>& matches = getKnnMatches(query_id, match_id);
 
   for (const std::vector<cv::DMatch>& match : matches) {
     if (match.at(0).distance < lowe_ratio * match.at(1).distance) {
@@ -626,6 +997,113 @@ void LoopClosureDetector::transformBodyPoseToCameraPose(
       B_Pose_camLrect_.inverse() * bodyCur_T_bodyRef * B_Pose_camLrect_;
 }
 
+/* ------------------------------------------------------------------------ */
+void LoopClosureDetector::fillPgoOutput(
+    const gtsam::Values& pgo_states,
+    const gtsam::NonlinearFactorGraph& pgo_nfg,
+    const bool& full_snapshot,
+    LcdOutput* output) {
+  CHECK_NOTNULL(output);
+  PgoFactorCounts pgo_factors;
+  for (const gtsam::NonlinearFactor::shared_ptr& factor : pgo_nfg) {
+    if (!factor) continue;
+    pgo_factors[getPgoFactorId(*factor)]++;
+  }
+
+  // A delta cannot remove factors.
+  bool is_full_snapshot = full_snapshot;
+  if (!is_full_snapshot) {
+    for (const PgoFactorCounts::value_type& id_count :
+         published_pgo_factors_) {
+      const PgoFactorCounts::const_iterator it =
+          pgo_factors.find(id_count.first);
+      if (it == pgo_factors.end() || it->second < id_count.second) {
+        VLOG(2) << "LoopClosureDetector: published PGO factors were removed, "
+                   "publishing the full PGO.";
+        is_full_snapshot = true;
+        break;
+      }
+    }
+  }
+
+  output->pgo_version_ = ++pgo_version_;
+  output->is_pgo_delta_ = !is_full_snapshot;
+
+  if (is_full_snapshot) {
+    output->states_ = pgo_states;
+    output->nfg_ = pgo_nfg;
+  } else {
+    for (const gtsam::Values::ConstKeyValuePair& key_value : pgo_states) {
+      const gtsam::Pose3& pose = key_value.value.cast<gtsam::Pose3>();
+      if (!published_pgo_states_.exists(key_value.key) ||
+          !pose.equals(published_pgo_states_.at<gtsam::Pose3>(key_value.key),
+                       FLAGS_lcd_pgo_delta_tol)) {
+        output->states_.insert(key_value.key, pose);
+      }
+    }
+    // Skip as many occurrences of each factor as were published.
+    PgoFactorCounts n_published = published_pgo_factors_;
+    for (const gtsam::NonlinearFactor::shared_ptr& factor : pgo_nfg) {
+      if (!factor) continue;
+      const PgoFactorCounts::iterator it =
+          n_published.find(getPgoFactorId(*factor));
+      if (it != n_published.end() && it->second > 0u) {
+        it->second--;
+      } else {
+        output->nfg_.push_back(factor);
+      }
+    }
+  }
+
+  // Keep track of what consumers have, only needed to compute deltas.
+  if (FLAGS_lcd_publish_pgo_deltas) {
+    published_pgo_factors_.swap(pgo_factors);
+    if (is_full_snapshot) {
+      published_pgo_states_ = pgo_states;
+    } else {
+      for (const gtsam::Values::ConstKeyValuePair& key_value :
+           output->states_) {
+        if (published_pgo_states_.exists(key_value.key)) {
+          published_pgo_states_.update(key_value.key, key_value.value);
+        } else {
+          published_pgo_states_.insert(key_value.key, key_value.value);
+        }
+      }
+    }
+  }
+}
+
+/* ------------------------------------------------------------------------ */
+LoopClosureDetector::PgoFactorId LoopClosureDetector::getPgoFactorId(
+    const gtsam::NonlinearFactor& factor) {
+  CHECK(!factor.keys().empty());
+  return PgoFactorId(
+      factor.keys().front(), factor.keys().back(), typeid(factor));
+}
+
+/* ------------------------------------------------------------------------ */
+const std::vector<std::vector<cv::DMatch>>& LoopClosureDetector::getKnnMatches(
+    const FrameId& query_id,
+    const FrameId& match_id) const {
+  if (knn_matches_cache_ && FLAGS_lcd_cache_knn_matches &&
+      knn_matches_cache_->query_id_ == query_id &&
+      knn_matches_cache_->match_id_ == match_id) {
+    return knn_matches_cache_->matches_;
+  }
+
+  if (!knn_matches_cache_) {
+    knn_matches_cache_ = VIO::make_unique<KnnMatches>();
+  }
+  knn_matches_cache_->query_id_ = query_id;
+  knn_matches_cache_->match_id_ = match_id;
+  knn_matches_cache_->matches_.clear();
+  orb_feature_matcher_->knnMatch(db_frames_.at(query_id).descriptors_mat_,
+                                 db_frames_.at(match_id).descriptors_mat_,
+                                 knn_matches_cache_->matches_,
+                                 2u);
+  return knn_matches_cache_->matches_;
+}
+
 /* ------------------------------------------------------------------------ */
 void LoopClosureDetector::computeMatchedIndices(const FrameId& query_id,
                                                 const FrameId& match_id,
@@ -636,14 +1114,10 @@ void LoopClosureDetector::computeMatchedIndices(const FrameId& query_id,
   CHECK_NOTNULL(i_match);
 
   // Get two best matches between frame descriptors.
-  std::vector<DMatchVec> matches;
   double lowe_ratio = 1.0;
   if (cut_matches) lowe_ratio = lcd_params_.lowe_ratio_;
 
-  orb_feature_matcher_->knnMatch(db_frames_[query_id].descriptors_mat_,
-                                 db_frames_[match_id].descriptors_mat_,
-                                 matches,
-                                 2u);
+  const std::vector<DMatchVec>& matches = getKnnMatches(query_id, match_id);
 
   // We reserve instead of resize because some of the matches will be pruned.
   const size_t& n_matches = matches.size();
@@ -660,9 +1134,6 @@ void LoopClosureDetector::computeMatchedIndices(const FrameId& query_id,
 }
 
 /* ------------------------------------------------------------------------ */
-// TODO(marcus): both geometrticVerification and recoverPose run the matching
-// alg. this is wasteful. Store the matched indices as latest for use in the
-// compute step
 bool LoopClosureDetector::geometricVerificationNister(
     const FrameId& query_id,
     const FrameId& match_id,
@@ -893,8 +1364,8 @@ void LoopClosureDetector::initializePGO(const OdometryFactor& factor) {
   init_nfg.add(gtsam::PriorFactor<gtsam::Pose3>(
       gtsam::Symbol(factor.cur_key_), factor.W_Pose_Blkf_, factor.noise_));
 
-  CHECK(pgo_);
-  pgo_->update(init_nfg, init_val);
+  CHECK(pgo_optimizer_);
+  pgo_optimizer_->addPrior(init_nfg, init_val);
 
   lcd_state_ = LcdState::Nominal;
 }
@@ -926,8 +1397,8 @@ void LoopClosureDetector::addOdometryFactorAndOptimize(
                                              B_llkf_Pose_lkf,
                                              factor.noise_));
 
-  CHECK(pgo_);
-  pgo_->update(nfg, value);
+  CHECK(pgo_optimizer_);
+  pgo_optimizer_->addOdometry(nfg, value);
 }
 
 /* ------------------------------------------------------------------------ */
@@ -940,8 +1411,8 @@ void LoopClosureDetector::addLoopClosureFactorAndOptimize(
                                              factor.ref_Pose_cur_,
                                              factor.noise_));
 
-  CHECK(pgo_);
-  pgo_->update(nfg);
+  CHECK(pgo_optimizer_);
+  pgo_optimizer_->addLoopClosure(nfg);
 }
 
 }  // namespace VIO
@@ -0,0 +1,211 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   PgoOptimizer.cpp
+ * @brief  Runs the robust pose-graph optimization of the LoopClosureDetector
+ * in its own thread.
+ *
+ * @author Marcus Abate
+ */
+
+#include "kimera-vio/loopclosure/PgoOptimizer.h"
+
+#include <utility>
+
+#include <glog/logging.h>
+
+#include <KimeraRPGO/RobustSolver.h>
+
+#include "kimera-vio/utils/Timer.h"
+
+namespace VIO {
+
+/* -------------------------------------------------------------------------- */
+PgoOptimizer::PgoOptimizer(const LoopClosureDetectorParams& lcd_params,
+                           const bool& parallel_run)
+    : parallel_run_(parallel_run), pgo_(nullptr) {
+  // TODO(marcus): parametrize the verbosity of PGO params
+  KimeraRPGO::RobustSolverParams pgo_params;
+  pgo_params.setPcmSimple3DParams(lcd_params.pgo_trans_threshold_,
+                                  lcd_params.pgo_rot_threshold_,
+                                  KimeraRPGO::Verbosity::QUIET);
+  pgo_ = VIO::make_unique<KimeraRPGO::RobustSolver>(pgo_params);
+
+  if (parallel_run_) {
+    worker_ = VIO::make_unique<std::thread>(&PgoOptimizer::spin, this);
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+PgoOptimizer::~PgoOptimizer() { shutdown(); }
+
+/* -------------------------------------------------------------------------- */
+void PgoOptimizer::addPrior(const gtsam::NonlinearFactorGraph& nfg,
+                            const gtsam::Values& values) {
+  addUpdate(PgoUpdate{PgoUpdateType::Prior, nfg, values});
+}
+
+/* -------------------------------------------------------------------------- */
+void PgoOptimizer::addOdometry(const gtsam::NonlinearFactorGraph& nfg,
+                               const gtsam::Values& values) {
+  addUpdate(PgoUpdate{PgoUpdateType::Odometry, nfg, values});
+}
+
+/* -------------------------------------------------------------------------- */
+void PgoOptimizer::addLoopClosure(const gtsam::NonlinearFactorGraph& nfg) {
+  addUpdate(PgoUpdate{PgoUpdateType::LoopClosure, nfg, gtsam::Values()});
+}
+
+/* -------------------------------------------------------------------------- */
+PgoEstimate::ConstPtr PgoOptimizer::getLatestEstimate() const {
+  std::lock_guard<std::mutex> lock(estimate_mutex_);
+  return latest_estimate_;
+}
+
+/* -------------------------------------------------------------------------- */
+size_t PgoOptimizer::getNumUpdatesAdded() const {
+  std::lock_guard<std::mutex> lock(update_mutex_);
+  return num_updates_added_;
+}
+
+/* -------------------------------------------------------------------------- */
+void PgoOptimizer::waitUntilIdle() {
+  std::unique_lock<std::mutex> lock(update_mutex_);
+  idle_condition_.wait(
+      lock, [this] { return pending_updates_.empty() && !is_busy_; });
+}
+
+/* -------------------------------------------------------------------------- */
+void PgoOptimizer::shutdown() {
+  {
+    // The worker applies the pending updates before exiting.
+    std::lock_guard<std::mutex> lock(update_mutex_);
+    shutdown_ = true;
+  }
+  update_condition_.notify_all();
+  idle_condition_.notify_all();
+  if (worker_ && worker_->joinable()) {
+    worker_->join();
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+void PgoOptimizer::addUpdate(PgoUpdate&& update) {
+  if (!parallel_run_) {
+    {
+      std::lock_guard<std::mutex> lock(update_mutex_);
+      num_updates_added_++;
+    }
+    std::deque<PgoUpdate> updates;
+    updates.push_back(std::move(update));
+    processUpdates(&updates);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(update_mutex_);
+    if (shutdown_) {
+      LOG(WARNING) << "PgoOptimizer: ignoring update added after shutdown.";
+      return;
+    }
+    pending_updates_.push_back(std::move(update));
+    num_updates_added_++;
+  }
+  update_condition_.notify_one();
+}
+
+/* -------------------------------------------------------------------------- */
+void PgoOptimizer::spin() {
+  LOG(INFO) << "Spinning PgoOptimizer.";
+  while (true) {
+    std::deque<PgoUpdate> updates;
+    {
+      std::unique_lock<std::mutex> lock(update_mutex_);
+      update_condition_.wait(
+          lock, [this] { return shutdown_ || !pending_updates_.empty(); });
+      // Pending updates are applied before shutting down.
+      if (pending_updates_.empty()) break;
+      updates.swap(pending_updates_);
+      is_busy_ = true;
+    }
+    processUpdates(&updates);
+    {
+      std::lock_guard<std::mutex> lock(update_mutex_);
+      is_busy_ = false;
+    }
+    idle_condition_.notify_all();
+  }
+  LOG(INFO) << "PgoOptimizer successfully shutdown.";
+}
+
+/* -------------------------------------------------------------------------- */
+void PgoOptimizer::processUpdates(std::deque<PgoUpdate>* updates) {
+  CHECK_NOTNULL(updates);
+  CHECK(pgo_);
+  auto tic = utils::Timer::tic();
+  const size_t n_updates = updates->size();
+
+  // Consecutive odometry updates are merged: RPGO does not optimize on
+  // odometry, so this only saves the per-update overhead.
+  gtsam::NonlinearFactorGraph odom_nfg;
+  gtsam::Values odom_values;
+  auto flush_odometry = [&]() {
+    if (odom_nfg.empty() && odom_values.empty()) return;
+    pgo_->update(odom_nfg, odom_values);
+    odom_nfg = gtsam::NonlinearFactorGraph();
+    odom_values.clear();
+  };
+
+  for (PgoUpdate& update : *updates) {
+    switch (update.type_) {
+      case PgoUpdateType::Odometry: {
+        odom_nfg.push_back(update.nfg_);
+        odom_values.insert(update.values_);
+        break;
+      }
+      case PgoUpdateType::Prior: {
+        flush_odometry();
+        pgo_->update(update.nfg_, update.values_);
+        break;
+      }
+      case PgoUpdateType::LoopClosure: {
+        flush_odometry();
+        pgo_->update(update.nfg_);
+        break;
+      }
+      default: {
+        LOG(FATAL) << "Unrecognized PGO update type.";
+      }
+    }
+  }
+  flush_odometry();
+  updates->clear();
+  num_updates_applied_ += n_updates;
+
+  publishEstimate();
+  VLOG(5) << "PgoOptimizer: applied " << n_updates << " updates in "
+          << utils::Timer::toc(tic).count() << " ms.";
+}
+
+/* -------------------------------------------------------------------------- */
+void PgoOptimizer::publishEstimate() {
+  PgoEstimate::Ptr estimate = std::make_shared<PgoEstimate>();
+  estimate->states_ = pgo_->calculateEstimate();
+  estimate->nfg_ = pgo_->getFactorsUnsafe();
+  estimate->pgo_size_ = pgo_->size();
+  estimate->num_lc_ = pgo_->getNumLC();
+  estimate->num_lc_inliers_ = pgo_->getNumLCInliers();
+  estimate->num_updates_ = num_updates_applied_;
+
+  std::lock_guard<std::mutex> lock(estimate_mutex_);
+  estimate->version_ = ++version_;
+  latest_estimate_ = estimate;
+}
+
+}  // namespace VIO
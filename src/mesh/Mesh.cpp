@@ -329,6 +329,18 @@ void Mesh<VertexPositionType>::convertPolygonsMeshToMat(
   *polygons_mesh = polygons_mesh_.clone();
 }
 
+/* -------------------------------------------------------------------------- */
+template <typename VertexPositionType>
+LandmarkIds Mesh<VertexPositionType>::getLandmarkIds() const {
+  // Vertices without landmark, if any, are left to -1.
+  LandmarkIds lmk_ids(static_cast<size_t>(vertices_mesh_.rows), -1);
+  for (const auto& vertex_to_lmk_id : vertex_to_lmk_id_map_) {
+    DCHECK_LT(vertex_to_lmk_id.first, vertices_mesh_.rows);
+    lmk_ids.at(vertex_to_lmk_id.first) = vertex_to_lmk_id.second;
+  }
+  return lmk_ids;
+}
+
 /* -------------------------------------------------------------------------- */
 // Reset all data structures of the mesh.
 template <typename VertexPositionType>
@@ -62,6 +62,16 @@ DEFINE_bool(log_histogram_2D,
             false,
             "Log 2D histogram to file."
             " It logs the raw and smoothed histogram.");
+DEFINE_bool(incremental_plane_histograms,
+            false,
+            "Update the histograms used for plane segmentation incrementally, "
+            "only with the polygons that are new, removed, or that have lmks "
+            "that moved, instead of recalculating them from scratch every "
+            "keyframe. Not benchmarked yet against the full recalculation.");
+DEFINE_double(incremental_histogram_lmk_tolerance,
+              0.01,
+              "Distance [m] a lmk has to move for its polygons to be voted "
+              "again in the incrementally updated histograms.");
 
 // Mesh filters.
 DEFINE_double(max_grad_in_triangle,
@@ -176,11 +186,68 @@ DEFINE_int32(z_histogram_max_number_of_peaks_to_select,
 
 namespace VIO {
 
+namespace {
+/* -------------------------------------------------------------------------- */
+// Appends the components of the given sample as consecutive floats, which is
+// the layout expected by Histogram::updateHistogram.
+template <int N>
+void appendHistogramSample(const cv::Vec<float, N>& sample, cv::Mat* samples) {
+  CHECK_NOTNULL(samples);
+  for (int i = 0; i < N; i++) {
+    samples->push_back(sample[i]);
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+// Moves the sample of the given polygon from the samples voted at the last
+// histogram update to the samples voted at this one. The polygon is only voted
+// again if it is new, or if any of its lmks moved.
+template <int N>
+void updatePolygonHistogramSample(
+    const Mesher::PolygonLmkIds& polygon_lmk_ids,
+    const cv::Vec<float, N>& sample,
+    const std::unordered_set<LandmarkId>& moved_lmk_ids,
+    std::map<Mesher::PolygonLmkIds, cv::Vec<float, N>>* voted_samples,
+    std::map<Mesher::PolygonLmkIds, cv::Vec<float, N>>* new_voted_samples,
+    cv::Mat* samples_to_remove,
+    cv::Mat* samples_to_add) {
+  CHECK_NOTNULL(voted_samples);
+  CHECK_NOTNULL(new_voted_samples);
+  CHECK_NOTNULL(samples_to_remove);
+  CHECK_NOTNULL(samples_to_add);
+  if (new_voted_samples->count(polygon_lmk_ids) > 0u) {
+    // Repeated polygon in the mesh, it only votes once.
+    return;
+  }
+  const auto& voted_it = voted_samples->find(polygon_lmk_ids);
+  if (voted_it != voted_samples->end()) {
+    bool has_moved = false;
+    for (const LandmarkId& lmk_id : polygon_lmk_ids) {
+      if (moved_lmk_ids.count(lmk_id) > 0u) {
+        has_moved = true;
+        break;
+      }
+    }
+    if (!has_moved) {
+      // Keep the vote, the histograms are not updated for this polygon.
+      new_voted_samples->emplace(polygon_lmk_ids, voted_it->second);
+      voted_samples->erase(voted_it);
+      return;
+    }
+    appendHistogramSample(voted_it->second, samples_to_remove);
+    voted_samples->erase(voted_it);
+  }
+  appendHistogramSample(sample, samples_to_add);
+  new_voted_samples->emplace(polygon_lmk_ids, sample);
+}
+}  // namespace
+
 /* -------------------------------------------------------------------------- */
 Mesher::Mesher(const MesherParams& mesher_params, const bool& serialize_meshes)
     : mesher_params_(mesher_params),
       mesh_2d_(),
       mesh_3d_(),
+      next_plane_id_(0u),
       mesher_logger_(nullptr),
       serialize_meshes_(serialize_meshes) {
   mesher_logger_ = VIO::make_unique<MesherLogger>();
@@ -837,6 +904,14 @@ void Mesher::segmentPlanesInMesh(
   Mesh3D::Polygon polygon;
   cv::Mat z_components(1, 0, CV_32F);
   cv::Mat walls(0, 0, CV_32FC2);
+  // Samples voted by each polygon, and samples to vote out of and into the
+  // histograms, for incremental histogram updates.
+  PolygonZSamples z_polygon_samples;
+  PolygonWallSamples wall_polygon_samples;
+  cv::Mat z_to_remove(0, 1, CV_32F);
+  cv::Mat z_to_add(0, 1, CV_32F);
+  cv::Mat walls_to_remove(0, 1, CV_32F);
+  cv::Mat walls_to_add(0, 1, CV_32F);
   for (size_t i = 0; i < mesh_3d_.getNumberOfPolygons(); i++) {
     CHECK(mesh_3d_.getPolygon(i, &polygon)) << "Could not retrieve polygon.";
     CHECK_EQ(polygon.size(), mesh_polygon_dim);
@@ -848,6 +923,13 @@ void Mesher::segmentPlanesInMesh(
     // The normals are in the world frame of reference.
     cv::Point3f triangle_normal;
     if (calculateNormal(p1, p2, p3, &triangle_normal)) {
+      // Identify the polygon by its (sorted) lmk ids, the polygon index in
+      // the mesh is not persistent across keyframes.
+      PolygonLmkIds polygon_lmk_ids = {polygon.at(0).getLmkId(),
+                                       polygon.at(1).getLmkId(),
+                                       polygon.at(2).getLmkId()};
+      std::sort(polygon_lmk_ids.begin(), polygon_lmk_ids.end());
+
       ////////////////////////// Update seed planes ////////////////////////////
       // Update seed_planes lmk_ids field with ids of vertices of polygon if the
       // polygon is on the plane.
@@ -876,9 +958,19 @@ void Mesher::segmentPlanesInMesh(
         // Store z components to build histogram.
         // TODO instead of storing z_components, use the accumulate flag in
         // calcHist and add them straight.
-        z_components.push_back(p1.z);
-        z_components.push_back(p2.z);
-        z_components.push_back(p3.z);
+        if (FLAGS_incremental_plane_histograms) {
+          updatePolygonHistogramSample(polygon_lmk_ids,
+                                       cv::Vec3f(p1.z, p2.z, p3.z),
+                                       moved_histogram_lmk_ids_,
+                                       &z_polygon_samples_,
+                                       &z_polygon_samples,
+                                       &z_to_remove,
+                                       &z_to_add);
+        } else {
+          z_components.push_back(p1.z);
+          z_components.push_back(p2.z);
+          z_components.push_back(p3.z);
+        }
       } else if ((FLAGS_only_use_non_clustered_points ? !is_polygon_on_a_plane
                                                       : true) &&
                  isNormalPerpendicularToAxis(
@@ -902,7 +994,20 @@ void Mesher::segmentPlanesInMesh(
           VLOG(10) << "New normalized theta: " << theta
                    << " and distance: " << distance;
         }
-        walls.push_back(cv::Point2f(theta, distance));
+        if (FLAGS_incremental_plane_histograms) {
+          const cv::Vec2f wall_sample(static_cast<float>(theta),
+                                      static_cast<float>(distance));
+          updatePolygonHistogramSample(
+              polygon_lmk_ids,
+              wall_sample,
+              moved_histogram_lmk_ids_,
+              &wall_polygon_samples_,
+              &wall_polygon_samples,
+              &walls_to_remove,
+              &walls_to_add);
+        } else {
+          walls.push_back(cv::Point2f(theta, distance));
+        }
         // WARNING should we instead be using projected triangle normal
         // on equator, and taking average of three distances...
         // NORMALIZE if a theta is positive and distance negative, it is the
@@ -911,13 +1016,65 @@ void Mesher::segmentPlanesInMesh(
     }
   }
 
-  VLOG(10) << "Number of polygons potentially on a wall: " << walls.rows;
+  if (FLAGS_incremental_plane_histograms) {
+    VLOG(10) << "Number of polygons potentially on a wall: "
+             << wall_polygon_samples.size();
+    // The polygons left were removed from the mesh, or do not vote in that
+    // histogram anymore.
+    for (const auto& z_polygon_sample : z_polygon_samples_) {
+      appendHistogramSample(z_polygon_sample.second, &z_to_remove);
+    }
+    for (const auto& wall_polygon_sample : wall_polygon_samples_) {
+      appendHistogramSample(wall_polygon_sample.second, &walls_to_remove);
+    }
+    VLOG(10) << "Z histogram: removing " << z_to_remove.rows / 3
+             << " and adding " << z_to_add.rows / 3 << " polygons.";
+    z_hist_.updateHistogram(z_to_add, z_to_remove, FLAGS_log_histogram_1D);
+    VLOG(10) << "2D histogram: removing " << walls_to_remove.rows / 2
+             << " and adding " << walls_to_add.rows / 2 << " polygons.";
+    hist_2d_.updateHistogram(
+        walls_to_add, walls_to_remove, FLAGS_log_histogram_2D);
+    z_polygon_samples_ = std::move(z_polygon_samples);
+    wall_polygon_samples_ = std::move(wall_polygon_samples);
+    moved_histogram_lmk_ids_.clear();
+  } else {
+    VLOG(10) << "Number of polygons potentially on a wall: " << walls.rows;
+  }
 
   // Segment new planes.
   // Currently using lmks that were used by the seed_planes...
   segmentNewPlanes(new_planes, z_components, walls);
 }
 
+/* -------------------------------------------------------------------------- */
+// Flags the lmks of the mesh that are new or that moved further than the
+// tolerance since their polygons were voted in the histograms.
+void Mesher::updateMovedHistogramLmks() {
+  std::unordered_map<LandmarkId, Vertex3D> histogram_lmk_positions;
+  std::unordered_set<LandmarkId> moved_histogram_lmk_ids;
+  Mesh3D::VertexType vertex;
+  for (const LandmarkId& lmk_id : mesh_3d_.getLandmarkIds()) {
+    if (lmk_id == -1) continue;
+    CHECK(mesh_3d_.getVertex(lmk_id, &vertex)) << "Could not retrieve vertex.";
+    const Vertex3D& position = vertex.getVertexPosition();
+    const auto& voted_it = histogram_lmk_positions_.find(lmk_id);
+    if (voted_it == histogram_lmk_positions_.end() ||
+        cv::norm(position - voted_it->second) >
+            FLAGS_incremental_histogram_lmk_tolerance ||
+        moved_histogram_lmk_ids_.count(lmk_id) > 0u) {
+      // Lmks flagged at a previous mesh update are kept until the histograms
+      // are updated.
+      moved_histogram_lmk_ids.insert(lmk_id);
+      histogram_lmk_positions.emplace(lmk_id, position);
+    } else {
+      histogram_lmk_positions.emplace(lmk_id, voted_it->second);
+    }
+  }
+  // Lmks that left the mesh are dropped, and flagged again if they come back.
+  histogram_lmk_positions_ = std::move(histogram_lmk_positions);
+  moved_histogram_lmk_ids_ = std::move(moved_histogram_lmk_ids);
+}
+
 /* -------------------------------------------------------------------------- */
 // Output goes from (-pi to pi], as we are using atan2, which looks at sign
 // of arguments.
@@ -1041,13 +1198,12 @@ void Mesher::segmentNewPlanes(std::vector<Plane>* new_segmented_planes,
   new_segmented_planes->clear();
 
   // Segment horizontal planes.
-  static size_t plane_id = 0;
   static const Plane::Normal vertical(0, 0, 1);
   segmentHorizontalPlanes(
-      new_segmented_planes, &plane_id, vertical, z_components);
+      new_segmented_planes, &next_plane_id_, vertical, z_components);
 
   // Segment vertical planes.
-  segmentWalls(new_segmented_planes, &plane_id, walls);
+  segmentWalls(new_segmented_planes, &next_plane_id_, walls);
 }
 
 /* -------------------------------------------------------------------------- */
@@ -1060,9 +1216,13 @@ void Mesher::segmentWalls(std::vector<Plane>* wall_planes,
   CHECK_NOTNULL(wall_planes);
   CHECK_NOTNULL(plane_id);
   ////////////////////////////// 2D Histogram //////////////////////////////////
-  VLOG(10) << "Starting to calculate 2D histogram...";
-  hist_2d_.calculateHistogram(walls, FLAGS_log_histogram_2D);
-  VLOG(10) << "Finished to calculate 2D histogram.";
+  if (!FLAGS_incremental_plane_histograms) {
+    // Otherwise, the histogram was already updated (and logged) in
+    // segmentPlanesInMesh.
+    VLOG(10) << "Starting to calculate 2D histogram...";
+    hist_2d_.calculateHistogram(walls, FLAGS_log_histogram_2D);
+    VLOG(10) << "Finished to calculate 2D histogram.";
+  }
 
   /// Added by me
   // cv::GaussianBlur(histImg, histImg, cv::Size(9, 9), 0);
@@ -1127,9 +1287,13 @@ void Mesher::segmentHorizontalPlanes(std::vector<Plane>* horizontal_planes,
   CHECK_NOTNULL(horizontal_planes);
   CHECK_NOTNULL(plane_id);
   ////////////////////////////// 1D Histogram //////////////////////////////////
-  VLOG(10) << "Starting calculate 1D histogram.";
-  z_hist_.calculateHistogram(z_components, FLAGS_log_histogram_1D);
-  VLOG(10) << "Finished calculate 1D histogram.";
+  if (!FLAGS_incremental_plane_histograms) {
+    // Otherwise, the histogram was already updated (and logged) in
+    // segmentPlanesInMesh.
+    VLOG(10) << "Starting calculate 1D histogram.";
+    z_hist_.calculateHistogram(z_components, FLAGS_log_histogram_1D);
+    VLOG(10) << "Finished calculate 1D histogram.";
+  }
 
   VLOG(10) << "Starting get local maximum for 1D.";
   static const cv::Size kernel_size(1, FLAGS_z_histogram_gaussian_kernel_size);
@@ -1434,6 +1598,8 @@ void Mesher::updateMesh3D(const PointsWithIdMap& points_with_id_VIO,
   // Calculate 3d mesh normals.
   if (FLAGS_compute_per_vertex_normals) mesh_3d_.computePerVertexNormals();
 
+  if (FLAGS_incremental_plane_histograms) updateMovedHistogramLmks();
+
   VLOG(10) << "Finished updateMesh3D.";
 }
 
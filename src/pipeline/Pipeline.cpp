@@ -41,6 +41,30 @@ DEFINE_bool(extract_planes_from_the_scene,
             "currently only planes.");
 
 DEFINE_bool(visualize, true, "Enable overall visualization.");
+DEFINE_int32(visualizer_type,
+             0,
+             "0: OpenCV, render the visualization in a window.\n"
+             "1: Stream, send the visualization to a viewer process (see "
+             "vizStreamViewer), for headless machines.");
+DEFINE_string(viz_stream_address,
+              "unix:/tmp/kimera_vio_viz.sock",
+              "Where viewers connect to when --visualizer_type=1: "
+              "unix:<path> or tcp:<port>.");
+DEFINE_int32(viz_queue_policy,
+             3,
+             "What to drop when visualization is slower than the estimator:\n"
+             "0: nothing, visualization queues grow unbounded.\n"
+             "1: visualize and display only the latest keyframe.\n"
+             "2: visualize and display at most viz_max_rate_hz keyframes per "
+             "second of data.\n"
+             "3: keep at most viz_max_queue_size inputs, dropping the oldest "
+             "ones, 2D images first.");
+DEFINE_double(viz_max_rate_hz,
+              10.0,
+              "Maximum visualization rate for --viz_queue_policy=2.");
+DEFINE_int32(viz_max_queue_size,
+             5,
+             "Maximum visualization queue size for --viz_queue_policy=3.");
 DEFINE_bool(visualize_lmk_type, false, "Enable landmark type visualization.");
 DEFINE_int32(viz_type,
              0,
@@ -65,9 +89,29 @@ DEFINE_int32(min_num_obs_for_mesher_points,
 DEFINE_bool(use_lcd,
             false,
             "Enable LoopClosureDetector processing in pipeline.");
+DEFINE_bool(imu_rate_odometry,
+            false,
+            "Output odometry at IMU rate by propagating the last backend state "
+            "with the IMU measurements received since.");
 
 namespace VIO {
 
+namespace {
+
+VisualizerQueueParams getVisualizerQueueParams() {
+  CHECK_GE(FLAGS_viz_queue_policy, 0);
+  CHECK_LE(FLAGS_viz_queue_policy, 3);
+  CHECK_GT(FLAGS_viz_max_queue_size, 0);
+  VisualizerQueueParams queue_params;
+  queue_params.policy_ =
+      static_cast<VisualizerQueuePolicy>(FLAGS_viz_queue_policy);
+  queue_params.max_rate_hz_ = FLAGS_viz_max_rate_hz;
+  queue_params.max_queue_size_ = static_cast<size_t>(FLAGS_viz_max_queue_size);
+  return queue_params;
+}
+
+}  // namespace
+
 Pipeline::Pipeline(const VioParams& params,
                    Visualizer3D::UniquePtr&& visualizer,
                    DisplayBase::UniquePtr&& displayer)
@@ -85,7 +129,7 @@ Pipeline::Pipeline(const VioParams& params,
       mesher_module_(nullptr),
       lcd_module_(nullptr),
       visualizer_module_(nullptr),
-      display_input_queue_("display_input_queue"),
+      display_input_queue_("display_input_queue", getVisualizerQueueParams()),
       display_module_(nullptr),
       shutdown_pipeline_cb_(nullptr),
       frontend_thread_(nullptr),
@@ -173,6 +217,26 @@ Pipeline::Pipeline(const VioParams& params,
                 // Send a cref: constant reference bcs updateImuBias is const
                 std::cref(*CHECK_NOTNULL(vio_frontend_module_.get())),
                 std::placeholders::_1));
+  //! The frontend predicts the optical flow from the last keyframe estimate,
+  //! and adapts its feature budget to how far behind the backend is.
+  const StereoVisionFrontEndModule& vio_frontend_module =
+      *CHECK_NOTNULL(vio_frontend_module_.get());
+  vio_backend_module_->registerOutputCallback(
+      [&vio_frontend_module](const BackendOutput::Ptr& output) {
+        CHECK(output);
+        vio_frontend_module.updateBackendState(output->W_State_Blkf_);
+      });
+
+  if (FLAGS_imu_rate_odometry) {
+    imu_odometry_ = VIO::make_unique<ImuOdometry>(
+        params.imu_params_, gtsam::imuBias::ConstantBias());
+    vio_backend_module_->registerOutputCallback(
+        [this](const BackendOutput::Ptr& output) {
+          CHECK(output);
+          CHECK_NOTNULL(imu_odometry_.get())
+              ->updateBackendState(output->W_State_Blkf_);
+        });
+  }
 
   if (static_cast<VisualizationType>(FLAGS_viz_type) ==
       VisualizationType::kMesh2dTo3dSparse) {
@@ -194,6 +258,8 @@ Pipeline::Pipeline(const VioParams& params,
   }
 
   if (FLAGS_visualize) {
+    const VisualizerType visualizer_type =
+        static_cast<VisualizerType>(FLAGS_visualizer_type);
     visualizer_module_ = VIO::make_unique<VisualizerModule>(
         //! Send ouput of visualizer to the display_input_queue_
         &display_input_queue_,
@@ -201,11 +267,12 @@ Pipeline::Pipeline(const VioParams& params,
         // Use given visualizer if any
         visualizer ? std::move(visualizer)
                    : VisualizerFactory::createVisualizer(
-                         VisualizerType::OpenCV,
+                         visualizer_type,
                          // TODO(Toni): bundle these three params in
                          // VisualizerParams...
                          static_cast<VisualizationType>(FLAGS_viz_type),
-                         backend_type_));
+                         backend_type_),
+        getVisualizerQueueParams());
     //! Register input callbacks
     vio_backend_module_->registerOutputCallback(
         std::bind(&VisualizerModule::fillBackendQueue,
@@ -222,16 +289,21 @@ Pipeline::Pipeline(const VioParams& params,
                     std::placeholders::_1));
     }
     //! Actual displaying of visual data is done in the main thread.
+    if (!displayer) {
+      if (visualizer_type == VisualizerType::Stream) {
+        StreamDisplayParams stream_display_params;
+        stream_display_params.address_ = FLAGS_viz_stream_address;
+        displayer = DisplayFactory::makeDisplay(DisplayType::kStream,
+                                                stream_display_params);
+      } else {
+        displayer =
+            DisplayFactory::makeDisplay(DisplayType::kOpenCV,
+                                        std::bind(&Pipeline::shutdown, this),
+                                        OpenCv3dDisplayParams());
+      }
+    }
     display_module_ = VIO::make_unique<DisplayModule>(
-        &display_input_queue_,
-        nullptr,
-        parallel_run_,
-        // Use given displayer if any
-        displayer
-            ? std::move(displayer)
-            : DisplayFactory::makeDisplay(DisplayType::kOpenCV,
-                                          std::bind(&Pipeline::shutdown, this),
-                                          OpenCv3dDisplayParams()));
+        &display_input_queue_, nullptr, parallel_run_, std::move(displayer));
   }
 
   if (FLAGS_use_lcd) {
@@ -239,7 +311,8 @@ Pipeline::Pipeline(const VioParams& params,
         parallel_run_,
         LcdFactory::createLcd(LoopClosureDetectorType::BoW,
                               params.lcd_params_,
-                              FLAGS_log_output));
+                              FLAGS_log_output,
+                              parallel_run_));
     //! Register input callbacks
     vio_backend_module_->registerOutputCallback(
         std::bind(&LcdModule::fillBackendQueue,
@@ -14,7 +14,9 @@
 
 #include "kimera-vio/utils/Histogram.h"
 
+#include <cmath>
 #include <cstddef>  // for nullptr
+#include <unordered_map>
 
 #include <glog/logging.h>
 
@@ -75,12 +77,12 @@ Histogram::~Histogram() {
 // Copy constructor.
 Histogram::Histogram(const Histogram& other) {
   n_images_ = other.n_images_;
+  dims_ = other.dims_;
   channels_ = new int[dims_];
   for (size_t i = 0; i < dims_; i++) {
     *(channels_ + i) = *(other.channels_ + i);
   }
   mask_ = other.mask_;
-  dims_ = other.dims_;
   hist_size_ = new int[dims_];
   for (size_t i = 0; i < dims_; i++) {
     *(hist_size_ + i) = *(other.hist_size_ + i);
@@ -94,6 +96,8 @@ Histogram::Histogram(const Histogram& other) {
   }
   uniform_ = other.uniform_;
   accumulate_ = other.accumulate_;
+  histogram_ = other.histogram_.clone();
+  is_smoothed_histogram_dirty_ = true;
 }
 
 // Copy assignment.
@@ -132,6 +136,8 @@ Histogram& Histogram::operator=(const Histogram& other) {
   ranges_ = tmp_ranges;
   uniform_ = other.uniform_;
   accumulate_ = other.accumulate_;
+  histogram_ = other.histogram_.clone();
+  is_smoothed_histogram_dirty_ = true;
 
   // Return this object.
   return *this;
@@ -140,23 +146,128 @@ Histogram& Histogram::operator=(const Histogram& other) {
 /* -------------------------------------------------------------------------- */
 void Histogram::calculateHistogram(const cv::Mat& input, bool log_histogram) {
   if (dims_ == 1) {
-    static const float* range_hist[] = {ranges_[0]};
+    const float* range_hist[] = {ranges_[0]};
     cv::calcHist(&input, n_images_, channels_, mask_, histogram_, dims_,
                  hist_size_, range_hist, uniform_, accumulate_);
   } else if (dims_ == 2) {
-    static const float* range_hist[] = {ranges_[0], ranges_[1]};
+    const float* range_hist[] = {ranges_[0], ranges_[1]};
     cv::calcHist(&input, n_images_, channels_, mask_, histogram_, dims_,
                  hist_size_, range_hist, uniform_, accumulate_);
   } else {
     LOG(FATAL) << "The histogram is not meant for dim: " << dims_;
   }
+  is_smoothed_histogram_dirty_ = true;
 
-  if (log_histogram) {
-    cv::FileStorage file("histogram_" + std::to_string(dims_) + ".yaml",
-                         cv::FileStorage::WRITE);
-    file << "Histogram";
-    file << histogram_;
+  if (log_histogram) logHistogram();
+}
+
+/* -------------------------------------------------------------------------- */
+bool Histogram::updateHistogram(const cv::Mat& samples_to_add,
+                                const cv::Mat& samples_to_remove,
+                                bool log_histogram) {
+  CHECK(dims_ == 1 || dims_ == 2)
+      << "The histogram is not meant for dim: " << dims_;
+  allocateHistogram();
+
+  // Accumulate the net change per bin first, so that a sample that is removed
+  // and re-added to the same bin does not touch the histogram at all.
+  std::unordered_map<int, float> bin_deltas;
+  const auto accumulate_votes = [this, &bin_deltas](const cv::Mat& samples,
+                                                    const float& vote) {
+    if (samples.empty()) return;
+    CHECK_EQ(samples.depth(), CV_32F);
+    CHECK_EQ(samples.channels() * samples.total() % dims_, 0u);
+    const cv::Mat samples_continuous =
+        samples.isContinuous() ? samples : samples.clone();
+    const float* sample = samples_continuous.ptr<float>();
+    const size_t n_samples =
+        samples_continuous.total() * samples_continuous.channels() / dims_;
+    for (size_t i = 0u; i < n_samples; ++i, sample += dims_) {
+      int bin_idx = 0;
+      if (getBinIdx(sample, &bin_idx)) bin_deltas[bin_idx] += vote;
+    }
+  };
+  accumulate_votes(samples_to_remove, -1.0f);
+  accumulate_votes(samples_to_add, 1.0f);
+
+  bool histogram_changed = false;
+  float* bins = histogram_.ptr<float>();
+  for (const auto& bin_delta : bin_deltas) {
+    if (bin_delta.second != 0.0f) {
+      bins[bin_delta.first] += bin_delta.second;
+      DCHECK_GE(bins[bin_delta.first], 0.0f)
+          << "Removed a sample that was never added to the histogram.";
+      histogram_changed = true;
+    }
   }
+  if (histogram_changed) is_smoothed_histogram_dirty_ = true;
+
+  if (log_histogram) logHistogram();
+  return histogram_changed;
+}
+
+/* -------------------------------------------------------------------------- */
+void Histogram::clearHistogram() {
+  allocateHistogram();
+  histogram_.setTo(0.0f);
+  is_smoothed_histogram_dirty_ = true;
+}
+
+/* -------------------------------------------------------------------------- */
+void Histogram::allocateHistogram() {
+  if (!histogram_.empty()) return;
+  // Same layout as the output of cv::calcHist.
+  if (dims_ == 1) {
+    histogram_ = cv::Mat::zeros(hist_size_[0], 1, CV_32F);
+  } else {
+    histogram_ = cv::Mat::zeros(dims_, hist_size_, CV_32F);
+  }
+  is_smoothed_histogram_dirty_ = true;
+}
+
+/* -------------------------------------------------------------------------- */
+void Histogram::logHistogram() const {
+  cv::FileStorage file("histogram_" + std::to_string(dims_) + ".yaml",
+                       cv::FileStorage::WRITE);
+  file << "Histogram";
+  file << histogram_;
+}
+
+/* -------------------------------------------------------------------------- */
+bool Histogram::getBinIdx(const float* sample, int* bin_idx) const {
+  CHECK_NOTNULL(sample);
+  CHECK_NOTNULL(bin_idx);
+  CHECK(uniform_) << "Incremental updates only support uniform histograms.";
+  *bin_idx = 0;
+  for (int dim = 0; dim < dims_; dim++) {
+    const float& lower = ranges_[dim][0];
+    const float& upper = ranges_[dim][1];
+    // Same convention as cv::calcHist: lower bound inclusive, upper exclusive.
+    if (!(sample[dim] >= lower && sample[dim] < upper)) return false;
+    int bin = static_cast<int>(
+        std::floor((sample[dim] - lower) * hist_size_[dim] / (upper - lower)));
+    bin = std::min(bin, hist_size_[dim] - 1);
+    *bin_idx = *bin_idx * hist_size_[dim] + bin;
+  }
+  return true;
+}
+
+/* -------------------------------------------------------------------------- */
+const cv::Mat& Histogram::getSmoothedHistogram(
+    const cv::Size& smooth_size) const {
+  if (is_smoothed_histogram_dirty_ || smooth_size != smooth_size_) {
+    CHECK_GE(histogram_.rows, smooth_size.height);
+    CHECK_GE(histogram_.cols, smooth_size.width);
+    // cv::GaussianBlur(InputArray src, OutputArray dst, Size ksize,
+    //                 double sigmaX, double sigmaY = 0,
+    //                 int borderType = BORDER_DEFAULT );
+    cv::GaussianBlur(histogram_, histogram_smoothed_, smooth_size, 0);
+    smooth_size_ = smooth_size;
+    is_smoothed_histogram_dirty_ = false;
+  } else {
+    VLOG(10) << "Histogram did not change, re-using smoothed histogram.";
+  }
+  return histogram_smoothed_;
 }
 
 /* -------------------------------------------------------------------------- */
@@ -263,31 +374,32 @@ std::vector<Histogram::PeakInfo> Histogram::findPeaks(cv::InputArray _src,
   CHECK_EQ(dims_, 1) << "This function is meant for 1D histograms.";
   cv::Mat src = _src.getMat();
 
-  cv::Mat slope_mat = src.clone();
-
   // Transform initial matrix into 1channel, and 1 row matrix
-  cv::Mat src2 = src.reshape(1, 1);
+  cv::Mat src2 =
+      src.isContinuous() ? src.reshape(1, 1) : src.clone().reshape(1, 1);
 
   int size = window_size / 2;
 
   Length up_hill, down_hill;
   std::vector<PeakInfo> output;
+  if (src2.cols <= 2 * size) return output;
+
+  // Compute the slope state of the whole histogram at once:
+  // 2 if going up, 1 if going down, 0 if flat.
+  // The slope at i is given by src2(i + size) - src2(i - size).
+  cv::Mat slope;
+  cv::subtract(src2.colRange(2 * size, src2.cols),
+               src2.colRange(0, src2.cols - 2 * size),
+               slope);
+  cv::Mat slope_state = cv::Mat::zeros(slope.size(), CV_8U);
+  slope_state.setTo(2, slope > 0);
+  slope_state.setTo(1, slope < 0);
+  const uchar* states = slope_state.ptr<uchar>();
+  const float* values = src2.ptr<float>();
 
   int pre_state = 0;
-  int i = size;
-
-  while (i < src2.cols - size) {
-    float cur_state = src2.at<float>(i + size) - src2.at<float>(i - size);
-
-    if (cur_state > 0)
-      cur_state = 2;
-    else if (cur_state < 0)
-      cur_state = 1;
-    else
-      cur_state = 0;
-
-    // In case you want to check how the slope looks like
-    slope_mat.at<float>(i) = cur_state;
+  for (int i = size; i < src2.cols - size; i++) {
+    const int cur_state = states[i - size];
 
     if (pre_state == 0 && cur_state == 2) {
       up_hill.pos1 = i;
@@ -300,17 +412,16 @@ std::vector<Histogram::PeakInfo> Histogram::findPeaks(cv::InputArray _src,
         (pre_state == 1 && cur_state == 0)) {
       down_hill.pos2 = i - 1;
       int max_pos = up_hill.pos2;
-      if (src2.at<float>(up_hill.pos2) < src2.at<float>(down_hill.pos1)) {
+      if (values[up_hill.pos2] < values[down_hill.pos1]) {
         max_pos = down_hill.pos1;
       }
 
       PeakInfo peak_info = peakInfo(max_pos, up_hill.size(), down_hill.size(),
-                                    src2.at<float>(max_pos));
+                                    values[max_pos]);
 
       output.push_back(peak_info);
     }
-    i++;
-    pre_state = (int)cur_state;
+    pre_state = cur_state;
   }
   return output;
 }
@@ -325,17 +436,9 @@ std::vector<Histogram::PeakInfo> Histogram::getLocalMaximum1D(
     bool display_histogram, bool log_histogram) const {
   CHECK_EQ(dims_, 1) << "This function is meant for 1D histograms.";
   CHECK_LT(peak_per, 1);
-  VLOG(10) << "Cloning histogram.";
-  cv::Mat src = histogram_.clone();
-
   VLOG(10) << "Adding gaussian blur to histogram.";
   std::vector<PeakInfo> output;
-  CHECK_GE(histogram_.rows, smooth_size.height);
-  CHECK_GE(histogram_.cols, smooth_size.width);
-  // cv::GaussianBlur(InputArray src, OutputArray dst, Size ksize,
-  //                 double sigmaX, double sigmaY = 0,
-  //                 int borderType = BORDER_DEFAULT );
-  cv::GaussianBlur(src, src, smooth_size, 0);
+  const cv::Mat& src = getSmoothedHistogram(smooth_size);
 
   if (log_histogram) {
     cv::FileStorage file(
@@ -363,8 +466,10 @@ std::vector<Histogram::PeakInfo> Histogram::getLocalMaximum1D(
   if (display_histogram) {
     VLOG(10) << "Drawing histogram.";
     int hist_size = histogram_.rows;  // WARNING assumes a 1D Histogram.
+    // drawHistogram1D normalizes the histogram in place, do not modify cache.
+    cv::Mat src_to_draw = src.clone();
     cv::Mat hist_img = drawHistogram1D(
-        &src, 400, 1024,
+        &src_to_draw, 400, 1024,
         hist_size,  // WARNING: this number has to coincide with nr of bins...
         cv::Scalar(255, 255, 255), 2, false);
 
@@ -392,10 +497,8 @@ bool Histogram::getLocalMaximum2D(std::vector<Histogram::PeakInfo2D>* peaks,
   }
 
   VLOG(10) << "Histogram size is: " << histogram_.size;
-  CHECK_GE(histogram_.rows, smooth_size.height);
-  CHECK_GE(histogram_.cols, smooth_size.width);
-  cv::Mat histogram_smoothed;
-  cv::GaussianBlur(histogram_, histogram_smoothed, smooth_size, 0);
+  // imgRegionalMax modifies its input, so work on a copy of the cache.
+  cv::Mat histogram_smoothed = getSmoothedHistogram(smooth_size).clone();
 
   if (log_histogram) {
     cv::FileStorage file(
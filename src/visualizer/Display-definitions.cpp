@@ -38,7 +38,8 @@ WindowData::WindowData()
       mesh_representation_(FLAGS_mesh_representation),
       mesh_shading_(FLAGS_mesh_shading),
       mesh_ambient_(FLAGS_set_mesh_ambient),
-      mesh_lighting_(FLAGS_set_mesh_lighting) {}
+      mesh_lighting_(FLAGS_set_mesh_lighting),
+      freeze_(false) {}
 
 WindowData::~WindowData() {
   // OpenCV 3d Viz has an issue that I can't resolve, it throws a segfault
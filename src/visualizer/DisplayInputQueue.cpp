@@ -0,0 +1,170 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   DisplayInputQueue.cpp
+ * @brief  Display queue that drops inputs when the display is late, so that
+ * visualization never blocks nor grows the memory of the estimator.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/visualizer/DisplayInputQueue.h"
+
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "kimera-vio/utils/UtilsNumerical.h"
+
+namespace VIO {
+
+DisplayInputQueue::DisplayInputQueue(const std::string& queue_id,
+                                     const VisualizerQueueParams& params)
+    : DisplayQueue(queue_id),
+      params_(params),
+      drop_statistics_(),
+      dropped_stats_(queue_id + " Dropped [#]") {
+  if (params_.policy_ == VisualizerQueuePolicy::kMaxRate) {
+    CHECK_GT(params_.max_rate_hz_, 0.0);
+  }
+  if (params_.policy_ == VisualizerQueuePolicy::kPriority) {
+    CHECK_GT(params_.max_queue_size_, 0u);
+  }
+}
+
+DisplayInputQueue::~DisplayInputQueue() {
+  const DropStatistics drop_statistics = getDropStatistics();
+  LOG_IF(INFO, drop_statistics.num_dropped_ > 0u)
+      << "Display was late: dropped " << drop_statistics.num_dropped_
+      << " of the " << drop_statistics.num_received_ << " inputs of "
+      << queue_id_ << ".";
+}
+
+/* -------------------------------------------------------------------------- */
+bool DisplayInputQueue::push(DisplayInputBase::UniquePtr new_value) {
+  if (params_.policy_ == VisualizerQueuePolicy::kUnbounded) {
+    std::unique_lock<std::mutex> lk(mutex_);
+    drop_statistics_.num_received_++;
+    lk.unlock();
+    return DisplayQueue::push(std::move(new_value));
+  }
+
+  if (shutdown_) return false;  // atomic, no lock needed.
+  CHECK(new_value);
+  QueuedInput data = std::make_shared<DisplayInputBase::UniquePtr>(
+      std::move(new_value));
+  std::unique_lock<std::mutex> lk(mutex_);
+  std::vector<QueuedInput> queued;
+  queued.reserve(data_queue_.size() + 1u);
+  while (!data_queue_.empty()) {
+    queued.push_back(data_queue_.front());
+    data_queue_.pop();
+  }
+  queued.push_back(data);
+
+  size_t num_dropped = 0u;
+  switch (params_.policy_) {
+    case VisualizerQueuePolicy::kLatestOnly: {
+      num_dropped = dropAbsorbedByLast(-1, &queued);
+      break;
+    }
+    case VisualizerQueuePolicy::kMaxRate: {
+      num_dropped = dropAbsorbedByLast(
+          UtilsNumerical::SecToNsec(1.0 / params_.max_rate_hz_), &queued);
+      break;
+    }
+    case VisualizerQueuePolicy::kPriority: {
+      num_dropped = dropLowestPriority(&queued);
+      break;
+    }
+    default: {
+      LOG(FATAL) << "Unknown visualizer queue policy: "
+                 << static_cast<int>(params_.policy_);
+    }
+  }
+
+  for (const QueuedInput& input : queued) data_queue_.push(input);
+  const size_t queue_size = data_queue_.size();
+  drop_statistics_.num_received_++;
+  drop_statistics_.num_dropped_ += num_dropped;
+  lk.unlock();  // Unlock before notify.
+  data_cond_.notify_one();
+
+  for (size_t i = 0u; i < num_dropped; i++) dropped_stats_.IncrementOne();
+  VLOG_IF(1, num_dropped > 0u) << "Queue with id: " << queue_id_
+                               << " dropped " << num_dropped
+                               << " inputs, size: " << queue_size;
+  return true;
+}
+
+/* -------------------------------------------------------------------------- */
+DropStatistics DisplayInputQueue::getDropStatistics() const {
+  std::lock_guard<std::mutex> lk(mutex_);
+  return drop_statistics_;
+}
+
+/* -------------------------------------------------------------------------- */
+size_t DisplayInputQueue::dropAbsorbedByLast(
+    const Timestamp& min_period,
+    std::vector<QueuedInput>* queued) const {
+  CHECK_NOTNULL(queued);
+  CHECK(!queued->empty());
+  DisplayInputBase* last = queued->back()->get();
+  CHECK_NOTNULL(last);
+  size_t num_dropped = 0u;
+  // From the newest to the oldest, so that the newest content is kept.
+  for (size_t i = queued->size() - 1u; i-- > 0u;) {
+    DisplayInputBase* older = CHECK_NOTNULL(queued->at(i)->get());
+    const bool is_close =
+        min_period < 0 || last->timestamp_ - older->timestamp_ < min_period;
+    if (is_close && last->absorb(older)) {
+      queued->erase(queued->begin() + i);
+      num_dropped++;
+    }
+  }
+  return num_dropped;
+}
+
+/* -------------------------------------------------------------------------- */
+size_t DisplayInputQueue::dropLowestPriority(
+    std::vector<QueuedInput>* queued) const {
+  CHECK_NOTNULL(queued);
+  size_t num_dropped = 0u;
+  for (const DisplayPriority& priority :
+       {DisplayPriority::kLow, DisplayPriority::kHigh}) {
+    for (size_t i = 0u;
+         i + 1u < queued->size() && queued->size() > params_.max_queue_size_;) {
+      if (queued->at(i)->get()->priority_ == priority &&
+          absorbIntoNewer(i, *queued)) {
+        queued->erase(queued->begin() + i);
+        num_dropped++;
+      } else {
+        i++;
+      }
+    }
+  }
+  VLOG_IF(1, queued->size() > params_.max_queue_size_)
+      << "Queue with id: " << queue_id_ << " has " << queued->size()
+      << " inputs that can not be dropped.";
+  return num_dropped;
+}
+
+/* -------------------------------------------------------------------------- */
+bool DisplayInputQueue::absorbIntoNewer(
+    const size_t& index,
+    const std::vector<QueuedInput>& queued) {
+  CHECK_LT(index, queued.size());
+  DisplayInputBase* older = CHECK_NOTNULL(queued.at(index)->get());
+  for (size_t i = index + 1u; i < queued.size(); i++) {
+    if (queued.at(i)->get()->absorb(older)) return true;
+  }
+  return false;
+}
+
+}  // namespace VIO
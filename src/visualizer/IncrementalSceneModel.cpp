@@ -0,0 +1,323 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   IncrementalSceneModel.cpp
+ * @brief  Keeps track of the geometry shown in the 3D window, to only
+ * re-create the widgets whose geometry changed since the previous keyframe.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/visualizer/IncrementalSceneModel.h"
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+#include <opencv2/viz.hpp>
+
+namespace VIO {
+
+namespace {
+
+const std::string kPointCloudPrefix = "Point cloud#";
+const std::string kMeshPrefix = "Mesh#";
+const std::string kTrajectoryPrefix = "Trajectory#";
+
+template <typename T>
+std::string chunkWidgetId(const std::string& prefix, const T& index) {
+  return prefix + std::to_string(index);
+}
+
+cv::Vec3b toVec3b(const cv::viz::Color& color) {
+  return cv::Vec3b(static_cast<uchar>(color[0]),
+                   static_cast<uchar>(color[1]),
+                   static_cast<uchar>(color[2]));
+}
+
+}  // namespace
+
+IncrementalSceneModel::IncrementalSceneModel(const size_t& chunk_size,
+                                             const float& position_tolerance)
+    : chunk_size_(chunk_size),
+      squared_position_tolerance_(position_tolerance * position_tolerance),
+      point_chunks_(),
+      mesh_chunks_(),
+      trajectory_segments_(),
+      lines_(),
+      removed_widgets_() {
+  CHECK_GT(chunk_size_, 1u);
+  CHECK_GE(position_tolerance, 0.0f);
+}
+
+/* -------------------------------------------------------------------------- */
+void IncrementalSceneModel::updatePointCloud(
+    const PointsWithIdMap& points,
+    const LmkIdToLmkTypeMap& lmk_id_to_lmk_type_map,
+    const cv::viz::Color& color,
+    WidgetsMap* widgets) {
+  CHECK_NOTNULL(widgets);
+  const bool color_the_cloud = !lmk_id_to_lmk_type_map.empty();
+  std::map<int64_t, PointChunk> updated_chunks;
+  for (const std::pair<LandmarkId, gtsam::Point3>& id_point : points) {
+    ColoredPoint point;
+    point.position_ = cv::Point3f(static_cast<float>(id_point.second.x()),
+                                  static_cast<float>(id_point.second.y()),
+                                  static_cast<float>(id_point.second.z()));
+    point.color_ = toVec3b(color);
+    if (color_the_cloud) {
+      const auto& lmk_type = lmk_id_to_lmk_type_map.find(id_point.first);
+      DCHECK(lmk_type != lmk_id_to_lmk_type_map.end());
+      point.color_ = lmk_type != lmk_id_to_lmk_type_map.end() &&
+                             lmk_type->second == LandmarkType::PROJECTION
+                         ? toVec3b(cv::viz::Color::green())
+                         : toVec3b(cv::viz::Color::white());
+    }
+    updated_chunks[chunkIndex(id_point.first)][id_point.first] = point;
+  }
+
+  for (auto& updated_chunk : updated_chunks) {
+    const auto& drawn_chunk = point_chunks_.find(updated_chunk.first);
+    if (drawn_chunk != point_chunks_.end() &&
+        !hasChanged(drawn_chunk->second, updated_chunk.second)) {
+      continue;
+    }
+    const PointChunk& chunk = updated_chunk.second;
+    cv::Mat cloud(1, static_cast<int>(chunk.size()), CV_32FC3);
+    cv::Mat colors(1, static_cast<int>(chunk.size()), CV_8UC3);
+    int i = 0;
+    for (const auto& point : chunk) {
+      cloud.at<cv::Point3f>(0, i) = point.second.position_;
+      colors.at<cv::Vec3b>(0, i) = point.second.color_;
+      i++;
+    }
+    std::unique_ptr<cv::viz::WCloud> cloud_widget =
+        VIO::make_unique<cv::viz::WCloud>(cloud, colors);
+    cloud_widget->setRenderingProperty(cv::viz::POINT_SIZE, 6);
+    (*widgets)[chunkWidgetId(kPointCloudPrefix, updated_chunk.first)] =
+        std::move(cloud_widget);
+    point_chunks_[updated_chunk.first] = std::move(updated_chunk.second);
+  }
+
+  for (auto it = point_chunks_.begin(); it != point_chunks_.end();) {
+    if (updated_chunks.find(it->first) == updated_chunks.end()) {
+      removeWidget(chunkWidgetId(kPointCloudPrefix, it->first));
+      it = point_chunks_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+void IncrementalSceneModel::updateMesh(const cv::Mat& vertices,
+                                       const cv::Mat& colors,
+                                       const cv::Mat& polygons,
+                                       const LandmarkIds& vertex_lmk_ids,
+                                       WidgetsMap* widgets) {
+  CHECK_NOTNULL(widgets);
+  CHECK_EQ(static_cast<size_t>(vertices.rows), vertex_lmk_ids.size());
+  const bool color_mesh = colors.rows != 0;
+  if (color_mesh) CHECK_EQ(vertices.rows, colors.rows);
+
+  std::map<int64_t, MeshChunk> updated_chunks;
+  for (int k = 0; k + 3 < polygons.rows; k += 4) {
+    CHECK_EQ(polygons.at<int32_t>(k), 3) << "Only triangle meshes.";
+    std::array<int32_t, 3> rows;
+    Triangle triangle;
+    for (size_t j = 0u; j < 3u; j++) {
+      rows[j] = polygons.at<int32_t>(k + 1 + static_cast<int>(j));
+      DCHECK_LT(rows[j], vertices.rows);
+      triangle[j] = vertex_lmk_ids[rows[j]];
+    }
+    // Smallest id first, keeping the winding, for triangles to be compared.
+    const size_t first = static_cast<size_t>(
+        std::min_element(triangle.begin(), triangle.end()) - triangle.begin());
+    std::rotate(triangle.begin(), triangle.begin() + first, triangle.end());
+    std::rotate(rows.begin(), rows.begin() + first, rows.end());
+
+    MeshChunk& chunk = updated_chunks[chunkIndex(triangle[0])];
+    chunk.colored_ = color_mesh;
+    chunk.triangles_.insert(triangle);
+    for (size_t j = 0u; j < 3u; j++) {
+      ColoredPoint& vertex = chunk.vertices_[triangle[j]];
+      vertex.position_ = vertices.at<cv::Point3f>(rows[j]);
+      vertex.color_ =
+          color_mesh ? colors.at<cv::Vec3b>(rows[j]) : cv::Vec3b(0, 0, 0);
+    }
+  }
+
+  for (auto& updated_chunk : updated_chunks) {
+    const auto& drawn_chunk = mesh_chunks_.find(updated_chunk.first);
+    if (drawn_chunk != mesh_chunks_.end() &&
+        drawn_chunk->second.colored_ == updated_chunk.second.colored_ &&
+        drawn_chunk->second.triangles_ == updated_chunk.second.triangles_ &&
+        !hasChanged(drawn_chunk->second.vertices_,
+                    updated_chunk.second.vertices_)) {
+      continue;
+    }
+    const MeshChunk& chunk = updated_chunk.second;
+    cv::viz::Mesh cv_mesh;
+    cv_mesh.cloud.create(1, static_cast<int>(chunk.vertices_.size()), CV_32FC3);
+    if (color_mesh) {
+      cv_mesh.colors.create(
+          1, static_cast<int>(chunk.vertices_.size()), CV_8UC3);
+    }
+    std::unordered_map<LandmarkId, int32_t> local_ids;
+    int32_t i = 0;
+    for (const auto& vertex : chunk.vertices_) {
+      cv_mesh.cloud.at<cv::Point3f>(0, i) = vertex.second.position_;
+      if (color_mesh) cv_mesh.colors.at<cv::Vec3b>(0, i) = vertex.second.color_;
+      local_ids[vertex.first] = i++;
+    }
+    cv_mesh.polygons.create(
+        1, 4 * static_cast<int>(chunk.triangles_.size()), CV_32SC1);
+    int32_t* polygon = cv_mesh.polygons.ptr<int32_t>();
+    for (const Triangle& triangle : chunk.triangles_) {
+      *(polygon++) = 3;
+      for (const LandmarkId& lmk_id : triangle) {
+        *(polygon++) = local_ids.at(lmk_id);
+      }
+    }
+    (*widgets)[chunkWidgetId(kMeshPrefix, updated_chunk.first)] =
+        VIO::make_unique<cv::viz::WMesh>(cv_mesh);
+    mesh_chunks_[updated_chunk.first] = std::move(updated_chunk.second);
+  }
+
+  for (auto it = mesh_chunks_.begin(); it != mesh_chunks_.end();) {
+    if (updated_chunks.find(it->first) == updated_chunks.end()) {
+      removeWidget(chunkWidgetId(kMeshPrefix, it->first));
+      it = mesh_chunks_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+void IncrementalSceneModel::updateTrajectory(
+    const std::deque<cv::Affine3d>& poses,
+    const size_t& first_pose_index,
+    WidgetsMap* widgets) {
+  CHECK_NOTNULL(widgets);
+  // Segment s goes from pose s * chunk_size_ to pose (s + 1) * chunk_size_,
+  // so that consecutive segments are connected.
+  std::map<size_t, std::pair<size_t, size_t>> updated_segments;
+  if (!poses.empty()) {
+    const size_t last_pose_index = first_pose_index + poses.size() - 1u;
+    for (size_t s = first_pose_index / chunk_size_;
+         s <= last_pose_index / chunk_size_;
+         s++) {
+      const size_t first = std::max(s * chunk_size_, first_pose_index);
+      const size_t last = std::min((s + 1u) * chunk_size_, last_pose_index);
+      if (last > first) updated_segments[s] = std::make_pair(first, last);
+    }
+  }
+
+  for (const auto& updated_segment : updated_segments) {
+    const auto& drawn_segment =
+        trajectory_segments_.find(updated_segment.first);
+    if (drawn_segment != trajectory_segments_.end() &&
+        drawn_segment->second == updated_segment.second) {
+      continue;
+    }
+    // Poses never change once added, only segments with new (or dropped)
+    // poses are re-drawn.
+    std::vector<cv::Affine3f> trajectory;
+    for (size_t i = updated_segment.second.first;
+         i <= updated_segment.second.second;
+         i++) {
+      trajectory.push_back(poses.at(i - first_pose_index));
+    }
+    (*widgets)[chunkWidgetId(kTrajectoryPrefix, updated_segment.first)] =
+        VIO::make_unique<cv::viz::WTrajectory>(trajectory,
+                                               cv::viz::WTrajectory::PATH,
+                                               1.0,
+                                               cv::viz::Color::red());
+    trajectory_segments_[updated_segment.first] = updated_segment.second;
+  }
+
+  for (auto it = trajectory_segments_.begin();
+       it != trajectory_segments_.end();) {
+    if (updated_segments.find(it->first) == updated_segments.end()) {
+      removeWidget(chunkWidgetId(kTrajectoryPrefix, it->first));
+      it = trajectory_segments_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+void IncrementalSceneModel::updateLine(const std::string& line_id,
+                                       const cv::Point3d& from,
+                                       const cv::Point3d& to,
+                                       WidgetsMap* widgets) {
+  CHECK_NOTNULL(widgets);
+  const auto& drawn_line = lines_.find(line_id);
+  if (drawn_line != lines_.end()) {
+    const cv::Point3d from_diff = from - drawn_line->second.first;
+    const cv::Point3d to_diff = to - drawn_line->second.second;
+    if (from_diff.dot(from_diff) <= squared_position_tolerance_ &&
+        to_diff.dot(to_diff) <= squared_position_tolerance_) {
+      return;
+    }
+  }
+  (*widgets)[line_id] = VIO::make_unique<cv::viz::WLine>(from, to);
+  lines_[line_id] = std::make_pair(from, to);
+}
+
+/* -------------------------------------------------------------------------- */
+void IncrementalSceneModel::clearMesh() {
+  for (const auto& mesh_chunk : mesh_chunks_) {
+    removeWidget(chunkWidgetId(kMeshPrefix, mesh_chunk.first));
+  }
+  mesh_chunks_.clear();
+}
+
+/* -------------------------------------------------------------------------- */
+void IncrementalSceneModel::removeWidget(const std::string& widget_id) {
+  removed_widgets_.push_back(widget_id);
+  lines_.erase(widget_id);
+}
+
+/* -------------------------------------------------------------------------- */
+void IncrementalSceneModel::popRemovedWidgets(
+    std::vector<std::string>* widget_ids) {
+  CHECK_NOTNULL(widget_ids);
+  widget_ids->insert(
+      widget_ids->end(), removed_widgets_.begin(), removed_widgets_.end());
+  removed_widgets_.clear();
+}
+
+/* -------------------------------------------------------------------------- */
+bool IncrementalSceneModel::isMeshWidgetId(const std::string& widget_id) {
+  return widget_id == "Mesh" ||
+         widget_id.compare(0u, kMeshPrefix.size(), kMeshPrefix) == 0;
+}
+
+/* -------------------------------------------------------------------------- */
+bool IncrementalSceneModel::hasChanged(const PointChunk& drawn,
+                                       const PointChunk& updated) const {
+  if (drawn.size() != updated.size()) return true;
+  // Both are sorted by landmark id.
+  for (auto drawn_it = drawn.begin(), updated_it = updated.begin();
+       drawn_it != drawn.end();
+       ++drawn_it, ++updated_it) {
+    if (drawn_it->first != updated_it->first ||
+        drawn_it->second.color_ != updated_it->second.color_) {
+      return true;
+    }
+    const cv::Point3f diff =
+        updated_it->second.position_ - drawn_it->second.position_;
+    if (diff.dot(diff) > squared_position_tolerance_) return true;
+  }
+  return false;
+}
+
+}  // namespace VIO
@@ -21,6 +21,7 @@
 #include <opencv2/opencv.hpp>
 
 #include "kimera-vio/utils/FilesystemUtils.h"
+#include "kimera-vio/visualizer/IncrementalSceneModel.h"
 
 namespace VIO {
 
@@ -30,7 +31,12 @@ OpenCv3dDisplay::OpenCv3dDisplay(
     : DisplayBase(),
       window_data_(),
       shutdown_pipeline_cb_(shutdown_pipeline_cb),
-      params_(params) {
+      params_(params),
+      mesh_widget_ids_(),
+      mesh_representation_shown_(window_data_.mesh_representation_),
+      mesh_shading_shown_(window_data_.mesh_shading_),
+      mesh_ambient_shown_(window_data_.mesh_ambient_),
+      mesh_lighting_shown_(window_data_.mesh_lighting_) {
   if (VLOG_IS_ON(2)) {
     window_data_.window_.setGlobalWarnings(true);
   } else {
@@ -78,10 +84,23 @@ void OpenCv3dDisplay::spin3dWindow(VisualizerOutput::UniquePtr&& viz_output) {
       shutdown_pipeline_cb_();
     }
     // viz_output.window_->spinOnce(1, true);
-    setMeshProperties(&viz_output->widgets_);
+    for (const std::string& widget_id : viz_output->widget_ids_to_remove_) {
+      mesh_widget_ids_.erase(widget_id);
+      try {
+        window_data_.window_.removeWidget(widget_id);
+      } catch (const cv::Exception& e) {
+        VLOG(20) << "Widget with id: " << widget_id
+                 << " is not in window: " << e.what();
+      }
+    }
     const WidgetsMap& widgets = viz_output->widgets_;
+    updateShownMeshProperties(widgets);
     for (auto it = widgets.begin(); it != widgets.end(); ++it) {
       CHECK(it->second);
+      if (IncrementalSceneModel::isMeshWidgetId(it->first)) {
+        setMeshProperties(it->second.get());
+        mesh_widget_ids_.insert(it->first);
+      }
       // This is to go around opencv issue #10829, new opencv should have this
       // fixed.
       it->second->updatePose(cv::Affine3d());
@@ -122,15 +141,33 @@ void OpenCv3dDisplay::setWidgetPose(const std::string& widget_id,
   }
 }
 
-void OpenCv3dDisplay::setMeshProperties(WidgetsMap* widgets) {
-  CHECK_NOTNULL(widgets);
-  static const std::string kMesh = "Mesh";
-  auto mesh_iterator = widgets->find(kMesh);
-  if (mesh_iterator == widgets->end()) {
-    LOG_EVERY_N(WARNING, 100) << "Missing Mesh in visualization's 3D widgets.";
+void OpenCv3dDisplay::updateShownMeshProperties(const WidgetsMap& widgets) {
+  if (mesh_representation_shown_ == window_data_.mesh_representation_ &&
+      mesh_shading_shown_ == window_data_.mesh_shading_ &&
+      mesh_ambient_shown_ == window_data_.mesh_ambient_ &&
+      mesh_lighting_shown_ == window_data_.mesh_lighting_) {
     return;
   }
-  WidgetPtr& mesh_widget = mesh_iterator->second;
+  // Mesh chunks that are not re-drawn keep the properties they were shown
+  // with, update them in the window.
+  for (const std::string& widget_id : mesh_widget_ids_) {
+    if (widgets.find(widget_id) != widgets.end()) continue;
+    try {
+      cv::viz::Widget mesh_widget = window_data_.window_.getWidget(widget_id);
+      setMeshProperties(&mesh_widget);
+    } catch (const cv::Exception& e) {
+      VLOG(20) << "Widget with id: " << widget_id
+               << " is not in window: " << e.what();
+    }
+  }
+  mesh_representation_shown_ = window_data_.mesh_representation_;
+  mesh_shading_shown_ = window_data_.mesh_shading_;
+  mesh_ambient_shown_ = window_data_.mesh_ambient_;
+  mesh_lighting_shown_ = window_data_.mesh_lighting_;
+}
+
+void OpenCv3dDisplay::setMeshProperties(cv::viz::Widget* mesh_widget) {
+  CHECK_NOTNULL(mesh_widget);
   // Decide mesh shading style.
   switch (window_data_.mesh_shading_) {
     case 0: {
@@ -199,11 +236,10 @@ void OpenCv3dDisplay::toggleFreezeScreenKeyboardCallback(
   CHECK_NOTNULL(window_data);
   if (code == 't') {
     LOG(WARNING) << "Pressing " << code << " toggles freezing screen.";
-    static bool freeze = false;
-    freeze = !freeze;  // Toggle.
+    window_data->freeze_ = !window_data->freeze_;  // Toggle.
     window_data->window_.spinOnce(1, true);
     while (!window_data->window_.wasStopped()) {
-      if (freeze) {
+      if (window_data->freeze_) {
         window_data->window_.spinOnce(1, true);
       } else {
         break;
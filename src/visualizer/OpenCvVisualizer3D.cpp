@@ -18,6 +18,7 @@
 #include <memory>         // for shared_ptr<>
 #include <string>         // for string
 #include <unordered_map>  // for unordered_map<>
+#include <unordered_set>  // for unordered_set<>
 #include <utility>        // for pair<>
 #include <vector>         // for vector<>
 
@@ -77,12 +78,32 @@ DEFINE_int32(displayed_trajectory_length,
              50,
              "Set length of plotted trajectory."
              "If -1 then all the trajectory is plotted.");
+DEFINE_bool(visualize_incrementally,
+            true,
+            "Split the point cloud, mesh and trajectory in chunks and only "
+            "re-draw the chunks that changed since the last keyframe.");
 
 namespace VIO {
 
 OpenCvVisualizer3D::OpenCvVisualizer3D(const VisualizationType& viz_type,
                                        const BackendType& backend_type)
-    : Visualizer3D(viz_type), backend_type_(backend_type), logger_(nullptr) {
+    : Visualizer3D(viz_type),
+      backend_type_(backend_type),
+      trajectory_poses_3d_(),
+      num_poses_dropped_(0u),
+      scene_model_(),
+      planes_prev_(),
+      points_with_id_VIO_prev_(),
+      lmk_id_to_lmk_type_map_prev_(),
+      vertices_mesh_prev_(),
+      polygons_mesh_prev_(),
+      vertex_lmk_ids_prev_(),
+      mesh_3d_viz_props_prev_(),
+      ply_mesh_visualized_(false),
+      plane_label_offset_(0.0),
+      point_cloud_id_(0u),
+      last_logged_mesh_timestamp_(0),
+      logger_(nullptr) {
   if (FLAGS_log_mesh) {
     logger_ = VIO::make_unique<VisualizerLogger>();
   }
@@ -100,6 +121,7 @@ VisualizerOutput::UniquePtr OpenCvVisualizer3D::spinOnce(
   DCHECK(input.backend_output_);
 
   VisualizerOutput::UniquePtr output = VIO::make_unique<VisualizerOutput>();
+  output->timestamp_ = input.timestamp_;
 
   // Ensure we have mesher output if the user requested mesh visualization
   // otherwise, switch to pointcloud visualization.
@@ -142,13 +164,6 @@ VisualizerOutput::UniquePtr OpenCvVisualizer3D::spinOnce(
       // 3D mesh visualization
       VLOG(10) << "Starting 3D mesh visualization...";
 
-      static std::vector<Plane> planes_prev;
-      static PointsWithIdMap points_with_id_VIO_prev;
-      static LmkIdToLmkTypeMap lmk_id_to_lmk_type_map_prev;
-      static cv::Mat vertices_mesh_prev;
-      static cv::Mat polygons_mesh_prev;
-      static Mesh3DVizProperties mesh_3d_viz_props_prev;
-
       if (FLAGS_visualize_mesh) {
         VLOG(10) << "Visualize mesh.";
         if (FLAGS_visualize_semantic_mesh) {
@@ -158,48 +173,48 @@ VisualizerOutput::UniquePtr OpenCvVisualizer3D::spinOnce(
                  "visualize_mesh_with_colored_polygon_cluster are set to True,"
                  " but visualization of the semantic mesh has priority over "
                  "visualization of the polygon clusters.";
-          visualizeMesh3D(vertices_mesh_prev,
-                          mesh_3d_viz_props_prev.colors_,
-                          polygons_mesh_prev,
+          visualizeMesh3D(vertices_mesh_prev_,
+                          mesh_3d_viz_props_prev_.colors_,
+                          polygons_mesh_prev_,
                           &output->widgets_,
-                          mesh_3d_viz_props_prev.tcoords_,
-                          mesh_3d_viz_props_prev.texture_);
+                          mesh_3d_viz_props_prev_.tcoords_,
+                          mesh_3d_viz_props_prev_.texture_,
+                          vertex_lmk_ids_prev_);
         } else {
           VLOG(10) << "Visualize mesh with colored clusters.";
-          LOG_IF(ERROR, mesh_3d_viz_props_prev.colors_.rows > 0u)
+          LOG_IF(ERROR, mesh_3d_viz_props_prev_.colors_.rows > 0u)
               << "The 3D mesh is being colored with semantic information, but"
                  " gflag visualize_semantic_mesh is set to false...";
           visualizeMesh3DWithColoredClusters(
-              planes_prev,
-              vertices_mesh_prev,
-              polygons_mesh_prev,
+              planes_prev_,
+              vertices_mesh_prev_,
+              polygons_mesh_prev_,
               &output->widgets_,
               FLAGS_visualize_mesh_with_colored_polygon_clusters,
-              input.timestamp_);
+              input.timestamp_,
+              vertex_lmk_ids_prev_);
         }
       }
 
       if (FLAGS_visualize_point_cloud) {
-        visualizePoints3D(points_with_id_VIO_prev,
-                          lmk_id_to_lmk_type_map_prev,
+        visualizePoints3D(points_with_id_VIO_prev_,
+                          lmk_id_to_lmk_type_map_prev_,
                           &output->widgets_);
       }
 
       if (!FLAGS_visualize_load_mesh_filename.empty()) {
-        // TODO(Toni): remove static, never use static wo const/constexpr
-        static bool visualize_ply_mesh_once = true;
-        if (visualize_ply_mesh_once) {
+        if (!ply_mesh_visualized_) {
           visualizePlyMesh(FLAGS_visualize_load_mesh_filename.c_str(),
                            &output->widgets_);
-          visualize_ply_mesh_once = false;
+          ply_mesh_visualized_ = true;
         }
       }
 
       if (FLAGS_visualize_convex_hull) {
-        if (planes_prev.size() != 0) {
-          visualizeConvexHull(planes_prev.at(0).triangle_cluster_,
-                              vertices_mesh_prev,
-                              polygons_mesh_prev,
+        if (planes_prev_.size() != 0) {
+          visualizeConvexHull(planes_prev_.at(0).triangle_cluster_,
+                              vertices_mesh_prev_,
+                              polygons_mesh_prev_,
                               &output->widgets_);
         }
       }
@@ -294,7 +309,7 @@ VisualizerOutput::UniquePtr OpenCvVisualizer3D::spinOnce(
         }
 
         // Also remove planes that were deleted by the backend...
-        for (const Plane& plane : planes_prev) {
+        for (const Plane& plane : planes_prev_) {
           const gtsam::Symbol& plane_symbol = plane.getPlaneSymbol();
           const std::uint64_t& plane_index = plane_symbol.index();
           gtsam::OrientedPlane3 current_plane_estimate;
@@ -311,15 +326,16 @@ VisualizerOutput::UniquePtr OpenCvVisualizer3D::spinOnce(
         }
       }
 
-      planes_prev = input.mesher_output_->planes_;
-      vertices_mesh_prev = input.mesher_output_->vertices_mesh_;
-      polygons_mesh_prev = input.mesher_output_->polygons_mesh_;
-      points_with_id_VIO_prev = input.backend_output_->landmarks_with_id_map_;
-      lmk_id_to_lmk_type_map_prev =
+      planes_prev_ = input.mesher_output_->planes_;
+      vertices_mesh_prev_ = input.mesher_output_->vertices_mesh_;
+      polygons_mesh_prev_ = input.mesher_output_->polygons_mesh_;
+      vertex_lmk_ids_prev_ = input.mesher_output_->mesh_3d_.getLandmarkIds();
+      points_with_id_VIO_prev_ = input.backend_output_->landmarks_with_id_map_;
+      lmk_id_to_lmk_type_map_prev_ =
           input.backend_output_->lmk_id_to_lmk_type_map_;
       LOG_IF(WARNING, mesh3d_viz_properties_callback_)
           << "Coloring the mesh using semantic segmentation colors.";
-      mesh_3d_viz_props_prev =
+      mesh_3d_viz_props_prev_ =
           // Call semantic mesh segmentation if someone registered a callback.
           mesh3d_viz_properties_callback_
               ? mesh3d_viz_properties_callback_(left_stereo_keyframe.timestamp_,
@@ -368,6 +384,9 @@ VisualizerOutput::UniquePtr OpenCvVisualizer3D::spinOnce(
       &output->widgets_);
   VLOG(10) << "Finished trajectory visualization.";
 
+  // Chunks and lines that are gone since the last keyframe.
+  scene_model_.popRemovedWidgets(&output->widget_ids_to_remove_);
+
   return output;
 }
 
@@ -467,6 +486,12 @@ void OpenCvVisualizer3D::visualizePoints3D(
     const LmkIdToLmkTypeMap& lmk_id_to_lmk_type_map,
     WidgetsMap* widgets_map) {
   CHECK(widgets_map);
+  if (FLAGS_visualize_incrementally) {
+    scene_model_.updatePointCloud(
+        points_with_id, lmk_id_to_lmk_type_map, cloud_color_, widgets_map);
+    return;
+  }
+
   bool color_the_cloud = false;
   if (lmk_id_to_lmk_type_map.size() != 0) {
     color_the_cloud = true;
@@ -546,10 +571,9 @@ void OpenCvVisualizer3D::visualizePlane(const PlaneId& plane_index,
   getColorById(cluster_id, &plane_color);
 
   if (visualize_plane_label) {
-    static double increase = 0.0;
     const cv::Point3d text_position(
-        d * n_x, d * n_y, d * n_z + std::fmod(increase, 1));
-    increase += 0.1;
+        d * n_x, d * n_y, d * n_z + std::fmod(plane_label_offset_, 1));
+    plane_label_offset_ += 0.1;
     (*widgets)[plane_id_for_viz + "_label"] =
         VIO::make_unique<cv::viz::WText3D>(
             plane_id_for_viz, text_position, 0.07, true);
@@ -581,16 +605,23 @@ void OpenCvVisualizer3D::drawLine(const std::string& line_id,
                                   const cv::Point3d& pt2,
                                   WidgetsMap* widgets) {
   CHECK_NOTNULL(widgets);
-  (*widgets)[line_id] = VIO::make_unique<cv::viz::WLine>(pt1, pt2);
+  scene_model_.updateLine(line_id, pt1, pt2, widgets);
 }
 
 /* -------------------------------------------------------------------------- */
 // Visualize a 3D point cloud of unique 3D landmarks with its connectivity.
 void OpenCvVisualizer3D::visualizeMesh3D(const cv::Mat& map_points_3d,
                                          const cv::Mat& polygons_mesh,
-                                         WidgetsMap* widgets) {
+                                         WidgetsMap* widgets,
+                                         const LandmarkIds& vertex_lmk_ids) {
   cv::Mat colors(0, 1, CV_8UC3, cv::viz::Color::gray());  // Do not color mesh.
-  visualizeMesh3D(map_points_3d, colors, polygons_mesh, widgets);
+  visualizeMesh3D(map_points_3d,
+                  colors,
+                  polygons_mesh,
+                  widgets,
+                  cv::Mat(),
+                  cv::Mat(),
+                  vertex_lmk_ids);
 }
 
 /* -------------------------------------------------------------------------- */
@@ -601,7 +632,8 @@ void OpenCvVisualizer3D::visualizeMesh3D(const cv::Mat& map_points_3d,
                                          const cv::Mat& polygons_mesh,
                                          WidgetsMap* widgets,
                                          const cv::Mat& tcoords,
-                                         const cv::Mat& texture) {
+                                         const cv::Mat& texture,
+                                         const LandmarkIds& vertex_lmk_ids) {
   CHECK_NOTNULL(widgets);
   // Check data
   bool color_mesh = false;
@@ -620,6 +652,15 @@ void OpenCvVisualizer3D::visualizeMesh3D(const cv::Mat& map_points_3d,
     CHECK(!texture.empty());
   }
 
+  // Textures are not split in chunks, the whole mesh is drawn at once then.
+  if (FLAGS_visualize_incrementally && texture.empty() &&
+      !vertex_lmk_ids.empty()) {
+    scene_model_.updateMesh(
+        map_points_3d, colors, polygons_mesh, vertex_lmk_ids, widgets);
+    return;
+  }
+  scene_model_.clearMesh();
+
   // No points/mesh to visualize.
   if (map_points_3d.rows == 0 || polygons_mesh.rows == 0) {
     return;
@@ -691,10 +732,9 @@ void OpenCvVisualizer3D::visualizePointCloud(const cv::Mat& point_cloud,
   cloud_widget->setRenderingProperty(cv::viz::POINT_SIZE, 2);
 
   // Send to maps
-  static size_t pcl_id = 0u;
-  (*widgets)["3D Point Cloud " + std::to_string(pcl_id)] =
+  (*widgets)["3D Point Cloud " + std::to_string(point_cloud_id_)] =
       std::move(cloud_widget);
-  pcl_id++;
+  point_cloud_id_++;
 }
 
 void OpenCvVisualizer3D::visualizeGlobalFrameOfReference(WidgetsMap* widgets,
@@ -723,13 +763,20 @@ void OpenCvVisualizer3D::visualizeMesh3DWithColoredClusters(
     const cv::Mat& polygons_mesh,
     WidgetsMap* widgets,
     const bool visualize_mesh_with_colored_polygon_clusters,
-    const Timestamp& timestamp) {
+    const Timestamp& timestamp,
+    const LandmarkIds& vertex_lmk_ids) {
   if (visualize_mesh_with_colored_polygon_clusters) {
     // Color the mesh.
     cv::Mat colors;
     colorMeshByClusters(planes, map_points_3d, polygons_mesh, &colors);
     // Visualize the colored mesh.
-    visualizeMesh3D(map_points_3d, colors, polygons_mesh, widgets);
+    visualizeMesh3D(map_points_3d,
+                    colors,
+                    polygons_mesh,
+                    widgets,
+                    cv::Mat(),
+                    cv::Mat(),
+                    vertex_lmk_ids);
     // Log the mesh.
     if (FLAGS_log_mesh) {
       logMesh(map_points_3d,
@@ -740,7 +787,7 @@ void OpenCvVisualizer3D::visualizeMesh3DWithColoredClusters(
     }
   } else {
     // Visualize the mesh with same colour.
-    visualizeMesh3D(map_points_3d, polygons_mesh, widgets);
+    visualizeMesh3D(map_points_3d, polygons_mesh, widgets, vertex_lmk_ids);
   }
 }
 
@@ -871,6 +918,12 @@ void OpenCvVisualizer3D::visualizeTrajectory3D(WidgetsMap* widgets_map) {
     return;
   }
 
+  if (FLAGS_visualize_incrementally) {
+    scene_model_.updateTrajectory(
+        trajectory_poses_3d_, num_poses_dropped_, widgets_map);
+    return;
+  }
+
   // Create a Trajectory widget. (argument can be PATH, FRAMES, BOTH).
   std::vector<cv::Affine3f> trajectory;
   trajectory.reserve(trajectory_poses_3d_.size());
@@ -926,19 +979,10 @@ void OpenCvVisualizer3D::visualizePoseWithImgInFrustum(
 /* -------------------------------------------------------------------------- */
 // Remove widget. True if successful, false if not.
 bool OpenCvVisualizer3D::removeWidget(const std::string& widget_id) {
-  try {
-    // window_data_.window_.removeWidget(widget_id);
-    return true;
-  } catch (const cv::Exception& e) {
-    VLOG(20) << e.what();
-    LOG(ERROR) << "Widget with id: " << widget_id.c_str()
-               << " is not in window.";
-  } catch (...) {
-    LOG(ERROR) << "Unrecognized exception when using "
-                  "window_data_.window_.removeWidget() "
-               << "with widget with id: " << widget_id.c_str();
-  }
-  return false;
+  // The window belongs to the display, which removes the widget when it
+  // receives the visualizer output.
+  scene_model_.removeWidget(widget_id);
+  return true;
 }
 
 /* -------------------------------------------------------------------------- */
@@ -1021,14 +1065,15 @@ void OpenCvVisualizer3D::visualizePlaneConstraints(const PlaneId& plane_id,
 // Remove line widgets from plane to lmks, for lines that are not pointing
 // to any lmk_id in lmk_ids.
 void OpenCvVisualizer3D::removeOldLines(const LandmarkIds& lmk_ids) {
+  const std::unordered_set<LandmarkId> lmk_ids_set(lmk_ids.begin(),
+                                                   lmk_ids.end());
   for (PlaneIdMap::value_type& plane_id_pair : plane_id_map_) {
     LmkIdToLineIdMap& lmk_id_to_line_id_map = plane_id_pair.second;
     for (LmkIdToLineIdMap::iterator lmk_id_to_line_id_it =
              lmk_id_to_line_id_map.begin();
          lmk_id_to_line_id_it != lmk_id_to_line_id_map.end();) {
-      if (std::find(lmk_ids.begin(),
-                    lmk_ids.end(),
-                    lmk_id_to_line_id_it->first) == lmk_ids.end()) {
+      if (lmk_ids_set.find(lmk_id_to_line_id_it->first) ==
+          lmk_ids_set.end()) {
         // We did not find the lmk_id of the current line in the list
         // of lmk_ids...
         // Delete the corresponding line.
@@ -1105,6 +1150,7 @@ void OpenCvVisualizer3D::addPoseToTrajectory(const cv::Affine3d& pose) {
   if (FLAGS_displayed_trajectory_length > 0) {
     while (trajectory_poses_3d_.size() > FLAGS_displayed_trajectory_length) {
       trajectory_poses_3d_.pop_front();
+      num_poses_dropped_++;
     }
   }
 }
@@ -1216,16 +1262,18 @@ void OpenCvVisualizer3D::logMesh(const cv::Mat& map_points_3d,
                                  const Timestamp& timestamp,
                                  bool log_accumulated_mesh) {
   /// Log the mesh in a ply file.
-  static Timestamp last_timestamp = timestamp;
-  static const Timestamp first_timestamp = timestamp;
-  if ((timestamp - last_timestamp) >
+  if (last_logged_mesh_timestamp_ == 0) {
+    last_logged_mesh_timestamp_ = timestamp;
+  }
+  if ((timestamp - last_logged_mesh_timestamp_) >
       6500000000) {  // Log every 6 seconds approx. (a little bit more than
                      // time-horizon)
-    LOG(WARNING) << "Logging mesh every (ns) = " << timestamp - last_timestamp;
+    LOG(WARNING) << "Logging mesh every (ns) = "
+                 << timestamp - last_logged_mesh_timestamp_;
     CHECK(logger_);
     logger_->logMesh(
         map_points_3d, colors, polygons_mesh, timestamp, log_accumulated_mesh);
-    last_timestamp = timestamp;
+    last_logged_mesh_timestamp_ = timestamp;
   }
 }
 
@@ -1320,7 +1368,7 @@ void OpenCvVisualizer3D::updateLineFromPlaneToPoint(const std::string& line_id,
                                                     const double& point_y,
                                                     const double& point_z,
                                                     WidgetsMap* widgets) {
-  removeWidget(line_id);
+  // Only re-drawn if it moved, see IncrementalSceneModel::updateLine.
   drawLineFromPlaneToPoint(line_id,
                            plane_n_x,
                            plane_n_y,
@@ -0,0 +1,58 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   StreamDisplay.cpp
+ * @brief  Headless display that streams the output of the StreamVisualizer3D
+ * to viewers connected over a Unix or TCP socket.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/visualizer/StreamDisplay.h"
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+StreamDisplay::StreamDisplay(const StreamDisplayParams& params)
+    : DisplayBase(),
+      params_(params),
+      server_(params.address_, params.max_pending_bytes_),
+      state_(params.max_trajectory_length_) {}
+
+/* -------------------------------------------------------------------------- */
+void StreamDisplay::spinOnce(DisplayInputBase::UniquePtr&& display_input) {
+  CHECK(display_input);
+  const StreamVisualizerOutput* stream_output =
+      dynamic_cast<const StreamVisualizerOutput*>(display_input.get());
+  if (!stream_output) {
+    VLOG(5) << "Display input is not a StreamVisualizerOutput, the "
+            << display_input->images_to_display_.size()
+            << " images in it are not streamed.";
+    return;
+  }
+
+  // Keep track of the scene even without viewers, for the ones to come.
+  const VizStreamMessage& message = stream_output->message_;
+  state_.apply(message);
+
+  const bool needs_snapshot = server_.acceptClients();
+  if (server_.numClients() == 0u) return;
+
+  std::string delta;
+  message.serialize(&delta);
+  std::string snapshot;
+  if (needs_snapshot) {
+    VizStreamMessage snapshot_message;
+    state_.snapshot(&snapshot_message);
+    snapshot_message.serialize(&snapshot);
+  }
+  server_.broadcast(delta, snapshot);
+}
+
+}  // namespace VIO
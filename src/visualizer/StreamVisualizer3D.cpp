@@ -0,0 +1,103 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   StreamVisualizer3D.cpp
+ * @brief  Headless visualizer: instead of building widgets, it computes what
+ * changed in the scene since the last keyframe, to be streamed to a viewer.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/visualizer/StreamVisualizer3D.h"
+
+#include <set>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kimera-vio/utils/Timer.h"
+
+DEFINE_double(viz_stream_position_tolerance,
+              0.005,
+              "Landmarks and mesh vertices that moved less than this (in "
+              "meters) are not streamed again.");
+
+namespace VIO {
+
+StreamVisualizer3D::StreamVisualizer3D(const VisualizationType& viz_type)
+    : Visualizer3D(viz_type), sent_state_(1) {}
+
+/* -------------------------------------------------------------------------- */
+VisualizerOutput::UniquePtr StreamVisualizer3D::spinOnce(
+    const VisualizerInput& input) {
+  DCHECK(input.backend_output_);
+  auto tic = utils::Timer::tic();
+
+  // Same fallback as the OpenCV visualizer.
+  if (visualization_type_ == VisualizationType::kMesh2dTo3dSparse &&
+      !input.mesher_output_) {
+    LOG(ERROR) << "Mesh visualization requested, but no "
+                  "mesher output available. Switching to Pointcloud"
+                  "visualization only.";
+    visualization_type_ = VisualizationType::kPointcloud;
+  }
+
+  StreamVisualizerOutput::UniquePtr output =
+      VIO::make_unique<StreamVisualizerOutput>();
+  output->timestamp_ = input.timestamp_;
+  output->visualization_type_ = visualization_type_;
+
+  VizStreamPoints landmarks;
+  if (visualization_type_ != VisualizationType::kNone) {
+    const PointsWithIdMap& points_with_id =
+        input.backend_output_->landmarks_with_id_map_;
+    landmarks.reserve(points_with_id.size());
+    for (const auto& point : points_with_id) {
+      landmarks[point.first] = cv::Point3f(point.second.x(),
+                                           point.second.y(),
+                                           point.second.z());
+    }
+  }
+
+  VizStreamPoints vertices;
+  std::set<VizStreamTriangle> triangles;
+  if (visualization_type_ == VisualizationType::kMesh2dTo3dSparse) {
+    const Mesh3D& mesh = input.mesher_output_->mesh_3d_;
+    Mesh3D::Polygon polygon;
+    for (size_t i = 0u; i < mesh.getNumberOfPolygons(); i++) {
+      CHECK(mesh.getPolygon(i, &polygon)) << "Could not retrieve polygon.";
+      CHECK_EQ(polygon.size(), 3u) << "Only triangle meshes are streamed.";
+      VizStreamTriangle triangle;
+      for (size_t j = 0u; j < 3u; j++) {
+        triangle[j] = polygon[j].getLmkId();
+        vertices[triangle[j]] = polygon[j].getVertexPosition();
+      }
+      triangles.insert(VizStreamState::canonicalTriangle(triangle));
+    }
+  }
+
+  sent_state_.computeDelta(
+      input.timestamp_,
+      VizStreamPose(input.timestamp_,
+                    input.backend_output_->W_State_Blkf_.pose_),
+      landmarks,
+      vertices,
+      triangles,
+      static_cast<float>(FLAGS_viz_stream_position_tolerance),
+      &output->message_);
+  sent_state_.apply(output->message_);
+
+  VLOG(10) << "Visualization delta: " << output->message_.landmarks_.size()
+           << " landmarks, " << output->message_.vertices_.size()
+           << " vertices and " << output->message_.triangles_.size()
+           << " triangles, computed in " << utils::Timer::toc(tic).count()
+           << " ms.";
+  return std::move(output);
+}
+
+}  // namespace VIO
@@ -14,6 +14,7 @@
 
 #include "kimera-vio/visualizer/Visualizer3DFactory.h"
 #include "kimera-vio/visualizer/OpenCvVisualizer3D.h"
+#include "kimera-vio/visualizer/StreamVisualizer3D.h"
 
 namespace VIO {
 
@@ -25,10 +26,13 @@ Visualizer3D::UniquePtr VisualizerFactory::createVisualizer(
     case VisualizerType::OpenCV: {
       return VIO::make_unique<OpenCvVisualizer3D>(viz_type, backend_type);
     }
+    case VisualizerType::Stream: {
+      return VIO::make_unique<StreamVisualizer3D>(viz_type);
+    }
     default: {
       LOG(FATAL) << "Requested visualizer type is not supported.\n"
                  << "Currently supported visualizer types:\n"
-                 << "0: OpenCV 3D viz\n 1: Pangolin (not supported yet)\n"
+                 << "0: OpenCV 3D viz\n 1: Stream to a viewer process\n"
                  << " but requested visualizer: "
                  << static_cast<int>(visualizer_type);
     }
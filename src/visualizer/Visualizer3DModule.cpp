@@ -14,21 +14,36 @@
 
 #include "kimera-vio/visualizer/Visualizer3DModule.h"
 
+#include <limits>
 #include <string>
 #include <utility>
 
+#include "kimera-vio/utils/UtilsNumerical.h"
+
 namespace VIO {
 
 VisualizerModule::VisualizerModule(OutputQueue* output_queue,
                                    bool parallel_run,
-                                   Visualizer3D::UniquePtr visualizer)
+                                   Visualizer3D::UniquePtr visualizer,
+                                   const VisualizerQueueParams& queue_params)
     : MISOPipelineModule<VisualizerInput, DisplayInputBase>(output_queue,
                                                             "Visualizer",
                                                             parallel_run),
       frontend_queue_("visualizer_frontend_queue"),
       backend_queue_("visualizer_backend_queue"),
       mesher_queue_(nullptr),
-      visualizer_(std::move(visualizer)) {
+      visualizer_(std::move(visualizer)),
+      queue_params_(queue_params),
+      next_timestamp_(std::numeric_limits<Timestamp>::min()),
+      num_received_(0u),
+      num_dropped_(0u),
+      dropped_stats_("Visualizer Dropped Keyframes [#]") {
+  if (queue_params_.policy_ == VisualizerQueuePolicy::kMaxRate) {
+    CHECK_GT(queue_params_.max_rate_hz_, 0.0);
+  }
+  if (queue_params_.policy_ == VisualizerQueuePolicy::kPriority) {
+    CHECK_GT(queue_params_.max_queue_size_, 0u);
+  }
   if (visualizer_->visualization_type_ ==
       VisualizationType::kMesh2dTo3dSparse) {
     // Activate mesher queue if we are going to visualize the mesh.
@@ -37,6 +52,12 @@ VisualizerModule::VisualizerModule(OutputQueue* output_queue,
   }
 }
 
+VisualizerModule::~VisualizerModule() {
+  LOG_IF(INFO, num_dropped_ > 0u)
+      << "Visualizer was late: skipped " << num_dropped_ << " of the "
+      << num_received_ << " keyframes.";
+}
+
 void VisualizerModule::fillMesherQueue(const VizMesherInput& mesher_payload) {
   CHECK(mesher_queue_)
       << "Filling mesher queue without mesher_queue_ being "
@@ -66,6 +87,38 @@ VisualizerModule::InputUniquePtr VisualizerModule::getInputPacket() {
   }
 
   CHECK(backend_payload);
+  num_received_++;
+
+  // Skip the keyframes that the queue policy drops, with their frontend and
+  // mesher payloads, so that no queue grows while visualization is late.
+  // A keyframe is only dropped once a newer one is queued: otherwise, it is
+  // visualized instead of waiting for the next one.
+  while (dropInput(backend_payload)) {
+    VizBackendInput next_backend_payload = nullptr;
+    if (!backend_queue_.pop(next_backend_payload)) break;
+    CHECK(next_backend_payload);
+    num_received_++;
+
+    VizFrontendInput dropped_frontend_payload = nullptr;
+    PIO::syncQueue(backend_payload->timestamp_,
+                   &frontend_queue_,
+                   &dropped_frontend_payload);
+    if (mesher_queue_) {
+      VizMesherInput dropped_mesher_payload = nullptr;
+      PIO::syncQueue(backend_payload->timestamp_,
+                     mesher_queue_.get(),
+                     &dropped_mesher_payload);
+    }
+    num_dropped_++;
+    dropped_stats_.IncrementOne();
+    VLOG(5) << "Visualizer dropped keyframe: " << backend_payload->timestamp_;
+    backend_payload = next_backend_payload;
+  }
+  if (queue_params_.policy_ == VisualizerQueuePolicy::kMaxRate) {
+    next_timestamp_ =
+        backend_payload->timestamp_ +
+        UtilsNumerical::SecToNsec(1.0 / queue_params_.max_rate_hz_);
+  }
   const Timestamp& timestamp = backend_payload->timestamp_;
 
   // Look for the synchronized packet in frontend payload queue
@@ -104,6 +157,37 @@ void VisualizerModule::shutdownQueues() {
   MISO::shutdownQueues();
 }
 
+bool VisualizerModule::dropInput(const VizBackendInput& backend_payload) const {
+  CHECK(backend_payload);
+  switch (queue_params_.policy_) {
+    case VisualizerQueuePolicy::kUnbounded: {
+      return false;
+    }
+    case VisualizerQueuePolicy::kLatestOnly: {
+      return !backend_queue_.empty();
+    }
+    case VisualizerQueuePolicy::kMaxRate: {
+      return backend_payload->timestamp_ < next_timestamp_;
+    }
+    case VisualizerQueuePolicy::kPriority: {
+      // All keyframes have the same priority, keep the most recent ones.
+      return backend_queue_.size() >= queue_params_.max_queue_size_;
+    }
+    default: {
+      LOG(FATAL) << "Unknown visualizer queue policy: "
+                 << static_cast<int>(queue_params_.policy_);
+      return false;
+    }
+  }
+}
+
+DropStatistics VisualizerModule::getDropStatistics() const {
+  DropStatistics drop_statistics;
+  drop_statistics.num_received_ = num_received_;
+  drop_statistics.num_dropped_ = num_dropped_;
+  return drop_statistics;
+}
+
 //! Checks if the module has work to do (should check input queues are empty)
 bool VisualizerModule::hasWork() const {
   LOG_IF(WARNING,
@@ -0,0 +1,366 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   VizStream.cpp
+ * @brief  Compact messages with the poses, landmarks and mesh estimated by the
+ * pipeline, streamed to a viewer running in another process (or machine).
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/visualizer/VizStream.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+namespace {
+
+// Every message starts with the magic and the size of the rest of the message.
+const uint32_t kVizStreamMagic = 0x5349564Bu;  // "KVIS"
+const size_t kHeaderSize = 2u * sizeof(uint32_t);
+
+template <typename T>
+void appendBinary(const T& value, std::string* output) {
+  output->append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool readBinary(const char** data, const char* end, T* value) {
+  if (end - *data < static_cast<std::ptrdiff_t>(sizeof(T))) return false;
+  std::memcpy(value, *data, sizeof(T));
+  *data += sizeof(T);
+  return true;
+}
+
+// Ids are always sent as 64 bits, whatever the size of LandmarkId.
+void appendId(const LandmarkId& id, std::string* output) {
+  appendBinary(static_cast<int64_t>(id), output);
+}
+
+bool readId(const char** data, const char* end, LandmarkId* id) {
+  int64_t value = 0;
+  if (!readBinary(data, end, &value)) return false;
+  *id = static_cast<LandmarkId>(value);
+  return true;
+}
+
+void appendPoints(const std::vector<std::pair<LandmarkId, cv::Point3f>>& points,
+                  std::string* output) {
+  appendBinary(static_cast<uint32_t>(points.size()), output);
+  for (const auto& point : points) {
+    appendId(point.first, output);
+    appendBinary(point.second.x, output);
+    appendBinary(point.second.y, output);
+    appendBinary(point.second.z, output);
+  }
+}
+
+bool readPoints(const char** data,
+                const char* end,
+                std::vector<std::pair<LandmarkId, cv::Point3f>>* points) {
+  uint32_t size = 0u;
+  if (!readBinary(data, end, &size)) return false;
+  points->resize(size);
+  for (auto& point : *points) {
+    if (!readId(data, end, &point.first) ||
+        !readBinary(data, end, &point.second.x) ||
+        !readBinary(data, end, &point.second.y) ||
+        !readBinary(data, end, &point.second.z)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void appendIds(const std::vector<LandmarkId>& ids, std::string* output) {
+  appendBinary(static_cast<uint32_t>(ids.size()), output);
+  for (const LandmarkId& id : ids) appendId(id, output);
+}
+
+bool readIds(const char** data,
+             const char* end,
+             std::vector<LandmarkId>* ids) {
+  uint32_t size = 0u;
+  if (!readBinary(data, end, &size)) return false;
+  ids->resize(size);
+  for (LandmarkId& id : *ids) {
+    if (!readId(data, end, &id)) return false;
+  }
+  return true;
+}
+
+void appendTriangles(const std::vector<VizStreamTriangle>& triangles,
+                     std::string* output) {
+  appendBinary(static_cast<uint32_t>(triangles.size()), output);
+  for (const VizStreamTriangle& triangle : triangles) {
+    for (const LandmarkId& id : triangle) appendId(id, output);
+  }
+}
+
+bool readTriangles(const char** data,
+                   const char* end,
+                   std::vector<VizStreamTriangle>* triangles) {
+  uint32_t size = 0u;
+  if (!readBinary(data, end, &size)) return false;
+  triangles->resize(size);
+  for (VizStreamTriangle& triangle : *triangles) {
+    for (LandmarkId& id : triangle) {
+      if (!readId(data, end, &id)) return false;
+    }
+  }
+  return true;
+}
+
+// Adds to delta the points that are new or moved more than the tolerance, and
+// the ids of the points that disappeared.
+void computePointsDelta(
+    const VizStreamPoints& old_points,
+    const VizStreamPoints& new_points,
+    const float& tolerance,
+    std::vector<std::pair<LandmarkId, cv::Point3f>>* updated,
+    std::vector<LandmarkId>* removed) {
+  CHECK_NOTNULL(updated);
+  CHECK_NOTNULL(removed);
+  const float squared_tolerance = tolerance * tolerance;
+  for (const auto& new_point : new_points) {
+    const auto& old_point = old_points.find(new_point.first);
+    if (old_point == old_points.end()) {
+      updated->push_back(new_point);
+      continue;
+    }
+    const cv::Point3f diff = new_point.second - old_point->second;
+    if (diff.dot(diff) > squared_tolerance) {
+      updated->push_back(new_point);
+    }
+  }
+  for (const auto& old_point : old_points) {
+    if (new_points.find(old_point.first) == new_points.end()) {
+      removed->push_back(old_point.first);
+    }
+  }
+}
+
+void applyPointsDelta(
+    const std::vector<std::pair<LandmarkId, cv::Point3f>>& updated,
+    const std::vector<LandmarkId>& removed,
+    VizStreamPoints* points) {
+  for (const LandmarkId& id : removed) points->erase(id);
+  for (const auto& point : updated) (*points)[point.first] = point.second;
+}
+
+}  // namespace
+
+/* -------------------------------------------------------------------------- */
+VizStreamPose::VizStreamPose(const Timestamp& timestamp,
+                             const gtsam::Pose3& W_Pose_B)
+    : timestamp_(timestamp) {
+  const gtsam::Point3& t = W_Pose_B.translation();
+  t_ = {{static_cast<float>(t.x()),
+         static_cast<float>(t.y()),
+         static_cast<float>(t.z())}};
+  const gtsam::Quaternion q = W_Pose_B.rotation().toQuaternion();
+  q_ = {{static_cast<float>(q.x()),
+         static_cast<float>(q.y()),
+         static_cast<float>(q.z()),
+         static_cast<float>(q.w())}};
+}
+
+/* -------------------------------------------------------------------------- */
+gtsam::Pose3 VizStreamPose::toPose3() const {
+  return gtsam::Pose3(gtsam::Rot3::Quaternion(q_[3], q_[0], q_[1], q_[2]),
+                      gtsam::Point3(t_[0], t_[1], t_[2]));
+}
+
+/* -------------------------------------------------------------------------- */
+void VizStreamMessage::serialize(std::string* output) const {
+  CHECK_NOTNULL(output);
+  const size_t start = output->size();
+  appendBinary(kVizStreamMagic, output);
+  // Size of the message, written once the message is.
+  appendBinary(static_cast<uint32_t>(0u), output);
+
+  appendBinary(static_cast<uint8_t>(type_), output);
+  appendBinary(static_cast<int64_t>(timestamp_), output);
+  appendBinary(static_cast<uint32_t>(poses_.size()), output);
+  for (const VizStreamPose& pose : poses_) {
+    appendBinary(static_cast<int64_t>(pose.timestamp_), output);
+    for (const float& t : pose.t_) appendBinary(t, output);
+    for (const float& q : pose.q_) appendBinary(q, output);
+  }
+  appendPoints(landmarks_, output);
+  appendIds(removed_landmarks_, output);
+  appendPoints(vertices_, output);
+  appendIds(removed_vertices_, output);
+  appendTriangles(triangles_, output);
+  appendTriangles(removed_triangles_, output);
+
+  const uint32_t size =
+      static_cast<uint32_t>(output->size() - start - kHeaderSize);
+  std::memcpy(&(*output)[start + sizeof(uint32_t)], &size, sizeof(size));
+}
+
+/* -------------------------------------------------------------------------- */
+bool VizStreamMessage::deserialize(const char** data,
+                                   const char* end,
+                                   VizStreamMessage* message) {
+  CHECK_NOTNULL(data);
+  CHECK_NOTNULL(message);
+  const char* cursor = *data;
+  uint32_t magic = 0u;
+  uint32_t size = 0u;
+  if (!readBinary(&cursor, end, &magic) || !readBinary(&cursor, end, &size)) {
+    return false;
+  }
+  CHECK_EQ(magic, kVizStreamMagic) << "Corrupted visualization stream.";
+  if (end - cursor < static_cast<std::ptrdiff_t>(size)) return false;
+  // From here on the whole message is in the buffer.
+  const char* message_end = cursor + size;
+
+  *message = VizStreamMessage();
+  uint8_t type = 0u;
+  int64_t timestamp = 0;
+  uint32_t num_poses = 0u;
+  CHECK(readBinary(&cursor, message_end, &type) &&
+        readBinary(&cursor, message_end, &timestamp) &&
+        readBinary(&cursor, message_end, &num_poses))
+      << "Corrupted visualization stream.";
+  CHECK_LE(type, static_cast<uint8_t>(Type::kSnapshot))
+      << "Corrupted visualization stream.";
+  message->type_ = static_cast<Type>(type);
+  message->timestamp_ = timestamp;
+  message->poses_.resize(num_poses);
+  for (VizStreamPose& pose : message->poses_) {
+    int64_t pose_timestamp = 0;
+    CHECK(readBinary(&cursor, message_end, &pose_timestamp))
+        << "Corrupted visualization stream.";
+    pose.timestamp_ = pose_timestamp;
+    for (float& t : pose.t_) {
+      CHECK(readBinary(&cursor, message_end, &t))
+          << "Corrupted visualization stream.";
+    }
+    for (float& q : pose.q_) {
+      CHECK(readBinary(&cursor, message_end, &q))
+          << "Corrupted visualization stream.";
+    }
+  }
+  CHECK(readPoints(&cursor, message_end, &message->landmarks_) &&
+        readIds(&cursor, message_end, &message->removed_landmarks_) &&
+        readPoints(&cursor, message_end, &message->vertices_) &&
+        readIds(&cursor, message_end, &message->removed_vertices_) &&
+        readTriangles(&cursor, message_end, &message->triangles_) &&
+        readTriangles(&cursor, message_end, &message->removed_triangles_))
+      << "Corrupted visualization stream.";
+  CHECK(cursor == message_end) << "Corrupted visualization stream.";
+  *data = message_end;
+  return true;
+}
+
+/* -------------------------------------------------------------------------- */
+VizStreamState::VizStreamState(const int& max_trajectory_length)
+    : max_trajectory_length_(max_trajectory_length),
+      timestamp_(0),
+      trajectory_(),
+      landmarks_(),
+      vertices_(),
+      triangles_() {
+  CHECK(max_trajectory_length_ == -1 || max_trajectory_length_ > 0);
+}
+
+/* -------------------------------------------------------------------------- */
+void VizStreamState::apply(const VizStreamMessage& message) {
+  if (message.type_ == VizStreamMessage::Type::kSnapshot) clear();
+  timestamp_ = message.timestamp_;
+  for (const VizStreamPose& pose : message.poses_) {
+    trajectory_.push_back(pose);
+  }
+  if (max_trajectory_length_ > 0) {
+    while (trajectory_.size() > static_cast<size_t>(max_trajectory_length_)) {
+      trajectory_.pop_front();
+    }
+  }
+  applyPointsDelta(
+      message.landmarks_, message.removed_landmarks_, &landmarks_);
+  applyPointsDelta(message.vertices_, message.removed_vertices_, &vertices_);
+  for (const VizStreamTriangle& triangle : message.removed_triangles_) {
+    triangles_.erase(triangle);
+  }
+  triangles_.insert(message.triangles_.begin(), message.triangles_.end());
+}
+
+/* -------------------------------------------------------------------------- */
+void VizStreamState::snapshot(VizStreamMessage* message) const {
+  CHECK_NOTNULL(message);
+  *message = VizStreamMessage();
+  message->type_ = VizStreamMessage::Type::kSnapshot;
+  message->timestamp_ = timestamp_;
+  message->poses_.assign(trajectory_.begin(), trajectory_.end());
+  message->landmarks_.assign(landmarks_.begin(), landmarks_.end());
+  message->vertices_.assign(vertices_.begin(), vertices_.end());
+  message->triangles_.assign(triangles_.begin(), triangles_.end());
+}
+
+/* -------------------------------------------------------------------------- */
+void VizStreamState::computeDelta(const Timestamp& timestamp,
+                                  const VizStreamPose& pose,
+                                  const VizStreamPoints& landmarks,
+                                  const VizStreamPoints& vertices,
+                                  const std::set<VizStreamTriangle>& triangles,
+                                  const float& position_tolerance,
+                                  VizStreamMessage* delta) const {
+  CHECK_NOTNULL(delta);
+  CHECK_GE(position_tolerance, 0.0f);
+  *delta = VizStreamMessage();
+  delta->type_ = VizStreamMessage::Type::kDelta;
+  delta->timestamp_ = timestamp;
+  delta->poses_.push_back(pose);
+  computePointsDelta(landmarks_,
+                     landmarks,
+                     position_tolerance,
+                     &delta->landmarks_,
+                     &delta->removed_landmarks_);
+  computePointsDelta(vertices_,
+                     vertices,
+                     position_tolerance,
+                     &delta->vertices_,
+                     &delta->removed_vertices_);
+  // Both sets are sorted, triangles must be given by canonicalTriangle.
+  std::set_difference(triangles.begin(),
+                      triangles.end(),
+                      triangles_.begin(),
+                      triangles_.end(),
+                      std::back_inserter(delta->triangles_));
+  std::set_difference(triangles_.begin(),
+                      triangles_.end(),
+                      triangles.begin(),
+                      triangles.end(),
+                      std::back_inserter(delta->removed_triangles_));
+}
+
+/* -------------------------------------------------------------------------- */
+void VizStreamState::clear() {
+  timestamp_ = 0;
+  trajectory_.clear();
+  landmarks_.clear();
+  vertices_.clear();
+  triangles_.clear();
+}
+
+/* -------------------------------------------------------------------------- */
+VizStreamTriangle VizStreamState::canonicalTriangle(
+    const VizStreamTriangle& ids) {
+  const size_t first = static_cast<size_t>(
+      std::min_element(ids.begin(), ids.end()) - ids.begin());
+  return {{ids[first], ids[(first + 1u) % 3u], ids[(first + 2u) % 3u]}};
+}
+
+}  // namespace VIO
@@ -0,0 +1,328 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   VizStreamSocket.cpp
+ * @brief  Unix and TCP sockets to send VizStream messages to viewers.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/visualizer/VizStreamSocket.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+namespace {
+
+#ifdef MSG_NOSIGNAL
+const int kSendFlags = MSG_NOSIGNAL;
+#else
+const int kSendFlags = 0;
+#endif
+
+const size_t kReceiveChunkSize = 1u << 16u;
+
+void setNonBlocking(const int& fd) {
+  const int flags = fcntl(fd, F_GETFL, 0);
+  CHECK_GE(flags, 0);
+  CHECK_EQ(fcntl(fd, F_SETFL, flags | O_NONBLOCK), 0);
+}
+
+void configureSocket(const int& fd, const bool& is_tcp) {
+#ifdef SO_NOSIGPIPE
+  // No MSG_NOSIGNAL on macOS, disable SIGPIPE on the socket instead.
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+  if (is_tcp) {
+    // Messages are small and latency matters more than throughput.
+    int no_delay = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+  }
+}
+
+/**
+ * @brief Opens a socket bound to (server) or connected to (client) the given
+ * address.
+ * @param[in] address "unix:<path>", "tcp:<host>:<port>" or "tcp:<port>".
+ * @param[in] is_server Whether to bind and listen, or to connect.
+ * @param[out] unix_path Path of the unix socket, empty for TCP.
+ * @return The socket, or -1 on failure.
+ */
+int openSocket(const std::string& address,
+               const bool& is_server,
+               std::string* unix_path) {
+  CHECK_NOTNULL(unix_path);
+  unix_path->clear();
+  const std::string kUnixPrefix = "unix:";
+  const std::string kTcpPrefix = "tcp:";
+
+  if (address.compare(0u, kUnixPrefix.size(), kUnixPrefix) == 0) {
+    const std::string path = address.substr(kUnixPrefix.size());
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+      LOG(ERROR) << "Invalid unix socket path: " << path;
+      return -1;
+    }
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1u);
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    configureSocket(fd, false);
+    if (is_server) {
+      // Remove the socket left by a previous run.
+      unlink(path.c_str());
+      if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+          listen(fd, 4) != 0) {
+        LOG(ERROR) << "Could not listen on " << address << ": "
+                   << std::strerror(errno);
+        close(fd);
+        return -1;
+      }
+      *unix_path = path;
+    } else if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) !=
+               0) {
+      close(fd);
+      return -1;
+    }
+    return fd;
+  }
+
+  CHECK_EQ(address.compare(0u, kTcpPrefix.size(), kTcpPrefix), 0)
+      << "Visualization stream address must start with unix: or tcp:, got: "
+      << address;
+  const std::string host_port = address.substr(kTcpPrefix.size());
+  const size_t colon = host_port.rfind(':');
+  const std::string host =
+      colon == std::string::npos ? "" : host_port.substr(0u, colon);
+  const std::string port =
+      colon == std::string::npos ? host_port : host_port.substr(colon + 1u);
+  CHECK(!port.empty()) << "Missing port in address: " << address;
+
+  addrinfo hints;
+  std::memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  if (is_server) hints.ai_flags = AI_PASSIVE;
+  addrinfo* results = nullptr;
+  if (getaddrinfo(host.empty() ? nullptr : host.c_str(),
+                  port.c_str(),
+                  &hints,
+                  &results) != 0) {
+    LOG(ERROR) << "Could not resolve address: " << address;
+    return -1;
+  }
+  int fd = -1;
+  for (addrinfo* result = results; result; result = result->ai_next) {
+    fd = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+    if (fd < 0) continue;
+    configureSocket(fd, true);
+    if (is_server) {
+      int reuse = 1;
+      setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+      if (bind(fd, result->ai_addr, result->ai_addrlen) == 0 &&
+          listen(fd, 4) == 0) {
+        break;
+      }
+    } else if (connect(fd, result->ai_addr, result->ai_addrlen) == 0) {
+      break;
+    }
+    close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(results);
+  LOG_IF(ERROR, is_server && fd < 0) << "Could not listen on " << address;
+  return fd;
+}
+
+}  // namespace
+
+/* -------------------------------------------------------------------------- */
+VizStreamServer::VizStreamServer(const std::string& address,
+                                 const size_t& max_pending_bytes)
+    : max_pending_bytes_(max_pending_bytes),
+      unix_path_(),
+      listen_fd_(-1),
+      clients_() {
+  CHECK_GT(max_pending_bytes_, 0u);
+  listen_fd_ = openSocket(address, true, &unix_path_);
+  if (listen_fd_ >= 0) {
+    setNonBlocking(listen_fd_);
+    LOG(INFO) << "Streaming visualization to viewers connecting to "
+              << address;
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+VizStreamServer::~VizStreamServer() {
+  for (Client& client : clients_) closeClient(&client);
+  if (listen_fd_ >= 0) close(listen_fd_);
+  if (!unix_path_.empty()) unlink(unix_path_.c_str());
+}
+
+/* -------------------------------------------------------------------------- */
+bool VizStreamServer::acceptClients() {
+  if (listen_fd_ >= 0) {
+    int fd = -1;
+    while ((fd = accept(listen_fd_, nullptr, nullptr)) >= 0) {
+      setNonBlocking(fd);
+      configureSocket(fd, unix_path_.empty());
+      Client client;
+      client.fd_ = fd;
+      clients_.push_back(client);
+      LOG(INFO) << "Visualization viewer connected.";
+    }
+    LOG_IF(ERROR, errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+        << "Could not accept viewer: " << std::strerror(errno);
+  }
+  for (const Client& client : clients_) {
+    if (!client.has_snapshot_) return true;
+  }
+  return false;
+}
+
+/* -------------------------------------------------------------------------- */
+void VizStreamServer::broadcast(const std::string& delta,
+                                const std::string& snapshot) {
+  for (Client& client : clients_) {
+    const std::string& message = client.has_snapshot_ ? delta : snapshot;
+    if (message.empty()) continue;
+    if (client.pending_.size() + message.size() > max_pending_bytes_) {
+      LOG(WARNING) << "Visualization viewer is too slow, disconnecting it.";
+      closeClient(&client);
+      continue;
+    }
+    client.pending_.append(message);
+    client.has_snapshot_ = true;
+    if (!sendPending(&client)) {
+      LOG(INFO) << "Visualization viewer disconnected.";
+      closeClient(&client);
+    }
+  }
+  clients_.erase(std::remove_if(clients_.begin(),
+                                clients_.end(),
+                                [](const Client& client) {
+                                  return client.fd_ < 0;
+                                }),
+                 clients_.end());
+}
+
+/* -------------------------------------------------------------------------- */
+bool VizStreamServer::sendPending(Client* client) {
+  CHECK_NOTNULL(client);
+  size_t num_sent = 0u;
+  while (num_sent < client->pending_.size()) {
+    const ssize_t n = send(client->fd_,
+                           client->pending_.data() + num_sent,
+                           client->pending_.size() - num_sent,
+                           kSendFlags);
+    if (n > 0) {
+      num_sent += static_cast<size_t>(n);
+    } else if (n < 0 && errno == EINTR) {
+      continue;
+    } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      // The socket buffer is full, the rest is sent on the next broadcast.
+      break;
+    } else {
+      return false;
+    }
+  }
+  client->pending_.erase(0u, num_sent);
+  return true;
+}
+
+/* -------------------------------------------------------------------------- */
+void VizStreamServer::closeClient(Client* client) {
+  CHECK_NOTNULL(client);
+  if (client->fd_ >= 0) close(client->fd_);
+  client->fd_ = -1;
+  client->pending_.clear();
+}
+
+/* -------------------------------------------------------------------------- */
+VizStreamClient::VizStreamClient() : fd_(-1), buffer_() {}
+
+/* -------------------------------------------------------------------------- */
+VizStreamClient::~VizStreamClient() { disconnect(); }
+
+/* -------------------------------------------------------------------------- */
+bool VizStreamClient::connect(const std::string& address) {
+  disconnect();
+  std::string unix_path;
+  fd_ = openSocket(address, false, &unix_path);
+  return fd_ >= 0;
+}
+
+/* -------------------------------------------------------------------------- */
+void VizStreamClient::disconnect() {
+  if (fd_ >= 0) close(fd_);
+  fd_ = -1;
+  buffer_.clear();
+}
+
+/* -------------------------------------------------------------------------- */
+bool VizStreamClient::receive(const int& timeout_ms,
+                              VizStreamMessage* message) {
+  CHECK_NOTNULL(message);
+  const auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::milliseconds(std::max(timeout_ms, 0));
+  char chunk[kReceiveChunkSize];
+  while (true) {
+    const char* data = buffer_.data();
+    if (VizStreamMessage::deserialize(
+            &data, buffer_.data() + buffer_.size(), message)) {
+      buffer_.erase(0u, static_cast<size_t>(data - buffer_.data()));
+      return true;
+    }
+    if (fd_ < 0) return false;
+
+    int poll_timeout_ms = -1;
+    if (timeout_ms >= 0) {
+      const auto remaining =
+          std::chrono::duration_cast<std::chrono::milliseconds>(
+              deadline - std::chrono::steady_clock::now());
+      poll_timeout_ms =
+          static_cast<int>(std::max<int64_t>(0, remaining.count()));
+    }
+    pollfd poll_fd;
+    poll_fd.fd = fd_;
+    poll_fd.events = POLLIN;
+    poll_fd.revents = 0;
+    const int num_ready = poll(&poll_fd, 1, poll_timeout_ms);
+    if (num_ready < 0 && errno == EINTR) continue;
+    if (num_ready <= 0) return false;
+
+    const ssize_t n = recv(fd_, chunk, sizeof(chunk), 0);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) {
+      LOG(INFO) << "Visualization stream closed.";
+      disconnect();
+      return false;
+    }
+    buffer_.append(chunk, static_cast<size_t>(n));
+  }
+}
+
+}  // namespace VIO
@@ -0,0 +1,127 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testAdaptiveRansac.cpp
+ * @brief  test AdaptiveRansac against opengv's RANSAC
+ * @author Antoni Rosinol
+ */
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <gtsam/geometry/Pose3.h>
+
+#include "kimera-vio/frontend/AdaptiveRansac.h"
+#include "kimera-vio/frontend/Tracker-definitions.h"
+
+namespace VIO {
+
+namespace {
+
+// 3D-3D correspondences, the first n_inliers are related by a rigid
+// transformation, the rest are random.
+void buildCorrespondences(const size_t& n_corrs,
+                          const size_t& n_inliers,
+                          BearingVectors* f_ref,
+                          BearingVectors* f_cur) {
+  CHECK_NOTNULL(f_ref)->clear();
+  CHECK_NOTNULL(f_cur)->clear();
+  const gtsam::Pose3 ref_P_cur(gtsam::Rot3::Ypr(0.1, -0.2, 0.05),
+                               gtsam::Point3(0.3, -0.1, 0.2));
+  std::mt19937 rng(42u);
+  std::uniform_real_distribution<double> coord(-5.0, 5.0);
+  for (size_t i = 0u; i < n_corrs; i++) {
+    const gtsam::Point3 p_cur(coord(rng), coord(rng), 5.0 + coord(rng));
+    f_cur->push_back(p_cur);
+    if (i < n_inliers) {
+      f_ref->push_back(ref_P_cur.transformFrom(p_cur));
+    } else {
+      f_ref->push_back(gtsam::Point3(coord(rng), coord(rng), coord(rng)));
+    }
+  }
+}
+
+std::vector<int> range(const size_t& n) {
+  std::vector<int> indices(n);
+  for (size_t i = 0u; i < n; i++) indices[i] = i;
+  return indices;
+}
+
+}  // namespace
+
+/* ************************************************************************* */
+TEST(testAdaptiveRansac, findsSameInliersAsRansac) {
+  const size_t n_corrs = 200u;
+  const size_t n_inliers = 100u;
+  BearingVectors f_ref, f_cur;
+  buildCorrespondences(n_corrs, n_inliers, &f_ref, &f_cur);
+  AdapterStereo adapter(f_ref, f_cur);
+
+  opengv::sac::Ransac<ProblemStereo> ransac;
+  ransac.threshold_ = 0.1;
+  ransac.max_iterations_ = 500;
+  ransac.probability_ = 0.995;
+  ransac.sac_model_ = std::make_shared<ProblemStereo>(adapter, false);
+  ASSERT_TRUE(ransac.computeModel(0));
+
+  AdaptiveRansac<ProblemStereo> adaptive_ransac(500, 0.1, 0.995, false);
+  adaptive_ransac.sac_model_ = std::make_shared<ProblemStereo>(adapter, false);
+  ASSERT_TRUE(adaptive_ransac.computeModel(0));
+
+  // Same inliers as opengv's RANSAC.
+  std::vector<int> inliers = adaptive_ransac.inliers_;
+  std::sort(inliers.begin(), inliers.end());
+  EXPECT_EQ(inliers, range(n_inliers));
+  EXPECT_EQ(adaptive_ransac.inliers_.size(), ransac.inliers_.size());
+
+  // Same result when re-using the problem for a smaller set.
+  buildCorrespondences(n_corrs / 2u, n_inliers / 2u, &f_ref, &f_cur);
+  adaptive_ransac.sac_model_->setUniformIndices(f_ref.size());
+  ASSERT_TRUE(adaptive_ransac.computeModel(0));
+  inliers = adaptive_ransac.inliers_;
+  std::sort(inliers.begin(), inliers.end());
+  EXPECT_EQ(inliers, range(n_inliers / 2u));
+}
+
+/* ************************************************************************* */
+TEST(testAdaptiveRansac, plainRansacWithoutProsacNorSprt) {
+  BearingVectors f_ref, f_cur;
+  buildCorrespondences(100u, 60u, &f_ref, &f_cur);
+  // Shuffle so that the order carries no information.
+  std::vector<int> order = range(f_ref.size());
+  std::shuffle(order.begin(), order.end(), std::mt19937(7u));
+  BearingVectors f_ref_shuffled, f_cur_shuffled;
+  for (const int& i : order) {
+    f_ref_shuffled.push_back(f_ref[i]);
+    f_cur_shuffled.push_back(f_cur[i]);
+  }
+  AdapterStereo adapter(f_ref_shuffled, f_cur_shuffled);
+
+  AdaptiveRansac<ProblemStereo> adaptive_ransac(500, 0.1, 0.995, false);
+  adaptive_ransac.use_prosac_ = false;
+  adaptive_ransac.use_sprt_ = false;
+  adaptive_ransac.sac_model_ = std::make_shared<ProblemStereo>(adapter, false);
+  ASSERT_TRUE(adaptive_ransac.computeModel(0));
+  EXPECT_EQ(adaptive_ransac.inliers_.size(), 60u);
+  for (const int& i : adaptive_ransac.inliers_) {
+    EXPECT_LT(order[i], 60);
+  }
+
+  // Not randomized: the same problem gives the same result.
+  const int iterations = adaptive_ransac.iterations_;
+  ASSERT_TRUE(adaptive_ransac.computeModel(0));
+  EXPECT_EQ(adaptive_ransac.iterations_, iterations);
+}
+
+}  // namespace VIO
@@ -0,0 +1,168 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testBowQueryEngine.cpp
+ * @brief  test BowQueryEngine against DBoW2's database query
+ * @author Marcus Abate
+ */
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <DBoW2/DBoW2.h>
+
+#include "kimera-vio/loopclosure/BowQueryEngine.h"
+#include "kimera-vio/utils/Timer.h"
+
+DECLARE_string(test_data_path);
+
+namespace VIO {
+
+class BowQueryEngineFixture : public ::testing::Test {
+ public:
+  BowQueryEngineFixture() : generator_(42u) {
+    vocabulary_.load(FLAGS_test_data_path +
+                     std::string("/ForLoopClosureDetector/small_voc.yml.gz"));
+    CHECK_EQ(vocabulary_.getScoringType(), DBoW2::L1_NORM);
+    CHECK_GT(vocabulary_.size(), 0u);
+  }
+
+ protected:
+  // Random L1-normalized BoW vector, as returned by the vocabulary.
+  DBoW2::BowVector randomBowVector() {
+    std::uniform_int_distribution<DBoW2::WordId> word_dist(
+        0u, vocabulary_.size() - 1u);
+    std::uniform_real_distribution<double> value_dist(0.01, 1.0);
+    DBoW2::BowVector bow_vec;
+    for (size_t i = 0u; i < num_words_per_entry_; i++) {
+      bow_vec.addWeight(word_dist(generator_), value_dist(generator_));
+    }
+    bow_vec.normalize(DBoW2::L1);
+    return bow_vec;
+  }
+
+  // Adds the same random entries to the database and the engine.
+  void addEntries(const size_t& num_entries,
+                  OrbDatabase* database,
+                  BowQueryEngine* engine) {
+    CHECK_NOTNULL(database);
+    CHECK_NOTNULL(engine);
+    for (size_t i = 0u; i < num_entries; i++) {
+      const DBoW2::BowVector bow_vec = randomBowVector();
+      EXPECT_EQ(database->add(bow_vec), engine->add(bow_vec));
+    }
+  }
+
+  void expectEqualResults(const DBoW2::QueryResults& expected,
+                          const DBoW2::QueryResults& actual) const {
+    ASSERT_EQ(expected.size(), actual.size());
+    for (size_t i = 0u; i < expected.size(); i++) {
+      EXPECT_EQ(expected[i].Id, actual[i].Id);
+      EXPECT_DOUBLE_EQ(expected[i].Score, actual[i].Score);
+    }
+  }
+
+  const size_t num_words_per_entry_ = 100u;
+  OrbVocabulary vocabulary_;
+  std::mt19937 generator_;
+};
+
+/* ************************************************************************** */
+TEST_F(BowQueryEngineFixture, queryMatchesDBoW2) {
+  const size_t num_entries = 200u;
+  for (const size_t& num_shards : {1u, 3u, 4u}) {
+    OrbDatabase database(vocabulary_);
+    BowQueryEngine engine(num_shards);
+    addEntries(num_entries, &database, &engine);
+    EXPECT_EQ(engine.size(), num_entries);
+    EXPECT_EQ(engine.numShards(), num_shards);
+
+    const DBoW2::BowVector query = randomBowVector();
+    for (const int& max_id : {-1, 0, 1, 5, 101}) {
+      for (const int& max_results : {0, 1, 10}) {
+        DBoW2::QueryResults expected, actual;
+        database.query(query, expected, max_results, max_id);
+        engine.query(query, max_results, max_id, &actual);
+        expectEqualResults(expected, actual);
+      }
+    }
+  }
+}
+
+/* ************************************************************************** */
+TEST_F(BowQueryEngineFixture, parallelQueryMatchesDBoW2) {
+  // Large enough for the shards to be scored in their own threads.
+  const size_t num_entries = 5000u;
+  OrbDatabase database(vocabulary_);
+  BowQueryEngine engine(4u);
+  addEntries(num_entries, &database, &engine);
+
+  const int max_id = static_cast<int>(num_entries) - 10;
+  for (size_t i = 0u; i < 5u; i++) {
+    const DBoW2::BowVector query = randomBowVector();
+    DBoW2::QueryResults expected, actual;
+    database.query(query, expected, 50, max_id);
+    engine.query(query, 50, max_id, &actual);
+    expectEqualResults(expected, actual);
+  }
+
+  engine.clear();
+  EXPECT_EQ(engine.size(), 0u);
+  DBoW2::QueryResults results;
+  engine.query(randomBowVector(), 50, -1, &results);
+  EXPECT_TRUE(results.empty());
+}
+
+/* ************************************************************************** */
+TEST_F(BowQueryEngineFixture, scalingBenchmark) {
+  // Raise the last size to 100000 to reproduce the full scaling benchmark;
+  // it is kept small so that the test suite stays fast.
+  const std::vector<size_t> database_sizes = {1000u, 10000u};
+  const size_t num_queries = 10u;
+  const int max_results = 50;
+
+  OrbDatabase database(vocabulary_);
+  BowQueryEngine engine(4u);
+  for (const size_t& database_size : database_sizes) {
+    addEntries(database_size - engine.size(), &database, &engine);
+
+    std::vector<DBoW2::BowVector> queries;
+    for (size_t i = 0u; i < num_queries; i++) {
+      queries.push_back(randomBowVector());
+    }
+
+    std::vector<DBoW2::QueryResults> expected(num_queries);
+    auto tic = utils::Timer::tic();
+    for (size_t i = 0u; i < num_queries; i++) {
+      database.query(queries[i], expected[i], max_results, -1);
+    }
+    const double dbow_ms = utils::Timer::toc(tic).count();
+
+    std::vector<DBoW2::QueryResults> actual(num_queries);
+    tic = utils::Timer::tic();
+    for (size_t i = 0u; i < num_queries; i++) {
+      engine.query(queries[i], max_results, -1, &actual[i]);
+    }
+    const double engine_ms = utils::Timer::toc(tic).count();
+
+    for (size_t i = 0u; i < num_queries; i++) {
+      expectEqualResults(expected[i], actual[i]);
+    }
+    LOG(INFO) << "BoW query on " << database_size << " entries: DBoW2 "
+              << dbow_ms / num_queries << " ms, BowQueryEngine "
+              << engine_ms / num_queries << " ms.";
+  }
+}
+
+}  // namespace VIO
@@ -31,6 +31,7 @@ static constexpr int default_timeout = 100000;
 static constexpr int no_timeout = std::numeric_limits<int>::max();
 
 DECLARE_bool(images_rectified);
+DECLARE_int32(max_frame_queue_depth);
 
 /* ************************************************************************** */
 // Testing data
@@ -60,7 +61,10 @@ class TestDataProviderModule : public ::testing::Test {
         });
   }
 
-  ~TestDataProviderModule() { FLAGS_images_rectified = false; }
+  ~TestDataProviderModule() {
+    FLAGS_images_rectified = false;
+    FLAGS_max_frame_queue_depth = 0;
+  }
 
  protected:
   VIO::StereoVisionFrontEndModule::InputQueue::UniquePtr output_queue_;
@@ -286,3 +290,50 @@ TEST_F(TestDataProviderModule, imageBeforeImuDelayedSpinTest) {
   // +1 because it interpolates to the time frame
   EXPECT_EQ(kImuTestBundleSize + 1, result->getImuStamps().size());
 }
+
+/* ************************************************************************* */
+TEST_F(TestDataProviderModule, overloadDropsOldestFrames) {
+  FLAGS_max_frame_queue_depth = 1;
+  VIO::FrameId current_id = 0;
+  VIO::Timestamp current_time = 10;  // 0 has special meaning, offset by 10
+
+  // Initial frame, never dropped.
+  current_time = fillImuQueueN(current_time, 1);
+  fillLeftRightQueue(++current_id, ++current_time);
+  size_t num_frames = 5;
+  for (size_t i = 0; i < num_frames; i++) {
+    current_time = fillImuQueueN(current_time, kImuTestBundleSize);
+    fillLeftRightQueue(++current_id, ++current_time);
+  }
+  current_time = fillImuQueueN(current_time, 1);
+  spinDataProviderModuleWithTimeout();
+  EXPECT_TRUE(output_queue_->empty());
+
+  // Frames are dropped while more than one is waiting.
+  size_t num_dropped_frames = num_frames - 2;
+  for (size_t i = 0; i < num_dropped_frames; i++) {
+    spinDataProviderModuleWithTimeout();
+    EXPECT_TRUE(output_queue_->empty());
+  }
+  EXPECT_EQ(num_dropped_frames, data_provider_module_->getNrDroppedFrames());
+
+  // The next frame gets the IMU data of the dropped ones.
+  spinDataProviderModuleWithTimeout();
+  VIO::StereoImuSyncPacket::UniquePtr result;
+  CHECK(output_queue_->pop(result));
+  CHECK(result);
+  EXPECT_EQ(static_cast<VIO::FrameId>(num_dropped_frames + 2),
+            result->getStereoFrame().getFrameId());
+  // +1 because it interpolates to the time frame
+  EXPECT_EQ((num_dropped_frames + 1) * kImuTestBundleSize + 1,
+            result->getImuStamps().size());
+
+  // The last one is not dropped.
+  spinDataProviderModuleWithTimeout();
+  CHECK(output_queue_->pop(result));
+  CHECK(result);
+  EXPECT_EQ(static_cast<VIO::FrameId>(num_frames + 1),
+            result->getStereoFrame().getFrameId());
+  EXPECT_EQ(kImuTestBundleSize + 1, result->getImuStamps().size());
+  EXPECT_EQ(num_dropped_frames, data_provider_module_->getNrDroppedFrames());
+}
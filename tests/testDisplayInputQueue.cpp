@@ -0,0 +1,116 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testDisplayInputQueue.cpp
+ * @brief  test the policies of the display queue when the display is late
+ * @author Antoni Rosinol
+ */
+
+#include <string>
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <opencv2/viz.hpp>
+
+#include "kimera-vio/visualizer/DisplayInputQueue.h"
+
+namespace VIO {
+
+namespace {
+
+DisplayInputBase::UniquePtr imageInput(const Timestamp& timestamp,
+                                       const std::string& window) {
+  DisplayInputBase::UniquePtr input = VIO::make_unique<DisplayInputBase>();
+  input->timestamp_ = timestamp;
+  input->images_to_display_.push_back(
+      ImageToDisplay(window, cv::Mat::zeros(2, 2, CV_8UC1)));
+  return input;
+}
+
+VisualizerOutput::UniquePtr vizOutput(
+    const Timestamp& timestamp,
+    const std::vector<std::string>& widget_ids,
+    const std::vector<std::string>& widget_ids_to_remove) {
+  VisualizerOutput::UniquePtr output = VIO::make_unique<VisualizerOutput>();
+  output->timestamp_ = timestamp;
+  for (const std::string& widget_id : widget_ids) {
+    output->widgets_[widget_id] =
+        VIO::make_unique<cv::viz::WLine>(cv::Point3d(0, 0, 0),
+                                         cv::Point3d(1, 1, 1));
+  }
+  output->widget_ids_to_remove_ = widget_ids_to_remove;
+  return output;
+}
+
+}  // namespace
+
+/* ************************************************************************* */
+TEST(testDisplayInputQueue, latestOnlyMergesVisualizerOutputs) {
+  VisualizerQueueParams params;
+  params.policy_ = VisualizerQueuePolicy::kLatestOnly;
+  DisplayInputQueue queue("test_display_queue", params);
+
+  EXPECT_TRUE(queue.push(vizOutput(1, {"A", "B"}, {})));
+  EXPECT_TRUE(queue.push(imageInput(1, "Feature Tracks")));
+  EXPECT_TRUE(queue.push(vizOutput(2, {"C"}, {"B"})));
+  EXPECT_TRUE(queue.push(imageInput(2, "Feature Tracks")));
+
+  // One input of each type is left.
+  DisplayInputBase::UniquePtr input = nullptr;
+  ASSERT_TRUE(queue.pop(input));
+  const VisualizerOutput* output =
+      dynamic_cast<const VisualizerOutput*>(input.get());
+  ASSERT_TRUE(output);
+  EXPECT_EQ(output->timestamp_, 2);
+  // B is removed, A is kept from the dropped output.
+  EXPECT_EQ(output->widgets_.size(), 2u);
+  EXPECT_TRUE(output->widgets_.count("A"));
+  EXPECT_TRUE(output->widgets_.count("C"));
+  EXPECT_EQ(output->widget_ids_to_remove_, std::vector<std::string>({"B"}));
+
+  ASSERT_TRUE(queue.pop(input));
+  EXPECT_EQ(input->timestamp_, 2);
+  EXPECT_EQ(input->images_to_display_.size(), 1u);
+  EXPECT_FALSE(queue.pop(input));
+
+  const DropStatistics drop_statistics = queue.getDropStatistics();
+  EXPECT_EQ(drop_statistics.num_received_, 4u);
+  EXPECT_EQ(drop_statistics.num_dropped_, 2u);
+}
+
+/* ************************************************************************* */
+TEST(testDisplayInputQueue, priorityDropsImagesFirst) {
+  VisualizerQueueParams params;
+  params.policy_ = VisualizerQueuePolicy::kPriority;
+  params.max_queue_size_ = 3u;
+  DisplayInputQueue queue("test_display_queue", params);
+
+  for (Timestamp timestamp = 1; timestamp <= 3; timestamp++) {
+    queue.push(vizOutput(timestamp, {"W" + std::to_string(timestamp)}, {}));
+    queue.push(imageInput(timestamp, "Feature Tracks"));
+  }
+  // Only the images are dropped, and then the oldest 3D output.
+  EXPECT_EQ(queue.size(), 3u);
+  DisplayInputBase::UniquePtr input = nullptr;
+  ASSERT_TRUE(queue.pop(input));
+  EXPECT_EQ(input->priority_, DisplayPriority::kHigh);
+  EXPECT_EQ(input->timestamp_, 2);
+  EXPECT_EQ(static_cast<VisualizerOutput*>(input.get())->widgets_.size(), 2u);
+  ASSERT_TRUE(queue.pop(input));
+  EXPECT_EQ(input->timestamp_, 3);
+  EXPECT_EQ(input->priority_, DisplayPriority::kHigh);
+  ASSERT_TRUE(queue.pop(input));
+  EXPECT_EQ(input->timestamp_, 3);
+  EXPECT_EQ(input->priority_, DisplayPriority::kLow);
+  EXPECT_EQ(queue.getDropStatistics().num_dropped_, 3u);
+}
+
+}  // namespace VIO
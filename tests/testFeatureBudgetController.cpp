@@ -0,0 +1,165 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testFeatureBudgetController.cpp
+ * @brief  test FeatureBudgetController
+ * @author Antoni Rosinol
+ */
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/frontend/FeatureBudgetController.h"
+
+namespace VIO {
+
+namespace {
+
+FeatureBudgetMeasurement frameMeasurement(const double& latency_ms) {
+  FeatureBudgetMeasurement measurement;
+  measurement.latency_ms_ = latency_ms;
+  return measurement;
+}
+
+// Keyframe where the detector finds what it is asked for.
+FeatureBudgetMeasurement keyframeMeasurement(const double& latency_ms,
+                                             const size_t& n_tracked,
+                                             const size_t& n_inliers) {
+  FeatureBudgetMeasurement measurement = frameMeasurement(latency_ms);
+  measurement.is_keyframe_ = true;
+  measurement.n_tracked_ = n_tracked;
+  measurement.n_inliers_ = n_inliers;
+  measurement.n_requested_ = 100u;
+  measurement.n_detected_ = 100u;
+  return measurement;
+}
+
+}  // namespace
+
+/* ************************************************************************* */
+TEST(testFeatureBudgetController, onTimeKeepsFullBudget) {
+  const FeatureBudgetControllerParams params;
+  FeatureBudgetController controller(params);
+  for (size_t i = 0u; i < 50u; i++) {
+    controller.update(frameMeasurement(0.5 * params.target_latency_ms_));
+  }
+  const FeatureBudget& budget = controller.getBudget();
+  EXPECT_EQ(budget.max_features_per_frame_, params.max_features_per_frame_);
+  EXPECT_EQ(budget.klt_max_level_, params.max_klt_max_level_);
+  EXPECT_EQ(budget.klt_max_iter_, params.max_klt_max_iter_);
+  EXPECT_DOUBLE_EQ(budget.threshold_scale_, 1.0);
+}
+
+/* ************************************************************************* */
+TEST(testFeatureBudgetController, lateShedsFeaturesBeforeKlt) {
+  const FeatureBudgetControllerParams params;
+  FeatureBudgetController controller(params);
+  int prev_n_features = params.max_features_per_frame_;
+  for (size_t i = 0u; i < 200u; i++) {
+    const FeatureBudget& budget =
+        controller.update(frameMeasurement(2.0 * params.target_latency_ms_));
+    EXPECT_LE(budget.max_features_per_frame_, prev_n_features);
+    prev_n_features = budget.max_features_per_frame_;
+    // The KLT effort is only cut in the lower half of the feature range.
+    if (budget.max_features_per_frame_ >
+        (params.min_features_per_frame_ + params.max_features_per_frame_) / 2) {
+      EXPECT_EQ(budget.klt_max_level_, params.max_klt_max_level_);
+      EXPECT_EQ(budget.klt_max_iter_, params.max_klt_max_iter_);
+    }
+  }
+  const FeatureBudget& budget = controller.getBudget();
+  EXPECT_EQ(budget.max_features_per_frame_, params.min_features_per_frame_);
+  EXPECT_EQ(budget.klt_max_level_, params.min_klt_max_level_);
+  EXPECT_EQ(budget.klt_max_iter_, params.min_klt_max_iter_);
+
+  // Recovers once on time, despite having been saturated for long.
+  for (size_t i = 0u; i < 100u; i++) {
+    controller.update(frameMeasurement(0.5 * params.target_latency_ms_));
+  }
+  EXPECT_EQ(controller.getBudget().max_features_per_frame_,
+            params.max_features_per_frame_);
+}
+
+/* ************************************************************************* */
+TEST(testFeatureBudgetController, poorTrackingKeepsFeatures) {
+  const FeatureBudgetControllerParams params;
+  FeatureBudgetController controller(params);
+  for (size_t i = 0u; i < 100u; i++) {
+    // Most of the tracks are outliers.
+    controller.update(
+        keyframeMeasurement(2.0 * params.target_latency_ms_, 200u, 20u));
+  }
+  EXPECT_GT(controller.getEffort(), 0.5);
+  EXPECT_GT(controller.getBudget().max_features_per_frame_,
+            (params.min_features_per_frame_ + params.max_features_per_frame_) /
+                2);
+
+  // But with good tracking the features are shed.
+  for (size_t i = 0u; i < 100u; i++) {
+    controller.update(
+        keyframeMeasurement(2.0 * params.target_latency_ms_, 200u, 180u));
+  }
+  EXPECT_EQ(controller.getBudget().max_features_per_frame_,
+            params.min_features_per_frame_);
+}
+
+/* ************************************************************************* */
+TEST(testFeatureBudgetController, backendLagLowersTarget) {
+  const FeatureBudgetControllerParams params;
+  FeatureBudgetController controller(params);
+  for (size_t i = 0u; i < 100u; i++) {
+    // On time, but the backend is far behind.
+    FeatureBudgetMeasurement measurement =
+        frameMeasurement(0.9 * params.target_latency_ms_);
+    measurement.backend_lag_ = 4u * (params.max_backend_lag_ + 1u);
+    controller.update(measurement);
+  }
+  EXPECT_LT(controller.getBudget().max_features_per_frame_,
+            params.max_features_per_frame_);
+}
+
+/* ************************************************************************* */
+TEST(testFeatureBudgetController, detectorThreshold) {
+  const FeatureBudgetControllerParams params;
+  FeatureBudgetController controller(params);
+
+  // Low texture: the detector finds few of the corners requested.
+  FeatureBudgetMeasurement measurement =
+      keyframeMeasurement(0.5 * params.target_latency_ms_, 200u, 180u);
+  measurement.n_detected_ = measurement.n_requested_ / 4u;
+  double prev_scale = controller.getBudget().threshold_scale_;
+  for (size_t i = 0u; i < 20u; i++) {
+    const double scale = controller.update(measurement).threshold_scale_;
+    EXPECT_LE(scale, prev_scale);
+    prev_scale = scale;
+  }
+  EXPECT_DOUBLE_EQ(prev_scale, params.min_threshold_scale_);
+
+  // High texture and late: raise it.
+  measurement =
+      keyframeMeasurement(2.0 * params.target_latency_ms_, 200u, 180u);
+  for (size_t i = 0u; i < 50u; i++) controller.update(measurement);
+  EXPECT_DOUBLE_EQ(controller.getBudget().threshold_scale_,
+                   params.max_threshold_scale_);
+
+  // Not changed by frames that are not keyframes.
+  for (size_t i = 0u; i < 50u; i++) {
+    controller.update(frameMeasurement(0.5 * params.target_latency_ms_));
+  }
+  EXPECT_DOUBLE_EQ(controller.getBudget().threshold_scale_,
+                   params.max_threshold_scale_);
+
+  // Back to nominal once on time.
+  measurement =
+      keyframeMeasurement(0.5 * params.target_latency_ms_, 200u, 180u);
+  for (size_t i = 0u; i < 50u; i++) controller.update(measurement);
+  EXPECT_DOUBLE_EQ(controller.getBudget().threshold_scale_, 1.0);
+}
+
+}  // namespace VIO
@@ -0,0 +1,153 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testFeatureDetector.cpp
+ * @brief  test grid-based FeatureDetector
+ * @author Antoni Rosinol
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <opencv2/core/core.hpp>
+
+#include "kimera-vio/frontend/CameraParams.h"
+#include "kimera-vio/frontend/Frame.h"
+#include "kimera-vio/frontend/feature-detector/FeatureDetector.h"
+#include "kimera-vio/frontend/feature-detector/FeatureDetectorParams.h"
+
+namespace VIO {
+
+namespace {
+
+// Image with a corner every square_size pixels.
+cv::Mat checkerboard(const int& cols, const int& rows, const int& square_size) {
+  cv::Mat img(rows, cols, CV_8UC1);
+  for (int r = 0; r < rows; ++r) {
+    for (int c = 0; c < cols; ++c) {
+      img.at<uchar>(r, c) =
+          ((r / square_size + c / square_size) % 2 == 0) ? 30u : 220u;
+    }
+  }
+  return img;
+}
+
+FeatureDetectorParams gridParams() {
+  FeatureDetectorParams params;
+  params.feature_detector_type_ = FeatureDetectorType::GFTT;
+  params.enable_grid_detection_ = true;
+  params.grid_cols_ = 4;
+  params.grid_rows_ = 3;
+  params.max_features_per_frame_ = 120;
+  params.min_distance_btw_tracked_and_detected_features_ = 10;
+  params.enable_subpixel_corner_refinement_ = false;
+  params.enable_non_max_suppression_ = false;
+  return params;
+}
+
+}  // namespace
+
+/* ************************************************************************* */
+TEST(testFeatureDetector, gridDetectionOnlyInCellsLackingTracks) {
+  const FeatureDetectorParams params = gridParams();
+  FeatureDetector feature_detector(params);
+  Frame frame(0, 0, CameraParams(), checkerboard(640, 480, 16));
+
+  // Cell (0, 0) of 160x160 pixels already has its share of tracks.
+  const int features_per_cell = 10;
+  for (int i = 0; i < features_per_cell; ++i) {
+    frame.keypoints_.push_back(KeypointCV(16 + 12 * i, 16 + 12 * i));
+    frame.landmarks_.push_back(1000 + i);
+    frame.landmarks_age_.push_back(1u);
+    frame.scores_.push_back(0.0);
+    frame.versors_.push_back(gtsam::Vector3(0.0, 0.0, 1.0));
+  }
+
+  feature_detector.featureDetection(&frame);
+  ASSERT_EQ(frame.keypoints_.size(), frame.landmarks_.size());
+  const size_t n_new = frame.keypoints_.size() - features_per_cell;
+  EXPECT_EQ(n_new,
+            static_cast<size_t>(params.max_features_per_frame_ -
+                                features_per_cell));
+
+  const double min_distance =
+      params.min_distance_btw_tracked_and_detected_features_;
+  for (size_t i = features_per_cell; i < frame.keypoints_.size(); ++i) {
+    const KeypointCV& kp = frame.keypoints_[i];
+    EXPECT_FALSE(kp.x < 160 && kp.y < 160) << "Detected in a full cell.";
+    for (int j = 0; j < features_per_cell; ++j) {
+      EXPECT_GE(cv::norm(kp - frame.keypoints_[j]), min_distance);
+    }
+    // Landmark ids are incremental from the ones of this detector.
+    EXPECT_EQ(frame.landmarks_[i],
+              static_cast<LandmarkId>(i - features_per_cell));
+  }
+}
+
+/* ************************************************************************* */
+TEST(testFeatureDetector, gridDetectionNothingNeeded) {
+  FeatureDetectorParams params = gridParams();
+  params.max_features_per_frame_ = 0;
+  FeatureDetector feature_detector(params);
+  Frame frame(0, 0, CameraParams(), checkerboard(640, 480, 16));
+  feature_detector.featureDetection(&frame);
+  EXPECT_TRUE(frame.keypoints_.empty());
+}
+
+/* ************************************************************************* */
+TEST(testFeatureDetector, gridDetectionWithFeatureBudget) {
+  const FeatureDetectorParams params = gridParams();
+  FeatureDetector feature_detector(params);
+  EXPECT_EQ(feature_detector.getMaxFeaturesPerFrame(),
+            params.max_features_per_frame_);
+
+  // The budget overrides the max number of features of the params.
+  const int max_features = params.max_features_per_frame_ / 2;
+  feature_detector.setFeatureBudget(max_features, 0.5);
+  EXPECT_EQ(feature_detector.getMaxFeaturesPerFrame(), max_features);
+  EXPECT_DOUBLE_EQ(feature_detector.getThresholdScale(), 0.5);
+  Frame frame(0, 0, CameraParams(), checkerboard(640, 480, 16));
+  feature_detector.featureDetection(&frame);
+  EXPECT_EQ(frame.keypoints_.size(), static_cast<size_t>(max_features));
+
+  // Only refills up to the budget.
+  Frame next_frame(frame);
+  feature_detector.setFeatureBudget(max_features / 2, 1.0);
+  feature_detector.featureDetection(&next_frame);
+  EXPECT_EQ(next_frame.keypoints_.size(), static_cast<size_t>(max_features));
+}
+
+/* ************************************************************************* */
+TEST(testFeatureDetector, landmarkIdsArePerDetector) {
+  const FeatureDetectorParams params = gridParams();
+  FeatureDetector feature_detector_a(params);
+  Frame frame_a(0, 0, CameraParams(), checkerboard(640, 480, 16));
+  feature_detector_a.featureDetection(&frame_a);
+  ASSERT_FALSE(frame_a.landmarks_.empty());
+
+  // Another detector in the same process starts from its own ids.
+  FeatureDetector feature_detector_b(params);
+  Frame frame_b(0, 0, CameraParams(), checkerboard(640, 480, 16));
+  feature_detector_b.featureDetection(&frame_b);
+  ASSERT_EQ(frame_b.landmarks_.size(), frame_a.landmarks_.size());
+  for (size_t i = 0u; i < frame_a.landmarks_.size(); ++i) {
+    EXPECT_EQ(frame_a.landmarks_[i], static_cast<LandmarkId>(i));
+    EXPECT_EQ(frame_b.landmarks_[i], static_cast<LandmarkId>(i));
+  }
+
+  // While the first one keeps counting.
+  Frame next_frame_a(1, 1, CameraParams(), checkerboard(640, 480, 16));
+  feature_detector_a.featureDetection(&next_frame_a);
+  ASSERT_FALSE(next_frame_a.landmarks_.empty());
+  EXPECT_EQ(next_frame_a.landmarks_.front(),
+            static_cast<LandmarkId>(frame_a.landmarks_.size()));
+}
+
+}  // namespace VIO
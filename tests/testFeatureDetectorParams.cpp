@@ -45,6 +45,9 @@ TEST(testFeatureDetectorParams, FeatureDetectorParamParseYAML) {
   EXPECT_EQ(tp.use_harris_corner_detector_, 0);
   EXPECT_EQ(tp.k_, 0.04);
   EXPECT_EQ(tp.fast_thresh_, 52);
+  EXPECT_EQ(tp.enable_grid_detection_, true);
+  EXPECT_EQ(tp.grid_cols_, 4);
+  EXPECT_EQ(tp.grid_rows_, 3);
 }
 
 TEST(testFeatureDetectorParams, equals) {
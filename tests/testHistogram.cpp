@@ -0,0 +1,156 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testHistogram.cpp
+ * @brief  test Histogram
+ * @author Antoni Rosinol
+ */
+
+#include <array>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/utils/Histogram.h"
+
+namespace VIO {
+
+class HistogramFixture : public ::testing::Test {
+ public:
+  HistogramFixture()
+      : z_hist_(1,
+                {0},
+                cv::Mat(),
+                1,
+                {kZBins},
+                {std::array<float, 2>{{-1.0f, 3.0f}}},
+                true,
+                false),
+        hist_2d_(1,
+                 {0, 1},
+                 cv::Mat(),
+                 2,
+                 {kThetaBins, kDistanceBins},
+                 {std::array<float, 2>{{0.0f, 3.1416f}},
+                  std::array<float, 2>{{-6.0f, 6.0f}}},
+                 true,
+                 false) {}
+
+ protected:
+  static constexpr int kZBins = 64;
+  static constexpr int kThetaBins = 20;
+  static constexpr int kDistanceBins = 20;
+
+  // Builds a batch of z values clustered around the given heights.
+  cv::Mat zSamples(const std::vector<float>& heights,
+                   const int& n_per_height) {
+    cv::Mat samples(0, 1, CV_32F);
+    for (const float& height : heights) {
+      for (int i = 0; i < n_per_height; i++) {
+        samples.push_back(height + 0.01f + 0.02f * (i % 5));
+      }
+    }
+    return samples;
+  }
+
+  Histogram z_hist_;
+  Histogram hist_2d_;
+};
+
+/* ************************************************************************** */
+TEST_F(HistogramFixture, incrementalUpdateMatchesBatch1D) {
+  cv::Mat first = zSamples({0.0f, 1.0f}, 60);
+  cv::Mat second = zSamples({2.0f}, 80);
+
+  // Batch: all samples at once.
+  cv::Mat all_samples;
+  cv::vconcat(first, second, all_samples);
+  Histogram batch_hist = z_hist_;
+  batch_hist.calculateHistogram(all_samples);
+
+  // Incremental: first batch, then second batch.
+  EXPECT_TRUE(z_hist_.updateHistogram(first, cv::Mat()));
+  EXPECT_TRUE(z_hist_.updateHistogram(second, cv::Mat()));
+
+  const cv::Size kernel(1, 5);
+  std::vector<Histogram::PeakInfo> batch_peaks =
+      batch_hist.getLocalMaximum1D(kernel, 3, 0.5, 10);
+  std::vector<Histogram::PeakInfo> incremental_peaks =
+      z_hist_.getLocalMaximum1D(kernel, 3, 0.5, 10);
+  ASSERT_EQ(batch_peaks.size(), incremental_peaks.size());
+  for (size_t i = 0u; i < batch_peaks.size(); i++) {
+    EXPECT_EQ(batch_peaks[i].pos_, incremental_peaks[i].pos_);
+    EXPECT_NEAR(batch_peaks[i].support_, incremental_peaks[i].support_, 1e-4);
+  }
+}
+
+/* ************************************************************************** */
+TEST_F(HistogramFixture, incrementalRemoval1D) {
+  cv::Mat ground = zSamples({0.0f}, 100);
+  cv::Mat table = zSamples({1.0f}, 100);
+  z_hist_.updateHistogram(ground, cv::Mat());
+  z_hist_.updateHistogram(table, cv::Mat());
+
+  // Vote out the table, only the ground should remain.
+  EXPECT_TRUE(z_hist_.updateHistogram(cv::Mat(), table));
+  Histogram ground_hist = z_hist_;
+  ground_hist.calculateHistogram(ground);
+
+  const cv::Size kernel(1, 5);
+  std::vector<Histogram::PeakInfo> expected_peaks =
+      ground_hist.getLocalMaximum1D(kernel, 3, 0.5, 10);
+  std::vector<Histogram::PeakInfo> peaks =
+      z_hist_.getLocalMaximum1D(kernel, 3, 0.5, 10);
+  ASSERT_EQ(expected_peaks.size(), peaks.size());
+  for (size_t i = 0u; i < peaks.size(); i++) {
+    EXPECT_EQ(expected_peaks[i].pos_, peaks[i].pos_);
+    EXPECT_NEAR(expected_peaks[i].support_, peaks[i].support_, 1e-4);
+  }
+}
+
+/* ************************************************************************** */
+TEST_F(HistogramFixture, noOpUpdateDoesNotChangeHistogram) {
+  cv::Mat samples = zSamples({0.5f}, 50);
+  EXPECT_TRUE(z_hist_.updateHistogram(samples, cv::Mat()));
+  // Removing and re-adding the same samples is a no-op.
+  EXPECT_FALSE(z_hist_.updateHistogram(samples, samples));
+  // Samples outside the range are ignored.
+  cv::Mat out_of_range(1, 1, CV_32F, cv::Scalar(10.0f));
+  EXPECT_FALSE(z_hist_.updateHistogram(out_of_range, cv::Mat()));
+}
+
+/* ************************************************************************** */
+TEST_F(HistogramFixture, incrementalUpdateMatchesBatch2D) {
+  cv::Mat walls(0, 0, CV_32FC2);
+  for (int i = 0; i < 50; i++) {
+    walls.push_back(cv::Point2f(1.0f, 2.0f + 0.001f * i));
+    walls.push_back(cv::Point2f(2.5f, -3.0f));
+  }
+  Histogram batch_hist = hist_2d_;
+  batch_hist.calculateHistogram(walls);
+  EXPECT_TRUE(hist_2d_.updateHistogram(walls, cv::Mat()));
+
+  std::vector<Histogram::PeakInfo2D> batch_peaks;
+  std::vector<Histogram::PeakInfo2D> incremental_peaks;
+  const cv::Size kernel(3, 3);
+  EXPECT_TRUE(batch_hist.getLocalMaximum2D(&batch_peaks, kernel, 2, 5, 3));
+  EXPECT_TRUE(
+      hist_2d_.getLocalMaximum2D(&incremental_peaks, kernel, 2, 5, 3));
+  ASSERT_EQ(batch_peaks.size(), 2u);
+  ASSERT_EQ(batch_peaks.size(), incremental_peaks.size());
+  for (size_t i = 0u; i < batch_peaks.size(); i++) {
+    EXPECT_EQ(batch_peaks[i].pos_, incremental_peaks[i].pos_);
+    EXPECT_NEAR(batch_peaks[i].support_, incremental_peaks[i].support_, 1e-4);
+  }
+}
+
+}  // namespace VIO
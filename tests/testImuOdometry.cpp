@@ -0,0 +1,197 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testImuOdometry.cpp
+ * @brief  test ImuOdometry
+ * @author Antoni Rosinol
+ */
+
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <gtsam/base/Testable.h>
+#include <gtsam/geometry/Pose3.h>
+
+#include "kimera-vio/imu-frontend/ImuOdometry.h"
+#include "kimera-vio/utils/UtilsNumerical.h"
+
+namespace VIO {
+
+namespace {
+
+// 200 Hz.
+constexpr Timestamp kImuPeriodNs = 5000000;
+constexpr double kTol = 1e-6;
+
+// Constant acceleration along x, without rotation.
+const gtsam::Vector3 kAcceleration(1.0, 0.0, 0.0);
+
+ImuParams imuParams() {
+  ImuParams imu_params;
+  imu_params.acc_walk_ = 1.0;
+  imu_params.acc_noise_ = 1.0;
+  imu_params.gyro_walk_ = 1.0;
+  imu_params.gyro_noise_ = 1.0;
+  imu_params.n_gravity_ << 0.0, 0.0, -9.81;
+  imu_params.imu_integration_sigma_ = 1.0;
+  imu_params.imu_preintegration_type_ =
+      ImuPreintegrationType::kPreintegratedCombinedMeasurements;
+  return imu_params;
+}
+
+ImuMeasurement imuMeasurement(const Timestamp& timestamp) {
+  ImuAccGyr imu_accgyr;
+  // Specific force, the accelerometer also measures the reaction to gravity.
+  imu_accgyr << kAcceleration + gtsam::Vector3(0.0, 0.0, 9.81),
+      gtsam::Vector3::Zero();
+  return ImuMeasurement(timestamp, imu_accgyr);
+}
+
+VioNavStateTimestamped backendState(const Timestamp& timestamp,
+                                    const gtsam::Vector3& velocity) {
+  return VioNavStateTimestamped(
+      timestamp, gtsam::Pose3(), velocity, gtsam::imuBias::ConstantBias());
+}
+
+// Position after moving from the backend state with constant acceleration.
+gtsam::Vector3 expectedPosition(const VioNavStateTimestamped& state,
+                                const Timestamp& timestamp) {
+  const double dt = UtilsNumerical::NsecToSec(timestamp - state.timestamp_);
+  return state.pose_.translation() + state.velocity_ * dt +
+         0.5 * kAcceleration * dt * dt;
+}
+
+}  // namespace
+
+/* ************************************************************************* */
+TEST(testImuOdometry, noOutputWithoutBackendState) {
+  ImuOdometry imu_odometry(imuParams(), gtsam::imuBias::ConstantBias());
+  size_t n_outputs = 0u;
+  imu_odometry.registerOutputCallback(
+      [&n_outputs](const VioNavStateTimestamped&) { n_outputs++; });
+  for (Timestamp t = 0; t < 10 * kImuPeriodNs; t += kImuPeriodNs) {
+    imu_odometry.addImuMeasurement(imuMeasurement(t));
+  }
+  EXPECT_EQ(n_outputs, 0u);
+}
+
+/* ************************************************************************* */
+TEST(testImuOdometry, outputForEachImuMeasurement) {
+  ImuOdometry imu_odometry(imuParams(), gtsam::imuBias::ConstantBias());
+  std::vector<VioNavStateTimestamped> outputs;
+  imu_odometry.registerOutputCallback(
+      [&outputs](const VioNavStateTimestamped& state) {
+        outputs.push_back(state);
+      });
+
+  imu_odometry.addImuMeasurement(imuMeasurement(0));
+  const VioNavStateTimestamped state =
+      backendState(0, gtsam::Vector3(0.5, 0.0, 0.0));
+  imu_odometry.updateBackendState(state);
+  EXPECT_TRUE(outputs.empty());
+
+  ImuStampS imu_stamps(1, 100);
+  ImuAccGyrS imu_accgyr(6, 100);
+  for (int i = 0; i < 100; ++i) {
+    const ImuMeasurement imu_measurement =
+        imuMeasurement((i + 1) * kImuPeriodNs);
+    imu_stamps(i) = imu_measurement.timestamp_;
+    imu_accgyr.col(i) = imu_measurement.acc_gyr_;
+  }
+  imu_odometry.addImuMeasurements(ImuMeasurements(imu_stamps, imu_accgyr));
+
+  ASSERT_EQ(outputs.size(), 100u);
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(outputs[i].timestamp_, imu_stamps(i));
+    EXPECT_TRUE(gtsam::assert_equal(
+        expectedPosition(state, imu_stamps(i)),
+        gtsam::Vector3(outputs[i].pose_.translation()),
+        kTol));
+    EXPECT_TRUE(
+        gtsam::assert_equal(gtsam::Rot3(), outputs[i].pose_.rotation()));
+  }
+}
+
+/* ************************************************************************* */
+TEST(testImuOdometry, repropagatesFromPastBackendState) {
+  ImuOdometry imu_odometry(imuParams(), gtsam::imuBias::ConstantBias());
+  std::vector<VioNavStateTimestamped> outputs;
+  imu_odometry.registerOutputCallback(
+      [&outputs](const VioNavStateTimestamped& state) {
+        outputs.push_back(state);
+      });
+
+  imu_odometry.addImuMeasurement(imuMeasurement(0));
+  imu_odometry.updateBackendState(backendState(0, gtsam::Vector3::Zero()));
+  for (int i = 1; i <= 20; ++i) {
+    imu_odometry.addImuMeasurement(imuMeasurement(i * kImuPeriodNs));
+  }
+  ASSERT_EQ(outputs.size(), 20u);
+
+  // The backend estimates a past state, between IMU measurements.
+  const VioNavStateTimestamped state = VioNavStateTimestamped(
+      12 * kImuPeriodNs + kImuPeriodNs / 2,
+      gtsam::Pose3(gtsam::Rot3(), gtsam::Point3(1.0, 2.0, 3.0)),
+      gtsam::Vector3(0.0, 1.0, 0.0),
+      gtsam::imuBias::ConstantBias());
+  imu_odometry.updateBackendState(state);
+  imu_odometry.addImuMeasurement(imuMeasurement(21 * kImuPeriodNs));
+  ASSERT_EQ(outputs.size(), 21u);
+  EXPECT_TRUE(gtsam::assert_equal(
+      expectedPosition(state, 21 * kImuPeriodNs),
+      gtsam::Vector3(outputs.back().pose_.translation()),
+      kTol));
+
+  // Also if there are no measurements in between.
+  const VioNavStateTimestamped next_state =
+      backendState(20 * kImuPeriodNs + kImuPeriodNs / 2,
+                   gtsam::Vector3(0.0, 0.0, 1.0));
+  imu_odometry.updateBackendState(next_state);
+  imu_odometry.addImuMeasurement(imuMeasurement(22 * kImuPeriodNs));
+  ASSERT_EQ(outputs.size(), 22u);
+  EXPECT_TRUE(gtsam::assert_equal(
+      expectedPosition(next_state, 22 * kImuPeriodNs),
+      gtsam::Vector3(outputs.back().pose_.translation()),
+      kTol));
+
+  // An older state is ignored.
+  imu_odometry.updateBackendState(
+      backendState(15 * kImuPeriodNs, gtsam::Vector3::Zero()));
+  imu_odometry.addImuMeasurement(imuMeasurement(23 * kImuPeriodNs));
+  ASSERT_EQ(outputs.size(), 23u);
+  EXPECT_TRUE(gtsam::assert_equal(
+      expectedPosition(next_state, 23 * kImuPeriodNs),
+      gtsam::Vector3(outputs.back().pose_.translation()),
+      kTol));
+}
+
+/* ************************************************************************* */
+TEST(testImuOdometry, backendStateNewerThanImu) {
+  ImuOdometry imu_odometry(imuParams(), gtsam::imuBias::ConstantBias());
+  std::vector<VioNavStateTimestamped> outputs;
+  imu_odometry.registerOutputCallback(
+      [&outputs](const VioNavStateTimestamped& state) {
+        outputs.push_back(state);
+      });
+
+  imu_odometry.addImuMeasurement(imuMeasurement(0));
+  const VioNavStateTimestamped state =
+      backendState(kImuPeriodNs / 2, gtsam::Vector3(1.0, 0.0, 0.0));
+  imu_odometry.updateBackendState(state);
+  imu_odometry.addImuMeasurement(imuMeasurement(kImuPeriodNs));
+  ASSERT_EQ(outputs.size(), 1u);
+  EXPECT_TRUE(gtsam::assert_equal(
+      expectedPosition(state, kImuPeriodNs),
+      gtsam::Vector3(outputs.back().pose_.translation()),
+      kTol));
+}
+
+}  // namespace VIO
@@ -0,0 +1,161 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testIncrementalSceneModel.cpp
+ * @brief  test that only the widgets whose geometry changed are re-drawn
+ * @author Antoni Rosinol
+ */
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <opencv2/viz.hpp>
+
+#include "kimera-vio/visualizer/IncrementalSceneModel.h"
+
+namespace VIO {
+
+namespace {
+
+const size_t kChunkSize = 4u;
+const float kTolerance = 0.01f;
+
+std::vector<std::string> widgetIds(const WidgetsMap& widgets) {
+  std::vector<std::string> ids;
+  for (const auto& widget : widgets) ids.push_back(widget.first);
+  return ids;
+}
+
+}  // namespace
+
+/* ************************************************************************* */
+TEST(testIncrementalSceneModel, pointCloudChunks) {
+  IncrementalSceneModel scene_model(kChunkSize, kTolerance);
+  PointsWithIdMap points;
+  for (LandmarkId lmk_id = 0; lmk_id < 10; lmk_id++) {
+    points[lmk_id] = gtsam::Point3(lmk_id, 0.0, 1.0);
+  }
+  WidgetsMap widgets;
+  scene_model.updatePointCloud(
+      points, LmkIdToLmkTypeMap(), cv::viz::Color::white(), &widgets);
+  EXPECT_EQ(widgetIds(widgets),
+            std::vector<std::string>(
+                {"Point cloud#0", "Point cloud#1", "Point cloud#2"}));
+
+  // Nothing changed, or below tolerance: nothing is re-drawn.
+  widgets.clear();
+  points[1] = gtsam::Point3(1.0 + 0.5 * kTolerance, 0.0, 1.0);
+  scene_model.updatePointCloud(
+      points, LmkIdToLmkTypeMap(), cv::viz::Color::white(), &widgets);
+  EXPECT_TRUE(widgets.empty());
+
+  // A point moves, landmarks of the last chunk are marginalized.
+  widgets.clear();
+  points[5] = gtsam::Point3(5.0 + 2.0 * kTolerance, 0.0, 1.0);
+  points.erase(8);
+  points.erase(9);
+  scene_model.updatePointCloud(
+      points, LmkIdToLmkTypeMap(), cv::viz::Color::white(), &widgets);
+  EXPECT_EQ(widgetIds(widgets), std::vector<std::string>({"Point cloud#1"}));
+  std::vector<std::string> removed;
+  scene_model.popRemovedWidgets(&removed);
+  EXPECT_EQ(removed, std::vector<std::string>({"Point cloud#2"}));
+  removed.clear();
+  scene_model.popRemovedWidgets(&removed);
+  EXPECT_TRUE(removed.empty());
+}
+
+/* ************************************************************************* */
+TEST(testIncrementalSceneModel, meshChunks) {
+  IncrementalSceneModel scene_model(kChunkSize, kTolerance);
+  cv::Mat vertices(0, 1, CV_32FC3);
+  LandmarkIds vertex_lmk_ids;
+  for (LandmarkId lmk_id : {1, 2, 3, 5, 6, 7}) {
+    vertices.push_back(cv::Point3f(lmk_id, lmk_id % 2, 1.0f));
+    vertex_lmk_ids.push_back(lmk_id);
+  }
+  // Triangles (3 1 2) in chunk 0 and (5 6 7) in chunk 1.
+  cv::Mat polygons(0, 1, CV_32SC1);
+  for (int32_t idx : {3, 2, 0, 1, 3, 3, 4, 5}) polygons.push_back(idx);
+
+  WidgetsMap widgets;
+  scene_model.updateMesh(
+      vertices, cv::Mat(), polygons, vertex_lmk_ids, &widgets);
+  EXPECT_EQ(widgetIds(widgets), std::vector<std::string>({"Mesh#0", "Mesh#1"}));
+
+  // Same triangles in a different order and with other vertex rows.
+  widgets.clear();
+  cv::Mat reordered_vertices(0, 1, CV_32FC3);
+  LandmarkIds reordered_lmk_ids;
+  for (int i = vertices.rows - 1; i >= 0; i--) {
+    reordered_vertices.push_back(vertices.at<cv::Point3f>(i));
+    reordered_lmk_ids.push_back(vertex_lmk_ids[i]);
+  }
+  cv::Mat reordered_polygons(0, 1, CV_32SC1);
+  for (int32_t idx : {3, 2, 1, 0, 3, 4, 3, 5}) {
+    reordered_polygons.push_back(idx);
+  }
+  scene_model.updateMesh(reordered_vertices,
+                         cv::Mat(),
+                         reordered_polygons,
+                         reordered_lmk_ids,
+                         &widgets);
+  EXPECT_TRUE(widgets.empty());
+
+  // Removing a triangle only re-draws its chunk.
+  widgets.clear();
+  reordered_polygons.pop_back(4);
+  scene_model.updateMesh(reordered_vertices,
+                         cv::Mat(),
+                         reordered_polygons,
+                         reordered_lmk_ids,
+                         &widgets);
+  EXPECT_TRUE(widgets.empty());
+  std::vector<std::string> removed;
+  scene_model.popRemovedWidgets(&removed);
+  EXPECT_EQ(removed, std::vector<std::string>({"Mesh#0"}));
+
+  EXPECT_TRUE(IncrementalSceneModel::isMeshWidgetId("Mesh"));
+  EXPECT_TRUE(IncrementalSceneModel::isMeshWidgetId("Mesh#1"));
+  EXPECT_FALSE(IncrementalSceneModel::isMeshWidgetId("Mesh from ply"));
+}
+
+/* ************************************************************************* */
+TEST(testIncrementalSceneModel, trajectorySegments) {
+  IncrementalSceneModel scene_model(kChunkSize, kTolerance);
+  std::deque<cv::Affine3d> poses;
+  size_t num_poses_dropped = 0u;
+  WidgetsMap widgets;
+  std::vector<std::string> removed;
+  for (size_t i = 0u; i < 10u; i++) {
+    poses.push_back(cv::Affine3d(cv::Vec3d(0, 0, 0), cv::Vec3d(i, 0, 0)));
+    // Keep the last 6 poses.
+    if (poses.size() > 6u) {
+      poses.pop_front();
+      num_poses_dropped++;
+    }
+    widgets.clear();
+    scene_model.updateTrajectory(poses, num_poses_dropped, &widgets);
+    scene_model.popRemovedWidgets(&removed);
+    if (i == 5u) {
+      // Pose 5 goes to the segment of poses [4, 8].
+      EXPECT_EQ(widgetIds(widgets), std::vector<std::string>({"Trajectory#1"}));
+    }
+  }
+  // Poses 4 to 9 are displayed: the segment of poses [4, 8] is the same as
+  // in the previous update, the segment of poses [0, 4] is removed.
+  EXPECT_EQ(widgetIds(widgets), std::vector<std::string>({"Trajectory#2"}));
+  EXPECT_EQ(removed, std::vector<std::string>({"Trajectory#0"}));
+}
+
+}  // namespace VIO
@@ -0,0 +1,109 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testLockFreeQueue.cpp
+ * @brief  test LockFreeQueue
+ * @author Antoni Rosinol
+ */
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/utils/LockFreeQueue.h"
+
+namespace VIO {
+
+/* ************************************************************************* */
+TEST(testLockFreeQueue, pushPopInOrder) {
+  LockFreeQueue<std::string> q(3u);
+  // Capacity is rounded up to a power of two.
+  EXPECT_EQ(q.capacity(), 4u);
+
+  std::string s;
+  EXPECT_FALSE(q.tryPop(&s));
+  for (size_t i = 0u; i < q.capacity(); i++) {
+    EXPECT_TRUE(q.tryPush(std::to_string(i)));
+  }
+  std::string overflow = "overflow";
+  EXPECT_FALSE(q.tryPush(std::move(overflow)));
+  // A failed push leaves the value untouched.
+  EXPECT_EQ(overflow, "overflow");
+
+  for (size_t i = 0u; i < q.capacity(); i++) {
+    EXPECT_TRUE(q.tryPop(&s));
+    EXPECT_EQ(s, std::to_string(i));
+  }
+  EXPECT_FALSE(q.tryPop(&s));
+
+  // Wraps around.
+  EXPECT_TRUE(q.tryPush("Hello World!"));
+  EXPECT_TRUE(q.tryPop(&s));
+  EXPECT_EQ(s, "Hello World!");
+}
+
+/* ************************************************************************* */
+TEST(testLockFreeQueue, multipleProducersAndConsumers) {
+  const size_t num_producers = 4u;
+  const size_t num_consumers = 2u;
+  const size_t num_values = 20000u;
+  // Small queue so that producers often find it full.
+  LockFreeQueue<std::pair<size_t, size_t>> q(64u);
+
+  std::vector<std::thread> producers;
+  for (size_t p = 0u; p < num_producers; p++) {
+    producers.emplace_back([&q, p, num_values] {
+      for (size_t i = 0u; i < num_values; i++) {
+        while (!q.tryPush(std::make_pair(p, i))) std::this_thread::yield();
+      }
+    });
+  }
+
+  std::atomic<size_t> num_popped = {0u};
+  std::vector<std::vector<std::vector<size_t>>> popped(
+      num_consumers, std::vector<std::vector<size_t>>(num_producers));
+  std::vector<std::thread> consumers;
+  for (size_t c = 0u; c < num_consumers; c++) {
+    consumers.emplace_back([&, c] {
+      std::pair<size_t, size_t> value;
+      while (num_popped < num_producers * num_values) {
+        if (q.tryPop(&value)) {
+          popped[c][value.first].push_back(value.second);
+          num_popped++;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  for (std::thread& producer : producers) producer.join();
+  for (std::thread& consumer : consumers) consumer.join();
+
+  // Every value is popped exactly once, and each consumer sees the values of
+  // a producer in the order they were pushed.
+  for (size_t p = 0u; p < num_producers; p++) {
+    std::vector<size_t> count(num_values, 0u);
+    for (size_t c = 0u; c < num_consumers; c++) {
+      const std::vector<size_t>& values = popped[c][p];
+      for (size_t i = 0u; i < values.size(); i++) {
+        if (i > 0u) EXPECT_LT(values[i - 1u], values[i]);
+        count[values[i]]++;
+      }
+    }
+    for (const size_t& n : count) EXPECT_EQ(n, 1u);
+  }
+}
+
+}  // namespace VIO
@@ -16,6 +16,7 @@
 #include <cstdlib>
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <vector>
 #include <string>
 #include <algorithm>
@@ -27,10 +28,12 @@
 
 #include "kimera-vio/backend/VioBackEnd-definitions.h"
 #include "kimera-vio/frontend/StereoVisionFrontEnd-definitions.h"
+#include "kimera-vio/logging/AsyncLogWriter.h"
 #include "kimera-vio/logging/Logger.h"
 
 DECLARE_string(test_data_path);
 DECLARE_string(output_path);
+DECLARE_bool(async_logging);
 
 
 namespace VIO {
@@ -466,6 +469,94 @@ TEST_F(LoopClosureDetectorLoggerFixture, logOptimizedTraj) {
   EXPECT_LT(actual_qz - traj_pose.rotation().toQuaternion().z(), tol);
 }
 
+std::string readFile(const std::string& filename) {
+  std::ifstream file(filename);
+  std::stringstream contents;
+  contents << file.rdbuf();
+  return contents.str();
+}
+
+TEST_F(LoggerFixture, asyncLogWriterMatchesSyncOutput) {
+  const std::string output_dir = logger_FLAGS_test_data_path + "backend_output";
+  const std::string converted_dir =
+      logger_FLAGS_test_data_path + "frontend_output";
+
+  // Records covering all field types, and a truncation.
+  std::vector<LogRecord> records;
+  records.push_back(LogRecord::Text("discarded\n"));
+  records.push_back(LogRecord::Control(LogRecord::Type::Truncate));
+  records.push_back(LogRecord::Text("#id,stamp,value,status\n"));
+  LogRecord rows(4u);
+  rows << 1u << Timestamp(1403636579763555584) << 0.1 << "VALID";
+  rows << -2 << Timestamp(-1) << 1.5e20 << std::string("INVALID");
+  records.push_back(rows);
+  LogRecord mesh_rows(3u, ' ', " \n");
+  mesh_rows << 1.5f << 2 << true;
+  records.push_back(mesh_rows);
+
+  std::string expected;
+  for (const LogRecord& record : records) record.format(&expected);
+  EXPECT_EQ(expected,
+            "#id,stamp,value,status\n"
+            "1,1403636579763555584,0.10000000000000000555,VALID\n"
+            "-2,-1,1.5e+20,INVALID\n"
+            "1.5 2 1 \n");
+  expected = expected.substr(std::string("discarded\n").size());
+
+  {
+    AsyncLogWriter csv_writer(16u, 10);
+    AsyncLogWriter binary_writer(16u, 10, output_dir + "/async_log.bin");
+    const uint32_t csv_id =
+        csv_writer.openFile(output_dir + "/async_log.csv");
+    const uint32_t binary_id =
+        binary_writer.openFile(output_dir + "/async_log.csv");
+    for (size_t i = 0u; i < records.size(); i++) {
+      LogRecord csv_record = records[i];
+      LogRecord binary_record = records[i];
+      csv_writer.write(csv_id, std::move(csv_record));
+      binary_writer.write(binary_id, std::move(binary_record));
+    }
+    csv_writer.flush();
+    EXPECT_EQ(readFile(output_dir + "/async_log.csv"), expected);
+  }
+
+  AsyncLogWriter::convertBinaryLog(output_dir + "/async_log.bin",
+                                   converted_dir);
+  EXPECT_EQ(readFile(converted_dir + "/async_log.csv"), expected);
+}
+
+TEST_F(LoggerFixture, asyncBackendLogger) {
+  FLAGS_output_path = logger_FLAGS_test_data_path + "backend_output/";
+  FLAGS_async_logging = true;
+  BackendLogger logger;
+  FLAGS_async_logging = false;
+
+  const Timestamp timestamp = 123;
+  for (size_t i = 0u; i < 3u; i++) {
+    logger.logBackendOutput(BackendOutput(timestamp,
+                                          gtsam::Values(),
+                                          gtsam::Pose3(),
+                                          gtsam::Vector3::Zero(),
+                                          ImuBias(),
+                                          gtsam::Matrix(),
+                                          i,
+                                          0,
+                                          DebugVioInfo(),
+                                          PointsWithIdMap(),
+                                          LmkIdToLmkTypeMap()));
+  }
+  AsyncLogWriter::instance().flush();
+
+  CsvMat results = csv_reader_.getData(FLAGS_output_path + "traj_vio.csv");
+  ASSERT_EQ(results.size(), 4u);
+  EXPECT_EQ(results.at(0).at(0), "#timestamp");
+  EXPECT_EQ(results.at(3).at(0), "123");
+  CsvMat timing =
+      csv_reader_.getData(FLAGS_output_path + "output_backendTiming.csv");
+  ASSERT_EQ(timing.size(), 4u);
+  EXPECT_EQ(timing.at(3).at(0), "2");
+}
+
 TEST(testOpenFile, OpenFile) {
   std::ofstream outputFile;
   OpenFile("tmp.txt", &outputFile);
@@ -12,6 +12,7 @@
  * @author Marcus Abate, Luca Carlone
  */
 
+#include <cstdio>
 #include <memory>
 #include <string>
 #include <utility>
@@ -21,16 +22,26 @@
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
+#include <gtsam/base/Vector.h>
+#include <gtsam/slam/BetweenFactor.h>
+#include <gtsam/slam/PriorFactor.h>
+
 #include "kimera-vio/frontend/CameraParams.h"
 #include "kimera-vio/frontend/Frame.h"
 #include "kimera-vio/frontend/StereoFrame.h"
 #include "kimera-vio/frontend/Tracker.h"
 #include "kimera-vio/frontend/feature-detector/FeatureDetector.h"
+#include "kimera-vio/loopclosure/BinaryOrbVocabulary.h"
 #include "kimera-vio/loopclosure/LoopClosureDetector.h"
+#include "kimera-vio/utils/Timer.h"
 #include "kimera-vio/utils/UtilsOpenCV.h"
 
 DECLARE_string(test_data_path);
 DECLARE_string(vocabulary_path);
+DECLARE_bool(lcd_use_frontend_features);
+DECLARE_int32(lcd_min_frontend_features);
+DECLARE_bool(lcd_cache_knn_matches);
+DECLARE_bool(lcd_publish_pgo_deltas);
 
 namespace VIO {
 
@@ -288,6 +299,57 @@ TEST_F(LCDFixture, processAndAddFrame) {
             lcd_detector_->getLCDParams().nfeatures_);
 }
 
+TEST_F(LCDFixture, processAndAddFrameWithFrontendFeatures) {
+  /* Test adding frame to database reusing the front-end features */
+  CHECK(lcd_detector_);
+  CHECK(ref1_stereo_frame_);
+  gflags::FlagSaver flag_saver;
+  FLAGS_lcd_use_frontend_features = true;
+  FLAGS_lcd_min_frontend_features = 1;
+
+  FrameId id_0 = lcd_detector_->processAndAddFrame(*ref1_stereo_frame_);
+  EXPECT_EQ(id_0, 0);
+
+  const LCDFrame& lcd_frame = lcd_detector_->getFrameDatabasePtr()->at(0);
+  EXPECT_EQ(lcd_frame.timestamp_, timestamp_ref1_);
+  EXPECT_EQ(lcd_frame.id_kf_, id_ref1_);
+  ASSERT_GT(lcd_frame.keypoints_.size(), 0u);
+  ASSERT_EQ(lcd_frame.keypoints_3d_.size(), lcd_frame.keypoints_.size());
+  ASSERT_EQ(lcd_frame.versors_.size(), lcd_frame.keypoints_.size());
+  ASSERT_EQ(lcd_frame.descriptors_mat_.rows,
+            static_cast<int>(lcd_frame.keypoints_.size()));
+  ASSERT_EQ(lcd_frame.descriptors_vec_.size(), lcd_frame.keypoints_.size());
+
+  // Keypoints, depth and versors must come straight from the front-end.
+  const Frame& left_frame = ref1_stereo_frame_->getLeftFrame();
+  size_t n_oriented = 0u;
+  for (size_t i = 0; i < lcd_frame.keypoints_.size(); i++) {
+    const size_t idx = lcd_frame.keypoints_[i].class_id;
+    ASSERT_LT(idx, left_frame.keypoints_.size());
+    EXPECT_EQ(ref1_stereo_frame_->right_keypoints_status_[idx],
+              KeypointStatus::VALID);
+    EXPECT_EQ(lcd_frame.keypoints_[i].pt, left_frame.keypoints_[idx]);
+    EXPECT_TRUE(gtsam::assert_equal(lcd_frame.keypoints_3d_[i],
+                                    ref1_stereo_frame_->keypoints_3d_[idx]));
+    EXPECT_TRUE(
+        gtsam::assert_equal(lcd_frame.versors_[i], left_frame.versors_[idx]));
+    // Descriptors are views into the descriptor matrix.
+    EXPECT_EQ(lcd_frame.descriptors_vec_[i].data,
+              lcd_frame.descriptors_mat_.ptr(i));
+    // Oriented like the keypoints detected by ORB.
+    EXPECT_GE(lcd_frame.keypoints_[i].angle, 0.0f);
+    EXPECT_LT(lcd_frame.keypoints_[i].angle, 360.0f);
+    if (lcd_frame.keypoints_[i].angle != 0.0f) n_oriented++;
+  }
+  EXPECT_GT(n_oriented, 0u);
+
+  // Too few features with depth: fall back to ORB detection.
+  FLAGS_lcd_min_frontend_features = left_frame.keypoints_.size() + 1;
+  lcd_detector_->processAndAddFrame(*ref1_stereo_frame_);
+  EXPECT_EQ(lcd_detector_->getFrameDatabasePtr()->at(1).keypoints_.size(),
+            lcd_detector_->getLCDParams().nfeatures_);
+}
+
 TEST_F(LCDFixture, geometricVerificationCheck) {
   /* Test geometric verification using RANSAC Nister 5pt method */
   CHECK(lcd_detector_);
@@ -353,6 +415,41 @@ TEST_F(LCDFixture, recoverPoseArun) {
   // EXPECT_LT(error.second, tran_tol);
 }
 
+TEST_F(LCDFixture, knnMatchesCache) {
+  /* Benchmark geometric verification + pose recovery with and without
+   * sharing the descriptor matches between both stages */
+  CHECK(lcd_detector_);
+  CHECK(ref1_stereo_frame_);
+  CHECK(cur1_stereo_frame_);
+  gflags::FlagSaver flag_saver;
+  lcd_detector_->getLCDParamsMutable()->pose_recovery_option_ =
+      PoseRecoveryOption::RANSAC_ARUN;
+  lcd_detector_->processAndAddFrame(*ref1_stereo_frame_);
+  lcd_detector_->processAndAddFrame(*cur1_stereo_frame_);
+
+  const size_t n_runs = 20u;
+  for (const bool& cache_matches : {false, true}) {
+    FLAGS_lcd_cache_knn_matches = cache_matches;
+    auto tic = utils::Timer::tic();
+    for (size_t i = 0u; i < n_runs; i++) {
+      gtsam::Pose3 camCur_T_camRef_mono, bodyCur_T_bodyRef;
+      lcd_detector_->geometricVerificationCheck(1, 0, &camCur_T_camRef_mono);
+      lcd_detector_->recoverPose(
+          1, 0, camCur_T_camRef_mono, &bodyCur_T_bodyRef);
+
+      std::pair<double, double> error =
+          UtilsOpenCV::ComputeRotationAndTranslationErrors(
+              ref1_to_cur1_pose_, bodyCur_T_bodyRef, true);
+      EXPECT_LT(error.first, rot_tol);
+      EXPECT_LT(error.second, tran_tol);
+    }
+    LOG(INFO) << "Geometric verification + pose recovery "
+              << (cache_matches ? "with" : "without") << " match cache: "
+              << utils::Timer::toc(tic).count() / static_cast<double>(n_runs)
+              << " ms per candidate.";
+  }
+}
+
 TEST_F(LCDFixture, recoverPoseGivenRot) {
   CHECK(lcd_detector_);
   lcd_detector_->getLCDParamsMutable()->pose_recovery_option_ =
@@ -444,6 +541,162 @@ TEST_F(LCDFixture, detectLoop) {
   EXPECT_LT(error.second, tran_tol);
 }
 
+TEST_F(LCDFixture, binaryVocabulary) {
+  /* Test that a binary vocabulary describes images like the text one */
+  const std::string text_path = FLAGS_vocabulary_path;
+  const std::string binary_path = lcd_test_data_path_ + "/small_voc.bin";
+
+  OrbVocabulary text_vocab;
+  text_vocab.load(text_path);
+  BinaryOrbVocabulary(text_vocab).saveBinary(binary_path);
+  EXPECT_TRUE(BinaryOrbVocabulary::isBinaryFile(binary_path));
+  EXPECT_FALSE(BinaryOrbVocabulary::isBinaryFile(text_path));
+
+  BinaryOrbVocabulary binary_vocab;
+  binary_vocab.loadBinary(binary_path);
+  EXPECT_EQ(binary_vocab.size(), text_vocab.size());
+  EXPECT_EQ(binary_vocab.getBranchingFactor(),
+            text_vocab.getBranchingFactor());
+  EXPECT_EQ(binary_vocab.getDepthLevels(), text_vocab.getDepthLevels());
+  EXPECT_EQ(binary_vocab.getScoringType(), text_vocab.getScoringType());
+  EXPECT_EQ(binary_vocab.getWeightingType(), text_vocab.getWeightingType());
+
+  CHECK(lcd_detector_);
+  CHECK(ref1_stereo_frame_);
+  lcd_detector_->processAndAddFrame(*ref1_stereo_frame_);
+  const OrbDescriptorVec& descriptors =
+      lcd_detector_->getFrameDatabasePtr()->at(0).descriptors_vec_;
+  DBoW2::BowVector text_bow_vec, binary_bow_vec;
+  text_vocab.transform(descriptors, text_bow_vec);
+  binary_vocab.transform(descriptors, binary_bow_vec);
+  EXPECT_FALSE(text_bow_vec.empty());
+  EXPECT_TRUE(text_bow_vec == binary_bow_vec);
+
+  std::remove(binary_path.c_str());
+}
+
+TEST_F(LCDFixture, sharedVocabulary) {
+  /* Test that the pipelines of a process share the loaded vocabulary */
+  std::shared_ptr<const BinaryOrbVocabulary> vocab =
+      BinaryOrbVocabulary::loadShared(FLAGS_vocabulary_path);
+  ASSERT_TRUE(vocab);
+  EXPECT_EQ(vocab, BinaryOrbVocabulary::loadShared(FLAGS_vocabulary_path));
+  EXPECT_EQ(vocab->size(),
+            lcd_detector_->getBoWDatabase()->getVocabulary()->size());
+
+  // Once no one holds it, the vocabulary is released and loaded again.
+  const size_t vocab_size = vocab->size();
+  vocab.reset();
+  lcd_detector_.reset();
+  vocab = BinaryOrbVocabulary::loadShared(FLAGS_vocabulary_path);
+  ASSERT_TRUE(vocab);
+  EXPECT_EQ(vocab->size(), vocab_size);
+}
+
+TEST_F(LCDFixture, saveAndLoadDatabase) {
+  /* Test detecting a loop against a database saved by another session */
+  CHECK(lcd_detector_);
+  lcd_detector_->getLCDParamsMutable()->pose_recovery_option_ =
+      PoseRecoveryOption::GIVEN_ROT;
+  CHECK(ref1_stereo_frame_);
+  CHECK(ref2_stereo_frame_);
+  CHECK(cur1_stereo_frame_);
+  LoopResult loop_result;
+  lcd_detector_->detectLoop(*ref2_stereo_frame_, &loop_result);
+  lcd_detector_->detectLoop(*ref1_stereo_frame_, &loop_result);
+  lcd_detector_->detectLoop(*ref1_stereo_frame_, &loop_result);
+
+  const std::string database_path = lcd_test_data_path_ + "/lcd_database.bin";
+  lcd_detector_->saveDatabase(database_path);
+
+  LoopClosureDetector loaded_detector(lcd_detector_->getLCDParams(), false);
+  loaded_detector.setIntrinsics(*ref1_stereo_frame_);
+  loaded_detector.loadDatabase(database_path);
+  std::remove(database_path.c_str());
+
+  const std::vector<LCDFrame>& frames = *lcd_detector_->getFrameDatabasePtr();
+  const std::vector<LCDFrame>& loaded_frames =
+      *loaded_detector.getFrameDatabasePtr();
+  ASSERT_EQ(loaded_frames.size(), frames.size());
+  for (size_t i = 0; i < frames.size(); i++) {
+    EXPECT_EQ(loaded_frames[i].timestamp_, frames[i].timestamp_);
+    EXPECT_EQ(loaded_frames[i].id_, frames[i].id_);
+    EXPECT_EQ(loaded_frames[i].id_kf_, frames[i].id_kf_);
+    ASSERT_EQ(loaded_frames[i].keypoints_.size(), frames[i].keypoints_.size());
+    ASSERT_EQ(loaded_frames[i].versors_.size(), frames[i].versors_.size());
+    for (size_t j = 0; j < frames[i].keypoints_.size(); j++) {
+      EXPECT_EQ(loaded_frames[i].keypoints_[j].pt, frames[i].keypoints_[j].pt);
+      EXPECT_EQ(loaded_frames[i].keypoints_3d_[j], frames[i].keypoints_3d_[j]);
+      EXPECT_EQ(loaded_frames[i].versors_[j], frames[i].versors_[j]);
+    }
+    EXPECT_TRUE(UtilsOpenCV::compareCvMatsUpToTol(
+        loaded_frames[i].descriptors_mat_, frames[i].descriptors_mat_, 0));
+    EXPECT_EQ(loaded_frames[i].descriptors_vec_.size(),
+              frames[i].descriptors_vec_.size());
+  }
+  EXPECT_EQ(loaded_detector.getBoWDatabase()->size(),
+            lcd_detector_->getBoWDatabase()->size());
+
+  // Same result as in detectLoop, using the loaded database.
+  loaded_detector.getLCDParamsMutable()->pose_recovery_option_ =
+      PoseRecoveryOption::GIVEN_ROT;
+  loaded_detector.detectLoop(*cur1_stereo_frame_, &loop_result);
+  EXPECT_TRUE(loop_result.isLoop());
+  EXPECT_EQ(loop_result.match_id_, 1);
+  EXPECT_EQ(loop_result.query_id_, 3);
+}
+
+TEST_F(LCDFixture, spinOnceAfterLoadingDatabase) {
+  /* Test running a new session against a database saved by another one */
+  CHECK(lcd_detector_);
+  CHECK(ref1_stereo_frame_);
+  CHECK(ref2_stereo_frame_);
+  CHECK(cur1_stereo_frame_);
+  LoopResult loop_result;
+  lcd_detector_->detectLoop(*ref2_stereo_frame_, &loop_result);
+  lcd_detector_->detectLoop(*ref1_stereo_frame_, &loop_result);
+  const std::string database_path = lcd_test_data_path_ + "/lcd_database.bin";
+  lcd_detector_->saveDatabase(database_path);
+
+  LoopClosureDetector loaded_detector(lcd_detector_->getLCDParams(), false);
+  loaded_detector.loadDatabase(database_path);
+  std::remove(database_path.c_str());
+  ASSERT_EQ(loaded_detector.getFrameDatabasePtr()->size(), 2u);
+  EXPECT_TRUE(loaded_detector.isLoadedFrame(1));
+  EXPECT_FALSE(loaded_detector.isLoadedFrame(2));
+  EXPECT_EQ(loaded_detector.getPgoKey(2), 0u);
+
+  // Matching ref1 of the loaded database does not touch the PGO.
+  LcdOutput::Ptr output_0 = loaded_detector.spinOnce(LcdInput(
+      timestamp_cur1_, FrameId(0), *cur1_stereo_frame_, gtsam::Pose3()));
+  ASSERT_TRUE(output_0);
+  EXPECT_FALSE(output_0->is_loop_closure_);
+  EXPECT_EQ(output_0->states_.size(), 1u);
+  EXPECT_EQ(output_0->nfg_.size(), 1u);
+
+  LcdOutput::Ptr output_1 = loaded_detector.spinOnce(LcdInput(
+      timestamp_ref2_, FrameId(1), *ref2_stereo_frame_, gtsam::Pose3()));
+  ASSERT_TRUE(output_1);
+  LcdOutput::Ptr output_2 = loaded_detector.spinOnce(LcdInput(
+      timestamp_ref1_, FrameId(2), *ref1_stereo_frame_, gtsam::Pose3()));
+  ASSERT_TRUE(output_2);
+  EXPECT_EQ(loaded_detector.getFrameDatabasePtr()->size(), 5u);
+
+  // Loop closures between frames of this session use the keyframe ids.
+  if (output_2->is_loop_closure_) {
+    EXPECT_EQ(output_2->id_match_, 0u);
+    EXPECT_EQ(output_2->id_recent_, 2u);
+    EXPECT_EQ(output_2->timestamp_match_, timestamp_cur1_);
+  }
+  const gtsam::Values pgo_trajectory = loaded_detector.getPGOTrajectory();
+  EXPECT_EQ(pgo_trajectory.size(), 3u);
+  for (const auto& factor : loaded_detector.getPGOnfg()) {
+    for (const gtsam::Key& key : factor->keys()) {
+      EXPECT_TRUE(pgo_trajectory.exists(key));
+    }
+  }
+}
+
 TEST_F(LCDFixture, addOdometryFactorAndOptimize) {
   /* Test the addition of odometry factors to the PGO */
   CHECK(lcd_detector_);
@@ -523,6 +776,121 @@ TEST_F(LCDFixture, spinOnce) {
   EXPECT_EQ(output_2->id_match_, 0);
   EXPECT_EQ(output_2->id_recent_, 2);
   EXPECT_EQ(output_2->states_.size(), 3);
+  // The PGO is optimized sequentially, the loop closure is applied already.
+  EXPECT_TRUE(output_2->is_pgo_optimized_);
+}
+
+TEST_F(LCDFixture, spinOnceWithPgoDeltas) {
+  /* Test that only PGO changes are published until a loop closure */
+  CHECK(lcd_detector_);
+  gflags::FlagSaver flag_saver;
+  FLAGS_lcd_publish_pgo_deltas = true;
+
+  CHECK(ref1_stereo_frame_);
+  LcdOutput::Ptr output_0 = lcd_detector_->spinOnce(LcdInput(
+      timestamp_ref1_, FrameId(0), *ref1_stereo_frame_, gtsam::Pose3()));
+
+  CHECK(ref2_stereo_frame_);
+  LcdOutput::Ptr output_1 = lcd_detector_->spinOnce(LcdInput(
+      timestamp_ref2_, FrameId(1), *ref2_stereo_frame_, gtsam::Pose3()));
+
+  CHECK(cur1_stereo_frame_);
+  LcdOutput::Ptr output_2 = lcd_detector_->spinOnce(LcdInput(
+      timestamp_cur1_, FrameId(2), *cur1_stereo_frame_, gtsam::Pose3()));
+
+  EXPECT_TRUE(output_0->is_pgo_delta_);
+  EXPECT_EQ(output_0->pgo_version_, 1u);
+  EXPECT_EQ(output_0->states_.size(), 1);
+  EXPECT_EQ(output_0->nfg_.size(), 1);
+
+  // Only the new keyframe and its odometry factor.
+  EXPECT_TRUE(output_1->is_pgo_delta_);
+  EXPECT_EQ(output_1->pgo_version_, 2u);
+  EXPECT_EQ(output_1->states_.size(), 1);
+  EXPECT_TRUE(output_1->states_.exists(1));
+  EXPECT_EQ(output_1->nfg_.size(), 1);
+
+  // Loop closures publish the full PGO.
+  EXPECT_TRUE(output_2->is_loop_closure_);
+  EXPECT_FALSE(output_2->is_pgo_delta_);
+  EXPECT_EQ(output_2->pgo_version_, 3u);
+  EXPECT_EQ(output_2->states_.size(), 3);
+  EXPECT_EQ(output_2->nfg_.size(), lcd_detector_->getPGOnfg().size());
+
+  // So do explicit requests.
+  lcd_detector_->requestFullPgoSnapshot();
+  CHECK(cur2_stereo_frame_);
+  LcdOutput::Ptr output_3 = lcd_detector_->spinOnce(LcdInput(
+      timestamp_cur2_, FrameId(3), *cur2_stereo_frame_, gtsam::Pose3()));
+  EXPECT_FALSE(output_3->is_pgo_delta_);
+  EXPECT_EQ(output_3->pgo_version_, 4u);
+  EXPECT_EQ(output_3->states_.size(), 4);
+}
+
+TEST_F(LCDFixture, fillPgoOutputAfterRejection) {
+  /* Test that PGO deltas do not depend on the position of the factors */
+  CHECK(lcd_detector_);
+  gflags::FlagSaver flag_saver;
+  FLAGS_lcd_publish_pgo_deltas = true;
+
+  const gtsam::SharedNoiseModel noise =
+      gtsam::noiseModel::Isotropic::Variance(6, 0.1);
+  gtsam::Values states;
+  for (size_t i = 0u; i < 4u; i++) {
+    states.insert(i, gtsam::Pose3(gtsam::Rot3(), gtsam::Point3(i, 0.0, 0.0)));
+  }
+  const gtsam::Pose3 odom(gtsam::Rot3(), gtsam::Point3(1.0, 0.0, 0.0));
+  const gtsam::NonlinearFactor::shared_ptr prior =
+      boost::make_shared<gtsam::PriorFactor<gtsam::Pose3>>(
+          0u, gtsam::Pose3(), noise);
+  const gtsam::NonlinearFactor::shared_ptr odom_01 =
+      boost::make_shared<gtsam::BetweenFactor<gtsam::Pose3>>(
+          0u, 1u, odom, noise);
+  const gtsam::NonlinearFactor::shared_ptr lc_02 =
+      boost::make_shared<gtsam::BetweenFactor<gtsam::Pose3>>(
+          0u, 2u, odom.compose(odom), noise);
+  const gtsam::NonlinearFactor::shared_ptr odom_12 =
+      boost::make_shared<gtsam::BetweenFactor<gtsam::Pose3>>(
+          1u, 2u, odom, noise);
+  const gtsam::NonlinearFactor::shared_ptr odom_23 =
+      boost::make_shared<gtsam::BetweenFactor<gtsam::Pose3>>(
+          2u, 3u, odom, noise);
+
+  gtsam::NonlinearFactorGraph nfg;
+  nfg.push_back(prior);
+  nfg.push_back(odom_01);
+  nfg.push_back(lc_02);
+  LcdOutput output_0;
+  lcd_detector_->fillPgoOutput(states, nfg, true, &output_0);
+  EXPECT_FALSE(output_0.is_pgo_delta_);
+  EXPECT_EQ(output_0.nfg_.size(), 3u);
+
+  // Factors reordered by the solver: only the new one is published.
+  nfg = gtsam::NonlinearFactorGraph();
+  nfg.push_back(odom_01);
+  nfg.push_back(prior);
+  nfg.push_back(odom_12);
+  nfg.push_back(lc_02);
+  LcdOutput output_1;
+  lcd_detector_->fillPgoOutput(states, nfg, false, &output_1);
+  EXPECT_TRUE(output_1.is_pgo_delta_);
+  ASSERT_EQ(output_1.nfg_.size(), 1u);
+  EXPECT_EQ(output_1.nfg_[0], odom_12);
+  EXPECT_TRUE(output_1.states_.empty());
+
+  // The loop closure is rejected while a factor is added, the graph keeps
+  // its size: the full PGO must be published.
+  nfg = gtsam::NonlinearFactorGraph();
+  nfg.push_back(prior);
+  nfg.push_back(odom_01);
+  nfg.push_back(odom_12);
+  nfg.push_back(odom_23);
+  LcdOutput output_2;
+  lcd_detector_->fillPgoOutput(states, nfg, false, &output_2);
+  EXPECT_FALSE(output_2.is_pgo_delta_);
+  EXPECT_EQ(output_2.nfg_.size(), 4u);
+  EXPECT_EQ(output_2.states_.size(), 4u);
+  EXPECT_EQ(output_2.pgo_version_, output_1.pgo_version_ + 1u);
 }
 
 }  // namespace VIO
@@ -24,9 +24,17 @@
 #include "kimera-vio/mesh/Mesher.h"
 
 DECLARE_string(test_data_path);
+DECLARE_bool(incremental_plane_histograms);
 
 namespace VIO {
 
+// Gives access to the plane segmentation of the Mesher.
+class MesherTester : public Mesher {
+ public:
+  using Mesher::Mesher;
+  using Mesher::segmentNewPlanes;
+};
+
 class MesherFixture : public ::testing::Test {
  public:
   MesherFixture()
@@ -196,4 +204,32 @@ TEST_F(MesherFixture, createMesh2dNoKeypoints) {
   ASSERT_EQ(triangulation2D.size(), 0);
 }
 
+/* ************************************************************************* */
+TEST_F(MesherFixture, planeIdsArePerMesher) {
+  gflags::FlagSaver flag_saver;
+  // Calculate the histograms from the given samples only.
+  FLAGS_incremental_plane_histograms = false;
+  // Ground at z = 1, and too few votes for a wall.
+  const cv::Mat z_components(1, 500, CV_32F, cv::Scalar(1.0f));
+  const cv::Mat walls(5, 1, CV_32FC2, cv::Scalar(0.5f, 1.0f));
+
+  MesherTester mesher_a(mesher_params_);
+  std::vector<Plane> planes_a;
+  mesher_a.segmentNewPlanes(&planes_a, z_components, walls);
+  ASSERT_EQ(planes_a.size(), 1u);
+  EXPECT_EQ(planes_a.at(0).getPlaneSymbol(), gtsam::Symbol('P', 0u));
+
+  // Another mesher in the same process starts from its own ids.
+  MesherTester mesher_b(mesher_params_);
+  std::vector<Plane> planes_b;
+  mesher_b.segmentNewPlanes(&planes_b, z_components, walls);
+  ASSERT_EQ(planes_b.size(), 1u);
+  EXPECT_EQ(planes_b.at(0).getPlaneSymbol(), gtsam::Symbol('P', 0u));
+
+  // While the first one keeps counting.
+  mesher_a.segmentNewPlanes(&planes_a, z_components, walls);
+  ASSERT_EQ(planes_a.size(), 1u);
+  EXPECT_EQ(planes_a.at(0).getPlaneSymbol(), gtsam::Symbol('P', 1u));
+}
+
 }  // namespace VIO
@@ -13,13 +13,18 @@
  */
 
 #include <string>
+#include <vector>
 
 #include <gflags/gflags.h>
 #include <gtest/gtest.h>
 
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/video/tracking.hpp>
+
 #include "kimera-vio/frontend/OpticalFlowPredictor.h"
 #include "kimera-vio/frontend/OpticalFlowPredictorFactory.h"
 #include "kimera-vio/pipeline/Pipeline-definitions.h"
+#include "kimera-vio/utils/Timer.h"
 
 DECLARE_string(test_data_path);
 DECLARE_bool(display);
@@ -609,4 +614,141 @@ TEST_F(OpticalFlowPredictorFixture,
   spinDisplay();
 }
 
+// Checks that knowing the depth of the landmarks, the prediction coincides
+// with the projection of the landmarks even if the camera translates.
+TEST_F(OpticalFlowPredictorFixture,
+       PoseOpticalFlowPredictionRotationAndTranslation) {
+  optical_flow_predictor_ =
+      buildOpticalFlowPredictor(OpticalFlowPredictorType::kPose);
+  ASSERT_TRUE(optical_flow_predictor_);
+
+  //! Cam2 is at 20 degree rotation wrt z axis wrt Cam1 and translated.
+  gtsam::Rot3 rot_20_z(0.985, 0.0, 0.0, 0.174);
+  gtsam::Vector3 t(0.3, 0.0, 0.0);
+  gtsam::Pose3 cam_1_P_cam_2(rot_20_z, t);
+  generateCam2(cam_1_P_cam_2);
+  ASSERT_EQ(cam_1_kpts_.size(), cam_2_kpts_.size());
+
+  // Depth of the landmarks wrt cam 1.
+  std::vector<double> cam_1_depths;
+  for (const Landmark& lmk : lmks_) {
+    cam_1_depths.push_back(cam_1_pose_.transformTo(lmk).z());
+  }
+
+  KeypointsCV actual_kpts;
+  optical_flow_predictor_->predictFlowWithDepth(
+      cam_1_kpts_, cam_1_depths, cam_1_P_cam_2, &actual_kpts);
+  compareKeypoints(cam_2_kpts_, actual_kpts, 1e-2);
+
+  // Without depth, we fall back to the rotational prediction.
+  KeypointsCV rotational_kpts;
+  buildOpticalFlowPredictor(OpticalFlowPredictorType::kRotational)
+      ->predictFlow(cam_1_kpts_, rot_20_z, &rotational_kpts);
+  optical_flow_predictor_->predictFlowWithDepth(
+      cam_1_kpts_,
+      std::vector<double>(cam_1_kpts_.size(), -1.0),
+      cam_1_P_cam_2,
+      &actual_kpts);
+  compareKeypoints(rotational_kpts, actual_kpts, 1e-3);
+
+  visualizeScene("PoseRotationAndTranslation", actual_kpts);
+  spinDisplay();
+}
+
+// Tracks a translating textured plane with KLT, seeded with the rotational
+// prediction (full pyramid) and with the pose prediction (shallow pyramid and
+// few iterations), and reports the time and the number of surviving tracks.
+TEST_F(OpticalFlowPredictorFixture, PoseOpticalFlowPredictionKltBenchmark) {
+  const cv::Size& img_size = camera_params_.image_size_;
+  const double fx = simulated_calib_.fx();
+  const double depth = 2.0;
+  const gtsam::Pose3 cam_1_P_cam_2(gtsam::Rot3(), gtsam::Vector3(0.2, 0, 0));
+  // A fronto-parallel plane moves by fx * t / depth pixels.
+  const double shift = fx * cam_1_P_cam_2.x() / depth;
+
+  // Deterministic texture.
+  cv::theRNG().state = 1234u;
+  cv::Mat img_1(img_size, CV_8UC1);
+  cv::randu(img_1, cv::Scalar(0), cv::Scalar(255));
+  cv::GaussianBlur(img_1, img_1, cv::Size(0, 0), 2.0);
+  cv::Mat img_2;
+  const cv::Mat translation =
+      (cv::Mat_<double>(2, 3) << 1.0, 0.0, -shift, 0.0, 1.0, 0.0);
+  cv::warpAffine(img_1, img_2, translation, img_size);
+
+  // Keypoints that remain visible in both images.
+  KeypointsCV kpts_1;
+  KeypointsCV expected_kpts;
+  const int border = 40;
+  for (int v = border; v < img_size.height - border; v += 20) {
+    for (int u = border + static_cast<int>(shift);
+         u < img_size.width - border;
+         u += 20) {
+      kpts_1.push_back(KeypointCV(u, v));
+      expected_kpts.push_back(KeypointCV(u - shift, v));
+    }
+  }
+  ASSERT_FALSE(kpts_1.empty());
+
+  const cv::Size klt_window(24, 24);
+  auto track = [&](const KeypointsCV& predicted_kpts,
+                   const int& max_level,
+                   const int& max_iter,
+                   double* time_us) -> size_t {
+    KeypointsCV kpts_2 = predicted_kpts;
+    std::vector<uchar> status;
+    std::vector<float> error;
+    auto tic = utils::Timer::tic();
+    cv::calcOpticalFlowPyrLK(
+        img_1,
+        img_2,
+        kpts_1,
+        kpts_2,
+        status,
+        error,
+        klt_window,
+        max_level,
+        cv::TermCriteria(
+            cv::TermCriteria::COUNT + cv::TermCriteria::EPS, max_iter, 0.1),
+        cv::OPTFLOW_USE_INITIAL_FLOW);
+    *time_us = static_cast<double>(
+        utils::Timer::toc<std::chrono::microseconds>(tic).count());
+    size_t survivors = 0u;
+    for (size_t i = 0u; i < kpts_2.size(); i++) {
+      if (status[i] && cv::norm(kpts_2[i] - expected_kpts[i]) < 1.0) {
+        survivors++;
+      }
+    }
+    return survivors;
+  };
+
+  KeypointsCV rotational_kpts;
+  buildOpticalFlowPredictor(OpticalFlowPredictorType::kRotational)
+      ->predictFlow(kpts_1, cam_1_P_cam_2.rotation(), &rotational_kpts);
+  double rotational_time_us = 0.0;
+  const size_t rotational_survivors =
+      track(rotational_kpts, 4, 30, &rotational_time_us);
+
+  optical_flow_predictor_ =
+      buildOpticalFlowPredictor(OpticalFlowPredictorType::kPose);
+  KeypointsCV pose_kpts;
+  optical_flow_predictor_->predictFlowWithDepth(
+      kpts_1,
+      std::vector<double>(kpts_1.size(), depth),
+      cam_1_P_cam_2,
+      &pose_kpts);
+  compareKeypoints(expected_kpts, pose_kpts, 1e-2);
+  double pose_time_us = 0.0;
+  const size_t pose_survivors = track(pose_kpts, 1, 10, &pose_time_us);
+
+  LOG(INFO) << "KLT over " << kpts_1.size() << " tracks, " << shift
+            << " px of flow:\n"
+            << " - Rotational prediction (4 levels, 30 iters): "
+            << rotational_time_us << " us, " << rotational_survivors
+            << " survivors.\n"
+            << " - Pose prediction (1 level, 10 iters): " << pose_time_us
+            << " us, " << pose_survivors << " survivors.";
+  EXPECT_GE(pose_survivors, rotational_survivors);
+}
+
 }  // namespace VIO
@@ -0,0 +1,133 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testPgoOptimizer.cpp
+ * @brief  test PgoOptimizer
+ * @author Marcus Abate
+ */
+
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <gtsam/geometry/Pose3.h>
+#include <gtsam/nonlinear/NonlinearFactorGraph.h>
+#include <gtsam/nonlinear/Values.h>
+#include <gtsam/slam/BetweenFactor.h>
+#include <gtsam/slam/PriorFactor.h>
+
+#include "kimera-vio/loopclosure/LoopClosureDetectorParams.h"
+#include "kimera-vio/loopclosure/PgoOptimizer.h"
+
+namespace VIO {
+
+class PgoOptimizerFixture : public ::testing::Test {
+ public:
+  PgoOptimizerFixture()
+      : noise_(gtsam::noiseModel::Isotropic::Variance(6, 0.1)) {
+    for (size_t i = 0u; i < num_poses_; i++) {
+      poses_.push_back(gtsam::Pose3(gtsam::Rot3::Ypr(0.05 * i, 0.0, 0.0),
+                                    gtsam::Point3(i, 0.0, 0.0)));
+    }
+  }
+
+ protected:
+  // Adds a prior on the first pose and odometry for all the others.
+  void addTrajectory(PgoOptimizer* pgo_optimizer) const {
+    CHECK_NOTNULL(pgo_optimizer);
+    gtsam::NonlinearFactorGraph prior_nfg;
+    gtsam::Values prior_values;
+    prior_nfg.add(gtsam::PriorFactor<gtsam::Pose3>(0u, poses_[0], noise_));
+    prior_values.insert(0u, poses_[0]);
+    pgo_optimizer->addPrior(prior_nfg, prior_values);
+
+    for (size_t i = 1u; i < num_poses_; i++) {
+      gtsam::NonlinearFactorGraph nfg;
+      gtsam::Values values;
+      nfg.add(gtsam::BetweenFactor<gtsam::Pose3>(
+          i - 1u, i, poses_[i - 1u].between(poses_[i]), noise_));
+      values.insert(i, poses_[i]);
+      pgo_optimizer->addOdometry(nfg, values);
+    }
+  }
+
+  void expectTrajectory(const PgoEstimate& estimate) const {
+    ASSERT_EQ(estimate.states_.size(), num_poses_);
+    for (size_t i = 0u; i < num_poses_; i++) {
+      EXPECT_TRUE(gtsam::assert_equal(
+          poses_[i], estimate.states_.at<gtsam::Pose3>(i), 1e-6));
+    }
+  }
+
+  const size_t num_poses_ = 10u;
+  const gtsam::SharedNoiseModel noise_;
+  std::vector<gtsam::Pose3> poses_;
+  LoopClosureDetectorParams lcd_params_;
+};
+
+/* ************************************************************************** */
+TEST_F(PgoOptimizerFixture, sequentialPublishesEveryUpdate) {
+  PgoOptimizer pgo_optimizer(lcd_params_, false);
+  EXPECT_FALSE(pgo_optimizer.getLatestEstimate());
+
+  addTrajectory(&pgo_optimizer);
+  PgoEstimate::ConstPtr estimate = pgo_optimizer.getLatestEstimate();
+  ASSERT_TRUE(estimate);
+  EXPECT_EQ(estimate->version_, num_poses_);
+  EXPECT_EQ(estimate->num_updates_, num_poses_);
+  EXPECT_EQ(estimate->nfg_.size(), num_poses_);
+  expectTrajectory(*estimate);
+}
+
+/* ************************************************************************** */
+TEST_F(PgoOptimizerFixture, parallelCoalescesOdometry) {
+  PgoOptimizer pgo_optimizer(lcd_params_, true);
+  addTrajectory(&pgo_optimizer);
+  pgo_optimizer.waitUntilIdle();
+
+  PgoEstimate::ConstPtr estimate = pgo_optimizer.getLatestEstimate();
+  ASSERT_TRUE(estimate);
+  // Updates queued while the worker is busy are applied at once.
+  EXPECT_GE(estimate->version_, 1u);
+  EXPECT_LE(estimate->version_, num_poses_);
+  EXPECT_EQ(estimate->nfg_.size(), num_poses_);
+  expectTrajectory(*estimate);
+
+  // A loop closure consistent with odometry must not move the trajectory.
+  gtsam::NonlinearFactorGraph lc_nfg;
+  lc_nfg.add(gtsam::BetweenFactor<gtsam::Pose3>(
+      0u,
+      num_poses_ - 1u,
+      poses_.front().between(poses_.back()),
+      noise_));
+  pgo_optimizer.addLoopClosure(lc_nfg);
+  pgo_optimizer.waitUntilIdle();
+
+  PgoEstimate::ConstPtr lc_estimate = pgo_optimizer.getLatestEstimate();
+  ASSERT_TRUE(lc_estimate);
+  EXPECT_GT(lc_estimate->version_, estimate->version_);
+  expectTrajectory(*lc_estimate);
+
+  // Shutting down applies the pending updates.
+  pgo_optimizer.addLoopClosure(lc_nfg);
+  pgo_optimizer.shutdown();
+  PgoEstimate::ConstPtr final_estimate = pgo_optimizer.getLatestEstimate();
+  ASSERT_TRUE(final_estimate);
+  EXPECT_EQ(final_estimate->num_updates_, num_poses_ + 2u);
+  EXPECT_EQ(final_estimate->num_updates_,
+            pgo_optimizer.getNumUpdatesAdded());
+
+  // Updates added after shutdown are ignored.
+  pgo_optimizer.addLoopClosure(lc_nfg);
+  EXPECT_EQ(pgo_optimizer.getNumUpdatesAdded(), num_poses_ + 2u);
+  pgo_optimizer.waitUntilIdle();
+}
+
+}  // namespace VIO
@@ -0,0 +1,405 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testRegularVioBackEndFactors.cpp
+ * @brief  test the bookkeeping of the factors of RegularVioBackEnd
+ * @author Antoni Rosinol
+ */
+
+#include <algorithm>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <gtsam/base/Testable.h>
+#include <gtsam/geometry/OrientedPlane3.h>
+#include <gtsam/geometry/Point3.h>
+#include <gtsam/geometry/Pose3.h>
+#include <gtsam/geometry/StereoCamera.h>
+#include <gtsam/inference/Symbol.h>
+#include <gtsam/slam/PriorFactor.h>
+
+#include "kimera-vio/backend/RegularVioBackEnd.h"
+#include "kimera-vio/backend/RegularVioBackEndParams.h"
+#include "kimera-vio/factors/PointPlaneFactor.h"
+#include "kimera-vio/imu-frontend/ImuFrontEndParams.h"
+#include "kimera-vio/utils/UtilsOpenCV.h"
+
+DECLARE_int32(min_num_of_plane_constraints_to_remove_factors);
+DECLARE_int32(smart_factor_triangulation_stripes);
+
+namespace VIO {
+
+// Gives access to the internals of the RegularVioBackEnd.
+class RegularVioBackEndTester : public RegularVioBackEnd {
+ public:
+  using RegularVioBackEnd::RegularVioBackEnd;
+  using RegularVioBackEnd::PlaneIdToLmkIdRegType;
+  using RegularVioBackEnd::RegularityType;
+  using RegularVioBackEnd::Slot;
+  using PlaneFactorsToAdd =
+      std::map<PlaneId, std::vector<std::pair<Slot, LandmarkId>>>;
+
+  // Updates the smoother and the factor slots, as VioBackEnd::optimize does.
+  void update(const gtsam::NonlinearFactorGraph& new_factors,
+              const gtsam::Values& new_values,
+              const gtsam::FactorIndices& delete_slots) {
+    gtsam::FixedLagSmoother::KeyTimestampMap timestamps;
+    for (const gtsam::Values::ConstKeyValuePair& key_value : new_values) {
+      timestamps[key_value.key] = 0.0;
+    }
+    smoother_->update(new_factors, new_values, timestamps, delete_slots);
+    updateExtraStructuresSlots();
+    state_ = smoother_->calculateEstimate();
+  }
+
+  void removeOldRegularityFactors(
+      const bool& fast,
+      const std::vector<Plane>& planes,
+      const PlaneFactorsToAdd& plane_factors_to_add,
+      PlaneIdToLmkIdRegType* plane_id_to_lmk_id_reg_type,
+      gtsam::FactorIndices* delete_slots) {
+    if (fast) {
+      RegularVioBackEnd::removeOldRegularityFactors(
+          planes, plane_factors_to_add, plane_id_to_lmk_id_reg_type,
+          delete_slots);
+    } else {
+      RegularVioBackEnd::removeOldRegularityFactors_Slow(
+          planes, plane_factors_to_add, plane_id_to_lmk_id_reg_type,
+          delete_slots);
+    }
+  }
+
+  inline const gtsam::NonlinearFactorGraph& getFactors() const {
+    return smoother_->getFactors();
+  }
+
+  inline void insertPose(const FrameId& frame_id, const gtsam::Pose3& pose) {
+    state_.insert(gtsam::Symbol('x', frame_id).key(), pose);
+  }
+
+  inline void updatePose(const FrameId& frame_id, const gtsam::Pose3& pose) {
+    state_.update(gtsam::Symbol('x', frame_id).key(), pose);
+  }
+
+  // Returns a smart factor of the lmk with exact observations from all the
+  // poses in the state. Its triangulation is cached at these poses.
+  SmartStereoFactor::shared_ptr makeSmartFactor(const gtsam::Point3& lmk) {
+    SmartStereoFactor::shared_ptr factor =
+        boost::make_shared<SmartStereoFactor>(
+            smart_noise_, smart_factors_params_, B_Pose_leftCam_);
+    for (const gtsam::Key& key : state_.keys()) {
+      const gtsam::StereoCamera camera(
+          state_.at<gtsam::Pose3>(key).compose(B_Pose_leftCam_), stereo_cal_);
+      factor->add(camera.project(lmk), key, stereo_cal_);
+    }
+    factor->point(state_);
+    return factor;
+  }
+
+  void triangulateSmartFactors(
+      const std::vector<SmartStereoFactor::shared_ptr>& smart_factors,
+      std::vector<gtsam::TriangulationResult>* results) const {
+    RegularVioBackEnd::triangulateSmartFactors(smart_factors, results);
+  }
+};
+
+namespace {
+
+std::unique_ptr<RegularVioBackEndTester> makeBackendTester() {
+  const StereoCalibPtr stereo_calibration =
+      boost::make_shared<gtsam::Cal3_S2Stereo>(
+          400.0, 400.0, 0.0, 400.0, 300.0, 0.5);
+  RegularVioBackEndParams backend_params;
+  backend_params.horizon_ = 100.0;
+  ImuParams imu_params;
+  imu_params.n_gravity_ = gtsam::Vector3(0.0, 0.0, -9.81);
+  return VIO::make_unique<RegularVioBackEndTester>(
+      gtsam::Pose3(),
+      stereo_calibration,
+      backend_params,
+      imu_params,
+      BackendOutputParams(false, 0, false),
+      false);
+}
+
+}  // namespace
+
+class RegularityFactorRemovalFixture : public ::testing::Test {
+ public:
+  RegularityFactorRemovalFixture()
+      : plane_a_('P', 0u),
+        plane_b_('P', 1u),
+        noise_(gtsam::noiseModel::Isotropic::Sigma(1, 0.1)),
+        lmk_noise_(gtsam::noiseModel::Isotropic::Sigma(3, 0.01)),
+        plane_noise_(gtsam::noiseModel::Isotropic::Sigma(3, 0.1)),
+        backend_(makeBackendTester()) {}
+
+ protected:
+  // Plane a is well constrained, plane b is not but has a prior.
+  void addPlanes() {
+    gtsam::NonlinearFactorGraph new_factors;
+    gtsam::Values new_values;
+    addPlane(plane_a_, 5.0, 0u, 16u, false, &new_factors, &new_values);
+    addPlane(plane_b_, 10.0, 16u, 21u, true, &new_factors, &new_values);
+    backend_->update(new_factors, new_values, gtsam::FactorIndices());
+  }
+
+  // Adds lmks lmk_begin to lmk_end - 1 on the plane z = distance.
+  void addPlane(const gtsam::Symbol& plane_symbol,
+                const double& distance,
+                const LandmarkId& lmk_begin,
+                const LandmarkId& lmk_end,
+                const bool& add_prior,
+                gtsam::NonlinearFactorGraph* new_factors,
+                gtsam::Values* new_values) {
+    const gtsam::OrientedPlane3 plane(0.0, 0.0, 1.0, -distance);
+    new_values->insert(plane_symbol.key(), plane);
+    if (add_prior) {
+      new_factors->push_back(
+          boost::make_shared<gtsam::PriorFactor<gtsam::OrientedPlane3>>(
+              plane_symbol.key(), plane, plane_noise_));
+    }
+    for (LandmarkId lmk_id = lmk_begin; lmk_id < lmk_end; lmk_id++) {
+      const gtsam::Symbol lmk_symbol('l', lmk_id);
+      const gtsam::Point3 lmk(lmk_id % 4, lmk_id / 4, distance);
+      new_values->insert(lmk_symbol.key(), lmk);
+      new_factors->push_back(
+          boost::make_shared<gtsam::PriorFactor<gtsam::Point3>>(
+              lmk_symbol.key(), lmk, lmk_noise_));
+      addPointPlaneFactor(plane_symbol, lmk_id, new_factors);
+    }
+  }
+
+  void addPointPlaneFactor(const gtsam::Symbol& plane_symbol,
+                           const LandmarkId& lmk_id,
+                           gtsam::NonlinearFactorGraph* new_factors) {
+    new_factors->push_back(boost::make_shared<gtsam::PointPlaneFactor>(
+        gtsam::Symbol('l', lmk_id).key(), plane_symbol.key(), noise_));
+    plane_id_to_lmk_id_reg_type_[plane_symbol.key()][lmk_id] =
+        RegularVioBackEndTester::RegularityType::POINT_PLANE;
+  }
+
+  LandmarkIds lmkIds(const LandmarkId& lmk_begin,
+                     const LandmarkId& lmk_end,
+                     const LandmarkIds& excluded) const {
+    LandmarkIds lmk_ids;
+    for (LandmarkId lmk_id = lmk_begin; lmk_id < lmk_end; lmk_id++) {
+      if (std::find(excluded.begin(), excluded.end(), lmk_id) ==
+          excluded.end()) {
+        lmk_ids.push_back(lmk_id);
+      }
+    }
+    return lmk_ids;
+  }
+
+  // Slot of the point plane factor between the lmk and the plane.
+  RegularVioBackEndTester::Slot getSlot(const gtsam::Symbol& plane_symbol,
+                                        const LandmarkId& lmk_id) const {
+    const gtsam::NonlinearFactorGraph& graph = backend_->getFactors();
+    for (size_t slot = 0u; slot < graph.size(); slot++) {
+      const auto& ppf =
+          boost::dynamic_pointer_cast<gtsam::PointPlaneFactor>(graph[slot]);
+      if (ppf && ppf->getPlaneKey() == plane_symbol.key() &&
+          ppf->getPointKey() == gtsam::Symbol('l', lmk_id).key()) {
+        return slot;
+      }
+    }
+    ADD_FAILURE() << "No point plane factor on lmk " << lmk_id;
+    return 0u;
+  }
+
+  // Runs both the slow and the fast removal on the current graph, and checks
+  // that they agree.
+  gtsam::FactorIndices removeOldRegularityFactors(
+      const std::vector<Plane>& planes) {
+    RegularVioBackEndTester::PlaneFactorsToAdd plane_factors_to_add;
+    for (const Plane& plane : planes) {
+      plane_factors_to_add[plane.getPlaneSymbol().key()];
+    }
+
+    RegularVioBackEndTester::PlaneIdToLmkIdRegType reg_type_slow =
+        plane_id_to_lmk_id_reg_type_;
+    gtsam::FactorIndices delete_slots_slow;
+    backend_->removeOldRegularityFactors(
+        false, planes, plane_factors_to_add, &reg_type_slow,
+        &delete_slots_slow);
+
+    RegularVioBackEndTester::PlaneIdToLmkIdRegType reg_type_fast =
+        plane_id_to_lmk_id_reg_type_;
+    gtsam::FactorIndices delete_slots_fast;
+    backend_->removeOldRegularityFactors(
+        true, planes, plane_factors_to_add, &reg_type_fast,
+        &delete_slots_fast);
+
+    // The fast path visits the factors in a different order.
+    std::sort(delete_slots_slow.begin(), delete_slots_slow.end());
+    std::sort(delete_slots_fast.begin(), delete_slots_fast.end());
+    EXPECT_EQ(delete_slots_slow, delete_slots_fast);
+    EXPECT_TRUE(reg_type_slow == reg_type_fast);
+
+    plane_id_to_lmk_id_reg_type_ = reg_type_fast;
+    return delete_slots_fast;
+  }
+
+  const gtsam::Symbol plane_a_;
+  const gtsam::Symbol plane_b_;
+  const gtsam::SharedNoiseModel noise_;
+  const gtsam::SharedNoiseModel lmk_noise_;
+  const gtsam::SharedNoiseModel plane_noise_;
+  std::unique_ptr<RegularVioBackEndTester> backend_;
+  RegularVioBackEndTester::PlaneIdToLmkIdRegType plane_id_to_lmk_id_reg_type_;
+};
+
+/* ************************************************************************* */
+TEST_F(RegularityFactorRemovalFixture, fastAndSlowRemovalAgree) {
+  ASSERT_LT(FLAGS_min_num_of_plane_constraints_to_remove_factors, 14);
+  addPlanes();
+
+  // Lmks 0 and 1 left plane a, lmk 16 left plane b.
+  std::vector<Plane> planes;
+  planes.push_back(Plane(plane_a_,
+                         Plane::Normal(0.0, 0.0, 1.0),
+                         5.0,
+                         lmkIds(0u, 16u, {0u, 1u})));
+  planes.push_back(Plane(plane_b_,
+                         Plane::Normal(0.0, 0.0, 1.0),
+                         10.0,
+                         lmkIds(16u, 21u, {16u})));
+  const gtsam::FactorIndices delete_slots =
+      removeOldRegularityFactors(planes);
+
+  gtsam::FactorIndices expected_delete_slots = {
+      getSlot(plane_a_, 0u), getSlot(plane_a_, 1u), getSlot(plane_b_, 16u)};
+  std::sort(expected_delete_slots.begin(), expected_delete_slots.end());
+  EXPECT_EQ(delete_slots, expected_delete_slots);
+  EXPECT_EQ(plane_id_to_lmk_id_reg_type_.at(plane_a_.key()).count(0u), 0u);
+  EXPECT_EQ(plane_id_to_lmk_id_reg_type_.at(plane_a_.key()).count(1u), 0u);
+  EXPECT_EQ(plane_id_to_lmk_id_reg_type_.at(plane_a_.key()).size(), 14u);
+  EXPECT_EQ(plane_id_to_lmk_id_reg_type_.at(plane_b_.key()).size(), 4u);
+}
+
+/* ************************************************************************* */
+TEST_F(RegularityFactorRemovalFixture, fastAndSlowRemovalAgreeAfterUpdate) {
+  ASSERT_LT(FLAGS_min_num_of_plane_constraints_to_remove_factors, 14);
+  addPlanes();
+  std::vector<Plane> planes;
+  planes.push_back(Plane(plane_a_,
+                         Plane::Normal(0.0, 0.0, 1.0),
+                         5.0,
+                         lmkIds(0u, 16u, {0u, 1u})));
+  planes.push_back(Plane(plane_b_,
+                         Plane::Normal(0.0, 0.0, 1.0),
+                         10.0,
+                         lmkIds(16u, 21u, {16u})));
+  const gtsam::FactorIndices delete_slots =
+      removeOldRegularityFactors(planes);
+  ASSERT_EQ(delete_slots.size(), 3u);
+
+  // The removed factors are deleted by iSAM, which invalidates their slots in
+  // the index of the fast path, while lmk 0 joins plane a again with a new
+  // factor.
+  gtsam::NonlinearFactorGraph new_factors;
+  addPointPlaneFactor(plane_a_, 0u, &new_factors);
+  backend_->update(new_factors, gtsam::Values(), delete_slots);
+
+  // Now lmk 2 leaves plane a. Lmk 1 is still out of it, but its factor is
+  // gone already.
+  planes.at(0).lmk_ids_ = lmkIds(0u, 16u, {1u, 2u});
+  const gtsam::FactorIndices new_delete_slots =
+      removeOldRegularityFactors(planes);
+  ASSERT_EQ(new_delete_slots.size(), 1u);
+  EXPECT_EQ(new_delete_slots.at(0), getSlot(plane_a_, 2u));
+  EXPECT_EQ(plane_id_to_lmk_id_reg_type_.at(plane_a_.key()).count(0u), 1u);
+  EXPECT_EQ(plane_id_to_lmk_id_reg_type_.at(plane_a_.key()).count(2u), 0u);
+}
+
+class SmartFactorTriangulationFixture : public ::testing::Test {
+ public:
+  SmartFactorTriangulationFixture()
+      : serial_backend_(makeBackendTester()),
+        parallel_backend_(makeBackendTester()) {}
+
+ protected:
+  // Makes the same smart factors for the given backend, and then moves its
+  // poses, so that re-triangulating changes the lmks.
+  // Lmk 5 is too far away to be triangulated.
+  std::vector<SmartStereoFactor::shared_ptr> makeSmartFactors(
+      RegularVioBackEndTester* backend) const {
+    CHECK_NOTNULL(backend);
+    for (FrameId frame_id = 0u; frame_id < 4u; frame_id++) {
+      backend->insertPose(
+          frame_id, gtsam::Pose3(gtsam::Rot3(), pose(frame_id, 0.0)));
+    }
+    std::vector<SmartStereoFactor::shared_ptr> smart_factors;
+    for (LandmarkId lmk_id = 0u; lmk_id < 6u; lmk_id++) {
+      smart_factors.push_back(backend->makeSmartFactor(lmk(lmk_id)));
+    }
+    for (FrameId frame_id = 0u; frame_id < 4u; frame_id++) {
+      backend->updatePose(
+          frame_id, gtsam::Pose3(gtsam::Rot3(), pose(frame_id, 0.1)));
+    }
+    return smart_factors;
+  }
+
+  gtsam::Point3 pose(const FrameId& frame_id, const double& offset) const {
+    return gtsam::Point3(0.2 * frame_id + offset, 0.0, 0.0);
+  }
+
+  gtsam::Point3 lmk(const LandmarkId& lmk_id) const {
+    return gtsam::Point3(lmk_id % 3, lmk_id / 3, lmk_id == 5u ? 50.0 : 10.0);
+  }
+
+  std::unique_ptr<RegularVioBackEndTester> serial_backend_;
+  std::unique_ptr<RegularVioBackEndTester> parallel_backend_;
+};
+
+/* ************************************************************************* */
+TEST_F(SmartFactorTriangulationFixture, parallelTriangulationAgreesWithSerial) {
+  gflags::FlagSaver flag_saver;
+  const std::vector<SmartStereoFactor::shared_ptr> serial_smart_factors =
+      makeSmartFactors(serial_backend_.get());
+  const std::vector<SmartStereoFactor::shared_ptr> parallel_smart_factors =
+      makeSmartFactors(parallel_backend_.get());
+
+  std::vector<gtsam::TriangulationResult> serial_results;
+  FLAGS_smart_factor_triangulation_stripes = 1;
+  serial_backend_->triangulateSmartFactors(serial_smart_factors,
+                                           &serial_results);
+  std::vector<gtsam::TriangulationResult> parallel_results;
+  FLAGS_smart_factor_triangulation_stripes = 4;
+  parallel_backend_->triangulateSmartFactors(parallel_smart_factors,
+                                             &parallel_results);
+
+  ASSERT_EQ(serial_results.size(), 6u);
+  ASSERT_EQ(parallel_results.size(), 6u);
+  for (size_t i = 0u; i < serial_results.size(); i++) {
+    ASSERT_EQ(serial_results.at(i).valid(), parallel_results.at(i).valid());
+    EXPECT_EQ(serial_results.at(i).farPoint(),
+              parallel_results.at(i).farPoint());
+    if (serial_results.at(i).valid()) {
+      EXPECT_TRUE(gtsam::assert_equal(
+          *serial_results.at(i), *parallel_results.at(i), 1e-9));
+      // The triangulation is at the moved poses.
+      EXPECT_TRUE(gtsam::assert_equal(
+          lmk(i) + gtsam::Point3(0.1, 0.0, 0.0), *parallel_results.at(i),
+          1e-6));
+      // And cached in the smart factors.
+      EXPECT_TRUE(gtsam::assert_equal(*parallel_results.at(i),
+                                      *parallel_smart_factors.at(i)->point()));
+    }
+  }
+  EXPECT_FALSE(parallel_results.at(5u).valid());
+}
+
+}  // namespace VIO
@@ -0,0 +1,125 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testStateCovarianceEstimator.cpp
+ * @brief  test StateCovarianceEstimator
+ * @author Antoni Rosinol
+ */
+
+#include <chrono>
+#include <thread>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <gtsam/geometry/Pose3.h>
+#include <gtsam/inference/Symbol.h>
+#include <gtsam/navigation/ImuBias.h>
+#include <gtsam/nonlinear/Marginals.h>
+#include <gtsam/nonlinear/NonlinearFactorGraph.h>
+#include <gtsam/slam/BetweenFactor.h>
+#include <gtsam/slam/PriorFactor.h>
+
+#include "kimera-vio/backend/StateCovarianceEstimator.h"
+#include "kimera-vio/utils/UtilsOpenCV.h"
+
+namespace VIO {
+
+class StateCovarianceEstimatorFixture : public ::testing::Test {
+ public:
+  StateCovarianceEstimatorFixture() {
+    // Two keyframes, linked by a between factor on the poses.
+    const gtsam::Pose3 pose_0;
+    const gtsam::Pose3 pose_1(gtsam::Rot3::Ypr(0.1, 0.0, 0.0),
+                              gtsam::Point3(1.0, 0.0, 0.0));
+    const gtsam::Vector3 vel(1.0, 0.0, 0.0);
+    const gtsam::imuBias::ConstantBias bias;
+    auto pose_noise = gtsam::noiseModel::Diagonal::Sigmas(
+        (gtsam::Vector(6) << 0.01, 0.02, 0.03, 0.1, 0.2, 0.3).finished());
+    auto vel_noise = gtsam::noiseModel::Isotropic::Sigma(3, 0.1);
+    auto bias_noise = gtsam::noiseModel::Isotropic::Sigma(6, 0.01);
+    for (FrameId kf_id = 0u; kf_id < 2u; kf_id++) {
+      const gtsam::Pose3& pose = kf_id == 0u ? pose_0 : pose_1;
+      graph_.emplace_shared<gtsam::PriorFactor<gtsam::Pose3>>(
+          gtsam::Symbol('x', kf_id), pose, pose_noise);
+      graph_.emplace_shared<gtsam::PriorFactor<gtsam::Vector3>>(
+          gtsam::Symbol('v', kf_id), vel, vel_noise);
+      graph_.emplace_shared<gtsam::PriorFactor<gtsam::imuBias::ConstantBias>>(
+          gtsam::Symbol('b', kf_id), bias, bias_noise);
+      values_.insert(gtsam::Symbol('x', kf_id), pose);
+      values_.insert(gtsam::Symbol('v', kf_id), vel);
+      values_.insert(gtsam::Symbol('b', kf_id), bias);
+    }
+    graph_.emplace_shared<gtsam::BetweenFactor<gtsam::Pose3>>(
+        gtsam::Symbol('x', 0u),
+        gtsam::Symbol('x', 1u),
+        pose_0.between(pose_1),
+        pose_noise);
+  }
+
+ protected:
+  gtsam::Matrix expectedCovariance(const FrameId& kf_id) const {
+    gtsam::Marginals marginals(graph_, values_);
+    gtsam::KeyVector keys;
+    keys.push_back(gtsam::Symbol('x', kf_id));
+    keys.push_back(gtsam::Symbol('v', kf_id));
+    keys.push_back(gtsam::Symbol('b', kf_id));
+    return UtilsOpenCV::Covariance_bvx2xvb(
+        marginals.jointMarginalCovariance(keys).fullMatrix());
+  }
+
+  gtsam::NonlinearFactorGraph graph_;
+  gtsam::Values values_;
+};
+
+/* ************************************************************************** */
+TEST_F(StateCovarianceEstimatorFixture, sequentialMatchesMarginals) {
+  StateCovarianceEstimator estimator(false);
+  EXPECT_FALSE(estimator.getLatestCovariance());
+
+  estimator.requestCovariance(graph_.linearize(values_), values_, 1u);
+  StateCovariance::ConstPtr covariance = estimator.getLatestCovariance();
+  ASSERT_TRUE(covariance);
+  EXPECT_EQ(covariance->kf_id_, 1u);
+  EXPECT_EQ(covariance->version_, 1u);
+  ASSERT_EQ(covariance->covariance_.rows(), 15);
+  ASSERT_EQ(covariance->covariance_.cols(), 15);
+  EXPECT_TRUE(gtsam::assert_equal(expectedCovariance(1u),
+                                  covariance->covariance_, 1e-9));
+
+  estimator.requestCovariance(graph_.linearize(values_), values_, 0u);
+  covariance = estimator.getLatestCovariance();
+  ASSERT_TRUE(covariance);
+  EXPECT_EQ(covariance->kf_id_, 0u);
+  EXPECT_EQ(covariance->version_, 2u);
+  EXPECT_TRUE(gtsam::assert_equal(expectedCovariance(0u),
+                                  covariance->covariance_, 1e-9));
+}
+
+/* ************************************************************************** */
+TEST_F(StateCovarianceEstimatorFixture, parallelPublishesCovariance) {
+  StateCovarianceEstimator estimator(true);
+  estimator.requestCovariance(graph_.linearize(values_), values_, 1u);
+
+  StateCovariance::ConstPtr covariance = nullptr;
+  for (size_t i = 0u; i < 5000u && !covariance; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    covariance = estimator.getLatestCovariance();
+  }
+  ASSERT_TRUE(covariance);
+  EXPECT_EQ(covariance->kf_id_, 1u);
+  EXPECT_TRUE(gtsam::assert_equal(expectedCovariance(1u),
+                                  covariance->covariance_, 1e-9));
+
+  // Shutting down with a pending request must not block.
+  estimator.requestCovariance(graph_.linearize(values_), values_, 0u);
+  estimator.shutdown();
+}
+
+}  // namespace VIO
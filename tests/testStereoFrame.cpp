@@ -27,6 +27,7 @@
 #include "kimera-vio/utils/Timer.h"
 
 DECLARE_string(test_data_path);
+DECLARE_bool(lazy_stereo_rectification);
 
 using namespace gtsam;
 using namespace std;
@@ -238,6 +239,64 @@ TEST_F(StereoFrameFixture, cloneRectificationParameters) {
       sf2->getRightFrame().cam_param_.equals(sf->getRightFrame().cam_param_));
 }
 
+TEST_F(StereoFrameFixture, sharedRectification) {
+  FrontendParams tp;
+  ASSERT_TRUE(sf->getRectification());
+  StereoFrame sf2(id + 1,
+                  timestamp + 1,
+                  UtilsOpenCV::ReadAndConvertToGrayScale(
+                      stereo_FLAGS_test_data_path + left_image_name,
+                      tp.stereo_matching_params_.equalize_image_),
+                  cam_params_left,
+                  UtilsOpenCV::ReadAndConvertToGrayScale(
+                      stereo_FLAGS_test_data_path + right_image_name,
+                      tp.stereo_matching_params_.equalize_image_),
+                  cam_params_right,
+                  tp.stereo_matching_params_,
+                  sf->getRectification());
+  // The rectification is not recomputed nor cloned, but shared.
+  EXPECT_EQ(sf2.getRectification(), sf->getRectification());
+  EXPECT_EQ(sf2.getLeftFrame().cam_param_.undistort_rectify_map_x_.data,
+            sf->getLeftFrame().cam_param_.undistort_rectify_map_x_.data);
+  EXPECT_EQ(sf2.getRightFrame().cam_param_.undistort_rectify_map_y_.data,
+            sf->getRightFrame().cam_param_.undistort_rectify_map_y_.data);
+  EXPECT_TRUE(
+      sf2.getLeftFrame().cam_param_.equals(sf->getLeftFrame().cam_param_));
+  EXPECT_TRUE(sf2.getBPoseCamLRect().equals(sf->getBPoseCamLRect()));
+  EXPECT_EQ(sf2.getBaseline(), sf->getBaseline());
+  EXPECT_TRUE(UtilsOpenCV::compareCvMatsUpToTol(sf2.getLeftImgRectified(),
+                                                left_image_rectified));
+}
+
+TEST_F(StereoFrameFixture, lazyStereoRectification) {
+  FLAGS_lazy_stereo_rectification = true;
+  FrontendParams tp;
+  StereoFrame sf2(id,
+                  timestamp,
+                  UtilsOpenCV::ReadAndConvertToGrayScale(
+                      stereo_FLAGS_test_data_path + left_image_name,
+                      tp.stereo_matching_params_.equalize_image_),
+                  cam_params_left,
+                  UtilsOpenCV::ReadAndConvertToGrayScale(
+                      stereo_FLAGS_test_data_path + right_image_name,
+                      tp.stereo_matching_params_.equalize_image_),
+                  cam_params_right,
+                  tp.stereo_matching_params_,
+                  sf->getRectification());
+  FLAGS_lazy_stereo_rectification = false;
+  // Rectification parameters are there, but images are not rectified yet.
+  EXPECT_TRUE(sf2.isRectified());
+  EXPECT_TRUE(sf2.left_img_rectified_.empty());
+  EXPECT_TRUE(sf2.right_img_rectified_.empty());
+
+  // Stereo matching rectifies the images first.
+  sf2.sparseStereoMatching();
+  EXPECT_TRUE(UtilsOpenCV::compareCvMatsUpToTol(sf2.left_img_rectified_,
+                                                left_image_rectified));
+  EXPECT_TRUE(UtilsOpenCV::compareCvMatsUpToTol(sf2.right_img_rectified_,
+                                                right_image_rectified));
+}
+
 TEST_F(StereoFrameFixture, findMatchingKeypointRectified) {
   // Synthetic experiments for findMatchingKeypointRectified
 
@@ -478,9 +478,9 @@ TEST_F(StereoVisionFrontEndFixture, DISABLED_processFirstFrame) {
   fake_imu_stamps.setZero(1, 3);
   ImuAccGyrS fake_imu_acc_gyr;
   fake_imu_acc_gyr.setRandom(6, 3);
-  StereoImuSyncPacket input(
-      first_stereo_frame, fake_imu_stamps, fake_imu_acc_gyr);
-  FrontendOutput::UniquePtr output = st.spinOnce(input);
+  FrontendOutput::UniquePtr output =
+      st.spinOnce(VIO::make_unique<StereoImuSyncPacket>(
+          first_stereo_frame, fake_imu_stamps, fake_imu_acc_gyr));
   EXPECT_TRUE(st.isInitialized());
   ASSERT_TRUE(output);
   const StereoFrame& sf = output->stereo_frame_lkf_;
@@ -851,6 +851,69 @@ TEST_F(TestTracker, geometricOutlierRejectionStereo) {
   }
 }
 
+/* ************************************************************************* */
+TEST_F(TestTracker, geometricOutlierRejectionStereoGivenMonoMatches) {
+  CHECK(ref_stereo_frame->isRectified());
+  Rot3 R = Rot3::Expmap(Vector3(0.1, 0.1, 0.1));
+  Vector3 T(ref_stereo_frame->getBaseline(), 0, 0);
+  Pose3 camLeftRef_pose_camLeftCur(R, T);
+  const int inlier_num = 40;
+  const int outlier_num = 20;
+
+  ClearStereoFrame(ref_stereo_frame);
+  ClearStereoFrame(cur_stereo_frame);
+  vector<double> depth_range;
+  depth_range.push_back(camLeftRef_pose_camLeftCur.translation().norm() * 10);
+  depth_range.push_back(camLeftRef_pose_camLeftCur.translation().norm() * 20);
+  AddNonPlanarInliersToStereoFrame(ref_stereo_frame,
+                                   cur_stereo_frame,
+                                   camLeftRef_pose_camLeftCur,
+                                   depth_range,
+                                   inlier_num);
+  AddOutliersToStereoFrame(ref_stereo_frame,
+                           cur_stereo_frame,
+                           camLeftRef_pose_camLeftCur,
+                           depth_range,
+                           outlier_num);
+
+  // Mono matches prior to the mono outlier rejection, which then removes
+  // some landmarks while the stereo outlier rejection runs.
+  KeypointMatches matches_ref_cur_mono;
+  Tracker::findMatchingKeypoints(ref_stereo_frame->getLeftFrame(),
+                                 cur_stereo_frame->getLeftFrame(),
+                                 &matches_ref_cur_mono);
+  const int removed_num = 5;
+  for (int i = 0; i < removed_num; i++) {
+    ref_stereo_frame->getLeftFrameMutable()->landmarks_[i] = -1;
+  }
+
+  FrontendParams trackerParams;
+  trackerParams.ransac_threshold_stereo_ = 0.3;
+  Tracker tracker(trackerParams, CameraParams());
+  TrackingStatus tracking_status;
+  Pose3 estimated_pose;
+  tie(tracking_status, estimated_pose) =
+      tracker.geometricOutlierRejectionStereo(
+          *ref_stereo_frame, *cur_stereo_frame, &matches_ref_cur_mono);
+
+  // The removed landmarks do not change the stereo putatives.
+  EXPECT_EQ(tracker.getTrackerDebugInfo().nrStereoPutatives_,
+            static_cast<size_t>(inlier_num + outlier_num));
+  for (int i = 0; i < inlier_num; i++) {
+    EXPECT_EQ(ref_stereo_frame->right_keypoints_status_[i],
+              KeypointStatus::VALID);
+    EXPECT_EQ(cur_stereo_frame->right_keypoints_status_[i],
+              KeypointStatus::VALID);
+  }
+  for (int i = inlier_num; i < inlier_num + outlier_num; i++) {
+    EXPECT_EQ(ref_stereo_frame->right_keypoints_status_[i],
+              KeypointStatus::FAILED_ARUN);
+    EXPECT_EQ(cur_stereo_frame->right_keypoints_status_[i],
+              KeypointStatus::FAILED_ARUN);
+  }
+  EXPECT_TRUE(assert_equal(T, Vector3(estimated_pose.translation()), 1e-3));
+}
+
 /* ************************************************************************* */
 TEST_F(TestTracker, geometricOutlierRejectionStereoGivenRotation) {
   // Start with the simplest case:
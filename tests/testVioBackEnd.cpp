@@ -342,6 +342,25 @@ TEST_F(BackendFixture, robotMovingWithConstantVelocity) {
       EXPECT_LT((imu_bias_lkf - imu_bias_).vector().norm(), tol);
     }
   }
+
+  // Check the lmks in time horizon, triangulated at the latest estimate.
+  const PointsWithIdMap lmks_in_time_horizon =
+      vio->getMapLmkIdsTo3dPointsInTimeHorizon();
+  ASSERT_EQ(lmks_in_time_horizon.size(), num_pts);
+  for (const auto& lmk_id_point : lmks_in_time_horizon) {
+    ASSERT_LT(static_cast<size_t>(lmk_id_point.first), num_pts);
+    EXPECT_TRUE(
+        assert_equal(pts[lmk_id_point.first], lmk_id_point.second, 1e-4));
+  }
+  // Asking again for the same estimate returns the cached triangulations.
+  const PointsWithIdMap cached_lmks_in_time_horizon =
+      vio->getMapLmkIdsTo3dPointsInTimeHorizon();
+  ASSERT_EQ(cached_lmks_in_time_horizon.size(), num_pts);
+  for (const auto& lmk_id_point : cached_lmks_in_time_horizon) {
+    EXPECT_TRUE(assert_equal(lmks_in_time_horizon.at(lmk_id_point.first),
+                             lmk_id_point.second,
+                             0.0));
+  }
 }
 
 }  // namespace VIO
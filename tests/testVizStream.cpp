@@ -0,0 +1,212 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testVizStream.cpp
+ * @brief  test the visualization stream: messages, deltas and sockets
+ * @author Antoni Rosinol
+ */
+
+#include <unistd.h>
+
+#include <set>
+#include <string>
+#include <utility>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <gtsam/geometry/Pose3.h>
+
+#include "kimera-vio/visualizer/StreamDisplay.h"
+#include "kimera-vio/visualizer/StreamVisualizer3D.h"
+#include "kimera-vio/visualizer/VizStream.h"
+#include "kimera-vio/visualizer/VizStreamSocket.h"
+
+namespace VIO {
+
+namespace {
+
+const float kTolerance = 0.01f;
+
+gtsam::Pose3 somePose(const double& x) {
+  return gtsam::Pose3(gtsam::Rot3::Ypr(0.1, -0.2, x),
+                      gtsam::Point3(x, 2.0, -3.0));
+}
+
+void expectEqualStates(const VizStreamState& expected,
+                       const VizStreamState& actual) {
+  EXPECT_EQ(expected.timestamp(), actual.timestamp());
+  ASSERT_EQ(expected.trajectory().size(), actual.trajectory().size());
+  for (size_t i = 0u; i < expected.trajectory().size(); i++) {
+    EXPECT_EQ(expected.trajectory()[i].timestamp_,
+              actual.trajectory()[i].timestamp_);
+    EXPECT_EQ(expected.trajectory()[i].t_, actual.trajectory()[i].t_);
+    EXPECT_EQ(expected.trajectory()[i].q_, actual.trajectory()[i].q_);
+  }
+  EXPECT_EQ(expected.landmarks(), actual.landmarks());
+  EXPECT_EQ(expected.vertices(), actual.vertices());
+  EXPECT_EQ(expected.triangles(), actual.triangles());
+}
+
+}  // namespace
+
+/* ************************************************************************* */
+TEST(testVizStream, serializeDeserialize) {
+  VizStreamMessage message;
+  message.type_ = VizStreamMessage::Type::kSnapshot;
+  message.timestamp_ = 123456789;
+  message.poses_.push_back(VizStreamPose(1, somePose(0.5)));
+  message.poses_.push_back(VizStreamPose(2, somePose(1.5)));
+  message.landmarks_.push_back(std::make_pair(7, cv::Point3f(1, 2, 3)));
+  message.removed_landmarks_.push_back(8);
+  message.vertices_.push_back(std::make_pair(9, cv::Point3f(4, 5, 6)));
+  message.removed_vertices_.push_back(10);
+  message.triangles_.push_back({{1, 2, 3}});
+  message.removed_triangles_.push_back({{4, 5, 6}});
+
+  // Two messages back to back, as in a socket.
+  std::string buffer;
+  message.serialize(&buffer);
+  const size_t message_size = buffer.size();
+  message.serialize(&buffer);
+  EXPECT_EQ(buffer.size(), 2u * message_size);
+
+  // An incomplete message is not read.
+  const char* data = buffer.data();
+  VizStreamMessage actual;
+  EXPECT_FALSE(
+      VizStreamMessage::deserialize(&data, data + message_size - 1u, &actual));
+  EXPECT_TRUE(data == buffer.data());
+
+  for (size_t i = 0u; i < 2u; i++) {
+    ASSERT_TRUE(VizStreamMessage::deserialize(
+        &data, buffer.data() + buffer.size(), &actual));
+    EXPECT_TRUE(data == buffer.data() + (i + 1u) * message_size);
+    EXPECT_EQ(actual.type_, message.type_);
+    EXPECT_EQ(actual.timestamp_, message.timestamp_);
+    ASSERT_EQ(actual.poses_.size(), 2u);
+    EXPECT_EQ(actual.poses_[1].timestamp_, 2);
+    EXPECT_TRUE(actual.poses_[1].toPose3().equals(somePose(1.5), 1e-5));
+    EXPECT_EQ(actual.landmarks_, message.landmarks_);
+    EXPECT_EQ(actual.removed_landmarks_, message.removed_landmarks_);
+    EXPECT_EQ(actual.vertices_, message.vertices_);
+    EXPECT_EQ(actual.removed_vertices_, message.removed_vertices_);
+    EXPECT_EQ(actual.triangles_, message.triangles_);
+    EXPECT_EQ(actual.removed_triangles_, message.removed_triangles_);
+  }
+}
+
+/* ************************************************************************* */
+TEST(testVizStream, deltasReproduceTheScene) {
+  VizStreamState sender(1);
+  VizStreamState viewer;
+
+  VizStreamPoints landmarks;
+  landmarks[1] = cv::Point3f(0, 0, 1);
+  landmarks[2] = cv::Point3f(0, 1, 1);
+  landmarks[3] = cv::Point3f(1, 1, 1);
+  std::set<VizStreamTriangle> triangles;
+  triangles.insert(VizStreamState::canonicalTriangle({{2, 3, 1}}));
+
+  VizStreamMessage delta;
+  sender.computeDelta(
+      1, VizStreamPose(1, somePose(0.0)), landmarks, landmarks, triangles,
+      kTolerance, &delta);
+  EXPECT_EQ(delta.landmarks_.size(), 3u);
+  EXPECT_EQ(delta.triangles_.size(), 1u);
+  // The winding is kept.
+  EXPECT_EQ(delta.triangles_[0], (VizStreamTriangle{{1, 2, 3}}));
+  sender.apply(delta);
+  viewer.apply(delta);
+
+  // Move a landmark below and one above the tolerance, remove one.
+  landmarks[1].x += 0.5f * kTolerance;
+  landmarks[2].x += 2.0f * kTolerance;
+  landmarks.erase(3);
+  landmarks[4] = cv::Point3f(2, 2, 2);
+  triangles.clear();
+  triangles.insert(VizStreamState::canonicalTriangle({{4, 2, 1}}));
+  sender.computeDelta(
+      2, VizStreamPose(2, somePose(1.0)), landmarks, landmarks, triangles,
+      kTolerance, &delta);
+  ASSERT_EQ(delta.landmarks_.size(), 2u);
+  EXPECT_EQ(delta.removed_landmarks_, LandmarkIds({3}));
+  EXPECT_EQ(delta.triangles_.size(), 1u);
+  EXPECT_EQ(delta.removed_triangles_.size(), 1u);
+  sender.apply(delta);
+  viewer.apply(delta);
+
+  EXPECT_EQ(viewer.trajectory().size(), 2u);
+  EXPECT_EQ(viewer.landmarks().size(), 3u);
+  // Not sent again, within tolerance.
+  EXPECT_EQ(viewer.landmarks().at(1), cv::Point3f(0, 0, 1));
+  EXPECT_EQ(viewer.landmarks().at(2), landmarks[2]);
+  EXPECT_EQ(viewer.triangles().size(), 1u);
+
+  // A new viewer gets the same scene from a snapshot.
+  VizStreamMessage snapshot;
+  viewer.snapshot(&snapshot);
+  VizStreamState new_viewer;
+  new_viewer.apply(delta);
+  new_viewer.apply(snapshot);
+  expectEqualStates(viewer, new_viewer);
+}
+
+/* ************************************************************************* */
+TEST(testVizStream, streamToViewerOverUnixSocket) {
+  const std::string address =
+      "unix:/tmp/kimera_vio_test_viz_" + std::to_string(getpid()) + ".sock";
+  StreamDisplayParams params;
+  params.address_ = address;
+  StreamDisplay display(params);
+
+  VizStreamState sender(1);
+  VizStreamState expected;
+  VizStreamPoints landmarks;
+  auto streamKeyframe = [&](const Timestamp& timestamp) {
+    landmarks[static_cast<LandmarkId>(timestamp)] =
+        cv::Point3f(timestamp, 0, 0);
+    StreamVisualizerOutput::UniquePtr output =
+        VIO::make_unique<StreamVisualizerOutput>();
+    sender.computeDelta(timestamp,
+                        VizStreamPose(timestamp, somePose(timestamp)),
+                        landmarks,
+                        VizStreamPoints(),
+                        std::set<VizStreamTriangle>(),
+                        kTolerance,
+                        &output->message_);
+    sender.apply(output->message_);
+    expected.apply(output->message_);
+    display.spinOnce(std::move(output));
+  };
+
+  // The viewer connects after the first keyframe.
+  streamKeyframe(1);
+  VizStreamClient client;
+  ASSERT_TRUE(client.connect(address));
+  streamKeyframe(2);
+  streamKeyframe(3);
+  // Images are not streamed.
+  display.spinOnce(VIO::make_unique<DisplayInputBase>());
+
+  VizStreamState viewer;
+  VizStreamMessage message;
+  ASSERT_TRUE(client.receive(1000, &message));
+  EXPECT_EQ(message.type_, VizStreamMessage::Type::kSnapshot);
+  EXPECT_EQ(message.poses_.size(), 2u);
+  viewer.apply(message);
+  ASSERT_TRUE(client.receive(1000, &message));
+  EXPECT_EQ(message.type_, VizStreamMessage::Type::kDelta);
+  EXPECT_EQ(message.landmarks_.size(), 1u);
+  viewer.apply(message);
+  EXPECT_FALSE(client.receive(10, &message));
+  expectEqualStates(expected, viewer);
+}
+
+}  // namespace VIO